@@ -0,0 +1,224 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/async_log.h"
+
+#include <chrono>
+#include <utility>
+
+#include "base/metrics.h"
+
+namespace {
+std::atomic<int>& GetLogLevel() {
+  // level set by INIT_LOGGER before loop threads start
+  static std::atomic<int> level(common::logging::CURRENT_LOG_LEVEL());
+  return level;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+LogSite::LogSite(uint32_t per_second, uint32_t sample_interval)
+    : per_second_(per_second),
+      sample_interval_(sample_interval),
+      samples_(0),
+      window_(0),
+      window_count_(0),
+      suppressed_(0) {}
+
+bool LogSite::Admit(common::logging::LOG_LEVEL level) {
+  if (!IsLogLevelEnabled(level)) {
+    return false;
+  }
+
+  if (sample_interval_ > 1 && samples_.fetch_add(1, std::memory_order_relaxed) % sample_interval_ != 0) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (per_second_) {
+    // racing threads may reset window late and let a few extra lines through, that's fine
+    const uint64_t second = GetMonotonicUsec() / 1000000;
+    uint64_t window = window_.load(std::memory_order_relaxed);
+    if (window != second && window_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+      window_count_.store(0, std::memory_order_relaxed);
+    }
+    if (window_count_.fetch_add(1, std::memory_order_relaxed) >= per_second_) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t LogSite::TakeSuppressed() {
+  return suppressed_.exchange(0, std::memory_order_relaxed);
+}
+
+AsyncLogger::Ring::Ring() : entries(), head(0), tail(0), pushing(false) {}
+
+AsyncLogger::AsyncLogger()
+    : running_(false), dropped_(0), reported_dropped_(0), rings_mutex_(), rings_(), stop_(true), writer_() {}
+
+AsyncLogger& AsyncLogger::GetInstance() {
+  static AsyncLogger logger;
+  return logger;
+}
+
+void AsyncLogger::Start() {
+  if (writer_.joinable()) {
+    return;
+  }
+
+  stop_.store(false, std::memory_order_release);
+  writer_ = std::thread(&AsyncLogger::WriteRoutine, this);
+  running_.store(true, std::memory_order_release);
+}
+
+void AsyncLogger::Stop() {
+  if (!writer_.joinable()) {
+    return;
+  }
+
+  running_.store(false);
+  {
+    // producers which saw logger running finish their push, later ones write synchronously
+    std::unique_lock<std::mutex> lock(rings_mutex_);
+    for (size_t i = 0; i < rings_.size(); ++i) {
+      while (rings_[i]->pushing.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  stop_.store(true, std::memory_order_release);
+  writer_.join();
+  // lines pushed while writer was stopping
+  DrainRings();
+}
+
+void AsyncLogger::Push(common::logging::LOG_LEVEL level, std::string&& line) {
+  Ring* ring = GetThreadRing();
+  // sequentially consistent pair with Stop: either running is seen cleared here,
+  // or Stop sees pushing set and waits with final drain until entry is published
+  ring->pushing.store(true);
+  if (!running_.load()) {
+    ring->pushing.store(false, std::memory_order_release);
+    RUNTIME_LOG(level) << line;
+    return;
+  }
+
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= ring_size) {
+    ring->pushing.store(false, std::memory_order_release);
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Entry& entry = ring->entries[head % ring_size];
+  entry.level = level;
+  entry.line = std::move(line);
+  ring->head.store(head + 1, std::memory_order_release);
+  ring->pushing.store(false, std::memory_order_release);
+}
+
+uint64_t AsyncLogger::GetDropped() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+AsyncLogger::Ring* AsyncLogger::GetThreadRing() {
+  thread_local std::shared_ptr<Ring> ring;
+  if (!ring) {
+    ring = std::make_shared<Ring>();
+    std::unique_lock<std::mutex> lock(rings_mutex_);
+    rings_.push_back(ring);
+  }
+  return ring.get();
+}
+
+void AsyncLogger::WriteRoutine() {
+  while (!stop_.load(std::memory_order_acquire)) {
+    if (!DrainRings()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(write_interval_msec));
+    }
+  }
+}
+
+size_t AsyncLogger::DrainRings() {
+  std::vector<std::shared_ptr<Ring>> rings;
+  {
+    std::unique_lock<std::mutex> lock(rings_mutex_);
+    // rings of exited threads are owned by registry only
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      Ring* ring = it->get();
+      if (it->use_count() == 1 &&
+          ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed)) {
+        it = rings_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    rings = rings_;
+  }
+
+  size_t written = 0;
+  for (size_t i = 0; i < rings.size(); ++i) {
+    Ring* ring = rings[i].get();
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    for (; tail != head; ++tail) {
+      Entry& entry = ring->entries[tail % ring_size];
+      const std::string line = std::move(entry.line);
+      RUNTIME_LOG(entry.level) << line;
+      written++;
+    }
+    ring->tail.store(tail, std::memory_order_release);
+  }
+
+  const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped != reported_dropped_) {
+    WARNING_LOG() << "Dropped " << dropped - reported_dropped_ << " log lines, writer can't keep up";
+    reported_dropped_ = dropped;
+  }
+  return written;
+}
+
+AsyncLogMessage::AsyncLogMessage(common::logging::LOG_LEVEL level, LogSite* site)
+    : level_(level), site_(site), stream_() {}
+
+AsyncLogMessage::~AsyncLogMessage() {
+  const uint64_t suppressed = site_ ? site_->TakeSuppressed() : 0;
+  if (suppressed) {
+    stream_ << " (" << suppressed << " similar lines suppressed)";
+  }
+  AsyncLogger::GetInstance().Push(level_, stream_.str());
+}
+
+std::ostream& AsyncLogMessage::Stream() {
+  return stream_;
+}
+
+void SetLogLevel(common::logging::LOG_LEVEL level) {
+  common::logging::SET_CURRENT_LOG_LEVEL(level);
+  GetLogLevel().store(level, std::memory_order_relaxed);
+}
+
+bool IsLogLevelEnabled(common::logging::LOG_LEVEL level) {
+  return level <= GetLogLevel().load(std::memory_order_relaxed);
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,153 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/logging.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Per call site limits, shared by all threads which reach it. Every sample_interval line is taken,
+// of those at most per_second are written in one second, 0 disables a limit.
+// Skipped lines are counted and reported with next written one.
+class LogSite {
+ public:
+  LogSite(uint32_t per_second, uint32_t sample_interval);
+
+  bool Admit(common::logging::LOG_LEVEL level);
+  uint64_t TakeSuppressed();
+
+ private:
+  const uint32_t per_second_;
+  const uint32_t sample_interval_;
+  std::atomic<uint64_t> samples_;
+  std::atomic<uint64_t> window_;  // current second, monotonic
+  std::atomic<uint32_t> window_count_;
+  std::atomic<uint64_t> suppressed_;
+};
+
+// Lines are formatted on calling thread and pushed into its own ring without locks,
+// writer thread passes them to common logger every few msec. Lines which don't fit are dropped and reported.
+// Before Start and after Stop lines are written synchronously.
+class AsyncLogger {
+ public:
+  enum : size_t { ring_size = 4096 };
+  enum : uint32_t { write_interval_msec = 10 };
+
+  static AsyncLogger& GetInstance();
+
+  void Start();
+  // writes what is left in rings
+  void Stop();
+
+  void Push(common::logging::LOG_LEVEL level, std::string&& line);
+
+  uint64_t GetDropped() const;
+
+ private:
+  struct Entry {
+    common::logging::LOG_LEVEL level;
+    std::string line;
+  };
+  // single producer single consumer ring, producer is owning thread, consumer is writer
+  struct Ring {
+    Ring();
+
+    Entry entries[ring_size];
+    std::atomic<uint64_t> head;  // written by producer
+    std::atomic<uint64_t> tail;  // written by consumer
+    std::atomic<bool> pushing;   // producer is between running check and publishing its entry
+  };
+
+  AsyncLogger();
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  Ring* GetThreadRing();
+  void WriteRoutine();
+  size_t DrainRings();
+
+  std::atomic<bool> running_;
+  std::atomic<uint64_t> dropped_;
+  uint64_t reported_dropped_;
+
+  std::mutex rings_mutex_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+  std::atomic<bool> stop_;
+  std::thread writer_;
+};
+
+class AsyncLogMessage {
+ public:
+  AsyncLogMessage(common::logging::LOG_LEVEL level, LogSite* site);
+  ~AsyncLogMessage();
+
+  std::ostream& Stream();
+
+ private:
+  AsyncLogMessage(const AsyncLogMessage&) = delete;
+  AsyncLogMessage& operator=(const AsyncLogMessage&) = delete;
+
+  const common::logging::LOG_LEVEL level_;
+  LogSite* const site_;
+  std::ostringstream stream_;
+};
+
+// level of common logger is a plain global, loop threads check an atomic copy of it instead;
+// change level at runtime only with SetLogLevel, which updates both
+void SetLogLevel(common::logging::LOG_LEVEL level);
+bool IsLogLevelEnabled(common::logging::LOG_LEVEL level);
+
+struct AsyncLogVoidify {
+  void operator&(std::ostream&) {}
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
+
+// streamed values are evaluated only if line is going to be written
+#define ASYNC_LOG(LEVEL)                                \
+  !fastocloud::server::base::IsLogLevelEnabled(LEVEL) \
+      ? (void)0                                         \
+      : fastocloud::server::base::AsyncLogVoidify() & fastocloud::server::base::AsyncLogMessage(LEVEL, nullptr).Stream()
+
+// every expansion owns its site, so limits apply per call site
+#define ASYNC_LOG_SITE(LEVEL, PER_SECOND, SAMPLE_INTERVAL)                                                     \
+  for (fastocloud::server::base::LogSite* log_site = []() {                                                    \
+         static fastocloud::server::base::LogSite site(PER_SECOND, SAMPLE_INTERVAL);                           \
+         return &site;                                                                                         \
+       }();                                                                                                    \
+       log_site && log_site->Admit(LEVEL); log_site = nullptr)                                                 \
+  fastocloud::server::base::AsyncLogMessage(LEVEL, log_site).Stream()
+
+#define ASYNC_DEBUG_LOG() ASYNC_LOG(common::logging::LOG_LEVEL_DEBUG)
+#define ASYNC_INFO_LOG() ASYNC_LOG(common::logging::LOG_LEVEL_INFO)
+#define ASYNC_WARNING_LOG() ASYNC_LOG(common::logging::LOG_LEVEL_WARNING)
+
+#define LIMITED_DEBUG_LOG(PER_SECOND) ASYNC_LOG_SITE(common::logging::LOG_LEVEL_DEBUG, PER_SECOND, 1)
+#define LIMITED_INFO_LOG(PER_SECOND) ASYNC_LOG_SITE(common::logging::LOG_LEVEL_INFO, PER_SECOND, 1)
+#define LIMITED_WARNING_LOG(PER_SECOND) ASYNC_LOG_SITE(common::logging::LOG_LEVEL_WARNING, PER_SECOND, 1)
@@ -0,0 +1,425 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/edge_registry.h"
+
+#include <ctype.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include <common/convert2string.h>
+
+#include "base/metrics.h"
+
+namespace {
+const char kLeastConnections[] = "least_connections";
+const char kResponseTime[] = "response_time";
+const char kOtherEdges[] = "other";
+
+// fnv-1a with murmur finalizer, virtual nodes of similar ids spread over whole ring
+uint64_t HashKey(const std::string& key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < key.size(); ++i) {
+    hash ^= static_cast<uint8_t>(key[i]);
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+EdgeNode::EdgeNode()
+    : id(), url(), capacity(0), weight(1), connections(0), response_time(0), last_report(0), healthy(true) {}
+
+bool EdgeNode::IsValid() const {
+  return !id.empty() && !url.empty();
+}
+
+std::string GetUrlOrigin(const std::string& url) {
+  const size_t scheme_end = url.find("://");
+  if (scheme_end == std::string::npos || scheme_end == 0) {
+    return std::string();
+  }
+
+  const size_t origin_end = url.find_first_of("/?#", scheme_end + 3);
+  std::string result = url.substr(0, origin_end);
+  if (result.size() == scheme_end + 3) {
+    return std::string();
+  }
+  std::transform(result.begin(), result.end(), result.begin(),
+                 [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+  return result;
+}
+
+std::string ReplaceUrlOrigin(const std::string& url, const std::string& origin) {
+  const size_t scheme_end = url.find("://");
+  if (scheme_end == std::string::npos) {
+    return url;
+  }
+
+  std::string result = origin;
+  while (!result.empty() && result[result.size() - 1] == '/') {
+    result.erase(result.size() - 1);
+  }
+  const size_t path_start = url.find('/', scheme_end + 3);
+  if (path_start != std::string::npos) {
+    result += url.substr(path_start);
+  }
+  return result;
+}
+
+std::vector<EdgeNode> ParseStaticEdges(const std::string& text) {
+  std::vector<EdgeNode> result;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+
+    const std::string entry = text.substr(start, end - start);
+    start = end + 1;
+    EdgeNode node;
+    const size_t separator = entry.find(';');
+    node.url = entry.substr(0, separator);
+    node.id = node.url;
+    if (separator != std::string::npos && !common::ConvertFromString(entry.substr(separator + 1), &node.capacity)) {
+      continue;
+    }
+    if (node.IsValid()) {
+      result.push_back(node);
+    }
+  }
+  return result;
+}
+
+std::vector<std::string> ParseEdgeOrigins(const std::string& text) {
+  std::vector<std::string> result;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+
+    const std::string origin = GetUrlOrigin(text.substr(start, end - start));
+    start = end + 1;
+    if (!origin.empty()) {
+      result.push_back(origin);
+    }
+  }
+  return result;
+}
+
+EdgeRegistry::EdgeRegistry(BalanceStrategy strategy,
+                           uint32_t load_factor,
+                           uint32_t report_timeout,
+                           const std::vector<std::string>& origins)
+    : strategy_(strategy),
+      load_factor_(load_factor > 100 ? static_cast<double>(load_factor) / 100.0 : 1.0),
+      report_timeout_(static_cast<common::time64_t>(report_timeout) * 1000),
+      origins_(origins),
+      mutex_(),
+      edges_(),
+      ring_(),
+      metric_ids_(),
+      last_decay_msec_(0) {}
+
+bool EdgeRegistry::IsBalancedUrl(const std::string& url) const {
+  const std::string origin = GetUrlOrigin(url);
+  return !origin.empty() && std::find(origins_.begin(), origins_.end(), origin) != origins_.end();
+}
+
+void EdgeRegistry::AddStatic(const EdgeNode& node) {
+  if (!node.IsValid()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    if (edges_[i].node.id == node.id) {
+      return;
+    }
+  }
+  EdgeNode static_node = node;
+  static_node.last_report = 0;
+  AddEdge(static_node);
+  RebuildRing();
+}
+
+bool EdgeRegistry::Report(const EdgeNode& report, common::time64_t now_msec) {
+  if (!report.IsValid()) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  Edge* edge = nullptr;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    if (edges_[i].node.id == report.id) {
+      edge = &edges_[i];
+      break;
+    }
+  }
+
+  if (!edge) {
+    if (edges_.size() >= max_edges) {
+      return false;
+    }
+    EdgeNode node = report;
+    node.last_report = now_msec;
+    AddEdge(node);
+    RebuildRing();
+    return true;
+  }
+
+  const bool ring_changed = edge->node.healthy != report.healthy || edge->node.weight != report.weight;
+  edge->node.url = report.url;
+  edge->node.capacity = report.capacity;
+  edge->node.weight = report.weight;
+  edge->node.connections = report.connections;
+  edge->node.response_time = report.response_time;
+  edge->node.healthy = report.healthy;
+  edge->node.last_report = now_msec;
+  edge->assigned = 0;
+  if (ring_changed) {
+    RebuildRing();
+  }
+  return true;
+}
+
+void EdgeRegistry::Expire(common::time64_t now_msec) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool ring_changed = false;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    EdgeNode& node = edges_[i].node;
+    if (node.healthy && node.last_report && now_msec - node.last_report > report_timeout_) {
+      node.healthy = false;
+      ring_changed = true;
+    }
+  }
+
+  const common::time64_t forget_timeout = report_timeout_ * forget_timeouts;
+  const size_t edges_count = edges_.size();
+  edges_.erase(std::remove_if(edges_.begin(), edges_.end(),
+                              [now_msec, forget_timeout](const Edge& edge) {
+                                return edge.node.last_report && now_msec - edge.node.last_report > forget_timeout;
+                              }),
+               edges_.end());
+  if (edges_.size() != edges_count) {
+    ring_changed = true;
+  }
+
+  // edges which never report are loaded only by our redirects, let viewers which left fade out
+  if (now_msec - last_decay_msec_ >= report_timeout_) {
+    last_decay_msec_ = now_msec;
+    for (size_t i = 0; i < edges_.size(); ++i) {
+      if (!edges_[i].node.last_report) {
+        edges_[i].assigned /= 2;
+      }
+    }
+  }
+
+  if (ring_changed) {
+    RebuildRing();
+  }
+}
+
+bool EdgeRegistry::SelectEdge(const std::string& key, EdgeNode* edge) {
+  if (!edge) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (ring_.empty()) {
+    return false;
+  }
+
+  const uint32_t default_response_time = GetAverageResponseTime();
+  size_t healthy = 0;
+  double total_load = 0;
+  double total_share = 0;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    const Edge& cur = edges_[i];
+    if (cur.node.healthy) {
+      healthy++;
+      total_load += cur.node.connections + cur.assigned;
+      total_share += GetShare(cur, default_response_time);
+    }
+  }
+
+  Edge* selected = nullptr;
+  std::vector<bool> checked(edges_.size(), false);
+  size_t checked_count = 0;
+  const uint64_t hash = HashKey(key);
+  size_t pos = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(hash, static_cast<size_t>(0))) -
+               ring_.begin();
+  for (size_t step = 0; step < ring_.size() && checked_count < healthy; ++step, ++pos) {
+    const size_t index = ring_[pos % ring_.size()].second;
+    if (checked[index]) {
+      continue;
+    }
+    checked[index] = true;
+    checked_count++;
+
+    Edge& cur = edges_[index];
+    const double load = cur.node.connections + cur.assigned;
+    const double bound = ceil(load_factor_ * (total_load + 1) * GetShare(cur, default_response_time) / total_share);
+    if (HasRoom(cur) && load + 1 <= bound) {
+      selected = &cur;
+      break;
+    }
+  }
+
+  if (!selected) {
+    // every edge is over its bound, take the least loaded one relative to its share
+    double best_cost = 0;
+    for (size_t i = 0; i < edges_.size(); ++i) {
+      Edge& cur = edges_[i];
+      if (!cur.node.healthy || !HasRoom(cur)) {
+        continue;
+      }
+
+      const double cost = (cur.node.connections + cur.assigned + 1) / GetShare(cur, default_response_time);
+      if (!selected || cost < best_cost) {
+        selected = &cur;
+        best_cost = cost;
+      }
+    }
+  }
+
+  if (!selected) {
+    return false;
+  }
+
+  selected->assigned++;
+  selected->redirects->Increment();
+  *edge = selected->node;
+  return true;
+}
+
+std::vector<EdgeNode> EdgeRegistry::GetEdges() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<EdgeNode> result;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    result.push_back(edges_[i].node);
+  }
+  return result;
+}
+
+double EdgeRegistry::GetShare(const Edge& edge, uint32_t default_response_time) const {
+  const uint32_t weight = std::min<uint32_t>(std::max<uint32_t>(edge.node.weight, 1), max_weight);
+  if (strategy_ != RESPONSE_TIME) {
+    return weight;
+  }
+
+  const uint32_t response_time = edge.node.response_time ? edge.node.response_time : default_response_time;
+  if (!response_time) {
+    return weight;
+  }
+  return static_cast<double>(weight) / response_time;
+}
+
+uint32_t EdgeRegistry::GetAverageResponseTime() const {
+  if (strategy_ != RESPONSE_TIME) {
+    return 0;
+  }
+
+  uint64_t total = 0;
+  uint64_t count = 0;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    const EdgeNode& node = edges_[i].node;
+    if (node.healthy && node.response_time) {
+      total += node.response_time;
+      count++;
+    }
+  }
+  return count ? static_cast<uint32_t>(total / count) : 0;
+}
+
+bool EdgeRegistry::HasRoom(const Edge& edge) {
+  return !edge.node.capacity || edge.node.connections + edge.assigned < edge.node.capacity;
+}
+
+void EdgeRegistry::AddEdge(const EdgeNode& node) {
+  Edge edge;
+  edge.node = node;
+  edge.assigned = 0;
+  edge.redirects = GetRedirectsMetric(node.id);
+  edges_.push_back(edge);
+}
+
+MetricCounter* EdgeRegistry::GetRedirectsMetric(const std::string& id) {
+  std::string label = id;
+  if (metric_ids_.find(id) == metric_ids_.end()) {
+    if (metric_ids_.size() < max_edges) {
+      metric_ids_.insert(id);
+    } else {
+      label = kOtherEdges;
+    }
+  }
+  return MetricsRegistry::GetInstance().GetCounter("fastocloud_edge_redirects_total",
+                                                   "Proxy stream viewers redirected to edge.",
+                                                   MakeMetricLabel("edge", label));
+}
+
+void EdgeRegistry::RebuildRing() {
+  ring_.clear();
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    const EdgeNode& node = edges_[i].node;
+    if (!node.healthy) {
+      continue;
+    }
+
+    const uint32_t weight = std::min<uint32_t>(std::max<uint32_t>(node.weight, 1), max_weight);
+    for (uint32_t j = 0; j < virtual_nodes * weight; ++j) {
+      ring_.push_back(std::make_pair(HashKey(node.id + "#" + common::ConvertToString(j)), i));
+    }
+  }
+  std::sort(ring_.begin(), ring_.end());
+}
+
+const char* BalanceStrategyToString(EdgeRegistry::BalanceStrategy strategy) {
+  if (strategy == EdgeRegistry::RESPONSE_TIME) {
+    return kResponseTime;
+  }
+  return kLeastConnections;
+}
+
+bool BalanceStrategyFromString(const std::string& text, EdgeRegistry::BalanceStrategy* strategy) {
+  if (!strategy) {
+    return false;
+  }
+
+  if (text == kLeastConnections) {
+    *strategy = EdgeRegistry::LEAST_CONNECTIONS;
+    return true;
+  } else if (text == kResponseTime) {
+    *strategy = EdgeRegistry::RESPONSE_TIME;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,129 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <common/time.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+class MetricCounter;
+
+struct EdgeNode {
+  EdgeNode();
+
+  bool IsValid() const;
+
+  std::string id;
+  std::string url;               // origin of edge, scheme://host[:port]
+  uint32_t capacity;             // viewers, 0 unlimited
+  uint32_t weight;               // relative share of streams
+  uint32_t connections;          // viewers reported by edge
+  uint32_t response_time;        // msec, reported by edge, 0 unknown
+  common::time64_t last_report;  // utc msec, 0 for static edge which never reported
+  bool healthy;
+};
+
+// scheme://host[:port] of url in lower case, empty if url has no scheme
+std::string GetUrlOrigin(const std::string& url);
+// replaces scheme, host and port of url with origin, path and query are kept
+std::string ReplaceUrlOrigin(const std::string& url, const std::string& origin);
+// comma separated origins, invalid entries are skipped
+std::vector<std::string> ParseEdgeOrigins(const std::string& text);
+// comma separated url[;capacity] entries, url is id of edge, invalid entries are skipped
+std::vector<EdgeNode> ParseStaticEdges(const std::string& text);
+
+// Edge nodes proxy streams are redirected to, configured statically or reported by daemon clients.
+// Edges mirror configured origins, only streams served from one of them are redirected, path and query
+// of stream url are kept and its origin is replaced with edge url.
+// Stream is mapped with consistent hashing with bounded loads: first edge clockwise from hash of stream
+// on a ring of virtual nodes whose load stays under load factor times its fair share, so viewers of one
+// stream keep hitting warm cache of one edge until it gets hot, and edges leaving move only their streams.
+// Fair share is proportional to weight, or to weight over response time for response time balancing.
+// Thread safe, daemon loop reports and http loop selects.
+class EdgeRegistry {
+ public:
+  enum BalanceStrategy { LEAST_CONNECTIONS = 0, RESPONSE_TIME };
+  enum {
+    virtual_nodes = 64,
+    max_weight = 16,
+    max_edges = 64,       // static and learned, reports of new ids are refused over it
+    forget_timeouts = 10  // learned edges silent for this many report timeouts are removed
+  };
+
+  // load factor in percent, must be over 100; learned edges without report for timeout sec become unhealthy
+  EdgeRegistry(BalanceStrategy strategy,
+               uint32_t load_factor,
+               uint32_t report_timeout,
+               const std::vector<std::string>& origins);
+
+  // true if url is served from origin mirrored by edges
+  bool IsBalancedUrl(const std::string& url) const;
+
+  void AddStatic(const EdgeNode& node);
+  // unknown ids are added, reported connections replace redirects counted since previous report;
+  // false if id is unknown and registry is full
+  bool Report(const EdgeNode& report, common::time64_t now_msec);
+  // should be called periodically
+  void Expire(common::time64_t now_msec);
+
+  // false if there are no healthy edges with free capacity
+  bool SelectEdge(const std::string& key, EdgeNode* edge);
+  std::vector<EdgeNode> GetEdges() const;
+
+ private:
+  struct Edge {
+    EdgeNode node;
+    uint32_t assigned;  // redirects since last report
+    MetricCounter* redirects;
+  };
+  typedef std::vector<std::pair<uint64_t, size_t>> ring_t;
+
+  // edges without response time report count with average of reporting ones, weight only if none reports
+  double GetShare(const Edge& edge, uint32_t default_response_time) const;
+  uint32_t GetAverageResponseTime() const;
+  static bool HasRoom(const Edge& edge);
+  void AddEdge(const EdgeNode& node);
+  // label per edge id up to max_edges ids, later ids share one, so reconnecting edges can't grow label set
+  MetricCounter* GetRedirectsMetric(const std::string& id);
+  void RebuildRing();
+
+  const BalanceStrategy strategy_;
+  const double load_factor_;
+  const common::time64_t report_timeout_;
+  const std::vector<std::string> origins_;
+
+  mutable std::mutex mutex_;
+  std::vector<Edge> edges_;  // ring refers edges by index, rebuilt when edge is removed
+  ring_t ring_;
+  std::set<std::string> metric_ids_;
+  common::time64_t last_decay_msec_;
+};
+
+const char* BalanceStrategyToString(EdgeRegistry::BalanceStrategy strategy);
+bool BalanceStrategyFromString(const std::string& text, EdgeRegistry::BalanceStrategy* strategy);
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
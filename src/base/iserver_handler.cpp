@@ -14,11 +14,17 @@
 
 #include "base/iserver_handler.h"
 
+#include "base/metrics.h"
+
 namespace fastocloud {
 namespace server {
 namespace base {
 
-IServerHandler::IServerHandler() : online_clients_(0) {}
+IServerHandler::IServerHandler(const std::string& loop_name)
+    : online_clients_(0),
+      connections_(MetricsRegistry::GetInstance().GetGauge("fastocloud_connections",
+                                                           "Connected clients per loop.",
+                                                           MakeMetricLabel("loop", loop_name))) {}
 
 size_t IServerHandler::GetOnlineClients() const {
   return online_clients_;
@@ -27,17 +33,20 @@ size_t IServerHandler::GetOnlineClients() const {
 void IServerHandler::Accepted(common::libev::IoClient* client) {
   UNUSED(client);
   online_clients_++;
+  connections_->Add(1);
 }
 
 void IServerHandler::Closed(common::libev::IoClient* client) {
   UNUSED(client);
   online_clients_--;
+  connections_->Add(-1);
 }
 
 void IServerHandler::Moved(common::libev::IoLoop* server, common::libev::IoClient* client) {
   UNUSED(server);
   UNUSED(client);
   online_clients_--;
+  connections_->Add(-1);
 }
 
 }  // namespace base
@@ -14,16 +14,21 @@
 
 #pragma once
 
+#include <string>
+
 #include <common/libev/io_loop_observer.h>
 
 namespace fastocloud {
 namespace server {
 namespace base {
 
+class MetricGauge;
+
 class IServerHandler : public common::libev::IoLoopObserver {
  public:
   typedef std::atomic<size_t> online_clients_t;
-  IServerHandler();
+  // loop name labels connections gauge of metrics
+  explicit IServerHandler(const std::string& loop_name);
 
   size_t GetOnlineClients() const;
 
@@ -33,6 +38,7 @@ class IServerHandler : public common::libev::IoLoopObserver {
 
  private:
   online_clients_t online_clients_;
+  MetricGauge* const connections_;
 };
 
 }  // namespace base
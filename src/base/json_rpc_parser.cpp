@@ -0,0 +1,135 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/json_rpc_parser.h"
+
+#include <string.h>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#define JSONRPC_ID_FIELD "id"
+#define JSONRPC_METHOD_FIELD "method"
+#define JSONRPC_PARAMS_FIELD "params"
+#define JSONRPC_RESULT_FIELD "result"
+#define JSONRPC_ERROR_FIELD "error"
+#define JSONRPC_ERROR_MESSAGE_FIELD "message"
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+JsonRpcFrame::JsonRpcFrame() : id(), method(nullptr), params(nullptr), result(nullptr), error(nullptr) {}
+
+bool JsonRpcFrame::IsRequest() const {
+  return method != nullptr;
+}
+
+bool JsonRpcFrame::IsResponse() const {
+  return !method;
+}
+
+bool JsonRpcFrame::IsMethod(const char* name) const {
+  return method && strcmp(method, name) == 0;
+}
+
+bool JsonRpcFrame::IsMessage() const {
+  return !method && !error;
+}
+
+bool JsonRpcFrame::IsError() const {
+  return error != nullptr;
+}
+
+std::string JsonRpcFrame::GetErrorDescription() const {
+  if (!error) {
+    return std::string();
+  }
+
+  json_object* jmessage = nullptr;
+  if (json_object_object_get_ex(error, JSONRPC_ERROR_MESSAGE_FIELD, &jmessage)) {
+    return json_object_get_string(jmessage);
+  }
+  return json_object_to_json_string_ext(error, JSON_C_TO_STRING_PLAIN);
+}
+
+fastotv::protocol::response_t JsonRpcFrame::MakeResponse() const {
+  if (!error) {
+    const std::string result_str = json_object_to_json_string_ext(result, JSON_C_TO_STRING_PLAIN);
+    return fastotv::protocol::response_t::MakeMessage(
+        id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage(result_str));
+  }
+
+  return fastotv::protocol::response_t::MakeError(
+      id, common::protocols::json_rpc::JsonRPCError::MakeServerErrorFromText(GetErrorDescription()));
+}
+
+JsonRpcParser::JsonRpcParser() : tokener_(json_tokener_new()), root_(nullptr) {}
+
+JsonRpcParser::~JsonRpcParser() {
+  ReleaseRoot();
+  json_tokener_free(tokener_);
+}
+
+common::Error JsonRpcParser::Parse(const std::string& data, JsonRpcFrame* frame) {
+  if (!frame || data.empty()) {
+    return common::make_error_inval();
+  }
+
+  ReleaseRoot();
+  *frame = JsonRpcFrame();
+  json_tokener_reset(tokener_);
+  root_ = json_tokener_parse_ex(tokener_, data.c_str(), data.size());
+  if (!root_) {
+    return common::make_error(json_tokener_error_desc(json_tokener_get_error(tokener_)));
+  }
+
+  if (!json_object_is_type(root_, json_type_object)) {
+    return common::make_error("Json-rpc message should be an object");
+  }
+
+  json_object* jid = nullptr;
+  if (json_object_object_get_ex(root_, JSONRPC_ID_FIELD, &jid) && !json_object_is_type(jid, json_type_null)) {
+    // fastotv ids are strings, numbers are accepted as their textual form
+    frame->id = fastotv::protocol::sequance_id_t(std::string(json_object_get_string(jid)));
+  }
+
+  json_object* jmethod = nullptr;
+  if (json_object_object_get_ex(root_, JSONRPC_METHOD_FIELD, &jmethod)) {
+    if (!json_object_is_type(jmethod, json_type_string)) {
+      return common::make_error("Json-rpc method should be a string");
+    }
+    frame->method = json_object_get_string(jmethod);
+    json_object_object_get_ex(root_, JSONRPC_PARAMS_FIELD, &frame->params);
+    return common::Error();
+  }
+
+  const bool has_result = json_object_object_get_ex(root_, JSONRPC_RESULT_FIELD, &frame->result);
+  json_object_object_get_ex(root_, JSONRPC_ERROR_FIELD, &frame->error);
+  if (!has_result && !frame->error) {
+    return common::make_error("Invalid json-rpc message");
+  }
+  return common::Error();
+}
+
+void JsonRpcParser::ReleaseRoot() {
+  if (root_) {
+    json_object_put(root_);
+    root_ = nullptr;
+  }
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,74 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+#include <common/error.h>
+
+#include <fastotv/protocol/types.h>
+
+struct json_object;
+struct json_tokener;
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// View of a parsed json-rpc frame, json objects are owned by the parser
+// and stay valid until its next Parse call.
+struct JsonRpcFrame {
+  JsonRpcFrame();
+
+  bool IsRequest() const;
+  bool IsResponse() const;
+  bool IsMethod(const char* name) const;
+
+  // response helpers
+  bool IsMessage() const;
+  bool IsError() const;
+  std::string GetErrorDescription() const;
+  // builds protocol response for callbacks registered by WriteRequest
+  fastotv::protocol::response_t MakeResponse() const;
+
+  fastotv::protocol::sequance_id_t id;
+  const char* method;
+  json_object* params;
+  json_object* result;
+  json_object* error;
+};
+
+// One per loop: keeps the tokener between frames and parses every frame only once,
+// handlers deserialize commands_info types straight from the params object.
+class JsonRpcParser {
+ public:
+  JsonRpcParser();
+  ~JsonRpcParser();
+
+  common::Error Parse(const std::string& data, JsonRpcFrame* frame) WARN_UNUSED_RESULT;
+
+ private:
+  JsonRpcParser(const JsonRpcParser&) = delete;
+  JsonRpcParser& operator=(const JsonRpcParser&) = delete;
+
+  void ReleaseRoot();
+
+  json_tokener* tokener_;
+  json_object* root_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
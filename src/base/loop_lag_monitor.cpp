@@ -0,0 +1,100 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/loop_lag_monitor.h"
+
+#include <common/logging.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+LoopLagMonitor::LoopLagMonitor(const std::string& name, uint32_t degraded_threshold, uint32_t overloaded_threshold)
+    : name_(name),
+      degraded_threshold_(degraded_threshold),
+      overloaded_threshold_(overloaded_threshold < degraded_threshold ? degraded_threshold : overloaded_threshold),
+      last_check_msec_(0),
+      lag_(0),
+      max_lag_(0),
+      level_(NORMAL_LOAD) {}
+
+void LoopLagMonitor::Start(common::time64_t now_msec) {
+  last_check_msec_ = now_msec;
+  lag_ = 0;
+  level_ = NORMAL_LOAD;
+}
+
+bool LoopLagMonitor::Check(common::time64_t now_msec, common::time64_t oldest_callback_age_msec) {
+  const common::time64_t expected = last_check_msec_ + check_interval_seconds * 1000;
+  const common::time64_t drift = now_msec > expected ? now_msec - expected : 0;
+  last_check_msec_ = now_msec;
+
+  lag_ = drift > oldest_callback_age_msec ? drift : oldest_callback_age_msec;
+  if (lag_ > max_lag_) {
+    max_lag_ = lag_;
+  }
+
+  const LoadLevel level = CalcLoadLevel(lag_);
+  if (level == level_) {
+    return false;
+  }
+
+  WARNING_LOG() << "Loop " << name_ << " load changed: " << LoadLevelToString(level_) << " -> "
+                << LoadLevelToString(level) << ", lag: " << lag_ << " msec.";
+  level_ = level;
+  return true;
+}
+
+common::time64_t LoopLagMonitor::GetLag() const {
+  return lag_;
+}
+
+common::time64_t LoopLagMonitor::GetMaxLag() const {
+  return max_lag_;
+}
+
+LoopLagMonitor::LoadLevel LoopLagMonitor::GetLoadLevel() const {
+  return level_;
+}
+
+LoopLagMonitor::LoadLevel LoopLagMonitor::CalcLoadLevel(common::time64_t lag) const {
+  if (lag >= overloaded_threshold_) {
+    return OVERLOADED;
+  }
+  if (lag >= degraded_threshold_) {
+    return level_ == OVERLOADED && lag >= overloaded_threshold_ / 2 ? OVERLOADED : DEGRADED_LOAD;
+  }
+
+  // hysteresis, keep current level until lag drops under half of its threshold
+  if (level_ == OVERLOADED && lag >= overloaded_threshold_ / 2) {
+    return OVERLOADED;
+  }
+  if (level_ != NORMAL_LOAD && lag >= degraded_threshold_ / 2) {
+    return DEGRADED_LOAD;
+  }
+  return NORMAL_LOAD;
+}
+
+const char* LoadLevelToString(LoopLagMonitor::LoadLevel level) {
+  if (level == LoopLagMonitor::OVERLOADED) {
+    return "overloaded";
+  } else if (level == LoopLagMonitor::DEGRADED_LOAD) {
+    return "degraded";
+  }
+  return "normal";
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,63 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include <common/time.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Measures how late periodic timer of loop fires, together with age of the oldest
+// callback queued in that loop, and maps it to load level with hysteresis.
+class LoopLagMonitor {
+ public:
+  enum LoadLevel { NORMAL_LOAD = 0, DEGRADED_LOAD, OVERLOADED };
+  enum { check_interval_seconds = 1 };
+
+  // thresholds in msec, level is left when lag drops under half of its threshold,
+  // now_msec is monotonic, wall clock steps would read as lag
+  LoopLagMonitor(const std::string& name, uint32_t degraded_threshold, uint32_t overloaded_threshold);
+
+  void Start(common::time64_t now_msec);
+  // should be called from timer with check_interval_seconds period, returns true if level changed
+  bool Check(common::time64_t now_msec, common::time64_t oldest_callback_age_msec);
+
+  common::time64_t GetLag() const;
+  common::time64_t GetMaxLag() const;
+  LoadLevel GetLoadLevel() const;
+
+ private:
+  LoadLevel CalcLoadLevel(common::time64_t lag) const;
+
+  const std::string name_;
+  const common::time64_t degraded_threshold_;
+  const common::time64_t overloaded_threshold_;
+
+  common::time64_t last_check_msec_;
+  common::time64_t lag_;
+  common::time64_t max_lag_;
+  LoadLevel level_;
+};
+
+const char* LoadLevelToString(LoopLagMonitor::LoadLevel level);
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
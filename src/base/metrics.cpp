@@ -0,0 +1,344 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/metrics.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <utility>
+
+#include <common/macros.h>
+
+namespace {
+std::atomic<size_t> g_next_shard(0);
+
+size_t GetThreadShard() {
+  // threads take shards round robin, loop threads are few so they rarely share one
+  static thread_local size_t shard = g_next_shard++ % fastocloud::server::base::metric_shards;
+  return shard;
+}
+
+void AppendSample(const std::string& name, const std::string& labels, const std::string& value, std::string* out) {
+  out->append(name);
+  if (!labels.empty()) {
+    out->append("{");
+    out->append(labels);
+    out->append("}");
+  }
+  out->append(" ");
+  out->append(value);
+  out->append("\n");
+}
+
+std::string FormatUint(uint64_t value) {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "%" PRIu64, value);
+  return buff;
+}
+
+std::string FormatInt(int64_t value) {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "%" PRId64, value);
+  return buff;
+}
+
+std::string FormatSeconds(uint64_t usec) {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "%.6f", static_cast<double>(usec) / 1000000.0);
+  return buff;
+}
+
+std::string JoinLabels(const std::string& labels, const std::string& extra) {
+  if (labels.empty()) {
+    return extra;
+  }
+  return labels + "," + extra;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+uint64_t GetMonotonicUsec() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+common::time64_t GetMonotonicMsec() {
+  return static_cast<common::time64_t>(GetMonotonicUsec() / 1000);
+}
+
+std::string MakeMetricLabel(const std::string& key, const std::string& value) {
+  std::string result = key + "=\"";
+  for (size_t i = 0; i < value.size(); ++i) {
+    const char c = value[i];
+    if (c == '\\' || c == '"') {
+      result += '\\';
+      result += c;
+    } else if (c == '\n') {
+      result += "\\n";
+    } else {
+      result += c;
+    }
+  }
+  result += '"';
+  return result;
+}
+
+MetricCounter::MetricCounter() {
+  for (size_t i = 0; i < metric_shards; ++i) {
+    shards_[i].value = 0;
+  }
+}
+
+void MetricCounter::Increment(uint64_t value) {
+  shards_[GetThreadShard()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t MetricCounter::GetValue() const {
+  uint64_t result = 0;
+  for (size_t i = 0; i < metric_shards; ++i) {
+    result += shards_[i].value.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+MetricGauge::MetricGauge() : value_(0) {}
+
+void MetricGauge::Set(int64_t value) {
+  value_.store(value, std::memory_order_relaxed);
+}
+
+void MetricGauge::Add(int64_t value) {
+  value_.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t MetricGauge::GetValue() const {
+  return value_.load(std::memory_order_relaxed);
+}
+
+MetricHistogramSnapshot::MetricHistogramSnapshot() : buckets(), count(0), sum_usec(0) {}
+
+MetricHistogramSnapshot GetHistogramDelta(const MetricHistogramSnapshot& current,
+                                          const MetricHistogramSnapshot& previous) {
+  MetricHistogramSnapshot delta;
+  for (size_t i = 0; i < metric_histogram_buckets; ++i) {
+    delta.buckets[i] = current.buckets[i] - previous.buckets[i];
+  }
+  delta.count = current.count - previous.count;
+  delta.sum_usec = current.sum_usec - previous.sum_usec;
+  return delta;
+}
+
+uint64_t GetHistogramPercentile(const MetricHistogramSnapshot& snapshot, double quantile) {
+  if (!snapshot.count) {
+    return 0;
+  }
+
+  const uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(snapshot.count) + 0.5);
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i + 1 < metric_histogram_buckets; ++i) {
+    cumulative += snapshot.buckets[i];
+    if (cumulative >= rank) {
+      return MetricHistogram::GetBucketBound(i);
+    }
+  }
+  return MetricHistogram::GetBucketBound(metric_histogram_buckets - 2);
+}
+
+MetricHistogram::MetricHistogram() {
+  for (size_t i = 0; i < metric_shards; ++i) {
+    for (size_t j = 0; j < metric_histogram_buckets; ++j) {
+      shards_[i].buckets[j] = 0;
+    }
+    shards_[i].sum_usec = 0;
+  }
+}
+
+void MetricHistogram::Record(uint64_t usec) {
+  Shard& shard = shards_[GetThreadShard()];
+  shard.buckets[GetBucketIndex(usec)].fetch_add(1, std::memory_order_relaxed);
+  shard.sum_usec.fetch_add(usec, std::memory_order_relaxed);
+}
+
+MetricHistogramSnapshot MetricHistogram::GetSnapshot() const {
+  MetricHistogramSnapshot snapshot;
+  for (size_t i = 0; i < metric_shards; ++i) {
+    for (size_t j = 0; j < metric_histogram_buckets; ++j) {
+      const uint64_t count = shards_[i].buckets[j].load(std::memory_order_relaxed);
+      snapshot.buckets[j] += count;
+      snapshot.count += count;
+    }
+    snapshot.sum_usec += shards_[i].sum_usec.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+uint64_t MetricHistogram::GetBucketBound(size_t index) {
+  if (index + 1 >= metric_histogram_buckets) {
+    return 0;
+  }
+  return UINT64_C(1) << (index + first_bucket_shift);
+}
+
+size_t MetricHistogram::GetBucketIndex(uint64_t usec) {
+  if (usec <= (UINT64_C(1) << first_bucket_shift)) {
+    return 0;
+  }
+
+  // smallest power of two not less than usec
+  const size_t bits = 64 - __builtin_clzll(usec - 1);
+  const size_t index = bits - first_bucket_shift;
+  return index < metric_histogram_buckets ? index : metric_histogram_buckets - 1;
+}
+
+ScopedMetricTimer::ScopedMetricTimer(MetricHistogram* histogram)
+    : histogram_(histogram), start_usec_(GetMonotonicUsec()) {}
+
+ScopedMetricTimer::~ScopedMetricTimer() {
+  histogram_->Record(GetMonotonicUsec() - start_usec_);
+}
+
+MetricsRegistry::MetricsRegistry() : mutex_(), families_() {}
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Family* MetricsRegistry::GetFamily(const std::string& name,
+                                                    const std::string& help,
+                                                    MetricType type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    Family family;
+    family.type = type;
+    family.help = help;
+    it = families_.insert(std::make_pair(name, std::move(family))).first;
+  }
+  DCHECK(it->second.type == type) << "Metric " << name << " registered with other type";
+  return &it->second;
+}
+
+MetricCounter* MetricsRegistry::GetCounter(const std::string& name,
+                                           const std::string& help,
+                                           const std::string& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, COUNTER_METRIC);
+  std::unique_ptr<MetricCounter>& counter = family->counters[labels];
+  if (!counter) {
+    counter.reset(new MetricCounter);
+  }
+  return counter.get();
+}
+
+MetricGauge* MetricsRegistry::GetGauge(const std::string& name, const std::string& help, const std::string& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, GAUGE_METRIC);
+  std::unique_ptr<MetricGauge>& gauge = family->gauges[labels];
+  if (!gauge) {
+    gauge.reset(new MetricGauge);
+  }
+  return gauge.get();
+}
+
+MetricHistogram* MetricsRegistry::GetHistogram(const std::string& name,
+                                               const std::string& help,
+                                               const std::string& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, HISTOGRAM_METRIC);
+  std::unique_ptr<MetricHistogram>& histogram = family->histograms[labels];
+  if (!histogram) {
+    histogram.reset(new MetricHistogram);
+  }
+  return histogram.get();
+}
+
+uint64_t MetricsRegistry::GetCounterSum(const std::string& name) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto it = families_.find(name);
+  if (it == families_.end()) {
+    return 0;
+  }
+
+  uint64_t result = 0;
+  const Family& family = it->second;
+  for (auto cit = family.counters.begin(); cit != family.counters.end(); ++cit) {
+    result += cit->second->GetValue();
+  }
+  return result;
+}
+
+MetricHistogramSnapshot MetricsRegistry::GetHistogramSum(const std::string& name) const {
+  MetricHistogramSnapshot result;
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto it = families_.find(name);
+  if (it == families_.end()) {
+    return result;
+  }
+
+  const Family& family = it->second;
+  for (auto hit = family.histograms.begin(); hit != family.histograms.end(); ++hit) {
+    const MetricHistogramSnapshot snapshot = hit->second->GetSnapshot();
+    for (size_t i = 0; i < metric_histogram_buckets; ++i) {
+      result.buckets[i] += snapshot.buckets[i];
+    }
+    result.count += snapshot.count;
+    result.sum_usec += snapshot.sum_usec;
+  }
+  return result;
+}
+
+std::string MetricsRegistry::Render() const {
+  static const char* const type_names[] = {"counter", "gauge", "histogram"};
+  std::string result;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (auto it = families_.begin(); it != families_.end(); ++it) {
+    const std::string& name = it->first;
+    const Family& family = it->second;
+    result += "# HELP " + name + " " + family.help + "\n";
+    result += "# TYPE " + name + " " + type_names[family.type] + "\n";
+    if (family.type == COUNTER_METRIC) {
+      for (auto cit = family.counters.begin(); cit != family.counters.end(); ++cit) {
+        AppendSample(name, cit->first, FormatUint(cit->second->GetValue()), &result);
+      }
+    } else if (family.type == GAUGE_METRIC) {
+      for (auto git = family.gauges.begin(); git != family.gauges.end(); ++git) {
+        AppendSample(name, git->first, FormatInt(git->second->GetValue()), &result);
+      }
+    } else {
+      for (auto hit = family.histograms.begin(); hit != family.histograms.end(); ++hit) {
+        const MetricHistogramSnapshot snapshot = hit->second->GetSnapshot();
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < metric_histogram_buckets; ++i) {
+          cumulative += snapshot.buckets[i];
+          const uint64_t bound = MetricHistogram::GetBucketBound(i);
+          const std::string le = bound ? FormatSeconds(bound) : "+Inf";
+          AppendSample(name + "_bucket", JoinLabels(hit->first, MakeMetricLabel("le", le)), FormatUint(cumulative),
+                       &result);
+        }
+        AppendSample(name + "_sum", hit->first, FormatSeconds(snapshot.sum_usec), &result);
+        AppendSample(name + "_count", hit->first, FormatUint(snapshot.count), &result);
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,162 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <common/time.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+enum : size_t { metric_shards = 8, metric_cache_line = 64, metric_histogram_buckets = 23 };
+
+uint64_t GetMonotonicUsec();
+// for intervals and deadlines, wall clock jumps don't shift them
+common::time64_t GetMonotonicMsec();
+
+// key="value" pair for registry lookups, several pairs are joined with comma
+std::string MakeMetricLabel(const std::string& key, const std::string& value);
+
+// Counter sharded by thread, every thread increments its own cache line, readers sum shards.
+class MetricCounter {
+ public:
+  MetricCounter();
+
+  void Increment(uint64_t value = 1);
+  uint64_t GetValue() const;
+
+ private:
+  struct Shard {
+    std::atomic<uint64_t> value;
+    char padding[metric_cache_line - sizeof(std::atomic<uint64_t>)];
+  };
+
+  Shard shards_[metric_shards];
+};
+
+class MetricGauge {
+ public:
+  MetricGauge();
+
+  void Set(int64_t value);
+  void Add(int64_t value);
+  int64_t GetValue() const;
+
+ private:
+  std::atomic<int64_t> value_;
+};
+
+struct MetricHistogramSnapshot {
+  MetricHistogramSnapshot();
+
+  uint64_t buckets[metric_histogram_buckets];  // not cumulative, last one is +Inf
+  uint64_t count;
+  uint64_t sum_usec;
+};
+
+// samples recorded between two snapshots of the same histogram
+MetricHistogramSnapshot GetHistogramDelta(const MetricHistogramSnapshot& current,
+                                          const MetricHistogramSnapshot& previous);
+// upper bound in usec of bucket where quantile falls, +Inf reports last finite bound, 0 for empty snapshot
+uint64_t GetHistogramPercentile(const MetricHistogramSnapshot& snapshot, double quantile);
+
+// Latency histogram with power of two buckets from 16us to ~33s, one bucket per octave
+// keeps relative error bounded like hdr histogram while exposition stays small.
+// Sharded by thread like counter.
+class MetricHistogram {
+ public:
+  enum : size_t { first_bucket_shift = 4 };
+
+  MetricHistogram();
+
+  void Record(uint64_t usec);
+  MetricHistogramSnapshot GetSnapshot() const;
+
+  // upper bound of bucket in usec, 0 for +Inf
+  static uint64_t GetBucketBound(size_t index);
+  static size_t GetBucketIndex(uint64_t usec);
+
+ private:
+  struct Shard {
+    std::atomic<uint64_t> buckets[metric_histogram_buckets];
+    std::atomic<uint64_t> sum_usec;
+  };
+
+  Shard shards_[metric_shards];
+};
+
+// records time since construction on destruction
+class ScopedMetricTimer {
+ public:
+  explicit ScopedMetricTimer(MetricHistogram* histogram);
+  ~ScopedMetricTimer();
+
+ private:
+  MetricHistogram* const histogram_;
+  const uint64_t start_usec_;
+};
+
+// Process wide metrics, rendered in prometheus text format.
+// Lookups take a lock, callers keep returned pointers, metrics live till process exit.
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& GetInstance();
+
+  MetricCounter* GetCounter(const std::string& name,
+                            const std::string& help,
+                            const std::string& labels = std::string());
+  MetricGauge* GetGauge(const std::string& name, const std::string& help, const std::string& labels = std::string());
+  MetricHistogram* GetHistogram(const std::string& name,
+                                const std::string& help,
+                                const std::string& labels = std::string());
+
+  // totals over all label sets of family, zero if family is not registered
+  uint64_t GetCounterSum(const std::string& name) const;
+  MetricHistogramSnapshot GetHistogramSum(const std::string& name) const;
+
+  // text exposition format 0.0.4
+  std::string Render() const;
+
+ private:
+  enum MetricType { COUNTER_METRIC, GAUGE_METRIC, HISTOGRAM_METRIC };
+  struct Family {
+    MetricType type;
+    std::string help;
+    std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+    std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+    std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+  };
+
+  MetricsRegistry();
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  Family* GetFamily(const std::string& name, const std::string& help, MetricType type);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family> families_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,474 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/msgpack.h"
+
+namespace {
+enum {
+  max_nesting_depth = 32,
+  positive_fixint_max = 0x7f,
+  fixmap_begin = 0x80,
+  fixmap_end = 0x8f,
+  fixarray_begin = 0x90,
+  fixarray_end = 0x9f,
+  fixstr_begin = 0xa0,
+  fixstr_end = 0xbf,
+  nil_marker = 0xc0,
+  false_marker = 0xc2,
+  true_marker = 0xc3,
+  bin8_marker = 0xc4,
+  bin16_marker = 0xc5,
+  bin32_marker = 0xc6,
+  float32_marker = 0xca,
+  float64_marker = 0xcb,
+  uint8_marker = 0xcc,
+  uint16_marker = 0xcd,
+  uint32_marker = 0xce,
+  uint64_marker = 0xcf,
+  int8_marker = 0xd0,
+  int16_marker = 0xd1,
+  int32_marker = 0xd2,
+  int64_marker = 0xd3,
+  str8_marker = 0xd9,
+  str16_marker = 0xda,
+  str32_marker = 0xdb,
+  array16_marker = 0xdc,
+  array32_marker = 0xdd,
+  map16_marker = 0xde,
+  map32_marker = 0xdf,
+  negative_fixint_begin = 0xe0
+};
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+MsgPackWriter::MsgPackWriter(std::string* out) : out_(out) {
+  DCHECK(out_);
+}
+
+void MsgPackWriter::PackNil() {
+  PutByte(nil_marker);
+}
+
+void MsgPackWriter::PackBool(bool value) {
+  PutByte(value ? true_marker : false_marker);
+}
+
+void MsgPackWriter::PackInt(int64_t value) {
+  if (value >= 0) {
+    if (value <= positive_fixint_max) {
+      PutByte(static_cast<uint8_t>(value));
+    } else if (value <= UINT8_MAX) {
+      PutByte(uint8_marker);
+      PutBigEndian(value, 1);
+    } else if (value <= UINT16_MAX) {
+      PutByte(uint16_marker);
+      PutBigEndian(value, 2);
+    } else if (value <= UINT32_MAX) {
+      PutByte(uint32_marker);
+      PutBigEndian(value, 4);
+    } else {
+      PutByte(uint64_marker);
+      PutBigEndian(value, 8);
+    }
+    return;
+  }
+
+  if (value >= -32) {
+    PutByte(static_cast<uint8_t>(value));
+  } else if (value >= INT8_MIN) {
+    PutByte(int8_marker);
+    PutBigEndian(static_cast<uint64_t>(value), 1);
+  } else if (value >= INT16_MIN) {
+    PutByte(int16_marker);
+    PutBigEndian(static_cast<uint64_t>(value), 2);
+  } else if (value >= INT32_MIN) {
+    PutByte(int32_marker);
+    PutBigEndian(static_cast<uint64_t>(value), 4);
+  } else {
+    PutByte(int64_marker);
+    PutBigEndian(static_cast<uint64_t>(value), 8);
+  }
+}
+
+void MsgPackWriter::PackString(const char* str, size_t size) {
+  if (size <= 31) {
+    PutByte(static_cast<uint8_t>(fixstr_begin | size));
+  } else if (size <= UINT8_MAX) {
+    PutByte(str8_marker);
+    PutBigEndian(size, 1);
+  } else if (size <= UINT16_MAX) {
+    PutByte(str16_marker);
+    PutBigEndian(size, 2);
+  } else {
+    PutByte(str32_marker);
+    PutBigEndian(size, 4);
+  }
+  out_->append(str, size);
+}
+
+void MsgPackWriter::PackString(const std::string& str) {
+  PackString(str.data(), str.size());
+}
+
+void MsgPackWriter::PackMap(uint32_t size) {
+  if (size <= 15) {
+    PutByte(static_cast<uint8_t>(fixmap_begin | size));
+  } else if (size <= UINT16_MAX) {
+    PutByte(map16_marker);
+    PutBigEndian(size, 2);
+  } else {
+    PutByte(map32_marker);
+    PutBigEndian(size, 4);
+  }
+}
+
+void MsgPackWriter::PackArray(uint32_t size) {
+  if (size <= 15) {
+    PutByte(static_cast<uint8_t>(fixarray_begin | size));
+  } else if (size <= UINT16_MAX) {
+    PutByte(array16_marker);
+    PutBigEndian(size, 2);
+  } else {
+    PutByte(array32_marker);
+    PutBigEndian(size, 4);
+  }
+}
+
+void MsgPackWriter::PutByte(uint8_t byte) {
+  out_->push_back(static_cast<char>(byte));
+}
+
+void MsgPackWriter::PutBigEndian(uint64_t value, size_t size) {
+  for (size_t i = size; i > 0; --i) {
+    PutByte(static_cast<uint8_t>((value >> ((i - 1) * 8)) & 0xff));
+  }
+}
+
+MsgPackReader::MsgPackReader(const char* data, size_t size)
+    : data_(reinterpret_cast<const uint8_t*>(data)), size_(size), pos_(0) {}
+
+bool MsgPackReader::IsEnd() const {
+  return pos_ >= size_;
+}
+
+size_t MsgPackReader::GetPosition() const {
+  return pos_;
+}
+
+bool MsgPackReader::IsMapNext() const {
+  uint8_t byte;
+  return Peek(&byte) && IsMsgPackMapMarker(byte);
+}
+
+bool MsgPackReader::ReadNil() {
+  uint8_t byte;
+  if (!Peek(&byte) || byte != nil_marker) {
+    return false;
+  }
+  pos_++;
+  return true;
+}
+
+bool MsgPackReader::ReadBool(bool* value) {
+  uint8_t byte;
+  if (!value || !Peek(&byte)) {
+    return false;
+  }
+
+  if (byte == true_marker || byte == false_marker) {
+    *value = byte == true_marker;
+    pos_++;
+    return true;
+  }
+  return false;
+}
+
+bool MsgPackReader::ReadInt(int64_t* value) {
+  uint8_t byte;
+  if (!value || !Peek(&byte)) {
+    return false;
+  }
+
+  if (byte <= positive_fixint_max) {
+    pos_++;
+    *value = byte;
+    return true;
+  }
+  if (byte >= negative_fixint_begin) {
+    pos_++;
+    *value = static_cast<int8_t>(byte);
+    return true;
+  }
+
+  const size_t start = pos_++;
+  uint64_t raw = 0;
+  bool ok = false;
+  switch (byte) {
+    case uint8_marker:
+      ok = GetBigEndian(1, &raw);
+      *value = static_cast<int64_t>(raw);
+      break;
+    case uint16_marker:
+      ok = GetBigEndian(2, &raw);
+      *value = static_cast<int64_t>(raw);
+      break;
+    case uint32_marker:
+      ok = GetBigEndian(4, &raw);
+      *value = static_cast<int64_t>(raw);
+      break;
+    case uint64_marker:
+      ok = GetBigEndian(8, &raw) && raw <= INT64_MAX;
+      *value = static_cast<int64_t>(raw);
+      break;
+    case int8_marker:
+      ok = GetBigEndian(1, &raw);
+      *value = static_cast<int8_t>(raw);
+      break;
+    case int16_marker:
+      ok = GetBigEndian(2, &raw);
+      *value = static_cast<int16_t>(raw);
+      break;
+    case int32_marker:
+      ok = GetBigEndian(4, &raw);
+      *value = static_cast<int32_t>(raw);
+      break;
+    case int64_marker:
+      ok = GetBigEndian(8, &raw);
+      *value = static_cast<int64_t>(raw);
+      break;
+    default:
+      break;
+  }
+
+  if (!ok) {
+    pos_ = start;
+  }
+  return ok;
+}
+
+bool MsgPackReader::ReadString(const char** str, size_t* size) {
+  uint8_t byte;
+  if (!str || !size || !Peek(&byte)) {
+    return false;
+  }
+
+  const size_t start = pos_++;
+  uint64_t len = 0;
+  bool ok = true;
+  if (byte >= fixstr_begin && byte <= fixstr_end) {
+    len = byte & 0x1f;
+  } else if (byte == str8_marker) {
+    ok = GetBigEndian(1, &len);
+  } else if (byte == str16_marker) {
+    ok = GetBigEndian(2, &len);
+  } else if (byte == str32_marker) {
+    ok = GetBigEndian(4, &len);
+  } else {
+    ok = false;
+  }
+
+  if (!ok || len > size_ - pos_) {
+    pos_ = start;
+    return false;
+  }
+
+  *str = reinterpret_cast<const char*>(data_ + pos_);
+  *size = len;
+  pos_ += len;
+  return true;
+}
+
+bool MsgPackReader::ReadString(std::string* str) {
+  const char* ptr = nullptr;
+  size_t size = 0;
+  if (!str || !ReadString(&ptr, &size)) {
+    return false;
+  }
+
+  str->assign(ptr, size);
+  return true;
+}
+
+bool MsgPackReader::ReadMap(uint32_t* size) {
+  uint8_t byte;
+  if (!size || !Peek(&byte)) {
+    return false;
+  }
+
+  const size_t start = pos_++;
+  uint64_t len = 0;
+  bool ok = true;
+  if (byte >= fixmap_begin && byte <= fixmap_end) {
+    len = byte & 0x0f;
+  } else if (byte == map16_marker) {
+    ok = GetBigEndian(2, &len);
+  } else if (byte == map32_marker) {
+    ok = GetBigEndian(4, &len);
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    pos_ = start;
+    return false;
+  }
+
+  *size = static_cast<uint32_t>(len);
+  return true;
+}
+
+bool MsgPackReader::ReadArray(uint32_t* size) {
+  uint8_t byte;
+  if (!size || !Peek(&byte)) {
+    return false;
+  }
+
+  const size_t start = pos_++;
+  uint64_t len = 0;
+  bool ok = true;
+  if (byte >= fixarray_begin && byte <= fixarray_end) {
+    len = byte & 0x0f;
+  } else if (byte == array16_marker) {
+    ok = GetBigEndian(2, &len);
+  } else if (byte == array32_marker) {
+    ok = GetBigEndian(4, &len);
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    pos_ = start;
+    return false;
+  }
+
+  *size = static_cast<uint32_t>(len);
+  return true;
+}
+
+bool MsgPackReader::Skip() {
+  return SkipValues(1, 0);
+}
+
+bool MsgPackReader::Peek(uint8_t* byte) const {
+  if (pos_ >= size_) {
+    return false;
+  }
+
+  *byte = data_[pos_];
+  return true;
+}
+
+bool MsgPackReader::GetBigEndian(size_t size, uint64_t* value) {
+  if (size > size_ - pos_) {
+    return false;
+  }
+
+  uint64_t result = 0;
+  for (size_t i = 0; i < size; ++i) {
+    result = (result << 8) | data_[pos_ + i];
+  }
+  pos_ += size;
+  *value = result;
+  return true;
+}
+
+bool MsgPackReader::SkipValues(uint64_t count, int depth) {
+  if (depth > max_nesting_depth) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < count; ++i) {
+    uint8_t byte;
+    if (!Peek(&byte)) {
+      return false;
+    }
+
+    if (byte <= positive_fixint_max || byte >= negative_fixint_begin || byte == nil_marker ||
+        byte == true_marker || byte == false_marker) {
+      pos_++;
+      continue;
+    }
+
+    int64_t ival;
+    if (ReadInt(&ival)) {
+      continue;
+    }
+
+    const char* str;
+    size_t len;
+    if (ReadString(&str, &len)) {
+      continue;
+    }
+
+    uint32_t nested;
+    if (ReadMap(&nested)) {
+      if (!SkipValues(static_cast<uint64_t>(nested) * 2, depth + 1)) {
+        return false;
+      }
+      continue;
+    }
+    if (ReadArray(&nested)) {
+      if (!SkipValues(nested, depth + 1)) {
+        return false;
+      }
+      continue;
+    }
+
+    uint64_t payload = 0;
+    pos_++;
+    switch (byte) {
+      case float32_marker:
+        payload = 4;
+        break;
+      case uint64_marker:  // above INT64_MAX, ReadInt refuses it
+      case float64_marker:
+        payload = 8;
+        break;
+      case bin8_marker:
+        if (!GetBigEndian(1, &payload)) {
+          return false;
+        }
+        break;
+      case bin16_marker:
+        if (!GetBigEndian(2, &payload)) {
+          return false;
+        }
+        break;
+      case bin32_marker:
+        if (!GetBigEndian(4, &payload)) {
+          return false;
+        }
+        break;
+      default:
+        return false;  // ext types are not used by the protocol
+    }
+
+    if (payload > size_ - pos_) {
+      return false;
+    }
+    pos_ += payload;
+  }
+  return true;
+}
+
+bool IsMsgPackMapMarker(uint8_t byte) {
+  return (byte >= fixmap_begin && byte <= fixmap_end) || byte == map16_marker || byte == map32_marker;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,80 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <common/macros.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Minimal MessagePack subset: nil, bool, int, str, map, array.
+class MsgPackWriter {
+ public:
+  explicit MsgPackWriter(std::string* out);
+
+  void PackNil();
+  void PackBool(bool value);
+  void PackInt(int64_t value);
+  void PackString(const char* str, size_t size);
+  void PackString(const std::string& str);
+  void PackMap(uint32_t size);
+  void PackArray(uint32_t size);
+
+ private:
+  void PutByte(uint8_t byte);
+  void PutBigEndian(uint64_t value, size_t size);
+
+  std::string* const out_;
+};
+
+// Reads values in place, strings are returned as pointers into the input buffer.
+class MsgPackReader {
+ public:
+  MsgPackReader(const char* data, size_t size);
+
+  bool IsEnd() const;
+  size_t GetPosition() const;
+  bool IsMapNext() const;
+
+  bool ReadNil() WARN_UNUSED_RESULT;
+  bool ReadBool(bool* value) WARN_UNUSED_RESULT;
+  bool ReadInt(int64_t* value) WARN_UNUSED_RESULT;
+  bool ReadString(const char** str, size_t* size) WARN_UNUSED_RESULT;
+  bool ReadString(std::string* str) WARN_UNUSED_RESULT;
+  bool ReadMap(uint32_t* size) WARN_UNUSED_RESULT;
+  bool ReadArray(uint32_t* size) WARN_UNUSED_RESULT;
+  bool Skip() WARN_UNUSED_RESULT;
+
+ private:
+  bool Peek(uint8_t* byte) const WARN_UNUSED_RESULT;
+  bool GetBigEndian(size_t size, uint64_t* value) WARN_UNUSED_RESULT;
+  bool SkipValues(uint64_t count, int depth) WARN_UNUSED_RESULT;
+
+  const uint8_t* const data_;
+  const size_t size_;
+  size_t pos_;
+};
+
+bool IsMsgPackMapMarker(uint8_t byte);
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
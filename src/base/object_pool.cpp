@@ -0,0 +1,48 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/object_pool.h"
+
+#include "base/metrics.h"
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+ObjectPoolMetrics::ObjectPoolMetrics(const std::string& pool)
+    : published_(),
+      hits_(MetricsRegistry::GetInstance().GetCounter("fastocloud_object_pool_hits_total",
+                                                      "Allocations served from pool free list.",
+                                                      MakeMetricLabel("pool", pool))),
+      misses_(MetricsRegistry::GetInstance().GetCounter("fastocloud_object_pool_misses_total",
+                                                        "Allocations served by global operator new.",
+                                                        MakeMetricLabel("pool", pool))),
+      remote_frees_(MetricsRegistry::GetInstance().GetCounter("fastocloud_object_pool_remote_frees_total",
+                                                              "Blocks freed by thread other than allocating one.",
+                                                              MakeMetricLabel("pool", pool))),
+      free_blocks_(MetricsRegistry::GetInstance().GetGauge("fastocloud_object_pool_free_blocks",
+                                                           "Blocks cached in pool free list.",
+                                                           MakeMetricLabel("pool", pool))) {}
+
+void ObjectPoolMetrics::Update(const ObjectPoolStats& stats) {
+  hits_->Increment(stats.hits - published_.hits);
+  misses_->Increment(stats.misses - published_.misses);
+  remote_frees_->Increment(stats.remote_frees - published_.remote_frees);
+  free_blocks_->Set(static_cast<int64_t>(stats.free_blocks));
+  published_ = stats;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
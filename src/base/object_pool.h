@@ -0,0 +1,157 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+class MetricCounter;
+class MetricGauge;
+
+struct ObjectPoolStats {
+  ObjectPoolStats() : hits(0), misses(0), free_blocks(0), remote_frees(0) {}
+
+  size_t hits;          // allocations served from free list
+  size_t misses;        // allocations served by global operator new
+  size_t free_blocks;
+  size_t remote_frees;  // blocks of other threads returned to global operator delete
+};
+
+// Free list of raw blocks for class T, one per thread, so every loop reuses blocks of clients it deleted
+// without locking. Objects are constructed from scratch on every allocation, nothing survives reuse.
+// Every block remembers thread which allocated it, blocks freed by another thread go back to
+// global operator delete, so objects moved between loops can't grow a foreign cache.
+// Usage: class specific operator new/delete forwarding to Allocate/Deallocate.
+template <typename T, size_t MaxFreeBlocks = 4096>
+class ObjectPool {
+ public:
+  static void* Allocate(size_t size) {
+    if (size != sizeof(T)) {  // derived class
+      return ::operator new(size);
+    }
+
+    ThreadCache* cache = GetThreadCache();
+    void* raw = nullptr;
+    if (cache->head) {
+      FreeBlock* block = cache->head;
+      cache->head = block->next;
+      cache->stats.hits++;
+      cache->stats.free_blocks--;
+      raw = block;
+    } else {
+      cache->stats.misses++;
+      raw = ::operator new(header_size + size);
+    }
+
+    static_cast<BlockHeader*>(raw)->owner = cache->id;
+    return static_cast<char*>(raw) + header_size;
+  }
+
+  static void Deallocate(void* ptr, size_t size) {
+    if (!ptr) {
+      return;
+    }
+
+    if (size != sizeof(T)) {
+      ::operator delete(ptr);
+      return;
+    }
+
+    void* raw = static_cast<char*>(ptr) - header_size;
+    ThreadCache* cache = GetThreadCache();
+    if (static_cast<BlockHeader*>(raw)->owner != cache->id) {
+      cache->stats.remote_frees++;
+      ::operator delete(raw);
+      return;
+    }
+
+    if (cache->stats.free_blocks >= MaxFreeBlocks) {
+      ::operator delete(raw);
+      return;
+    }
+
+    FreeBlock* block = static_cast<FreeBlock*>(raw);
+    block->next = cache->head;
+    cache->head = block;
+    cache->stats.free_blocks++;
+  }
+
+  // stats of calling thread
+  static ObjectPoolStats GetStats() { return GetThreadCache()->stats; }
+
+ private:
+  union BlockHeader {
+    uint64_t owner;  // id of thread cache, addresses of thread locals are reused by new threads
+    max_align_t align;  // keeps object behind header aligned as by operator new
+  };
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  enum : size_t { header_size = sizeof(BlockHeader) };
+
+  struct ThreadCache {
+    ThreadCache() : id(NextCacheID()), head(nullptr), stats() {}
+    ~ThreadCache() {
+      while (head) {
+        FreeBlock* next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+
+    const uint64_t id;
+    FreeBlock* head;
+    ObjectPoolStats stats;
+  };
+
+  static uint64_t NextCacheID() {
+    static std::atomic<uint64_t> last_id(0);
+    return ++last_id;
+  }
+
+  static ThreadCache* GetThreadCache() {
+    static thread_local ThreadCache cache;
+    return &cache;
+  }
+};
+
+// Publishes pool stats of one thread as metrics labeled with pool name, call periodically from that thread.
+class ObjectPoolMetrics {
+ public:
+  explicit ObjectPoolMetrics(const std::string& pool);
+
+  void Update(const ObjectPoolStats& stats);
+
+ private:
+  ObjectPoolStats published_;
+  MetricCounter* const hits_;
+  MetricCounter* const misses_;
+  MetricCounter* const remote_frees_;
+  MetricGauge* const free_blocks_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,261 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/request_tracer.h"
+
+#include <errno.h>
+#include <inttypes.h>
+
+#include <chrono>
+#include <utility>
+
+#include "base/metrics.h"
+
+namespace {
+const uint64_t kWriteIntervalMsec = 100;
+const int kTracePid = 1;
+
+thread_local fastocloud::server::base::RequestTrace* g_current_trace = nullptr;
+
+std::string EscapeJson(const std::string& value) {
+  std::string result;
+  result.reserve(value.size());
+  for (size_t i = 0; i < value.size(); ++i) {
+    const char c = value[i];
+    if (c == '"' || c == '\\') {
+      result.push_back('\\');
+      result.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buff[8];
+      snprintf(buff, sizeof(buff), "\\u%04x", c);
+      result += buff;
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+TraceSpan::TraceSpan() : name(), category(nullptr), start_usec(0), end_usec(0) {}
+
+TraceSpan::TraceSpan(const std::string& name, const char* category, uint64_t start_usec, uint64_t end_usec)
+    : name(name), category(category), start_usec(start_usec), end_usec(end_usec) {}
+
+RequestTrace::RequestTrace() : id_(0), start_usec_(0), method_(), spans_() {}
+
+RequestTrace::RequestTrace(uint64_t id, uint64_t start_usec) : id_(id), start_usec_(start_usec), method_(), spans_() {}
+
+bool RequestTrace::IsSampled() const {
+  return id_ != 0;
+}
+
+uint64_t RequestTrace::GetID() const {
+  return id_;
+}
+
+uint64_t RequestTrace::GetStartTime() const {
+  return start_usec_;
+}
+
+void RequestTrace::SetMethod(const std::string& method) {
+  if (IsSampled()) {
+    method_ = method;
+  }
+}
+
+const std::string& RequestTrace::GetMethod() const {
+  return method_;
+}
+
+void RequestTrace::AddSpan(const std::string& name, const char* category, uint64_t start_usec, uint64_t end_usec) {
+  if (IsSampled()) {
+    spans_.push_back(TraceSpan(name, category, start_usec, end_usec));
+  }
+}
+
+const std::vector<TraceSpan>& RequestTrace::GetSpans() const {
+  return spans_;
+}
+
+RequestTrace* RequestTrace::GetCurrent() {
+  return g_current_trace;
+}
+
+ScopedTraceActivation::ScopedTraceActivation(RequestTrace* trace) : parent_(g_current_trace) {
+  g_current_trace = trace && trace->IsSampled() ? trace : nullptr;
+}
+
+ScopedTraceActivation::~ScopedTraceActivation() {
+  g_current_trace = parent_;
+}
+
+ScopedTraceSpan::ScopedTraceSpan(const char* name, const char* category)
+    : trace_(g_current_trace), name_(name), category_(category), start_usec_(trace_ ? GetMonotonicUsec() : 0) {}
+
+ScopedTraceSpan::~ScopedTraceSpan() {
+  if (trace_) {
+    trace_->AddSpan(name_, category_, start_usec_, GetMonotonicUsec());
+  }
+}
+
+RequestTracer::RequestTracer(const std::string& path, uint32_t sample_interval)
+    : path_(path),
+      sample_interval_(sample_interval ? sample_interval : 1),
+      file_(nullptr),
+      start_usec_(0),
+      requests_(0),
+      mutex_(),
+      cond_(),
+      queue_(),
+      written_(0),
+      dropped_(0),
+      stop_(true),
+      writer_() {}
+
+RequestTracer::~RequestTracer() {
+  Stop();
+}
+
+common::ErrnoError RequestTracer::Start() {
+  if (file_) {
+    return common::make_errno_error_inval();
+  }
+
+  file_ = fopen(path_.c_str(), "w");
+  if (!file_) {
+    return common::make_errno_error("Can't open trace file: " + path_, errno);
+  }
+
+  // closing bracket is optional in trace event format, so killed process still leaves readable file
+  if (fprintf(file_, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"fastocloud\"}}",
+              kTracePid) < 0) {
+    const int err = errno;
+    fclose(file_);
+    file_ = nullptr;
+    return common::make_errno_error("Can't write trace file: " + path_, err);
+  }
+
+  start_usec_ = GetMonotonicUsec();
+  stop_ = false;
+  writer_ = std::thread(&RequestTracer::WriteRoutine, this);
+  return common::ErrnoError();
+}
+
+void RequestTracer::Stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_one();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  if (file_) {
+    fputs("]\n", file_);
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+RequestTrace RequestTracer::StartTrace(uint64_t start_usec) {
+  const uint64_t request = requests_.fetch_add(1, std::memory_order_relaxed);
+  if (request % sample_interval_ != 0) {
+    return RequestTrace();
+  }
+  return RequestTrace(request / sample_interval_ + 1, start_usec);
+}
+
+void RequestTracer::FinishTrace(RequestTrace* trace) {
+  if (!trace || !trace->IsSampled()) {
+    return;
+  }
+
+  // root span covers whole request, stages are nested into it
+  trace->AddSpan(trace->GetMethod(), "request", trace->GetStartTime(), GetMonotonicUsec());
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (stop_ || queue_.size() >= queue_limit) {
+    dropped_++;
+    return;
+  }
+  queue_.push_back(std::move(*trace));
+  *trace = RequestTrace();
+}
+
+uint64_t RequestTracer::GetWritten() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return written_;
+}
+
+uint64_t RequestTracer::GetDropped() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void RequestTracer::WriteRoutine() {
+  std::vector<RequestTrace> traces;
+  bool stop = false;
+  while (!stop) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait_for(lock, std::chrono::milliseconds(kWriteIntervalMsec), [this] { return stop_; });
+      stop = stop_;
+      traces.swap(queue_);
+      written_ += traces.size();
+    }
+    WriteTraces(traces);
+    traces.clear();
+  }
+}
+
+void RequestTracer::WriteTraces(const std::vector<RequestTrace>& traces) {
+  for (size_t i = 0; i < traces.size(); ++i) {
+    const RequestTrace& trace = traces[i];
+    fprintf(file_,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%" PRIu64
+            ",\"args\":{\"name\":\"%s #%" PRIu64 "\"}}",
+            kTracePid, trace.GetID(), EscapeJson(trace.GetMethod()).c_str(), trace.GetID());
+    const std::vector<TraceSpan>& spans = trace.GetSpans();
+    // root span is added last, viewers nest spans by start time and duration
+    for (size_t j = spans.size(); j > 0; --j) {
+      const TraceSpan& span = spans[j - 1];
+      WriteEvent(span.name, span.category, trace.GetID(), span.start_usec, span.end_usec);
+    }
+  }
+  if (!traces.empty()) {
+    fflush(file_);
+  }
+}
+
+void RequestTracer::WriteEvent(const std::string& name,
+                               const char* category,
+                               uint64_t id,
+                               uint64_t start_usec,
+                               uint64_t end_usec) {
+  // spans may start before tracer, e.g. request read while it was starting
+  const uint64_t ts = start_usec > start_usec_ ? start_usec - start_usec_ : 0;
+  const uint64_t dur = end_usec > start_usec ? end_usec - start_usec : 0;
+  fprintf(file_,
+          ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+          ",\"pid\":%d,\"tid\":%" PRIu64 ",\"args\":{\"trace_id\":%" PRIu64 "}}",
+          EscapeJson(name).c_str(), category, ts, dur, kTracePid, id, id);
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
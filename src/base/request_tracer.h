@@ -0,0 +1,144 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/error.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// times are monotonic usec
+struct TraceSpan {
+  TraceSpan();
+  TraceSpan(const std::string& name, const char* category, uint64_t start_usec, uint64_t end_usec);
+
+  std::string name;
+  const char* category;  // stage kind: loop, db or socket
+  uint64_t start_usec;
+  uint64_t end_usec;
+};
+
+// Stages of one request, trace which isn't sampled ignores spans and costs nothing.
+class RequestTrace {
+ public:
+  RequestTrace();
+  RequestTrace(uint64_t id, uint64_t start_usec);
+
+  bool IsSampled() const;
+  uint64_t GetID() const;
+  uint64_t GetStartTime() const;
+
+  void SetMethod(const std::string& method);
+  const std::string& GetMethod() const;
+
+  void AddSpan(const std::string& name, const char* category, uint64_t start_usec, uint64_t end_usec);
+  const std::vector<TraceSpan>& GetSpans() const;
+
+  // sampled trace activated on current thread, null otherwise
+  static RequestTrace* GetCurrent();
+
+ private:
+  uint64_t id_;  // 0 if not sampled
+  uint64_t start_usec_;
+  std::string method_;
+  std::vector<TraceSpan> spans_;
+};
+
+// makes trace current for this thread, so db and socket layers can add spans without passing it around
+class ScopedTraceActivation {
+ public:
+  explicit ScopedTraceActivation(RequestTrace* trace);
+  ~ScopedTraceActivation();
+
+ private:
+  ScopedTraceActivation(const ScopedTraceActivation&) = delete;
+  ScopedTraceActivation& operator=(const ScopedTraceActivation&) = delete;
+
+  RequestTrace* const parent_;
+};
+
+// span of current trace from construction to destruction, only reads clock if trace is sampled
+class ScopedTraceSpan {
+ public:
+  ScopedTraceSpan(const char* name, const char* category);
+  ~ScopedTraceSpan();
+
+ private:
+  ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+  ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+  RequestTrace* const trace_;
+  const char* const name_;
+  const char* const category_;
+  const uint64_t start_usec_;
+};
+
+// Writes sampled request traces as chrome trace events (json array of complete events),
+// file opens in chrome://tracing or perfetto, every request is its own row named by method and trace id.
+// Loops only queue finished traces, writer thread formats them, traces over queue limit are dropped and counted.
+class RequestTracer {
+ public:
+  enum : size_t { queue_limit = 4096 };
+
+  // every sample_interval request is traced
+  RequestTracer(const std::string& path, uint32_t sample_interval);
+  ~RequestTracer();
+
+  common::ErrnoError Start() WARN_UNUSED_RESULT;
+  // writes what is left in queue
+  void Stop();
+
+  // thread safe
+  RequestTrace StartTrace(uint64_t start_usec);
+  // thread safe, ends trace now, not sampled traces are ignored
+  void FinishTrace(RequestTrace* trace);
+
+  uint64_t GetWritten() const;
+  uint64_t GetDropped() const;
+
+ private:
+  void WriteRoutine();
+  void WriteTraces(const std::vector<RequestTrace>& traces);
+  void WriteEvent(const std::string& name, const char* category, uint64_t id, uint64_t start_usec, uint64_t end_usec);
+
+  const std::string path_;
+  const uint32_t sample_interval_;
+  FILE* file_;
+  uint64_t start_usec_;
+  std::atomic<uint64_t> requests_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<RequestTrace> queue_;
+  uint64_t written_;
+  uint64_t dropped_;
+  bool stop_;
+  std::thread writer_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
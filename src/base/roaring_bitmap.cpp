@@ -0,0 +1,189 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/roaring_bitmap.h"
+
+#include <algorithm>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+namespace {
+uint16_t HighBits(uint32_t value) {
+  return static_cast<uint16_t>(value >> 16);
+}
+
+uint16_t LowBits(uint32_t value) {
+  return static_cast<uint16_t>(value & 0xFFFF);
+}
+}  // namespace
+
+RoaringBitmap::Container::Container(uint16_t key) : key(key), cardinality(0), array(), bitset() {}
+
+bool RoaringBitmap::Container::IsBitset() const {
+  return !bitset.empty();
+}
+
+bool RoaringBitmap::Container::Contains(uint16_t low) const {
+  if (IsBitset()) {
+    return bitset[low >> 6] & (UINT64_C(1) << (low & 63));
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool RoaringBitmap::Container::Add(uint16_t low) {
+  if (IsBitset()) {
+    uint64_t& word = bitset[low >> 6];
+    const uint64_t mask = UINT64_C(1) << (low & 63);
+    if (word & mask) {
+      return false;
+    }
+    word |= mask;
+    cardinality++;
+    return true;
+  }
+
+  const auto it = std::lower_bound(array.begin(), array.end(), low);
+  if (it != array.end() && *it == low) {
+    return false;
+  }
+  array.insert(it, low);
+  cardinality++;
+  if (cardinality > array_max_size) {
+    ToBitset();
+  }
+  return true;
+}
+
+bool RoaringBitmap::Container::Remove(uint16_t low) {
+  if (IsBitset()) {
+    uint64_t& word = bitset[low >> 6];
+    const uint64_t mask = UINT64_C(1) << (low & 63);
+    if (!(word & mask)) {
+      return false;
+    }
+    word &= ~mask;
+    cardinality--;
+    // convert back with some hysteresis, add/remove around the limit should not flip layouts
+    if (cardinality <= array_max_size / 2) {
+      ToArray();
+    }
+    return true;
+  }
+
+  const auto it = std::lower_bound(array.begin(), array.end(), low);
+  if (it == array.end() || *it != low) {
+    return false;
+  }
+  array.erase(it);
+  cardinality--;
+  return true;
+}
+
+void RoaringBitmap::Container::ToBitset() {
+  bitset.assign(bitset_words, 0);
+  for (size_t i = 0; i < array.size(); ++i) {
+    bitset[array[i] >> 6] |= UINT64_C(1) << (array[i] & 63);
+  }
+  std::vector<uint16_t>().swap(array);
+}
+
+void RoaringBitmap::Container::ToArray() {
+  array.reserve(cardinality);
+  for (uint32_t i = 0; i < bitset_words; ++i) {
+    uint64_t word = bitset[i];
+    while (word) {
+      const int bit = __builtin_ctzll(word);
+      array.push_back(static_cast<uint16_t>(i * 64 + bit));
+      word &= word - 1;
+    }
+  }
+  std::vector<uint64_t>().swap(bitset);
+}
+
+RoaringBitmap::RoaringBitmap() : containers_() {}
+
+bool RoaringBitmap::Add(uint32_t value) {
+  const uint16_t key = HighBits(value);
+  auto it = LowerBound(key);
+  if (it == containers_.end() || it->key != key) {
+    it = containers_.insert(it, Container(key));
+  }
+  return it->Add(LowBits(value));
+}
+
+bool RoaringBitmap::Remove(uint32_t value) {
+  const uint16_t key = HighBits(value);
+  const auto it = LowerBound(key);
+  if (it == containers_.end() || it->key != key) {
+    return false;
+  }
+
+  if (!it->Remove(LowBits(value))) {
+    return false;
+  }
+
+  if (it->cardinality == 0) {
+    containers_.erase(it);
+  }
+  return true;
+}
+
+bool RoaringBitmap::Contains(uint32_t value) const {
+  const uint16_t key = HighBits(value);
+  const auto it = LowerBound(key);
+  if (it == containers_.end() || it->key != key) {
+    return false;
+  }
+  return it->Contains(LowBits(value));
+}
+
+bool RoaringBitmap::IsEmpty() const {
+  return containers_.empty();
+}
+
+size_t RoaringBitmap::GetCardinality() const {
+  size_t result = 0;
+  for (size_t i = 0; i < containers_.size(); ++i) {
+    result += containers_[i].cardinality;
+  }
+  return result;
+}
+
+size_t RoaringBitmap::GetMemoryUsage() const {
+  size_t result = containers_.capacity() * sizeof(Container);
+  for (size_t i = 0; i < containers_.size(); ++i) {
+    result += containers_[i].array.capacity() * sizeof(uint16_t) + containers_[i].bitset.capacity() * sizeof(uint64_t);
+  }
+  return result;
+}
+
+void RoaringBitmap::Clear() {
+  containers_.clear();
+}
+
+std::vector<RoaringBitmap::Container>::iterator RoaringBitmap::LowerBound(uint16_t key) {
+  return std::lower_bound(containers_.begin(), containers_.end(), key,
+                          [](const Container& container, uint16_t value) { return container.key < value; });
+}
+
+std::vector<RoaringBitmap::Container>::const_iterator RoaringBitmap::LowerBound(uint16_t key) const {
+  return std::lower_bound(containers_.begin(), containers_.end(), key,
+                          [](const Container& container, uint16_t value) { return container.key < value; });
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
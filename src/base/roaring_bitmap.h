@@ -0,0 +1,70 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Compressed bitmap of 32 bit values, Roaring layout: values are grouped by high 16 bits,
+// each group is a sorted array while sparse and a plain bitset once it has more than array_max_size values.
+class RoaringBitmap {
+ public:
+  enum : uint32_t { array_max_size = 4096 };
+
+  RoaringBitmap();
+
+  bool Add(uint32_t value);     // false if already present
+  bool Remove(uint32_t value);  // false if missing
+  bool Contains(uint32_t value) const;
+
+  bool IsEmpty() const;
+  size_t GetCardinality() const;
+  size_t GetMemoryUsage() const;
+  void Clear();
+
+ private:
+  enum : uint32_t { bitset_words = 65536 / 64 };
+
+  struct Container {
+    explicit Container(uint16_t key);
+
+    bool IsBitset() const;
+    bool Contains(uint16_t low) const;
+    bool Add(uint16_t low);
+    bool Remove(uint16_t low);
+    void ToBitset();
+    void ToArray();
+
+    uint16_t key;
+    uint32_t cardinality;
+    std::vector<uint16_t> array;  // sorted, used while cardinality <= array_max_size
+    std::vector<uint64_t> bitset;
+  };
+
+  std::vector<Container>::iterator LowerBound(uint16_t key);
+  std::vector<Container>::const_iterator LowerBound(uint16_t key) const;
+
+  std::vector<Container> containers_;  // sorted by key
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
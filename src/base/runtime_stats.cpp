@@ -0,0 +1,173 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/runtime_stats.h"
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+LoopStats::LoopStats() : name(), connections(0), lag(0), max_lag(0), level(LoopLagMonitor::NORMAL_LOAD) {}
+
+LoopStats::LoopStats(const std::string& name, size_t connections, const LoopLagMonitor& monitor)
+    : name(name),
+      connections(connections),
+      lag(monitor.GetLag()),
+      max_lag(monitor.GetMaxLag()),
+      level(monitor.GetLoadLevel()) {}
+
+SubscribersStats::SubscribersStats() : users(0), connections(0), watchers() {}
+
+RuntimeStatsSnapshot::RuntimeStatsSnapshot()
+    : uptime(0),
+      memory_rss(0),
+      loops(),
+      subscribers(),
+      requests_rate(0),
+      errors_rate(0),
+      shed_rate(0),
+      db_rate(0),
+      db_p50(0),
+      db_p90(0),
+      db_p99(0) {}
+
+uint64_t GetMemoryRss() {
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (file) {
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int count = fscanf(file, "%lu %lu", &size, &resident);
+    fclose(file);
+    if (count == 2) {
+      return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+    }
+  }
+
+  // peak instead of current, better than nothing where procfs is absent
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+  }
+  return 0;
+}
+
+RuntimeStats::MetricsSample::MetricsSample() : time_usec(0), requests(0), errors(0), shed(0), db() {}
+
+RuntimeStats::RuntimeStats()
+    : start_usec_(GetMonotonicUsec()), mutex_(), loops_(), users_(), subscribers_(), last_sample_(), rates_() {}
+
+RuntimeStats& RuntimeStats::GetInstance() {
+  static RuntimeStats stats;
+  return stats;
+}
+
+void RuntimeStats::UpdateLoop(const LoopStats& loop) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  loops_[loop.name] = loop;
+}
+
+void RuntimeStats::AddSubscriber(const fastotv::user_id_t& user) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  users_[user]++;
+  subscribers_.connections++;
+}
+
+void RuntimeStats::ChangeSubscriberStream(const fastotv::stream_id_t& previous, const fastotv::stream_id_t& current) {
+  if (previous == current) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!previous.empty()) {
+    auto it = subscribers_.watchers.find(previous);
+    if (it != subscribers_.watchers.end() && --it->second == 0) {
+      subscribers_.watchers.erase(it);
+    }
+  }
+  if (!current.empty()) {
+    subscribers_.watchers[current]++;
+  }
+}
+
+void RuntimeStats::RemoveSubscriber(const fastotv::user_id_t& user, const fastotv::stream_id_t& sid) {
+  ChangeSubscriberStream(sid, fastotv::stream_id_t());
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = users_.find(user);
+  if (it == users_.end()) {
+    return;
+  }
+
+  if (--it->second == 0) {
+    users_.erase(it);
+  }
+  subscribers_.connections--;
+}
+
+RuntimeStats::MetricsSample RuntimeStats::TakeSample(uint64_t now_usec) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  MetricsSample sample;
+  sample.time_usec = now_usec;
+  sample.requests = registry.GetCounterSum("fastocloud_rpc_requests_total");
+  sample.errors = registry.GetCounterSum("fastocloud_rpc_errors_total");
+  sample.shed = registry.GetCounterSum("fastocloud_rpc_shed_total");
+  sample.db = registry.GetHistogramSum("fastocloud_mongo_operation_duration_seconds");
+  return sample;
+}
+
+void RuntimeStats::Sample(uint64_t now_usec) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (last_sample_.time_usec && now_usec - last_sample_.time_usec < rate_window_seconds * UINT64_C(1000000)) {
+      return;
+    }
+  }
+
+  // registry takes its own lock, don't hold ours meanwhile
+  const MetricsSample sample = TakeSample(now_usec);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (last_sample_.time_usec) {
+    const double seconds = static_cast<double>(sample.time_usec - last_sample_.time_usec) / 1000000.0;
+    const MetricHistogramSnapshot db = GetHistogramDelta(sample.db, last_sample_.db);
+    rates_.requests_rate = static_cast<double>(sample.requests - last_sample_.requests) / seconds;
+    rates_.errors_rate = static_cast<double>(sample.errors - last_sample_.errors) / seconds;
+    rates_.shed_rate = static_cast<double>(sample.shed - last_sample_.shed) / seconds;
+    rates_.db_rate = static_cast<double>(db.count) / seconds;
+    rates_.db_p50 = GetHistogramPercentile(db, 0.5);
+    rates_.db_p90 = GetHistogramPercentile(db, 0.9);
+    rates_.db_p99 = GetHistogramPercentile(db, 0.99);
+  }
+  last_sample_ = sample;
+}
+
+RuntimeStatsSnapshot RuntimeStats::GetSnapshot() const {
+  const uint64_t memory_rss = GetMemoryRss();
+  std::unique_lock<std::mutex> lock(mutex_);
+  RuntimeStatsSnapshot snapshot = rates_;
+  snapshot.uptime = (GetMonotonicUsec() - start_usec_) / 1000;
+  snapshot.memory_rss = memory_rss;
+  for (auto it = loops_.begin(); it != loops_.end(); ++it) {
+    snapshot.loops.push_back(it->second);
+  }
+  snapshot.subscribers = subscribers_;
+  snapshot.subscribers.users = users_.size();
+  return snapshot;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,121 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fastotv/types.h>
+
+#include "base/loop_lag_monitor.h"
+#include "base/metrics.h"
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+struct LoopStats {
+  LoopStats();
+  LoopStats(const std::string& name, size_t connections, const LoopLagMonitor& monitor);
+
+  std::string name;
+  size_t connections;
+  common::time64_t lag;      // msec
+  common::time64_t max_lag;  // msec
+  LoopLagMonitor::LoadLevel level;
+};
+
+struct SubscribersStats {
+  typedef std::map<fastotv::stream_id_t, size_t> watchers_t;
+
+  SubscribersStats();
+
+  size_t users;         // distinct logged in users
+  size_t connections;   // logged in connections of subscribers and http loops
+  watchers_t watchers;  // connections per watched stream
+};
+
+struct RuntimeStatsSnapshot {
+  RuntimeStatsSnapshot();
+
+  common::time64_t uptime;  // msec
+  uint64_t memory_rss;      // bytes
+  std::vector<LoopStats> loops;
+  SubscribersStats subscribers;
+  // per second and usec over last completed rate window
+  double requests_rate;
+  double errors_rate;
+  double shed_rate;
+  double db_rate;
+  uint64_t db_p50;
+  uint64_t db_p90;
+  uint64_t db_p99;
+};
+
+// resident set size of process in bytes, 0 if unknown
+uint64_t GetMemoryRss();
+
+// Loops publish their state from own timers and report subscribers as they log in, switch stream and leave,
+// daemon reads consistent copy of all of them on demand, so stats requests never touch other loops data.
+class RuntimeStats {
+ public:
+  enum { rate_window_seconds = 10 };
+
+  static RuntimeStats& GetInstance();
+
+  void UpdateLoop(const LoopStats& loop);
+  void AddSubscriber(const fastotv::user_id_t& user);
+  void ChangeSubscriberStream(const fastotv::stream_id_t& previous, const fastotv::stream_id_t& current);
+  void RemoveSubscriber(const fastotv::user_id_t& user, const fastotv::stream_id_t& sid);
+  // should be called periodically, turns metrics deltas into rates and db percentiles once per window
+  void Sample(uint64_t now_usec);
+
+  RuntimeStatsSnapshot GetSnapshot() const;
+
+ private:
+  struct MetricsSample {
+    MetricsSample();
+
+    uint64_t time_usec;
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t shed;
+    MetricHistogramSnapshot db;
+  };
+
+  RuntimeStats();
+  RuntimeStats(const RuntimeStats&) = delete;
+  RuntimeStats& operator=(const RuntimeStats&) = delete;
+
+  static MetricsSample TakeSample(uint64_t now_usec);
+
+  const uint64_t start_usec_;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, LoopStats> loops_;
+  std::map<fastotv::user_id_t, size_t> users_;  // connections per user
+  SubscribersStats subscribers_;
+  MetricsSample last_sample_;
+  // only rates and db percentiles are filled
+  RuntimeStatsSnapshot rates_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,69 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/socket_tuning.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace {
+common::ErrnoError SetIntOption(common::net::socket_descr_t fd, int level, int name, int value) {
+  if (setsockopt(fd, level, name, &value, sizeof(value)) == -1) {
+    return common::make_errno_error(errno);
+  }
+  return common::ErrnoError();
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+SocketTuning::SocketTuning() : no_delay(true), send_buffer(0), receive_buffer(0) {}
+
+common::ErrnoError ApplySocketTuning(common::net::socket_descr_t fd, const SocketTuning& tuning) {
+  if (fd == INVALID_DESCRIPTOR) {
+    return common::make_errno_error_inval();
+  }
+
+  if (tuning.no_delay) {
+    // responses are small framed messages, don't hold them for nagle
+    common::ErrnoError err = SetIntOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    if (err) {
+      return err;
+    }
+  }
+
+  if (tuning.send_buffer > 0) {
+    common::ErrnoError err = SetIntOption(fd, SOL_SOCKET, SO_SNDBUF, tuning.send_buffer);
+    if (err) {
+      return err;
+    }
+  }
+
+  if (tuning.receive_buffer > 0) {
+    common::ErrnoError err = SetIntOption(fd, SOL_SOCKET, SO_RCVBUF, tuning.receive_buffer);
+    if (err) {
+      return err;
+    }
+  }
+
+  return common::ErrnoError();
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
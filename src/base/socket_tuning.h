@@ -0,0 +1,37 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/error.h>
+#include <common/net/types.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Options applied to every accepted client socket, zero buffer size keeps kernel default.
+struct SocketTuning {
+  SocketTuning();
+
+  bool no_delay;
+  int send_buffer;
+  int receive_buffer;
+};
+
+common::ErrnoError ApplySocketTuning(common::net::socket_descr_t fd, const SocketTuning& tuning) WARN_UNUSED_RESULT;
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
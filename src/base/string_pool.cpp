@@ -0,0 +1,132 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/string_pool.h"
+
+#include <functional>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+namespace {
+const char kSchemeSeparator[] = "://";
+}
+
+StringPool::CompactUrl::CompactUrl()
+    : origin(empty_string_id), directory(empty_string_id), file_name(empty_string_id) {}
+
+size_t StringPool::StringPtrHash::operator()(const std::string* str) const {
+  return std::hash<std::string>()(*str);
+}
+
+bool StringPool::StringPtrEqual::operator()(const std::string* lhs, const std::string* rhs) const {
+  return *lhs == *rhs;
+}
+
+StringPool::StringPool() : strings_(), index_(), bytes_(0) {
+  strings_.push_back(std::string());
+  index_[&strings_.back()] = empty_string_id;
+}
+
+StringPool::string_id_t StringPool::Intern(const std::string& str) {
+  const auto it = index_.find(&str);
+  if (it != index_.end()) {
+    return it->second;
+  }
+
+  const string_id_t id = static_cast<string_id_t>(strings_.size());
+  strings_.push_back(str);
+  index_[&strings_.back()] = id;
+  bytes_ += str.size();
+  return id;
+}
+
+bool StringPool::Find(const std::string& str, string_id_t* id) const {
+  if (!id) {
+    return false;
+  }
+
+  const auto it = index_.find(&str);
+  if (it == index_.end()) {
+    return false;
+  }
+  *id = it->second;
+  return true;
+}
+
+const std::string& StringPool::Get(string_id_t id) const {
+  if (id >= strings_.size()) {
+    return strings_[empty_string_id];
+  }
+  return strings_[id];
+}
+
+StringPool::CompactUrl StringPool::InternUrl(const std::string& url) {
+  CompactUrl result;
+  size_t path_start = 0;
+  const size_t scheme_end = url.find(kSchemeSeparator);
+  if (scheme_end != std::string::npos) {
+    path_start = url.find('/', scheme_end + sizeof(kSchemeSeparator) - 1);
+    if (path_start == std::string::npos) {
+      result.origin = Intern(url);
+      return result;
+    }
+    path_start++;
+  }
+
+  size_t file_start = url.rfind('/');
+  if (file_start == std::string::npos || file_start < path_start) {
+    file_start = path_start;
+  } else {
+    file_start++;
+  }
+
+  result.origin = Intern(url.substr(0, path_start));
+  result.directory = Intern(url.substr(path_start, file_start - path_start));
+  result.file_name = Intern(url.substr(file_start));
+  return result;
+}
+
+std::string StringPool::GetUrl(const CompactUrl& url) const {
+  const std::string& origin = Get(url.origin);
+  const std::string& directory = Get(url.directory);
+  const std::string& file_name = Get(url.file_name);
+  std::string result;
+  result.reserve(origin.size() + directory.size() + file_name.size());
+  result += origin;
+  result += directory;
+  result += file_name;
+  return result;
+}
+
+size_t StringPool::GetSize() const {
+  return strings_.size();
+}
+
+size_t StringPool::GetBytes() const {
+  return bytes_;
+}
+
+void StringPool::Clear() {
+  index_.clear();
+  strings_.clear();
+  bytes_ = 0;
+  strings_.push_back(std::string());
+  index_[&strings_.back()] = empty_string_id;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,75 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Interned strings live until Clear(), owners keep ids and drop them together with the pool (epoch reclaim).
+class StringPool {
+ public:
+  typedef uint32_t string_id_t;
+  enum : string_id_t { empty_string_id = 0 };
+
+  // url split into origin, directory and file name, each part interned on its own
+  struct CompactUrl {
+    CompactUrl();
+
+    string_id_t origin;
+    string_id_t directory;
+    string_id_t file_name;
+  };
+
+  StringPool();
+
+  string_id_t Intern(const std::string& str);
+  bool Find(const std::string& str, string_id_t* id) const;
+  const std::string& Get(string_id_t id) const;
+
+  CompactUrl InternUrl(const std::string& url);
+  std::string GetUrl(const CompactUrl& url) const;
+
+  size_t GetSize() const;
+  // payload bytes of unique strings
+  size_t GetBytes() const;
+  void Clear();
+
+ private:
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  struct StringPtrHash {
+    size_t operator()(const std::string* str) const;
+  };
+  struct StringPtrEqual {
+    bool operator()(const std::string* lhs, const std::string* rhs) const;
+  };
+
+  std::deque<std::string> strings_;  // stable addresses, indexed by id
+  std::unordered_map<const std::string*, string_id_t, StringPtrHash, StringPtrEqual> index_;
+  size_t bytes_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
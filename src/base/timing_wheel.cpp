@@ -0,0 +1,174 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/timing_wheel.h"
+
+namespace {
+const fastocloud::server::base::TimingWheel::tick_t kSlotMask = fastocloud::server::base::TimingWheel::slots_count - 1;
+
+size_t SlotIndex(fastocloud::server::base::TimingWheel::tick_t tick, size_t level) {
+  return (tick >> (level * fastocloud::server::base::TimingWheel::slot_bits)) & kSlotMask;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+TimingWheelNode::TimingWheelNode() : prev_(nullptr), next_(nullptr), expires_(0) {}
+
+TimingWheelNode::~TimingWheelNode() {
+  Unlink();
+}
+
+bool TimingWheelNode::IsScheduled() const {
+  return next_ != nullptr;
+}
+
+TimingWheelNode::tick_t TimingWheelNode::GetExpires() const {
+  return expires_;
+}
+
+void TimingWheelNode::Unlink() {
+  if (!next_) {
+    return;
+  }
+
+  prev_->next_ = next_;
+  next_->prev_ = prev_;
+  prev_ = nullptr;
+  next_ = nullptr;
+}
+
+const TimingWheel::tick_t TimingWheel::max_delay;
+
+TimingWheel::TimingWheel(tick_t now) : slots_(), current_(now) {
+  for (size_t level = 0; level < levels_count; ++level) {
+    for (size_t slot = 0; slot < slots_count; ++slot) {
+      TimingWheelNode* head = &slots_[level][slot];
+      head->prev_ = head;
+      head->next_ = head;
+    }
+  }
+}
+
+TimingWheel::~TimingWheel() {
+  for (size_t level = 0; level < levels_count; ++level) {
+    for (size_t slot = 0; slot < slots_count; ++slot) {
+      TimingWheelNode* head = &slots_[level][slot];
+      while (head->next_ != head) {
+        head->next_->Unlink();
+      }
+      head->prev_ = nullptr;
+      head->next_ = nullptr;
+    }
+  }
+}
+
+void TimingWheel::Schedule(TimingWheelNode* node, tick_t delay) {
+  if (!node) {
+    return;
+  }
+
+  if (delay == 0) {
+    delay = 1;
+  } else if (delay > max_delay) {
+    delay = max_delay;
+  }
+
+  node->Unlink();
+  node->expires_ = current_ + delay;
+  Insert(node);
+}
+
+void TimingWheel::Cancel(TimingWheelNode* node) {
+  if (!node) {
+    return;
+  }
+
+  node->Unlink();
+}
+
+void TimingWheel::Advance(tick_t now, std::vector<TimingWheelNode*>* expired) {
+  if (!expired) {
+    return;
+  }
+
+  while (current_ < now) {
+    Step(expired);
+  }
+}
+
+TimingWheel::tick_t TimingWheel::GetCurrentTick() const {
+  return current_;
+}
+
+void TimingWheel::Insert(TimingWheelNode* node) {
+  // overdue nodes (only possible while cascading) go to the slot processed next
+  const tick_t expires = node->expires_ > current_ ? node->expires_ : current_;
+  const tick_t diff = expires - current_;
+  size_t level = 0;
+  while (level + 1 < levels_count && diff >= (static_cast<tick_t>(1) << (slot_bits * (level + 1)))) {
+    level++;
+  }
+
+  TimingWheelNode* head = &slots_[level][SlotIndex(expires, level)];
+  node->prev_ = head->prev_;
+  node->next_ = head;
+  head->prev_->next_ = node;
+  head->prev_ = node;
+}
+
+void TimingWheel::Cascade(size_t level) {
+  TimingWheelNode* head = &slots_[level][SlotIndex(current_, level)];
+  TimingWheelNode list;
+  if (head->next_ == head) {
+    return;
+  }
+
+  // detach whole slot first, reinserted nodes may land in the same slot
+  list.next_ = head->next_;
+  list.prev_ = head->prev_;
+  list.next_->prev_ = &list;
+  list.prev_->next_ = &list;
+  head->next_ = head;
+  head->prev_ = head;
+
+  while (list.next_ != &list) {
+    TimingWheelNode* node = list.next_;
+    node->Unlink();
+    Insert(node);
+  }
+}
+
+void TimingWheel::Step(std::vector<TimingWheelNode*>* expired) {
+  current_++;
+  for (size_t level = 1; level < levels_count; ++level) {
+    if (SlotIndex(current_, level - 1) != 0) {
+      break;
+    }
+    Cascade(level);
+  }
+
+  TimingWheelNode* head = &slots_[0][SlotIndex(current_, 0)];
+  while (head->next_ != head) {
+    TimingWheelNode* node = head->next_;
+    node->Unlink();
+    expired->push_back(node);
+  }
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,85 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+class TimingWheel;
+
+// Intrusive entry, owner inherits it; destructor unlinks scheduled node.
+class TimingWheelNode {
+ public:
+  typedef uint64_t tick_t;
+
+  TimingWheelNode();
+  ~TimingWheelNode();
+
+  bool IsScheduled() const;
+  tick_t GetExpires() const;
+
+ private:
+  TimingWheelNode(const TimingWheelNode&) = delete;
+  TimingWheelNode& operator=(const TimingWheelNode&) = delete;
+  friend class TimingWheel;
+
+  void Unlink();
+
+  TimingWheelNode* prev_;
+  TimingWheelNode* next_;
+  tick_t expires_;
+};
+
+// Hierarchical timing wheel (4 levels x 64 slots), schedule/cancel are O(1),
+// Advance is O(1) amortized per tick plus expired nodes.
+class TimingWheel {
+ public:
+  typedef TimingWheelNode::tick_t tick_t;
+  enum { slot_bits = 6, slots_count = 1 << slot_bits, levels_count = 4 };
+  static const tick_t max_delay = (1ULL << (slot_bits * levels_count)) - 1;
+
+  explicit TimingWheel(tick_t now);
+  ~TimingWheel();
+
+  // delay in ticks, clamped to [1, max_delay], rescheduling a node moves it
+  void Schedule(TimingWheelNode* node, tick_t delay);
+  void Cancel(TimingWheelNode* node);
+
+  // moves wheel to now, expired nodes are unlinked and appended in expiration order
+  void Advance(tick_t now, std::vector<TimingWheelNode*>* expired);
+
+  tick_t GetCurrentTick() const;
+
+ private:
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel& operator=(const TimingWheel&) = delete;
+
+  void Insert(TimingWheelNode* node);
+  void Cascade(size_t level);
+  void Step(std::vector<TimingWheelNode*>* expired);
+
+  TimingWheelNode slots_[levels_count][slots_count];
+  tick_t current_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,212 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/token_bucket.h"
+
+namespace {
+const size_t kMinTableSize = 64;
+const size_t kMaxTableEntries = 1 << 20;
+const size_t kEvictScan = 32;
+
+uint64_t HashKey(const std::string& key) {
+  // fnv-1a, zero is reserved for empty buckets
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < key.size(); ++i) {
+    hash ^= static_cast<uint8_t>(key[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash ? hash : 1;
+}
+
+size_t CapacityForEntries(size_t entries) {
+  // keeps load factor of full table at 3/4
+  size_t capacity = kMinTableSize;
+  while (capacity * 3 < entries * 4) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+uint32_t BurstFromRate(uint32_t per_minute) {
+  // a quarter of the minute budget may be spent at once
+  return per_minute / 4 + 1;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+TokenBucketTable::TokenBucketTable(uint32_t per_minute, uint32_t burst, size_t max_entries)
+    : rate_per_msec_(static_cast<float>(per_minute) / 60000.f),
+      burst_(static_cast<float>(burst)),
+      max_capacity_(CapacityForEntries(max_entries)),
+      buckets_(),
+      size_(0),
+      clock_hand_(0) {}
+
+bool TokenBucketTable::IsEnabled() const {
+  return rate_per_msec_ > 0;
+}
+
+bool TokenBucketTable::Consume(const std::string& key, common::time64_t now_msec) {
+  if (!IsEnabled() || key.empty()) {
+    return true;
+  }
+
+  if (buckets_.empty()) {
+    Rehash(now_msec);
+  }
+
+  const uint64_t hash = HashKey(key);
+  Bucket* bucket = Find(hash);
+  if (!bucket->hash) {
+    if ((size_ + 1) * 4 > buckets_.size() * 3) {
+      if (buckets_.size() < max_capacity_) {
+        Rehash(now_msec);
+      } else {
+        Evict(now_msec);
+      }
+      bucket = Find(hash);
+    }
+    bucket->hash = hash;
+    bucket->tokens = burst_;
+    bucket->updated_msec = now_msec;
+    size_++;
+  }
+
+  bucket->tokens = Refill(*bucket, now_msec);
+  bucket->updated_msec = now_msec;
+  if (bucket->tokens < 1.f) {
+    return false;
+  }
+
+  bucket->tokens -= 1.f;
+  return true;
+}
+
+size_t TokenBucketTable::GetSize() const {
+  return size_;
+}
+
+float TokenBucketTable::Refill(const Bucket& bucket, common::time64_t now_msec) const {
+  if (now_msec <= bucket.updated_msec) {
+    return bucket.tokens;
+  }
+
+  const float tokens = bucket.tokens + static_cast<float>(now_msec - bucket.updated_msec) * rate_per_msec_;
+  return tokens < burst_ ? tokens : burst_;
+}
+
+TokenBucketTable::Bucket* TokenBucketTable::Find(uint64_t hash) {
+  const size_t mask = buckets_.size() - 1;
+  size_t pos = hash & mask;
+  while (buckets_[pos].hash && buckets_[pos].hash != hash) {
+    pos = (pos + 1) & mask;
+  }
+  return &buckets_[pos];
+}
+
+void TokenBucketTable::Rehash(common::time64_t now_msec) {
+  std::vector<Bucket> old;
+  old.swap(buckets_);
+
+  size_t active = 0;
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (old[i].hash && Refill(old[i], now_msec) < burst_) {
+      active++;
+    }
+  }
+
+  // only called below max capacity, so active buckets always fit
+  size_t capacity = kMinTableSize;
+  while (capacity < max_capacity_ && (active + 1) * 2 > capacity) {
+    capacity *= 2;
+  }
+
+  const Bucket empty = {0, 0.f, 0};
+  buckets_.assign(capacity, empty);
+  size_ = 0;
+  clock_hand_ = 0;
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (!old[i].hash || Refill(old[i], now_msec) >= burst_) {
+      continue;
+    }
+    *Find(old[i].hash) = old[i];
+    size_++;
+  }
+}
+
+void TokenBucketTable::Evict(common::time64_t now_msec) {
+  // full bucket is same as missing one, otherwise the least recently used of the scanned buckets goes
+  const size_t mask = buckets_.size() - 1;
+  size_t victim = buckets_.size();
+  for (size_t i = 0; i < kEvictScan; ++i) {
+    const size_t pos = (clock_hand_ + i) & mask;
+    const Bucket& bucket = buckets_[pos];
+    if (!bucket.hash) {
+      continue;
+    }
+    if (Refill(bucket, now_msec) >= burst_) {
+      victim = pos;
+      break;
+    }
+    if (victim == buckets_.size() || bucket.updated_msec < buckets_[victim].updated_msec) {
+      victim = pos;
+    }
+  }
+  clock_hand_ = (clock_hand_ + kEvictScan) & mask;
+
+  if (victim != buckets_.size()) {
+    Erase(victim);
+  }
+}
+
+void TokenBucketTable::Erase(size_t pos) {
+  // backward shift keeps probe chains of linear probing without tombstones
+  const size_t mask = buckets_.size() - 1;
+  size_t next = (pos + 1) & mask;
+  while (buckets_[next].hash) {
+    const size_t home = buckets_[next].hash & mask;
+    if (((next - home) & mask) >= ((next - pos) & mask)) {
+      buckets_[pos] = buckets_[next];
+      pos = next;
+    }
+    next = (next + 1) & mask;
+  }
+  buckets_[pos].hash = 0;
+  size_--;
+}
+
+AdmissionControl::AdmissionControl(uint32_t per_host, uint32_t per_user, uint32_t per_device)
+    : hosts_(per_host, BurstFromRate(per_host), kMaxTableEntries),
+      users_(per_user, BurstFromRate(per_user), kMaxTableEntries),
+      devices_(per_device, BurstFromRate(per_device), kMaxTableEntries) {}
+
+bool AdmissionControl::Admit(const std::string& host,
+                             const std::string& user,
+                             const std::string& device,
+                             common::time64_t now_msec) {
+  if (!hosts_.Consume(host, now_msec)) {
+    return false;
+  }
+  if (!users_.Consume(user, now_msec)) {
+    return false;
+  }
+  return devices_.Consume(device, now_msec);
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
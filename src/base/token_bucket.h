@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <common/time.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Token buckets keyed by string hash in open addressing table, buckets are refilled lazily on access.
+// Buckets which would be full again are dropped on rehash, so memory follows active keys only.
+// Full table evicts with clock hand, idle buckets first, so new keys never reset active ones wholesale.
+class TokenBucketTable {
+ public:
+  // per_minute == 0 disables limiting
+  TokenBucketTable(uint32_t per_minute, uint32_t burst, size_t max_entries);
+
+  bool IsEnabled() const;
+  bool Consume(const std::string& key, common::time64_t now_msec);
+
+  size_t GetSize() const;
+
+ private:
+  struct Bucket {
+    uint64_t hash;  // 0 for empty bucket
+    float tokens;
+    common::time64_t updated_msec;
+  };
+
+  float Refill(const Bucket& bucket, common::time64_t now_msec) const;
+  Bucket* Find(uint64_t hash);
+  void Rehash(common::time64_t now_msec);
+  void Evict(common::time64_t now_msec);
+  void Erase(size_t pos);
+
+  const float rate_per_msec_;
+  const float burst_;
+  const size_t max_capacity_;
+  std::vector<Bucket> buckets_;
+  size_t size_;
+  size_t clock_hand_;
+};
+
+// Admission for db backed requests, checked per source host, user and device.
+class AdmissionControl {
+ public:
+  // requests per minute, 0 disables scope
+  AdmissionControl(uint32_t per_host, uint32_t per_user, uint32_t per_device);
+
+  bool Admit(const std::string& host,
+             const std::string& user,
+             const std::string& device,
+             common::time64_t now_msec);
+
+ private:
+  TokenBucketTable hosts_;
+  TokenBucketTable users_;
+  TokenBucketTable devices_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
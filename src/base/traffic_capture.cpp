@@ -0,0 +1,533 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/traffic_capture.h"
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <utility>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <common/logging.h>
+
+#include "base/metrics.h"
+
+#define CAPTURE_LOGIN_FIELD "login"
+#define CAPTURE_PASSWORD_FIELD "password"
+#define CAPTURE_DEVICE_ID_FIELD "device_id"
+#define CAPTURE_PASSWORD_REPLACEMENT "anon"
+
+namespace {
+const uint64_t kWriteIntervalMsec = 100;
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+const char* const kDroppedHeaders[] = {"Cookie", "Authorization", "X-Forwarded-For", "X-Real-IP"};
+
+void PutUint16(uint16_t value, char* out) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    out[i] = static_cast<char>(value >> (i * 8));
+  }
+}
+
+void PutUint32(uint32_t value, char* out) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    out[i] = static_cast<char>(value >> (i * 8));
+  }
+}
+
+void PutUint64(uint64_t value, char* out) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    out[i] = static_cast<char>(value >> (i * 8));
+  }
+}
+
+uint16_t GetUint16(const char* in) {
+  uint16_t result = 0;
+  for (size_t i = 0; i < sizeof(result); ++i) {
+    result |= static_cast<uint16_t>(static_cast<uint8_t>(in[i])) << (i * 8);
+  }
+  return result;
+}
+
+uint32_t GetUint32(const char* in) {
+  uint32_t result = 0;
+  for (size_t i = 0; i < sizeof(result); ++i) {
+    result |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (i * 8);
+  }
+  return result;
+}
+
+uint64_t GetUint64(const char* in) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < sizeof(result); ++i) {
+    result |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (i * 8);
+  }
+  return result;
+}
+
+// fnv-1a with murmur finalizer, close ids give unrelated pseudonyms
+uint64_t HashValue(uint64_t hash, const std::string& value) {
+  for (size_t i = 0; i < value.size(); ++i) {
+    hash ^= static_cast<uint8_t>(value[i]);
+    hash *= kFnvPrime;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+void AppendHex(uint64_t value, size_t digits, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  for (size_t i = digits; i > 0; --i) {
+    out->push_back(kHex[(value >> ((i - 1) * 4)) & 0xf]);
+  }
+}
+
+template <typename F>
+bool AnonymizeJson(json_object* obj, const F& pseudonym) {
+  bool changed = false;
+  if (json_object_is_type(obj, json_type_array)) {
+    const size_t count = json_object_array_length(obj);
+    for (size_t i = 0; i < count; ++i) {
+      changed |= AnonymizeJson(json_object_array_get_idx(obj, i), pseudonym);
+    }
+    return changed;
+  }
+  if (!json_object_is_type(obj, json_type_object)) {
+    return false;
+  }
+
+  json_object_object_foreach(obj, key, val) {
+    if (json_object_is_type(val, json_type_string) &&
+        (strcmp(key, CAPTURE_LOGIN_FIELD) == 0 || strcmp(key, CAPTURE_DEVICE_ID_FIELD) == 0)) {
+      // replacing value of existing key doesn't invalidate iteration
+      json_object_object_add(obj, key, json_object_new_string(pseudonym(json_object_get_string(val)).c_str()));
+      changed = true;
+    } else if (json_object_is_type(val, json_type_string) && strcmp(key, CAPTURE_PASSWORD_FIELD) == 0) {
+      json_object_object_add(obj, key, json_object_new_string(CAPTURE_PASSWORD_REPLACEMENT));
+      changed = true;
+    } else {
+      changed |= AnonymizeJson(val, pseudonym);
+    }
+  }
+  return changed;
+}
+
+bool IsDroppedHeader(const std::string& line) {
+  const size_t colon = line.find(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+
+  for (size_t i = 0; i < sizeof(kDroppedHeaders) / sizeof(kDroppedHeaders[0]); ++i) {
+    if (strlen(kDroppedHeaders[i]) == colon && strncasecmp(line.c_str(), kDroppedHeaders[i], colon) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+TrafficRecord::TrafficRecord()
+    : offset_usec(0), source(SUBSCRIBERS_SOURCE), kind(FRAME_RECORD), connection(0), payload() {}
+
+TrafficCapture::Ring::Ring(size_t size) : data(size), head(0), tail(0) {}
+
+void TrafficCapture::Ring::CopyIn(uint64_t pos, const char* in, size_t size) {
+  const size_t offset = pos % data.size();
+  const size_t first = std::min(size, data.size() - offset);
+  memcpy(data.data() + offset, in, first);
+  memcpy(data.data(), in + first, size - first);
+}
+
+void TrafficCapture::Ring::CopyOut(uint64_t pos, char* out, size_t size) const {
+  const size_t offset = pos % data.size();
+  const size_t first = std::min(size, data.size() - offset);
+  memcpy(out, data.data() + offset, first);
+  memcpy(out + first, data.data(), size - first);
+}
+
+TrafficCapture::TrafficCapture(const std::string& path, size_t buffer_size)
+    : path_(path),
+      file_(nullptr),
+      salt_(0),
+      start_usec_(0),
+      subscribers_ring_(buffer_size),
+      http_ring_(buffer_size),
+      subscribers_records_(),
+      http_records_(),
+      recorded_(0),
+      dropped_(0),
+      write_errors_(0),
+      mutex_(),
+      cond_(),
+      wake_(false),
+      stop_(true),
+      writer_() {}
+
+TrafficCapture::~TrafficCapture() {
+  Stop();
+}
+
+common::ErrnoError TrafficCapture::Start() {
+  if (file_) {
+    return common::make_errno_error_inval();
+  }
+
+  file_ = fopen(path_.c_str(), "wb");
+  if (!file_) {
+    return common::make_errno_error("Can't open capture file: " + path_, errno);
+  }
+
+  char header[file_header_size];
+  PutUint32(file_magic, header);
+  PutUint16(file_version, header + 4);
+  PutUint16(0, header + 6);
+  PutUint64(common::time::current_utc_mstime(), header + 8);
+  if (fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+    const int err = errno;
+    fclose(file_);
+    file_ = nullptr;
+    return common::make_errno_error("Can't write capture file: " + path_, err);
+  }
+
+  // pseudonyms are stable inside one capture only
+  std::random_device device;
+  salt_ = (static_cast<uint64_t>(device()) << 32) | device();
+  start_usec_ = GetMonotonicUsec();
+  stop_ = false;
+  writer_ = std::thread(&TrafficCapture::WriteRoutine, this);
+  return common::ErrnoError();
+}
+
+void TrafficCapture::Stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_one();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+void TrafficCapture::RecordFrame(TrafficRecord::Source source, uint32_t connection, const char* data, size_t size) {
+  Push(source, TrafficRecord::FRAME_RECORD, connection, data, size);
+}
+
+void TrafficCapture::RecordClose(TrafficRecord::Source source, uint32_t connection) {
+  Push(source, TrafficRecord::CLOSE_RECORD, connection, nullptr, 0);
+}
+
+uint64_t TrafficCapture::GetRecorded() const {
+  return recorded_;
+}
+
+uint64_t TrafficCapture::GetDropped() const {
+  return dropped_;
+}
+
+uint64_t TrafficCapture::GetWriteErrors() const {
+  return write_errors_;
+}
+
+TrafficCapture::Ring* TrafficCapture::GetRing(TrafficRecord::Source source) {
+  return source == TrafficRecord::HTTP_SOURCE ? &http_ring_ : &subscribers_ring_;
+}
+
+void TrafficCapture::Push(TrafficRecord::Source source,
+                          TrafficRecord::Kind kind,
+                          uint32_t connection,
+                          const char* data,
+                          size_t size) {
+  Ring* ring = GetRing(source);
+  const size_t total = record_header_size + size;
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  const uint64_t used = head - ring->tail.load(std::memory_order_acquire);
+  if (stop_ || size > UINT32_MAX || total > ring->data.size() - used) {
+    dropped_++;
+    return;
+  }
+
+  char header[record_header_size];
+  PutUint64(GetMonotonicUsec() - start_usec_, header);
+  header[8] = static_cast<char>(source);
+  header[9] = static_cast<char>(kind);
+  PutUint32(connection, header + 10);
+  PutUint32(static_cast<uint32_t>(size), header + 14);
+  ring->CopyIn(head, header, record_header_size);
+  if (size) {
+    ring->CopyIn(head + record_header_size, data, size);
+  }
+  ring->head.store(head + total, std::memory_order_release);
+  recorded_++;
+
+  if (used + total >= ring->data.size() / 2 && !wake_.exchange(true)) {
+    cond_.notify_one();
+  }
+}
+
+void TrafficCapture::WriteRoutine() {
+  bool stop = false;
+  while (!stop) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait_for(lock, std::chrono::milliseconds(kWriteIntervalMsec), [this] { return stop_ || wake_; });
+      stop = stop_;
+      wake_ = false;
+    }
+
+    // records pushed later are newer than this, except ones whose loop was preempted between stamp and push
+    const uint64_t offset_usec = stop ? UINT64_MAX : GetMonotonicUsec() - start_usec_;
+    DrainRing(&subscribers_ring_, &subscribers_records_);
+    DrainRing(&http_ring_, &http_records_);
+    if (!WriteRecords(offset_usec)) {
+      const int err = errno;
+      write_errors_++;
+      stop_ = true;
+      ERROR_LOG() << "Traffic capture stopped, can't write capture file: " << path_ << ", " << strerror(err);
+      return;
+    }
+  }
+}
+
+void TrafficCapture::DrainRing(Ring* ring, std::deque<TrafficRecord>* records) {
+  const uint64_t head = ring->head.load(std::memory_order_acquire);
+  uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  while (tail != head) {
+    char header[record_header_size];
+    ring->CopyOut(tail, header, record_header_size);
+    TrafficRecord record;
+    record.offset_usec = GetUint64(header);
+    record.source = static_cast<TrafficRecord::Source>(header[8]);
+    record.kind = static_cast<TrafficRecord::Kind>(header[9]);
+    record.connection = GetUint32(header + 10);
+    record.payload.resize(GetUint32(header + 14));
+    if (!record.payload.empty()) {
+      ring->CopyOut(tail + record_header_size, &record.payload[0], record.payload.size());
+    }
+    tail += record_header_size + record.payload.size();
+    records->push_back(std::move(record));
+  }
+  ring->tail.store(tail, std::memory_order_release);
+}
+
+bool TrafficCapture::WriteRecords(uint64_t offset_usec) {
+  // every loop stamps its records in order, so merging fronts keeps file sorted
+  bool written = false;
+  while (true) {
+    std::deque<TrafficRecord>* records = nullptr;
+    if (!subscribers_records_.empty() && subscribers_records_.front().offset_usec < offset_usec) {
+      records = &subscribers_records_;
+    }
+    if (!http_records_.empty() && http_records_.front().offset_usec < offset_usec &&
+        (!records || http_records_.front().offset_usec < records->front().offset_usec)) {
+      records = &http_records_;
+    }
+    if (!records) {
+      break;
+    }
+
+    TrafficRecord& record = records->front();
+    Anonymize(&record);
+    if (!WriteRecord(record)) {
+      return false;
+    }
+    records->pop_front();
+    written = true;
+  }
+
+  return !written || fflush(file_) == 0;
+}
+
+bool TrafficCapture::WriteRecord(const TrafficRecord& record) {
+  char header[record_header_size];
+  PutUint64(record.offset_usec, header);
+  header[8] = static_cast<char>(record.source);
+  header[9] = static_cast<char>(record.kind);
+  PutUint32(record.connection, header + 10);
+  PutUint32(static_cast<uint32_t>(record.payload.size()), header + 14);
+  return fwrite(header, 1, sizeof(header), file_) == sizeof(header) &&
+         fwrite(record.payload.data(), 1, record.payload.size(), file_) == record.payload.size();
+}
+
+void TrafficCapture::Anonymize(TrafficRecord* record) const {
+  if (record->kind != TrafficRecord::FRAME_RECORD || record->payload.empty()) {
+    return;
+  }
+
+  if (record->source == TrafficRecord::HTTP_SOURCE) {
+    record->payload = AnonymizeHttp(record->payload);
+    return;
+  }
+
+  // binary frames have no credentials, logins are json only
+  json_object* obj = json_tokener_parse(record->payload.c_str());
+  if (!obj) {
+    return;
+  }
+
+  auto pseudonym = [this](const std::string& value) { return MakePseudonym(value); };
+  if (AnonymizeJson(obj, pseudonym)) {
+    record->payload = json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN);
+  }
+  json_object_put(obj);
+}
+
+std::string TrafficCapture::AnonymizeHttp(const std::string& request) const {
+  const size_t head_end = request.find("\r\n\r\n");
+  const std::string head = request.substr(0, head_end);
+  std::string result;
+  size_t start = 0;
+  bool first_line = true;
+  while (start <= head.size()) {
+    size_t end = head.find("\r\n", start);
+    if (end == std::string::npos) {
+      end = head.size();
+    }
+    const std::string line = head.substr(start, end - start);
+    start = end + 2;
+
+    if (first_line) {
+      first_line = false;
+      // GET /user_id/password_hash/device_id/stream_id/channel_id/file HTTP/1.1
+      const size_t path_start = line.find(' ');
+      const size_t path_end = line.rfind(' ');
+      if (path_start == std::string::npos || path_end <= path_start) {
+        result += line;
+        continue;
+      }
+
+      result += line.substr(0, path_start + 1);
+      const std::string path = line.substr(path_start + 1, path_end - path_start - 1);
+      size_t token_start = path.empty() || path[0] != '/' ? 0 : 1;
+      if (token_start) {
+        result += '/';
+      }
+      for (size_t token = 0; token_start <= path.size(); ++token) {
+        size_t token_end = path.find('/', token_start);
+        if (token_end == std::string::npos) {
+          token_end = path.size();
+        }
+        const std::string value = path.substr(token_start, token_end - token_start);
+        if (token == 1) {
+          result += CAPTURE_PASSWORD_REPLACEMENT;
+        } else if (token == 0 || token == 2) {
+          result += MakePseudonym(value);
+        } else {
+          result += value;
+        }
+        if (token_end < path.size()) {
+          result += '/';
+        }
+        token_start = token_end + 1;
+      }
+      result += line.substr(path_end);
+      continue;
+    }
+
+    if (!IsDroppedHeader(line)) {
+      result += "\r\n" + line;
+    }
+  }
+
+  if (head_end != std::string::npos) {
+    result += request.substr(head_end);
+  }
+  return result;
+}
+
+std::string TrafficCapture::MakePseudonym(const std::string& value) const {
+  // looks like an object id, replay tool maps it to one of its accounts
+  const uint64_t high = HashValue(kFnvOffsetBasis ^ salt_, value);
+  const uint64_t low = HashValue(high, value);
+  std::string result;
+  AppendHex(high, 16, &result);
+  AppendHex(low, 8, &result);
+  return result;
+}
+
+TrafficCaptureReader::TrafficCaptureReader() : file_(nullptr), start_time_(0) {}
+
+TrafficCaptureReader::~TrafficCaptureReader() {
+  Close();
+}
+
+common::ErrnoError TrafficCaptureReader::Open(const std::string& path) {
+  Close();
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_) {
+    return common::make_errno_error("Can't open capture file: " + path, errno);
+  }
+
+  char header[TrafficCapture::file_header_size];
+  if (fread(header, 1, sizeof(header), file_) != sizeof(header) || GetUint32(header) != TrafficCapture::file_magic ||
+      GetUint16(header + 4) != TrafficCapture::file_version) {
+    Close();
+    return common::make_errno_error("Invalid capture file: " + path, EINVAL);
+  }
+
+  start_time_ = static_cast<common::time64_t>(GetUint64(header + 8));
+  return common::ErrnoError();
+}
+
+bool TrafficCaptureReader::Next(TrafficRecord* record) {
+  char header[TrafficCapture::record_header_size];
+  if (!file_ || !record || fread(header, 1, sizeof(header), file_) != sizeof(header)) {
+    return false;
+  }
+
+  record->offset_usec = GetUint64(header);
+  record->source = static_cast<TrafficRecord::Source>(header[8]);
+  record->kind = static_cast<TrafficRecord::Kind>(header[9]);
+  record->connection = GetUint32(header + 10);
+  record->payload.resize(GetUint32(header + 14));
+  if (record->payload.empty()) {
+    return true;
+  }
+  return fread(&record->payload[0], 1, record->payload.size(), file_) == record->payload.size();
+}
+
+void TrafficCaptureReader::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+common::time64_t TrafficCaptureReader::GetStartTime() const {
+  return start_time_;
+}
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,142 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/error.h>
+#include <common/time.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+
+// Capture file is a header (magic, version, reserved, start utc msec) followed by records
+// (usec since start, source, kind, connection, payload size, payload), integers are little endian.
+struct TrafficRecord {
+  enum Source : uint8_t { SUBSCRIBERS_SOURCE = 1, HTTP_SOURCE = 2 };
+  enum Kind : uint8_t { FRAME_RECORD = 1, CLOSE_RECORD = 2 };
+
+  TrafficRecord();
+
+  uint64_t offset_usec;
+  Source source;
+  Kind kind;
+  uint32_t connection;  // client fd, reused by next connection after close record
+  std::string payload;
+};
+
+// Records inbound frames of subscribers and http loops. Every loop copies frames into its own ring buffer
+// without locks, frames which don't fit are dropped and counted, loops never wait for disk.
+// Writer thread merges rings by time, anonymizes credentials and appends records to the file:
+// logins and device/user ids become salted pseudonyms of 24 hex digits, passwords are replaced,
+// cookies, authorization and forwarding headers are removed, binary frames are stored as is.
+// Failed write stops capture, file keeps records written before it.
+class TrafficCapture {
+ public:
+  enum : uint32_t { file_magic = 0x50414346, file_version = 1 };  // "FCAP"
+  enum : size_t { file_header_size = 16, record_header_size = 18 };
+
+  // buffer_size is per loop
+  TrafficCapture(const std::string& path, size_t buffer_size);
+  ~TrafficCapture();
+
+  common::ErrnoError Start() WARN_UNUSED_RESULT;
+  // writes what is left in buffers
+  void Stop();
+
+  // every source is recorded from its loop thread only
+  void RecordFrame(TrafficRecord::Source source, uint32_t connection, const char* data, size_t size);
+  void RecordClose(TrafficRecord::Source source, uint32_t connection);
+
+  uint64_t GetRecorded() const;
+  uint64_t GetDropped() const;
+  uint64_t GetWriteErrors() const;
+
+ private:
+  // single producer single consumer byte ring, producer is source loop, consumer is writer
+  struct Ring {
+    explicit Ring(size_t size);
+
+    void CopyIn(uint64_t pos, const char* data, size_t size);
+    void CopyOut(uint64_t pos, char* data, size_t size) const;
+
+    std::vector<char> data;
+    std::atomic<uint64_t> head;  // total bytes pushed, written by producer
+    std::atomic<uint64_t> tail;  // total bytes taken, written by consumer
+  };
+
+  Ring* GetRing(TrafficRecord::Source source);
+  void Push(TrafficRecord::Source source, TrafficRecord::Kind kind, uint32_t connection, const char* data, size_t size);
+  void WriteRoutine();
+  void DrainRing(Ring* ring, std::deque<TrafficRecord>* records);
+  // writes records older than offset_usec in time order
+  bool WriteRecords(uint64_t offset_usec) WARN_UNUSED_RESULT;
+  bool WriteRecord(const TrafficRecord& record) WARN_UNUSED_RESULT;
+
+  void Anonymize(TrafficRecord* record) const;
+  std::string AnonymizeHttp(const std::string& request) const;
+  std::string MakePseudonym(const std::string& value) const;
+
+  const std::string path_;
+  FILE* file_;
+  uint64_t salt_;
+  uint64_t start_usec_;
+
+  Ring subscribers_ring_;
+  Ring http_ring_;
+  std::deque<TrafficRecord> subscribers_records_;  // drained, not written yet, writer only
+  std::deque<TrafficRecord> http_records_;
+  std::atomic<uint64_t> recorded_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> write_errors_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::atomic<bool> wake_;
+  std::atomic<bool> stop_;
+  std::thread writer_;
+};
+
+// Sequential reader of capture files, used by replay tool.
+class TrafficCaptureReader {
+ public:
+  TrafficCaptureReader();
+  ~TrafficCaptureReader();
+
+  common::ErrnoError Open(const std::string& path) WARN_UNUSED_RESULT;
+  // false at the end of file or on truncated record
+  bool Next(TrafficRecord* record);
+  void Close();
+
+  common::time64_t GetStartTime() const;
+
+ private:
+  FILE* file_;
+  common::time64_t start_time_;
+};
+
+}  // namespace base
+}  // namespace server
+}  // namespace fastocloud
@@ -30,6 +30,54 @@
 #define SERVICE_CATCHUP_HOST_FIELD "catchups_host"
 #define SERVICE_CATCHUP_HTTP_ROOT_FIELD "catchups_http_root"
 #define SERVICE_LICENSE_KEY_FIELD "license_key"
+#define SERVICE_SUBSCRIBERS_COMPRESSION_FIELD "subscribers_compression"
+#define SERVICE_SUBSCRIBERS_PING_INTERVAL_FIELD "subscribers_ping_interval"
+#define SERVICE_SUBSCRIBERS_IDLE_TIMEOUT_FIELD "subscribers_idle_timeout"
+#define SERVICE_SUBSCRIBERS_OUTPUT_HIGH_WATERMARK_FIELD "subscribers_output_high_watermark"
+#define SERVICE_SUBSCRIBERS_OUTPUT_QUEUE_LIMIT_FIELD "subscribers_output_queue_limit"
+#define SERVICE_SUBSCRIBERS_SLOW_CONSUMER_TIMEOUT_FIELD "subscribers_slow_consumer_timeout"
+#define SERVICE_RATE_LIMIT_PER_HOST_FIELD "rate_limit_per_host"
+#define SERVICE_RATE_LIMIT_PER_USER_FIELD "rate_limit_per_user"
+#define SERVICE_RATE_LIMIT_PER_DEVICE_FIELD "rate_limit_per_device"
+#define SERVICE_SUBSCRIBERS_REQUEST_QUEUE_LIMIT_FIELD "subscribers_request_queue_limit"
+#define SERVICE_LOOP_LAG_DEGRADED_THRESHOLD_FIELD "loop_lag_degraded_threshold"
+#define SERVICE_LOOP_LAG_OVERLOADED_THRESHOLD_FIELD "loop_lag_overloaded_threshold"
+#define SERVICE_LISTEN_BACKLOG_FIELD "listen_backlog"
+#define SERVICE_TCP_NODELAY_FIELD "tcp_nodelay"
+#define SERVICE_TCP_SEND_BUFFER_FIELD "tcp_send_buffer"
+#define SERVICE_TCP_RECEIVE_BUFFER_FIELD "tcp_receive_buffer"
+#define SERVICE_CATALOG_CACHE_TTL_FIELD "catalog_cache_ttl"
+#define SERVICE_CAPTURE_PATH_FIELD "capture_path"
+#define SERVICE_CAPTURE_BUFFER_SIZE_FIELD "capture_buffer_size"
+#define SERVICE_MONGO_SLOW_THRESHOLD_FIELD "mongo_slow_threshold"
+#define SERVICE_TRACE_PATH_FIELD "trace_path"
+#define SERVICE_TRACE_SAMPLE_INTERVAL_FIELD "trace_sample_interval"
+#define SERVICE_HTTP_METRICS_FIELD "http_metrics"
+#define SERVICE_EDGES_FIELD "edges"
+#define SERVICE_EDGE_ORIGINS_FIELD "edge_origins"
+#define SERVICE_EDGE_BALANCE_FIELD "edge_balance"
+#define SERVICE_EDGE_LOAD_FACTOR_FIELD "edge_load_factor"
+#define SERVICE_EDGE_REPORT_TIMEOUT_FIELD "edge_report_timeout"
+
+#define DEFAULT_SUBSCRIBERS_PING_INTERVAL 60
+#define DEFAULT_SUBSCRIBERS_IDLE_TIMEOUT 180
+#define DEFAULT_SUBSCRIBERS_OUTPUT_HIGH_WATERMARK (1024 * 1024)
+#define DEFAULT_SUBSCRIBERS_OUTPUT_QUEUE_LIMIT (4 * 1024 * 1024)
+#define DEFAULT_SUBSCRIBERS_SLOW_CONSUMER_TIMEOUT 30
+#define DEFAULT_RATE_LIMIT_PER_HOST 300
+#define DEFAULT_RATE_LIMIT_PER_USER 60
+#define DEFAULT_RATE_LIMIT_PER_DEVICE 30
+#define DEFAULT_SUBSCRIBERS_REQUEST_QUEUE_LIMIT 1024
+#define DEFAULT_LOOP_LAG_DEGRADED_THRESHOLD 200
+#define DEFAULT_LOOP_LAG_OVERLOADED_THRESHOLD 1000
+#define DEFAULT_LISTEN_BACKLOG 4096
+#define DEFAULT_CATALOG_CACHE_TTL 0
+#define DEFAULT_CAPTURE_BUFFER_SIZE (16 * 1024 * 1024)
+#define DEFAULT_MONGO_SLOW_THRESHOLD 100
+#define DEFAULT_TRACE_SAMPLE_INTERVAL 1000
+#define DEFAULT_EDGE_BALANCE "least_connections"
+#define DEFAULT_EDGE_LOAD_FACTOR 125
+#define DEFAULT_EDGE_REPORT_TIMEOUT 30
 
 #define DUMMY_LOG_FILE_PATH "/dev/null"
 
@@ -83,6 +131,62 @@ common::ErrnoError ReadConfigFile(const std::string& path, common::HashValue** a
       options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
     } else if (pair.first == SERVICE_LICENSE_KEY_FIELD) {
       options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_COMPRESSION_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_PING_INTERVAL_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_IDLE_TIMEOUT_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_OUTPUT_HIGH_WATERMARK_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_OUTPUT_QUEUE_LIMIT_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_SLOW_CONSUMER_TIMEOUT_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_RATE_LIMIT_PER_HOST_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_RATE_LIMIT_PER_USER_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_RATE_LIMIT_PER_DEVICE_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_SUBSCRIBERS_REQUEST_QUEUE_LIMIT_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_LOOP_LAG_DEGRADED_THRESHOLD_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_LOOP_LAG_OVERLOADED_THRESHOLD_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_LISTEN_BACKLOG_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_TCP_NODELAY_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_TCP_SEND_BUFFER_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_TCP_RECEIVE_BUFFER_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_CATALOG_CACHE_TTL_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_CAPTURE_PATH_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_CAPTURE_BUFFER_SIZE_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_MONGO_SLOW_THRESHOLD_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_TRACE_PATH_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_TRACE_SAMPLE_INTERVAL_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_HTTP_METRICS_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_EDGES_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_EDGE_ORIGINS_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_EDGE_BALANCE_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_EDGE_LOAD_FACTOR_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
+    } else if (pair.first == SERVICE_EDGE_REPORT_TIMEOUT_FIELD) {
+      options->Insert(pair.first, common::Value::CreateStringValueFromBasicString(pair.second));
     }
   }
 
@@ -103,7 +207,35 @@ Config::Config()
       epg_url(EPG_URL),
       catchup_host(GetCatchupDefaultHost()),
       catchups_http_root(CATCHUPS_HTTP_ROOT),
-      license_key() {}
+      license_key(),
+      subscribers_compression(true),
+      subscribers_ping_interval(DEFAULT_SUBSCRIBERS_PING_INTERVAL),
+      subscribers_idle_timeout(DEFAULT_SUBSCRIBERS_IDLE_TIMEOUT),
+      subscribers_output_high_watermark(DEFAULT_SUBSCRIBERS_OUTPUT_HIGH_WATERMARK),
+      subscribers_output_queue_limit(DEFAULT_SUBSCRIBERS_OUTPUT_QUEUE_LIMIT),
+      subscribers_slow_consumer_timeout(DEFAULT_SUBSCRIBERS_SLOW_CONSUMER_TIMEOUT),
+      rate_limit_per_host(DEFAULT_RATE_LIMIT_PER_HOST),
+      rate_limit_per_user(DEFAULT_RATE_LIMIT_PER_USER),
+      rate_limit_per_device(DEFAULT_RATE_LIMIT_PER_DEVICE),
+      subscribers_request_queue_limit(DEFAULT_SUBSCRIBERS_REQUEST_QUEUE_LIMIT),
+      loop_lag_degraded_threshold(DEFAULT_LOOP_LAG_DEGRADED_THRESHOLD),
+      loop_lag_overloaded_threshold(DEFAULT_LOOP_LAG_OVERLOADED_THRESHOLD),
+      listen_backlog(DEFAULT_LISTEN_BACKLOG),
+      tcp_nodelay(true),
+      tcp_send_buffer(0),
+      tcp_receive_buffer(0),
+      catalog_cache_ttl(DEFAULT_CATALOG_CACHE_TTL),
+      capture_path(),
+      capture_buffer_size(DEFAULT_CAPTURE_BUFFER_SIZE),
+      mongo_slow_threshold(DEFAULT_MONGO_SLOW_THRESHOLD),
+      trace_path(),
+      trace_sample_interval(DEFAULT_TRACE_SAMPLE_INTERVAL),
+      http_metrics(false),
+      edges(),
+      edge_origins(),
+      edge_balance(DEFAULT_EDGE_BALANCE),
+      edge_load_factor(DEFAULT_EDGE_LOAD_FACTOR),
+      edge_report_timeout(DEFAULT_EDGE_REPORT_TIMEOUT) {}
 
 common::net::HostAndPort Config::GetDefaultHost() {
   common::net::HostAndPort result;
@@ -211,6 +343,212 @@ common::ErrnoError load_config_from_file(const std::string& config_absolute_path
   }
   lconfig.catchups_http_root = catchups_http_root;
 
+  common::Value* compression_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_COMPRESSION_FIELD);
+  std::string compression_str;
+  if (!compression_field || !compression_field->GetAsBasicString(&compression_str) ||
+      !common::ConvertFromString(compression_str, &lconfig.subscribers_compression)) {
+    lconfig.subscribers_compression = true;
+  }
+
+  common::Value* ping_interval_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_PING_INTERVAL_FIELD);
+  std::string ping_interval_str;
+  if (!ping_interval_field || !ping_interval_field->GetAsBasicString(&ping_interval_str) ||
+      !common::ConvertFromString(ping_interval_str, &lconfig.subscribers_ping_interval) ||
+      lconfig.subscribers_ping_interval == 0) {
+    lconfig.subscribers_ping_interval = DEFAULT_SUBSCRIBERS_PING_INTERVAL;
+  }
+
+  common::Value* idle_timeout_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_IDLE_TIMEOUT_FIELD);
+  std::string idle_timeout_str;
+  if (!idle_timeout_field || !idle_timeout_field->GetAsBasicString(&idle_timeout_str) ||
+      !common::ConvertFromString(idle_timeout_str, &lconfig.subscribers_idle_timeout) ||
+      lconfig.subscribers_idle_timeout <= lconfig.subscribers_ping_interval) {
+    // peer must have at least one ping interval to answer
+    lconfig.subscribers_idle_timeout = lconfig.subscribers_ping_interval * 3;
+  }
+
+  common::Value* high_watermark_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_OUTPUT_HIGH_WATERMARK_FIELD);
+  std::string high_watermark_str;
+  if (!high_watermark_field || !high_watermark_field->GetAsBasicString(&high_watermark_str) ||
+      !common::ConvertFromString(high_watermark_str, &lconfig.subscribers_output_high_watermark) ||
+      lconfig.subscribers_output_high_watermark == 0) {
+    lconfig.subscribers_output_high_watermark = DEFAULT_SUBSCRIBERS_OUTPUT_HIGH_WATERMARK;
+  }
+
+  common::Value* queue_limit_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_OUTPUT_QUEUE_LIMIT_FIELD);
+  std::string queue_limit_str;
+  if (!queue_limit_field || !queue_limit_field->GetAsBasicString(&queue_limit_str) ||
+      !common::ConvertFromString(queue_limit_str, &lconfig.subscribers_output_queue_limit) ||
+      lconfig.subscribers_output_queue_limit < lconfig.subscribers_output_high_watermark) {
+    lconfig.subscribers_output_queue_limit = lconfig.subscribers_output_high_watermark * 4;
+  }
+
+  common::Value* slow_consumer_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_SLOW_CONSUMER_TIMEOUT_FIELD);
+  std::string slow_consumer_str;
+  if (!slow_consumer_field || !slow_consumer_field->GetAsBasicString(&slow_consumer_str) ||
+      !common::ConvertFromString(slow_consumer_str, &lconfig.subscribers_slow_consumer_timeout) ||
+      lconfig.subscribers_slow_consumer_timeout == 0) {
+    lconfig.subscribers_slow_consumer_timeout = DEFAULT_SUBSCRIBERS_SLOW_CONSUMER_TIMEOUT;
+  }
+
+  // 0 disables limit
+  common::Value* rate_host_field = slave_config_args->Find(SERVICE_RATE_LIMIT_PER_HOST_FIELD);
+  std::string rate_host_str;
+  if (!rate_host_field || !rate_host_field->GetAsBasicString(&rate_host_str) ||
+      !common::ConvertFromString(rate_host_str, &lconfig.rate_limit_per_host)) {
+    lconfig.rate_limit_per_host = DEFAULT_RATE_LIMIT_PER_HOST;
+  }
+
+  common::Value* rate_user_field = slave_config_args->Find(SERVICE_RATE_LIMIT_PER_USER_FIELD);
+  std::string rate_user_str;
+  if (!rate_user_field || !rate_user_field->GetAsBasicString(&rate_user_str) ||
+      !common::ConvertFromString(rate_user_str, &lconfig.rate_limit_per_user)) {
+    lconfig.rate_limit_per_user = DEFAULT_RATE_LIMIT_PER_USER;
+  }
+
+  common::Value* rate_device_field = slave_config_args->Find(SERVICE_RATE_LIMIT_PER_DEVICE_FIELD);
+  std::string rate_device_str;
+  if (!rate_device_field || !rate_device_field->GetAsBasicString(&rate_device_str) ||
+      !common::ConvertFromString(rate_device_str, &lconfig.rate_limit_per_device)) {
+    lconfig.rate_limit_per_device = DEFAULT_RATE_LIMIT_PER_DEVICE;
+  }
+
+  common::Value* request_queue_field = slave_config_args->Find(SERVICE_SUBSCRIBERS_REQUEST_QUEUE_LIMIT_FIELD);
+  std::string request_queue_str;
+  if (!request_queue_field || !request_queue_field->GetAsBasicString(&request_queue_str) ||
+      !common::ConvertFromString(request_queue_str, &lconfig.subscribers_request_queue_limit) ||
+      lconfig.subscribers_request_queue_limit == 0) {
+    lconfig.subscribers_request_queue_limit = DEFAULT_SUBSCRIBERS_REQUEST_QUEUE_LIMIT;
+  }
+
+  common::Value* lag_degraded_field = slave_config_args->Find(SERVICE_LOOP_LAG_DEGRADED_THRESHOLD_FIELD);
+  std::string lag_degraded_str;
+  if (!lag_degraded_field || !lag_degraded_field->GetAsBasicString(&lag_degraded_str) ||
+      !common::ConvertFromString(lag_degraded_str, &lconfig.loop_lag_degraded_threshold) ||
+      lconfig.loop_lag_degraded_threshold == 0) {
+    lconfig.loop_lag_degraded_threshold = DEFAULT_LOOP_LAG_DEGRADED_THRESHOLD;
+  }
+
+  common::Value* lag_overloaded_field = slave_config_args->Find(SERVICE_LOOP_LAG_OVERLOADED_THRESHOLD_FIELD);
+  std::string lag_overloaded_str;
+  if (!lag_overloaded_field || !lag_overloaded_field->GetAsBasicString(&lag_overloaded_str) ||
+      !common::ConvertFromString(lag_overloaded_str, &lconfig.loop_lag_overloaded_threshold) ||
+      lconfig.loop_lag_overloaded_threshold < lconfig.loop_lag_degraded_threshold) {
+    lconfig.loop_lag_overloaded_threshold = lconfig.loop_lag_degraded_threshold * 5;
+  }
+
+  // kernel caps backlog with net.core.somaxconn
+  common::Value* backlog_field = slave_config_args->Find(SERVICE_LISTEN_BACKLOG_FIELD);
+  std::string backlog_str;
+  if (!backlog_field || !backlog_field->GetAsBasicString(&backlog_str) ||
+      !common::ConvertFromString(backlog_str, &lconfig.listen_backlog) || lconfig.listen_backlog <= 0) {
+    lconfig.listen_backlog = DEFAULT_LISTEN_BACKLOG;
+  }
+
+  common::Value* nodelay_field = slave_config_args->Find(SERVICE_TCP_NODELAY_FIELD);
+  std::string nodelay_str;
+  if (!nodelay_field || !nodelay_field->GetAsBasicString(&nodelay_str) ||
+      !common::ConvertFromString(nodelay_str, &lconfig.tcp_nodelay)) {
+    lconfig.tcp_nodelay = true;
+  }
+
+  common::Value* send_buffer_field = slave_config_args->Find(SERVICE_TCP_SEND_BUFFER_FIELD);
+  std::string send_buffer_str;
+  if (!send_buffer_field || !send_buffer_field->GetAsBasicString(&send_buffer_str) ||
+      !common::ConvertFromString(send_buffer_str, &lconfig.tcp_send_buffer) || lconfig.tcp_send_buffer < 0) {
+    lconfig.tcp_send_buffer = 0;
+  }
+
+  common::Value* receive_buffer_field = slave_config_args->Find(SERVICE_TCP_RECEIVE_BUFFER_FIELD);
+  std::string receive_buffer_str;
+  if (!receive_buffer_field || !receive_buffer_field->GetAsBasicString(&receive_buffer_str) ||
+      !common::ConvertFromString(receive_buffer_str, &lconfig.tcp_receive_buffer) || lconfig.tcp_receive_buffer < 0) {
+    lconfig.tcp_receive_buffer = 0;
+  }
+
+  common::Value* catalog_ttl_field = slave_config_args->Find(SERVICE_CATALOG_CACHE_TTL_FIELD);
+  std::string catalog_ttl_str;
+  if (!catalog_ttl_field || !catalog_ttl_field->GetAsBasicString(&catalog_ttl_str) ||
+      !common::ConvertFromString(catalog_ttl_str, &lconfig.catalog_cache_ttl)) {
+    lconfig.catalog_cache_ttl = DEFAULT_CATALOG_CACHE_TTL;
+  }
+
+  common::Value* capture_path_field = slave_config_args->Find(SERVICE_CAPTURE_PATH_FIELD);
+  std::string capture_path;
+  if (capture_path_field && capture_path_field->GetAsBasicString(&capture_path)) {
+    lconfig.capture_path = capture_path;
+  }
+
+  common::Value* capture_buffer_field = slave_config_args->Find(SERVICE_CAPTURE_BUFFER_SIZE_FIELD);
+  std::string capture_buffer_str;
+  if (!capture_buffer_field || !capture_buffer_field->GetAsBasicString(&capture_buffer_str) ||
+      !common::ConvertFromString(capture_buffer_str, &lconfig.capture_buffer_size) ||
+      lconfig.capture_buffer_size == 0) {
+    lconfig.capture_buffer_size = DEFAULT_CAPTURE_BUFFER_SIZE;
+  }
+
+  common::Value* mongo_slow_field = slave_config_args->Find(SERVICE_MONGO_SLOW_THRESHOLD_FIELD);
+  std::string mongo_slow_str;
+  if (!mongo_slow_field || !mongo_slow_field->GetAsBasicString(&mongo_slow_str) ||
+      !common::ConvertFromString(mongo_slow_str, &lconfig.mongo_slow_threshold)) {
+    lconfig.mongo_slow_threshold = DEFAULT_MONGO_SLOW_THRESHOLD;
+  }
+
+  common::Value* trace_path_field = slave_config_args->Find(SERVICE_TRACE_PATH_FIELD);
+  std::string trace_path;
+  if (trace_path_field && trace_path_field->GetAsBasicString(&trace_path)) {
+    lconfig.trace_path = trace_path;
+  }
+
+  common::Value* trace_sample_field = slave_config_args->Find(SERVICE_TRACE_SAMPLE_INTERVAL_FIELD);
+  std::string trace_sample_str;
+  if (!trace_sample_field || !trace_sample_field->GetAsBasicString(&trace_sample_str) ||
+      !common::ConvertFromString(trace_sample_str, &lconfig.trace_sample_interval) ||
+      lconfig.trace_sample_interval == 0) {
+    lconfig.trace_sample_interval = DEFAULT_TRACE_SAMPLE_INTERVAL;
+  }
+
+  common::Value* http_metrics_field = slave_config_args->Find(SERVICE_HTTP_METRICS_FIELD);
+  std::string http_metrics_str;
+  if (!http_metrics_field || !http_metrics_field->GetAsBasicString(&http_metrics_str) ||
+      !common::ConvertFromString(http_metrics_str, &lconfig.http_metrics)) {
+    lconfig.http_metrics = false;
+  }
+
+  common::Value* edges_field = slave_config_args->Find(SERVICE_EDGES_FIELD);
+  std::string edges;
+  if (edges_field && edges_field->GetAsBasicString(&edges)) {
+    lconfig.edges = edges;
+  }
+
+  common::Value* edge_origins_field = slave_config_args->Find(SERVICE_EDGE_ORIGINS_FIELD);
+  std::string edge_origins;
+  if (edge_origins_field && edge_origins_field->GetAsBasicString(&edge_origins)) {
+    lconfig.edge_origins = edge_origins;
+  }
+
+  common::Value* edge_balance_field = slave_config_args->Find(SERVICE_EDGE_BALANCE_FIELD);
+  if (!edge_balance_field || !edge_balance_field->GetAsBasicString(&lconfig.edge_balance) ||
+      lconfig.edge_balance.empty()) {
+    lconfig.edge_balance = DEFAULT_EDGE_BALANCE;
+  }
+
+  // bounded loads need some headroom over fair share
+  common::Value* edge_load_field = slave_config_args->Find(SERVICE_EDGE_LOAD_FACTOR_FIELD);
+  std::string edge_load_str;
+  if (!edge_load_field || !edge_load_field->GetAsBasicString(&edge_load_str) ||
+      !common::ConvertFromString(edge_load_str, &lconfig.edge_load_factor) || lconfig.edge_load_factor <= 100) {
+    lconfig.edge_load_factor = DEFAULT_EDGE_LOAD_FACTOR;
+  }
+
+  common::Value* edge_timeout_field = slave_config_args->Find(SERVICE_EDGE_REPORT_TIMEOUT_FIELD);
+  std::string edge_timeout_str;
+  if (!edge_timeout_field || !edge_timeout_field->GetAsBasicString(&edge_timeout_str) ||
+      !common::ConvertFromString(edge_timeout_str, &lconfig.edge_report_timeout) ||
+      lconfig.edge_report_timeout == 0) {
+    lconfig.edge_report_timeout = DEFAULT_EDGE_REPORT_TIMEOUT;
+  }
+
   *config = lconfig;
   delete slave_config_args;
   return common::ErrnoError();
@@ -45,6 +45,34 @@ struct Config {
   common::net::HostAndPort catchup_host;
   common::file_system::ascii_directory_string_path catchups_http_root;
   license_t license_key;
+  bool subscribers_compression;
+  uint32_t subscribers_ping_interval;          // sec
+  uint32_t subscribers_idle_timeout;           // sec
+  uint32_t subscribers_output_high_watermark;  // bytes
+  uint32_t subscribers_output_queue_limit;     // bytes
+  uint32_t subscribers_slow_consumer_timeout;  // sec
+  uint32_t rate_limit_per_host;                // requests per minute
+  uint32_t rate_limit_per_user;                // requests per minute
+  uint32_t rate_limit_per_device;              // requests per minute
+  uint32_t subscribers_request_queue_limit;    // queued login and bulk requests, per queue
+  uint32_t loop_lag_degraded_threshold;        // msec
+  uint32_t loop_lag_overloaded_threshold;      // msec
+  int listen_backlog;
+  bool tcp_nodelay;
+  int tcp_send_buffer;             // bytes, 0 kernel default
+  int tcp_receive_buffer;          // bytes, 0 kernel default
+  uint32_t catalog_cache_ttl;      // sec, 0 disables catalog cache, admin panel edits are served stale up to it
+  std::string capture_path;        // inbound traffic capture file, empty disables capture
+  uint32_t capture_buffer_size;    // bytes per loop
+  uint32_t mongo_slow_threshold;   // msec, db operations above it are logged, 0 disables
+  std::string trace_path;          // chrome trace file of sampled requests, empty disables tracing
+  uint32_t trace_sample_interval;  // every n-th request is traced
+  bool http_metrics;               // serve /metrics on http_host, keep off unless http_host is private
+  std::string edges;               // static edges for proxy streams, comma separated url[;capacity]
+  std::string edge_origins;        // comma separated origins mirrored by edges, other streams aren't redirected
+  std::string edge_balance;        // least_connections or response_time
+  uint32_t edge_load_factor;       // percent of fair share edge may take before streams spill over
+  uint32_t edge_report_timeout;    // sec, reporting edge is unhealthy without fresh report
 };
 
 common::ErrnoError load_config_from_file(const std::string& config_absolute_path, Config* config) WARN_UNUSED_RESULT;
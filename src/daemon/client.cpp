@@ -86,6 +86,77 @@ common::ErrnoError ProtocoledDaemonClient::Pong(fastotv::protocol::sequance_id_t
   return WriteResponse(resp);
 }
 
+common::ErrnoError ProtocoledDaemonClient::Pong(fastotv::protocol::sequance_id_t id, const ServerStatsInfo& pong) {
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = PingServiceResponce(id, pong, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+  return WriteResponse(resp);
+}
+
+common::ErrnoError ProtocoledDaemonClient::Stats(fastotv::protocol::sequance_id_t id, const ServerStatsInfo& stats) {
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = StatsResponse(id, stats, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+  return WriteResponse(resp);
+}
+
+common::ErrnoError ProtocoledDaemonClient::SlowQueries(fastotv::protocol::sequance_id_t id,
+                                                       const SlowQueriesInfo& queries) {
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = SlowQueriesResponse(id, queries, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+  return WriteResponse(resp);
+}
+
+common::ErrnoError ProtocoledDaemonClient::SetLogLevelFail(fastotv::protocol::sequance_id_t id, common::Error err) {
+  const std::string error_str = err->GetDescription();
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = SetLogLevelResponseFail(id, error_str, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+
+  return WriteResponse(resp);
+}
+
+common::ErrnoError ProtocoledDaemonClient::SetLogLevelSuccess(fastotv::protocol::sequance_id_t id,
+                                                              const LogLevelInfo& level) {
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = SetLogLevelResponse(id, level, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+
+  return WriteResponse(resp);
+}
+
+common::ErrnoError ProtocoledDaemonClient::EdgeReportFail(fastotv::protocol::sequance_id_t id, common::Error err) {
+  const std::string error_str = err->GetDescription();
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = EdgeReportResponseFail(id, error_str, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+
+  return WriteResponse(resp);
+}
+
+common::ErrnoError ProtocoledDaemonClient::EdgeReportSuccess(fastotv::protocol::sequance_id_t id) {
+  fastotv::protocol::response_t resp;
+  common::Error err_ser = EdgeReportResponse(id, &resp);
+  if (err_ser) {
+    return common::make_errno_error(err_ser->GetDescription(), EAGAIN);
+  }
+
+  return WriteResponse(resp);
+}
+
 common::ErrnoError ProtocoledDaemonClient::ActivateFail(fastotv::protocol::sequance_id_t id, common::Error err) {
   const std::string error_str = err->GetDescription();
   fastotv::protocol::response_t resp;
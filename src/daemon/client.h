@@ -24,6 +24,10 @@
 
 #include <common/daemon/commands/ping_info.h>
 
+#include "daemon/log_level_info.h"
+#include "daemon/server_stats_info.h"
+#include "daemon/slow_queries_info.h"
+
 namespace fastocloud {
 namespace server {
 
@@ -42,6 +46,19 @@ class ProtocoledDaemonClient : public fastotv::protocol::ProtocolClient<common::
   common::ErrnoError Pong(fastotv::protocol::sequance_id_t id) WARN_UNUSED_RESULT;
   common::ErrnoError Pong(fastotv::protocol::sequance_id_t id,
                           const common::daemon::commands::ServerPingInfo& pong) WARN_UNUSED_RESULT;
+  common::ErrnoError Pong(fastotv::protocol::sequance_id_t id, const ServerStatsInfo& pong) WARN_UNUSED_RESULT;
+
+  common::ErrnoError Stats(fastotv::protocol::sequance_id_t id, const ServerStatsInfo& stats) WARN_UNUSED_RESULT;
+
+  common::ErrnoError SlowQueries(fastotv::protocol::sequance_id_t id,
+                                 const SlowQueriesInfo& queries) WARN_UNUSED_RESULT;
+
+  common::ErrnoError SetLogLevelFail(fastotv::protocol::sequance_id_t id, common::Error err) WARN_UNUSED_RESULT;
+  common::ErrnoError SetLogLevelSuccess(fastotv::protocol::sequance_id_t id,
+                                        const LogLevelInfo& level) WARN_UNUSED_RESULT;
+
+  common::ErrnoError EdgeReportFail(fastotv::protocol::sequance_id_t id, common::Error err) WARN_UNUSED_RESULT;
+  common::ErrnoError EdgeReportSuccess(fastotv::protocol::sequance_id_t id) WARN_UNUSED_RESULT;
 
   common::ErrnoError ActivateFail(fastotv::protocol::sequance_id_t id, common::Error err) WARN_UNUSED_RESULT;
   common::ErrnoError ActivateSuccess(fastotv::protocol::sequance_id_t id) WARN_UNUSED_RESULT;
@@ -24,6 +24,10 @@
 
 #define DAEMON_STOP_SERVICE "stop_service"  // {"delay": 0 }
 #define DAEMON_PING_SERVICE "ping_service"
+#define DAEMON_GET_SLOW_QUERIES "get_slow_queries"
+#define DAEMON_SET_LOG_LEVEL "set_log_level"  // {"level": "DEBUG"}
+#define DAEMON_GET_STATS "get_stats"
+#define DAEMON_EDGE_REPORT "edge_report"  // {"id": "edge1", "url": "http://edge1:8000", "connections": 10}
 
 #define DAEMON_SERVER_PING "ping_client"
 
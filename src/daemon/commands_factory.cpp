@@ -101,6 +101,24 @@ common::Error PingServiceResponce(fastotv::protocol::sequance_id_t id,
   return common::Error();
 }
 
+common::Error PingServiceResponce(fastotv::protocol::sequance_id_t id,
+                                  const ServerStatsInfo& ping,
+                                  fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  std::string ping_server_json;
+  common::Error err_ser = ping.SerializeToString(&ping_server_json);
+  if (err_ser) {
+    return err_ser;
+  }
+
+  *resp = fastotv::protocol::response_t::MakeMessage(
+      id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage(ping_server_json));
+  return common::Error();
+}
+
 common::Error PingServiceResponceFail(fastotv::protocol::sequance_id_t id,
                                       const std::string& error_text,
                                       fastotv::protocol::response_t* resp) {
@@ -113,6 +131,94 @@ common::Error PingServiceResponceFail(fastotv::protocol::sequance_id_t id,
   return common::Error();
 }
 
+common::Error SlowQueriesResponse(fastotv::protocol::sequance_id_t id,
+                                  const SlowQueriesInfo& queries,
+                                  fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  std::string queries_json;
+  common::Error err_ser = queries.SerializeToString(&queries_json);
+  if (err_ser) {
+    return err_ser;
+  }
+
+  *resp = fastotv::protocol::response_t::MakeMessage(
+      id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage(queries_json));
+  return common::Error();
+}
+
+common::Error StatsResponse(fastotv::protocol::sequance_id_t id,
+                            const ServerStatsInfo& stats,
+                            fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  std::string stats_json;
+  common::Error err_ser = stats.SerializeToString(&stats_json);
+  if (err_ser) {
+    return err_ser;
+  }
+
+  *resp = fastotv::protocol::response_t::MakeMessage(
+      id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage(stats_json));
+  return common::Error();
+}
+
+common::Error SetLogLevelResponse(fastotv::protocol::sequance_id_t id,
+                                  const LogLevelInfo& level,
+                                  fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  std::string level_json;
+  common::Error err_ser = level.SerializeToString(&level_json);
+  if (err_ser) {
+    return err_ser;
+  }
+
+  *resp = fastotv::protocol::response_t::MakeMessage(
+      id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage(level_json));
+  return common::Error();
+}
+
+common::Error SetLogLevelResponseFail(fastotv::protocol::sequance_id_t id,
+                                      const std::string& error_text,
+                                      fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  *resp = fastotv::protocol::response_t::MakeError(
+      id, common::protocols::json_rpc::JsonRPCError::MakeServerErrorFromText(error_text));
+  return common::Error();
+}
+
+common::Error EdgeReportResponse(fastotv::protocol::sequance_id_t id, fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  *resp =
+      fastotv::protocol::response_t::MakeMessage(id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage());
+  return common::Error();
+}
+
+common::Error EdgeReportResponseFail(fastotv::protocol::sequance_id_t id,
+                                     const std::string& error_text,
+                                     fastotv::protocol::response_t* resp) {
+  if (!resp) {
+    return common::make_error_inval();
+  }
+
+  *resp = fastotv::protocol::response_t::MakeError(
+      id, common::protocols::json_rpc::JsonRPCError::MakeServerErrorFromText(error_text));
+  return common::Error();
+}
+
 common::Error ActivateResponse(fastotv::protocol::sequance_id_t id, fastotv::protocol::response_t* resp) {
   if (!resp) {
     return common::make_error_inval();
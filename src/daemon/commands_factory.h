@@ -21,6 +21,11 @@
 #include <common/daemon/commands/ping_info.h>
 #include <common/daemon/commands/stop_info.h>
 
+#include "daemon/edge_info.h"
+#include "daemon/log_level_info.h"
+#include "daemon/server_stats_info.h"
+#include "daemon/slow_queries_info.h"
+
 namespace fastocloud {
 namespace server {
 
@@ -41,10 +46,33 @@ common::Error StopServiceResponseFail(fastotv::protocol::sequance_id_t id,
 common::Error PingServiceResponce(fastotv::protocol::sequance_id_t id,
                                   const common::daemon::commands::ServerPingInfo& ping,
                                   fastotv::protocol::response_t* resp);
+common::Error PingServiceResponce(fastotv::protocol::sequance_id_t id,
+                                  const ServerStatsInfo& ping,
+                                  fastotv::protocol::response_t* resp);
 common::Error PingServiceResponceFail(fastotv::protocol::sequance_id_t id,
                                       const std::string& error_text,
                                       fastotv::protocol::response_t* resp);
 
+common::Error SlowQueriesResponse(fastotv::protocol::sequance_id_t id,
+                                  const SlowQueriesInfo& queries,
+                                  fastotv::protocol::response_t* resp);
+
+common::Error StatsResponse(fastotv::protocol::sequance_id_t id,
+                            const ServerStatsInfo& stats,
+                            fastotv::protocol::response_t* resp);
+
+common::Error SetLogLevelResponse(fastotv::protocol::sequance_id_t id,
+                                  const LogLevelInfo& level,
+                                  fastotv::protocol::response_t* resp);
+common::Error SetLogLevelResponseFail(fastotv::protocol::sequance_id_t id,
+                                      const std::string& error_text,
+                                      fastotv::protocol::response_t* resp);
+
+common::Error EdgeReportResponse(fastotv::protocol::sequance_id_t id, fastotv::protocol::response_t* resp);
+common::Error EdgeReportResponseFail(fastotv::protocol::sequance_id_t id,
+                                     const std::string& error_text,
+                                     fastotv::protocol::response_t* resp);
+
 common::Error ActivateResponse(fastotv::protocol::sequance_id_t id, fastotv::protocol::response_t* resp);
 common::Error ActivateResponseFail(fastotv::protocol::sequance_id_t id,
                                    const std::string& error_text,
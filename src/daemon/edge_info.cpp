@@ -0,0 +1,90 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "daemon/edge_info.h"
+
+#include <string>
+
+#define EDGE_INFO_ID_FIELD "id"
+#define EDGE_INFO_URL_FIELD "url"
+#define EDGE_INFO_CAPACITY_FIELD "capacity"
+#define EDGE_INFO_WEIGHT_FIELD "weight"
+#define EDGE_INFO_CONNECTIONS_FIELD "connections"
+#define EDGE_INFO_RESPONSE_TIME_FIELD "response_time"
+#define EDGE_INFO_HEALTHY_FIELD "healthy"
+
+namespace fastocloud {
+namespace server {
+
+EdgeInfo::EdgeInfo() : node_() {}
+
+EdgeInfo::EdgeInfo(const base::EdgeNode& node) : node_(node) {}
+
+base::EdgeNode EdgeInfo::GetNode() const {
+  return node_;
+}
+
+common::Error EdgeInfo::SerializeFields(json_object* deserialized) const {
+  json_object_object_add(deserialized, EDGE_INFO_ID_FIELD, json_object_new_string(node_.id.c_str()));
+  json_object_object_add(deserialized, EDGE_INFO_URL_FIELD, json_object_new_string(node_.url.c_str()));
+  json_object_object_add(deserialized, EDGE_INFO_CAPACITY_FIELD, json_object_new_int64(node_.capacity));
+  json_object_object_add(deserialized, EDGE_INFO_WEIGHT_FIELD, json_object_new_int64(node_.weight));
+  json_object_object_add(deserialized, EDGE_INFO_CONNECTIONS_FIELD, json_object_new_int64(node_.connections));
+  json_object_object_add(deserialized, EDGE_INFO_RESPONSE_TIME_FIELD, json_object_new_int64(node_.response_time));
+  json_object_object_add(deserialized, EDGE_INFO_HEALTHY_FIELD, json_object_new_boolean(node_.healthy));
+  return common::Error();
+}
+
+common::Error EdgeInfo::DoDeSerialize(json_object* serialized) {
+  json_object* jid = nullptr;
+  if (!json_object_object_get_ex(serialized, EDGE_INFO_ID_FIELD, &jid) || !json_object_is_type(jid, json_type_string)) {
+    return common::make_error_inval();
+  }
+
+  json_object* jurl = nullptr;
+  if (!json_object_object_get_ex(serialized, EDGE_INFO_URL_FIELD, &jurl) ||
+      !json_object_is_type(jurl, json_type_string)) {
+    return common::make_error_inval();
+  }
+
+  base::EdgeNode node;
+  node.id = json_object_get_string(jid);
+  node.url = json_object_get_string(jurl);
+  if (!node.IsValid()) {
+    return common::make_error_inval();
+  }
+
+  json_object* jfield = nullptr;
+  if (json_object_object_get_ex(serialized, EDGE_INFO_CAPACITY_FIELD, &jfield)) {
+    node.capacity = json_object_get_int64(jfield);
+  }
+  if (json_object_object_get_ex(serialized, EDGE_INFO_WEIGHT_FIELD, &jfield)) {
+    node.weight = json_object_get_int64(jfield);
+  }
+  if (json_object_object_get_ex(serialized, EDGE_INFO_CONNECTIONS_FIELD, &jfield)) {
+    node.connections = json_object_get_int64(jfield);
+  }
+  if (json_object_object_get_ex(serialized, EDGE_INFO_RESPONSE_TIME_FIELD, &jfield)) {
+    node.response_time = json_object_get_int64(jfield);
+  }
+  if (json_object_object_get_ex(serialized, EDGE_INFO_HEALTHY_FIELD, &jfield)) {
+    node.healthy = json_object_get_boolean(jfield);
+  }
+
+  *this = EdgeInfo(node);
+  return common::Error();
+}
+
+}  // namespace server
+}  // namespace fastocloud
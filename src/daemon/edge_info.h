@@ -0,0 +1,43 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/serializer/json_serializer.h>
+
+#include "base/edge_registry.h"
+
+namespace fastocloud {
+namespace server {
+
+// load report of edge node, e.g.
+// {"id": "edge1", "url": "http://edge1:8000", "capacity": 1000, "weight": 1, "connections": 10,
+//  "response_time": 12, "healthy": true}
+class EdgeInfo : public common::serializer::JsonSerializer<EdgeInfo> {
+ public:
+  EdgeInfo();
+  explicit EdgeInfo(const base::EdgeNode& node);
+
+  base::EdgeNode GetNode() const;
+
+ protected:
+  common::Error DoDeSerialize(json_object* serialized) override;
+  common::Error SerializeFields(json_object* deserialized) const override;
+
+ private:
+  base::EdgeNode node_;
+};
+
+}  // namespace server
+}  // namespace fastocloud
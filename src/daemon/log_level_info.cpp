@@ -0,0 +1,53 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "daemon/log_level_info.h"
+
+#define LOG_LEVEL_INFO_LEVEL_FIELD "level"
+
+namespace fastocloud {
+namespace server {
+
+LogLevelInfo::LogLevelInfo() : level_(common::logging::LOG_LEVEL_INFO) {}
+
+LogLevelInfo::LogLevelInfo(common::logging::LOG_LEVEL level) : level_(level) {}
+
+common::logging::LOG_LEVEL LogLevelInfo::GetLevel() const {
+  return level_;
+}
+
+common::Error LogLevelInfo::SerializeFields(json_object* deserialized) const {
+  json_object_object_add(deserialized, LOG_LEVEL_INFO_LEVEL_FIELD,
+                         json_object_new_string(common::logging::log_level_to_text(level_)));
+  return common::Error();
+}
+
+common::Error LogLevelInfo::DoDeSerialize(json_object* serialized) {
+  json_object* jlevel = nullptr;
+  if (!json_object_object_get_ex(serialized, LOG_LEVEL_INFO_LEVEL_FIELD, &jlevel) ||
+      !json_object_is_type(jlevel, json_type_string)) {
+    return common::make_error_inval();
+  }
+
+  common::logging::LOG_LEVEL level;
+  if (!common::logging::text_to_log_level(json_object_get_string(jlevel), &level)) {
+    return common::make_error("Unknown log level");
+  }
+
+  *this = LogLevelInfo(level);
+  return common::Error();
+}
+
+}  // namespace server
+}  // namespace fastocloud
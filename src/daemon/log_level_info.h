@@ -0,0 +1,40 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/logging.h>
+#include <common/serializer/json_serializer.h>
+
+namespace fastocloud {
+namespace server {
+
+// log level by name as in config file, e.g. {"level": "DEBUG"}
+class LogLevelInfo : public common::serializer::JsonSerializer<LogLevelInfo> {
+ public:
+  LogLevelInfo();
+  explicit LogLevelInfo(common::logging::LOG_LEVEL level);
+
+  common::logging::LOG_LEVEL GetLevel() const;
+
+ protected:
+  common::Error DoDeSerialize(json_object* serialized) override;
+  common::Error SerializeFields(json_object* deserialized) const override;
+
+ private:
+  common::logging::LOG_LEVEL level_;
+};
+
+}  // namespace server
+}  // namespace fastocloud
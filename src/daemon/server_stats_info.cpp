@@ -0,0 +1,204 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "daemon/server_stats_info.h"
+
+#include <string>
+
+#define SERVER_STATS_INFO_TIMESTAMP_FIELD "timestamp"
+#define SERVER_STATS_INFO_UPTIME_FIELD "uptime"
+#define SERVER_STATS_INFO_MEMORY_RSS_FIELD "memory_rss"
+#define SERVER_STATS_INFO_LOOPS_FIELD "loops"
+#define SERVER_STATS_INFO_ONLINE_USERS_FIELD "online_users"
+#define SERVER_STATS_INFO_ONLINE_CONNECTIONS_FIELD "online_connections"
+#define SERVER_STATS_INFO_ACTIVE_STREAMS_FIELD "active_streams"
+#define SERVER_STATS_INFO_STREAMS_FIELD "streams"
+#define SERVER_STATS_INFO_REQUESTS_RATE_FIELD "requests_rate"
+#define SERVER_STATS_INFO_ERRORS_RATE_FIELD "errors_rate"
+#define SERVER_STATS_INFO_SHED_RATE_FIELD "shed_rate"
+#define SERVER_STATS_INFO_DB_FIELD "db"
+
+#define LOOP_STATS_NAME_FIELD "name"
+#define LOOP_STATS_CONNECTIONS_FIELD "connections"
+#define LOOP_STATS_LAG_FIELD "lag"
+#define LOOP_STATS_MAX_LAG_FIELD "max_lag"
+#define LOOP_STATS_LOAD_FIELD "load"
+
+#define STREAM_STATS_ID_FIELD "id"
+#define STREAM_STATS_WATCHERS_FIELD "watchers"
+
+#define DB_STATS_RATE_FIELD "rate"
+#define DB_STATS_P50_FIELD "p50"
+#define DB_STATS_P90_FIELD "p90"
+#define DB_STATS_P99_FIELD "p99"
+
+namespace {
+std::string GetStringField(json_object* obj, const char* field) {
+  json_object* jfield = nullptr;
+  if (!json_object_object_get_ex(obj, field, &jfield)) {
+    return std::string();
+  }
+  return json_object_get_string(jfield);
+}
+
+int64_t GetInt64Field(json_object* obj, const char* field) {
+  json_object* jfield = nullptr;
+  if (!json_object_object_get_ex(obj, field, &jfield)) {
+    return 0;
+  }
+  return json_object_get_int64(jfield);
+}
+
+double GetDoubleField(json_object* obj, const char* field) {
+  json_object* jfield = nullptr;
+  if (!json_object_object_get_ex(obj, field, &jfield)) {
+    return 0;
+  }
+  return json_object_get_double(jfield);
+}
+
+fastocloud::server::base::LoopLagMonitor::LoadLevel GetLoadLevelField(json_object* obj, const char* field) {
+  const std::string load = GetStringField(obj, field);
+  const fastocloud::server::base::LoopLagMonitor::LoadLevel levels[] = {
+      fastocloud::server::base::LoopLagMonitor::NORMAL_LOAD, fastocloud::server::base::LoopLagMonitor::DEGRADED_LOAD,
+      fastocloud::server::base::LoopLagMonitor::OVERLOADED};
+  for (size_t i = 0; i < SIZEOFMASS(levels); ++i) {
+    if (load == fastocloud::server::base::LoadLevelToString(levels[i])) {
+      return levels[i];
+    }
+  }
+  return fastocloud::server::base::LoopLagMonitor::NORMAL_LOAD;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+
+ServerStatsInfo::ServerStatsInfo() : stats_(), timestamp_(0), with_streams_(false) {}
+
+ServerStatsInfo::ServerStatsInfo(const base::RuntimeStatsSnapshot& stats, common::time64_t timestamp, bool with_streams)
+    : stats_(stats), timestamp_(timestamp), with_streams_(with_streams) {}
+
+base::RuntimeStatsSnapshot ServerStatsInfo::GetStats() const {
+  return stats_;
+}
+
+common::time64_t ServerStatsInfo::GetTimestamp() const {
+  return timestamp_;
+}
+
+common::Error ServerStatsInfo::SerializeFields(json_object* deserialized) const {
+  json_object_object_add(deserialized, SERVER_STATS_INFO_TIMESTAMP_FIELD, json_object_new_int64(timestamp_));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_UPTIME_FIELD, json_object_new_int64(stats_.uptime));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_MEMORY_RSS_FIELD, json_object_new_int64(stats_.memory_rss));
+
+  json_object* jloops = json_object_new_array();
+  for (size_t i = 0; i < stats_.loops.size(); ++i) {
+    const base::LoopStats& loop = stats_.loops[i];
+    json_object* jloop = json_object_new_object();
+    json_object_object_add(jloop, LOOP_STATS_NAME_FIELD, json_object_new_string(loop.name.c_str()));
+    json_object_object_add(jloop, LOOP_STATS_CONNECTIONS_FIELD, json_object_new_int64(loop.connections));
+    json_object_object_add(jloop, LOOP_STATS_LAG_FIELD, json_object_new_int64(loop.lag));
+    json_object_object_add(jloop, LOOP_STATS_MAX_LAG_FIELD, json_object_new_int64(loop.max_lag));
+    json_object_object_add(jloop, LOOP_STATS_LOAD_FIELD, json_object_new_string(base::LoadLevelToString(loop.level)));
+    json_object_array_add(jloops, jloop);
+  }
+  json_object_object_add(deserialized, SERVER_STATS_INFO_LOOPS_FIELD, jloops);
+
+  const base::SubscribersStats& subscribers = stats_.subscribers;
+  json_object_object_add(deserialized, SERVER_STATS_INFO_ONLINE_USERS_FIELD, json_object_new_int64(subscribers.users));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_ONLINE_CONNECTIONS_FIELD,
+                         json_object_new_int64(subscribers.connections));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_ACTIVE_STREAMS_FIELD,
+                         json_object_new_int64(subscribers.watchers.size()));
+  if (with_streams_) {
+    json_object* jstreams = json_object_new_array();
+    for (auto it = subscribers.watchers.begin(); it != subscribers.watchers.end(); ++it) {
+      json_object* jstream = json_object_new_object();
+      json_object_object_add(jstream, STREAM_STATS_ID_FIELD, json_object_new_string(it->first.c_str()));
+      json_object_object_add(jstream, STREAM_STATS_WATCHERS_FIELD, json_object_new_int64(it->second));
+      json_object_array_add(jstreams, jstream);
+    }
+    json_object_object_add(deserialized, SERVER_STATS_INFO_STREAMS_FIELD, jstreams);
+  }
+
+  json_object_object_add(deserialized, SERVER_STATS_INFO_REQUESTS_RATE_FIELD,
+                         json_object_new_double(stats_.requests_rate));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_ERRORS_RATE_FIELD, json_object_new_double(stats_.errors_rate));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_SHED_RATE_FIELD, json_object_new_double(stats_.shed_rate));
+
+  json_object* jdb = json_object_new_object();
+  json_object_object_add(jdb, DB_STATS_RATE_FIELD, json_object_new_double(stats_.db_rate));
+  json_object_object_add(jdb, DB_STATS_P50_FIELD, json_object_new_int64(stats_.db_p50));
+  json_object_object_add(jdb, DB_STATS_P90_FIELD, json_object_new_int64(stats_.db_p90));
+  json_object_object_add(jdb, DB_STATS_P99_FIELD, json_object_new_int64(stats_.db_p99));
+  json_object_object_add(deserialized, SERVER_STATS_INFO_DB_FIELD, jdb);
+  return common::Error();
+}
+
+common::Error ServerStatsInfo::DoDeSerialize(json_object* serialized) {
+  json_object* jloops = nullptr;
+  if (!json_object_object_get_ex(serialized, SERVER_STATS_INFO_LOOPS_FIELD, &jloops) ||
+      !json_object_is_type(jloops, json_type_array)) {
+    return common::make_error_inval();
+  }
+
+  ServerStatsInfo inf;
+  inf.timestamp_ = GetInt64Field(serialized, SERVER_STATS_INFO_TIMESTAMP_FIELD);
+  inf.stats_.uptime = GetInt64Field(serialized, SERVER_STATS_INFO_UPTIME_FIELD);
+  inf.stats_.memory_rss = GetInt64Field(serialized, SERVER_STATS_INFO_MEMORY_RSS_FIELD);
+
+  const size_t loops_len = json_object_array_length(jloops);
+  for (size_t i = 0; i < loops_len; ++i) {
+    json_object* jloop = json_object_array_get_idx(jloops, i);
+    base::LoopStats loop;
+    loop.name = GetStringField(jloop, LOOP_STATS_NAME_FIELD);
+    loop.connections = GetInt64Field(jloop, LOOP_STATS_CONNECTIONS_FIELD);
+    loop.lag = GetInt64Field(jloop, LOOP_STATS_LAG_FIELD);
+    loop.max_lag = GetInt64Field(jloop, LOOP_STATS_MAX_LAG_FIELD);
+    loop.level = GetLoadLevelField(jloop, LOOP_STATS_LOAD_FIELD);
+    inf.stats_.loops.push_back(loop);
+  }
+
+  inf.stats_.subscribers.users = GetInt64Field(serialized, SERVER_STATS_INFO_ONLINE_USERS_FIELD);
+  inf.stats_.subscribers.connections = GetInt64Field(serialized, SERVER_STATS_INFO_ONLINE_CONNECTIONS_FIELD);
+  json_object* jstreams = nullptr;
+  if (json_object_object_get_ex(serialized, SERVER_STATS_INFO_STREAMS_FIELD, &jstreams) &&
+      json_object_is_type(jstreams, json_type_array)) {
+    inf.with_streams_ = true;
+    const size_t streams_len = json_object_array_length(jstreams);
+    for (size_t i = 0; i < streams_len; ++i) {
+      json_object* jstream = json_object_array_get_idx(jstreams, i);
+      const std::string sid = GetStringField(jstream, STREAM_STATS_ID_FIELD);
+      inf.stats_.subscribers.watchers[sid] = GetInt64Field(jstream, STREAM_STATS_WATCHERS_FIELD);
+    }
+  }
+
+  inf.stats_.requests_rate = GetDoubleField(serialized, SERVER_STATS_INFO_REQUESTS_RATE_FIELD);
+  inf.stats_.errors_rate = GetDoubleField(serialized, SERVER_STATS_INFO_ERRORS_RATE_FIELD);
+  inf.stats_.shed_rate = GetDoubleField(serialized, SERVER_STATS_INFO_SHED_RATE_FIELD);
+  json_object* jdb = nullptr;
+  if (json_object_object_get_ex(serialized, SERVER_STATS_INFO_DB_FIELD, &jdb)) {
+    inf.stats_.db_rate = GetDoubleField(jdb, DB_STATS_RATE_FIELD);
+    inf.stats_.db_p50 = GetInt64Field(jdb, DB_STATS_P50_FIELD);
+    inf.stats_.db_p90 = GetInt64Field(jdb, DB_STATS_P90_FIELD);
+    inf.stats_.db_p99 = GetInt64Field(jdb, DB_STATS_P99_FIELD);
+  }
+
+  *this = inf;
+  return common::Error();
+}
+
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,47 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/serializer/json_serializer.h>
+#include <common/time.h>
+
+#include "base/runtime_stats.h"
+
+namespace fastocloud {
+namespace server {
+
+// live load of node, superset of ServerPingInfo so it is sent as pong too;
+// lags and uptime in msec, db latencies in usec, rates per second,
+// per stream watchers are serialized only when requested
+class ServerStatsInfo : public common::serializer::JsonSerializer<ServerStatsInfo> {
+ public:
+  ServerStatsInfo();
+  ServerStatsInfo(const base::RuntimeStatsSnapshot& stats, common::time64_t timestamp, bool with_streams);
+
+  base::RuntimeStatsSnapshot GetStats() const;
+  common::time64_t GetTimestamp() const;
+
+ protected:
+  common::Error DoDeSerialize(json_object* serialized) override;
+  common::Error SerializeFields(json_object* deserialized) const override;
+
+ private:
+  base::RuntimeStatsSnapshot stats_;
+  common::time64_t timestamp_;
+  bool with_streams_;
+};
+
+}  // namespace server
+}  // namespace fastocloud
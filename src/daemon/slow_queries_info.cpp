@@ -0,0 +1,109 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "daemon/slow_queries_info.h"
+
+#define SLOW_QUERIES_INFO_QUERIES_FIELD "queries"
+#define SLOW_QUERY_OPERATION_FIELD "operation"
+#define SLOW_QUERY_COMMAND_FIELD "command"
+#define SLOW_QUERY_COLLECTION_FIELD "collection"
+#define SLOW_QUERY_SHAPE_FIELD "shape"
+#define SLOW_QUERY_COUNT_FIELD "count"
+#define SLOW_QUERY_MAX_TIME_FIELD "max_time"
+#define SLOW_QUERY_TOTAL_TIME_FIELD "total_time"
+#define SLOW_QUERY_DOCUMENTS_FIELD "documents"
+#define SLOW_QUERY_BYTES_FIELD "bytes"
+#define SLOW_QUERY_LAST_SEEN_FIELD "last_seen"
+
+namespace {
+std::string GetStringField(json_object* obj, const char* field) {
+  json_object* jfield = nullptr;
+  if (!json_object_object_get_ex(obj, field, &jfield)) {
+    return std::string();
+  }
+  return json_object_get_string(jfield);
+}
+
+int64_t GetInt64Field(json_object* obj, const char* field) {
+  json_object* jfield = nullptr;
+  if (!json_object_object_get_ex(obj, field, &jfield)) {
+    return 0;
+  }
+  return json_object_get_int64(jfield);
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+
+SlowQueriesInfo::SlowQueriesInfo() : queries_() {}
+
+SlowQueriesInfo::SlowQueriesInfo(const queries_t& queries) : queries_(queries) {}
+
+SlowQueriesInfo::queries_t SlowQueriesInfo::GetQueries() const {
+  return queries_;
+}
+
+common::Error SlowQueriesInfo::SerializeFields(json_object* deserialized) const {
+  json_object* jqueries = json_object_new_array();
+  for (size_t i = 0; i < queries_.size(); ++i) {
+    const mongo::SlowQuery& query = queries_[i];
+    json_object* jquery = json_object_new_object();
+    json_object_object_add(jquery, SLOW_QUERY_OPERATION_FIELD, json_object_new_string(query.operation.c_str()));
+    json_object_object_add(jquery, SLOW_QUERY_COMMAND_FIELD, json_object_new_string(query.command.c_str()));
+    json_object_object_add(jquery, SLOW_QUERY_COLLECTION_FIELD, json_object_new_string(query.collection.c_str()));
+    json_object_object_add(jquery, SLOW_QUERY_SHAPE_FIELD, json_object_new_string(query.shape.c_str()));
+    json_object_object_add(jquery, SLOW_QUERY_COUNT_FIELD, json_object_new_int64(query.count));
+    json_object_object_add(jquery, SLOW_QUERY_MAX_TIME_FIELD, json_object_new_int64(query.max_usec / 1000));
+    json_object_object_add(jquery, SLOW_QUERY_TOTAL_TIME_FIELD, json_object_new_int64(query.total_usec / 1000));
+    json_object_object_add(jquery, SLOW_QUERY_DOCUMENTS_FIELD, json_object_new_int64(query.last_documents));
+    json_object_object_add(jquery, SLOW_QUERY_BYTES_FIELD, json_object_new_int64(query.last_bytes));
+    json_object_object_add(jquery, SLOW_QUERY_LAST_SEEN_FIELD, json_object_new_int64(query.last_seen));
+    json_object_array_add(jqueries, jquery);
+  }
+  json_object_object_add(deserialized, SLOW_QUERIES_INFO_QUERIES_FIELD, jqueries);
+  return common::Error();
+}
+
+common::Error SlowQueriesInfo::DoDeSerialize(json_object* serialized) {
+  json_object* jqueries = nullptr;
+  if (!json_object_object_get_ex(serialized, SLOW_QUERIES_INFO_QUERIES_FIELD, &jqueries) ||
+      !json_object_is_type(jqueries, json_type_array)) {
+    return common::make_error_inval();
+  }
+
+  SlowQueriesInfo inf;
+  const size_t len = json_object_array_length(jqueries);
+  for (size_t i = 0; i < len; ++i) {
+    json_object* jquery = json_object_array_get_idx(jqueries, i);
+    mongo::SlowQuery query;
+    query.operation = GetStringField(jquery, SLOW_QUERY_OPERATION_FIELD);
+    query.command = GetStringField(jquery, SLOW_QUERY_COMMAND_FIELD);
+    query.collection = GetStringField(jquery, SLOW_QUERY_COLLECTION_FIELD);
+    query.shape = GetStringField(jquery, SLOW_QUERY_SHAPE_FIELD);
+    query.count = GetInt64Field(jquery, SLOW_QUERY_COUNT_FIELD);
+    query.max_usec = GetInt64Field(jquery, SLOW_QUERY_MAX_TIME_FIELD) * 1000;
+    query.total_usec = GetInt64Field(jquery, SLOW_QUERY_TOTAL_TIME_FIELD) * 1000;
+    query.last_documents = GetInt64Field(jquery, SLOW_QUERY_DOCUMENTS_FIELD);
+    query.last_bytes = GetInt64Field(jquery, SLOW_QUERY_BYTES_FIELD);
+    query.last_seen = GetInt64Field(jquery, SLOW_QUERY_LAST_SEEN_FIELD);
+    inf.queries_.push_back(query);
+  }
+
+  *this = inf;
+  return common::Error();
+}
+
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,45 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <common/serializer/json_serializer.h>
+
+#include "mongo/mongo_operation.h"
+
+namespace fastocloud {
+namespace server {
+
+// slowest db query shapes, durations are serialized in msec
+class SlowQueriesInfo : public common::serializer::JsonSerializer<SlowQueriesInfo> {
+ public:
+  typedef std::vector<mongo::SlowQuery> queries_t;
+
+  SlowQueriesInfo();
+  explicit SlowQueriesInfo(const queries_t& queries);
+
+  queries_t GetQueries() const;
+
+ protected:
+  common::Error DoDeSerialize(json_object* serialized) override;
+  common::Error SerializeFields(json_object* deserialized) const override;
+
+ private:
+  queries_t queries_;
+};
+
+}  // namespace server
+}  // namespace fastocloud
@@ -29,6 +29,8 @@
 #include <common/utils.h>
 #endif
 
+#include "base/async_log.h"
+
 #include "process_slave_wrapper.h"
 
 #define HELP_TEXT                       \
@@ -147,6 +149,9 @@ int main(int argc, char** argv, char** envp) {
     return EXIT_FAILURE;
   }
 
+  // hot paths log through writer thread from now on
+  fastocloud::server::base::AsyncLogger::GetInstance().Start();
+
   // start
   fastocloud::server::ProcessSlaveWrapper wrapper(config);
   NOTICE_LOG() << "Running " PROJECT_VERSION_HUMAN << " in " << (run_as_daemon ? "daemon" : "common") << " mode";
@@ -157,6 +162,7 @@ int main(int argc, char** argv, char** envp) {
   }
 
   int res = wrapper.Exec();
+  fastocloud::server::base::AsyncLogger::GetInstance().Stop();
   NOTICE_LOG() << "Quiting " PROJECT_VERSION_HUMAN;
 
   err = pidfile.Unlock();
@@ -0,0 +1,98 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "http/auth_cache.h"
+
+#include <common/hash/md5.h>
+
+namespace {
+std::string HashPassword(const std::string& password) {
+  common::hash::MD5_CTX ctx;
+  common::hash::MD5_Init(&ctx);
+  common::hash::MD5_Update(&ctx, password.data(), password.size());
+  unsigned char digest[MD5_HASH_LENGHT];
+  common::hash::MD5_Final(digest, &ctx);
+  return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace http {
+
+AuthCache::AuthCache(common::time64_t ttl_msec, size_t max_entries)
+    : ttl_msec_(ttl_msec), max_entries_(max_entries), entries_(), index_() {}
+
+std::string AuthCache::MakeKey(const std::string& host,
+                               const std::string& user,
+                               const std::string& password,
+                               const std::string& device) {
+  // path tokens can't contain '/', digest has fixed size
+  return host + "/" + user + "/" + HashPassword(password) + "/" + device;
+}
+
+bool AuthCache::Find(const std::string& key, common::time64_t now_msec, base::ServerDBAuthInfo* auth) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+
+  if (it->second->expires_msec <= now_msec) {
+    entries_.erase(it->second);
+    index_.erase(it);
+    return false;
+  }
+
+  *auth = it->second->auth;
+  return true;
+}
+
+void AuthCache::Insert(const std::string& key, const base::ServerDBAuthInfo& auth, common::time64_t now_msec) {
+  if (ttl_msec_ <= 0 || max_entries_ == 0) {
+    return;
+  }
+
+  RemoveExpired(now_msec);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // refreshed entry expires last
+    entries_.splice(entries_.end(), entries_, it->second);
+    it->second->auth = auth;
+    it->second->expires_msec = now_msec + ttl_msec_;
+    return;
+  }
+
+  if (index_.size() >= max_entries_) {
+    index_.erase(entries_.front().key);
+    entries_.pop_front();
+  }
+
+  Entry entry = {key, auth, now_msec + ttl_msec_};
+  index_[key] = entries_.insert(entries_.end(), entry);
+}
+
+size_t AuthCache::GetSize() const {
+  return index_.size();
+}
+
+void AuthCache::RemoveExpired(common::time64_t now_msec) {
+  while (!entries_.empty() && entries_.front().expires_msec <= now_msec) {
+    index_.erase(entries_.front().key);
+    entries_.pop_front();
+  }
+}
+
+}  // namespace http
+}  // namespace server
+}  // namespace fastocloud
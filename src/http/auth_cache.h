@@ -0,0 +1,70 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <common/time.h>
+
+#include "base/server_auth_info.h"
+
+namespace fastocloud {
+namespace server {
+namespace http {
+
+// Logins verified against db, keyed by credentials and source host.
+// Players open new connection per segment, so without it every segment costs db login and rate limit token.
+// Cached login outlives password change or ban in db by up to ttl.
+// All entries share ttl, so insertion order is expiration order: expired entries leave from the front
+// and full cache evicts the oldest one, both O(1).
+class AuthCache {
+ public:
+  // ttl_msec == 0 disables caching
+  AuthCache(common::time64_t ttl_msec, size_t max_entries);
+
+  // password is kept only as its md5 digest
+  static std::string MakeKey(const std::string& host,
+                             const std::string& user,
+                             const std::string& password,
+                             const std::string& device);
+
+  bool Find(const std::string& key, common::time64_t now_msec, base::ServerDBAuthInfo* auth);
+  void Insert(const std::string& key, const base::ServerDBAuthInfo& auth, common::time64_t now_msec);
+
+  size_t GetSize() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    base::ServerDBAuthInfo auth;
+    common::time64_t expires_msec;
+  };
+  typedef std::list<Entry> entries_t;
+
+  void RemoveExpired(common::time64_t now_msec);
+
+  const common::time64_t ttl_msec_;
+  const size_t max_entries_;
+  entries_t entries_;  // oldest first
+  std::unordered_map<std::string, entries_t::iterator> index_;
+};
+
+}  // namespace http
+}  // namespace server
+}  // namespace fastocloud
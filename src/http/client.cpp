@@ -21,6 +21,18 @@ namespace http {
 HttpClient::HttpClient(common::libev::IoLoop* server, const common::net::socket_info& info)
     : base_class(server, info), is_verified_(false) {}
 
+void* HttpClient::operator new(size_t size) {
+  return base::ObjectPool<HttpClient>::Allocate(size);
+}
+
+void HttpClient::operator delete(void* ptr, size_t size) {
+  base::ObjectPool<HttpClient>::Deallocate(ptr, size);
+}
+
+base::ObjectPoolStats HttpClient::GetPoolStats() {
+  return base::ObjectPool<HttpClient>::GetStats();
+}
+
 bool HttpClient::IsVerified() const {
   return is_verified_;
 }
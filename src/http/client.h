@@ -16,6 +16,7 @@
 
 #include <common/libev/http/http_client.h>
 
+#include "base/object_pool.h"
 #include "base/subscriber_info.h"
 
 namespace fastocloud {
@@ -28,6 +29,11 @@ class HttpClient : public common::libev::http::HttpClient, public base::Subscrib
 
   HttpClient(common::libev::IoLoop* server, const common::net::socket_info& info);
 
+  // clients without keep-alive are deleted after every response, reuse their memory
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+  static base::ObjectPoolStats GetPoolStats();
+
   bool IsVerified() const;
   void SetVerified(bool verified);
 
@@ -18,24 +18,59 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <common/convert2string.h>
+#include <common/time.h>
 
+#include "base/async_log.h"
+#include "base/edge_registry.h"
 #include "base/isubscribers_manager.h"
+#include "base/metrics.h"
+#include "base/runtime_stats.h"
+#include "base/traffic_capture.h"
 
 #include "http/client.h"
 
+namespace {
+// not in common::http::http_status list
+const common::http::http_status kHttpTemporaryRedirect = static_cast<common::http::http_status>(307);
+const common::http::http_status kHttpTooManyRequests = static_cast<common::http::http_status>(429);
+const common::http::http_status kHttpServiceUnavailable = static_cast<common::http::http_status>(503);
+
+const char kMetricsPath[] = "metrics";
+const char kMetricsContentType[] = "text/plain; version=0.0.4";
+}  // namespace
+
 namespace fastocloud {
 namespace server {
 namespace http {
 
-HttpHandler::HttpHandler(base::ISubscribersManager* manager) : base_class(), manager_(manager) {}
+HttpHandler::HttpHandler(base::ISubscribersManager* manager,
+                         const Config& config,
+                         base::TrafficCapture* capture,
+                         base::EdgeRegistry* edges)
+    : base_class("http"),
+      manager_(manager),
+      admission_(config.rate_limit_per_host, config.rate_limit_per_user, config.rate_limit_per_device),
+      auth_cache_(auth_cache_ttl_seconds * 1000, auth_cache_max_entries),
+      lag_timer_id_(INVALID_TIMER_ID),
+      lag_monitor_("http", config.loop_lag_degraded_threshold, config.loop_lag_overloaded_threshold),
+      pool_metrics_("http_client"),
+      capture_(capture),
+      edges_(edges),
+      metrics_enabled_(config.http_metrics),
+      status_metrics_(),
+      sent_bytes_metric_(base::MetricsRegistry::GetInstance().GetCounter(
+          "fastocloud_http_sent_bytes_total",
+          "Bytes of files and metrics sent by http server, headers and error pages excluded.")) {}
 
 void HttpHandler::PreLooped(common::libev::IoLoop* server) {
-  UNUSED(server);
+  lag_monitor_.Start(base::GetMonotonicMsec());
+  lag_timer_id_ = server->CreateTimer(base::LoopLagMonitor::check_interval_seconds, true);
 }
 
 void HttpHandler::Accepted(common::libev::IoClient* client) {
@@ -48,6 +83,9 @@ void HttpHandler::Moved(common::libev::IoLoop* server, common::libev::IoClient*
 
 void HttpHandler::Closed(common::libev::IoClient* client) {
   HttpClient* iclient = static_cast<HttpClient*>(client);
+  if (capture_) {
+    capture_->RecordClose(base::TrafficRecord::HTTP_SOURCE, iclient->GetInfo().fd());
+  }
   const auto server_user_auth = iclient->GetLogin();
   common::Error unreg_err = manager_->UnRegisterInnerConnectionByHost(iclient);
   if (unreg_err) {
@@ -60,13 +98,18 @@ void HttpHandler::Closed(common::libev::IoClient* client) {
     return;
   }
 
-  INFO_LOG() << "Bye http registered user: " << server_user_auth->GetLogin();
+  base::RuntimeStats::GetInstance().RemoveSubscriber(server_user_auth->GetUserID(), iclient->GetCurrentStreamID());
+  LIMITED_INFO_LOG(100) << "Bye http registered user: " << server_user_auth->GetLogin();
   base_class::Closed(client);
 }
 
 void HttpHandler::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
   UNUSED(server);
-  UNUSED(id);
+  if (lag_timer_id_ == id) {
+    lag_monitor_.Check(base::GetMonotonicMsec(), 0);
+    base::RuntimeStats::GetInstance().UpdateLoop(base::LoopStats("http", GetOnlineClients(), lag_monitor_));
+    pool_metrics_.Update(HttpClient::GetPoolStats());
+  }
 }
 
 void HttpHandler::Accepted(common::libev::IoChild* child) {
@@ -103,24 +146,31 @@ void HttpHandler::DataReadyToWrite(common::libev::IoClient* client) {
 }
 
 void HttpHandler::PostLooped(common::libev::IoLoop* server) {
-  UNUSED(server);
+  if (lag_timer_id_ != INVALID_TIMER_ID) {
+    server->RemoveTimer(lag_timer_id_);
+    lag_timer_id_ = INVALID_TIMER_ID;
+  }
+}
+
+const base::LoopLagMonitor& HttpHandler::GetLoopLagMonitor() const {
+  return lag_monitor_;
 }
 
 void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size_t req_len) {
   static const common::libev::http::HttpServerInfo hinf(PROJECT_NAME_TITLE, PROJECT_DOMAIN);
+  if (capture_) {
+    capture_->RecordFrame(base::TrafficRecord::HTTP_SOURCE, hclient->GetInfo().fd(), request, req_len);
+  }
+
   common::http::HttpRequest hrequest;
   std::string request_str(request, req_len);
   std::pair<common::http::http_status, common::Error> result = common::http::parse_http_request(request_str, &hrequest);
-  DEBUG_LOG() << "Http request:\n" << request;
+  LIMITED_DEBUG_LOG(20) << "Http request:\n" << request;
 
   if (result.second) {
     const std::string error_text = result.second->GetDescription();
     DEBUG_MSG_ERROR(result.second, common::logging::LOG_LEVEL_ERR);
-    common::ErrnoError err =
-        hclient->SendError(common::http::HP_1_1, result.first, nullptr, error_text.c_str(), false, hinf);
-    if (err) {
-      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    }
+    SendError(hclient, common::http::HP_1_1, result.first, nullptr, error_text.c_str(), false, hinf);
     ignore_result(hclient->Close());
     delete hclient;
     return;
@@ -136,25 +186,26 @@ void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size
       hrequest.GetMethod() == common::http::http_method::HM_HEAD) {
     common::uri::Upath path = hrequest.GetPath();
     if (!path.IsValid() || path.IsRoot()) {  // for hls
-      common::ErrnoError err =
-          hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header, "Invalid request.", IsKeepAlive, hinf);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+      SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, "Invalid request.", IsKeepAlive, hinf);
       goto finish;
     }
 
     std::vector<std::string> tokens;
     const size_t levels = common::Tokenize(path.GetPath(), "/", &tokens);
-    if (levels < 6) {
-      common::ErrnoError err =
-          hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header, "Invalid request.", IsKeepAlive, hinf);
+    if (metrics_enabled_ && levels == 1 && tokens[0] == kMetricsPath) {
+      common::ErrnoError err = SendMetrics(hclient, protocol, hrequest.GetMethod() == common::http::http_method::HM_GET,
+                                           IsKeepAlive, hinf);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       }
       goto finish;
     }
 
+    if (levels < 6) {
+      SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, "Invalid request.", IsKeepAlive, hinf);
+      goto finish;
+    }
+
     base::ServerDBAuthInfo maybe_auth;
     common::Error cerr = manager_->CheckIsLoginClient(hclient, &maybe_auth);
     if (cerr) {
@@ -162,31 +213,42 @@ void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size
       const fastotv::user_id_t user_uid = tokens[0];
       const std::string password = tokens[1];
       const fastotv::device_id_t dev = tokens[2];
-      // try to check login
-      cerr = manager_->ClientLogin(user_uid, password, dev, &maybe_auth);
-      if (cerr) {
-        const std::string err_desc = cerr->GetDescription();
-        common::ErrnoError errn =
-            hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header, err_desc.c_str(), IsKeepAlive, hinf);
-        if (errn) {
-          DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
+      const common::time64_t now = base::GetMonotonicMsec();
+      const std::string auth_key = AuthCache::MakeKey(hclient->GetInfo().host(), user_uid, password, dev);
+      if (!auth_cache_.Find(auth_key, now, &maybe_auth)) {
+        if (lag_monitor_.GetLoadLevel() != base::LoopLagMonitor::NORMAL_LOAD) {
+          // busy loop, don't start new db logins
+          SendError(hclient, protocol, kHttpServiceUnavailable, extra_header, "Service overloaded, try again later.",
+                    IsKeepAlive, hinf);
+          goto finish;
+        }
+        if (!admission_.Admit(hclient->GetInfo().host(), user_uid, dev, now)) {
+          LIMITED_WARNING_LOG(10) << "Rate limited http client[" << hclient->GetFormatedName()
+                                  << "], user: " << user_uid;
+          SendError(hclient, protocol, kHttpTooManyRequests, extra_header, "Too many requests, try again later.",
+                    IsKeepAlive, hinf);
+          goto finish;
         }
-        goto finish;
+        // try to check login
+        cerr = manager_->ClientLogin(user_uid, password, dev, &maybe_auth);
+        if (cerr) {
+          const std::string err_desc = cerr->GetDescription();
+          SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, err_desc.c_str(), IsKeepAlive, hinf);
+          goto finish;
+        }
+        auth_cache_.Insert(auth_key, maybe_auth, now);
+        LIMITED_INFO_LOG(100) << "Welcome registered user: " << maybe_auth.GetLogin();
       }
       cerr = manager_->RegisterInnerConnectionByHost(hclient, maybe_auth);
       DCHECK(!cerr) << "Register inner connection error: " << cerr->GetDescription();
-      INFO_LOG() << "Welcome registered user: " << maybe_auth.GetLogin();
+      base::RuntimeStats::GetInstance().AddSubscriber(maybe_auth.GetUserID());
     }
 
     const fastotv::stream_id_t sid = tokens[3];
     fastotv::channel_id_t cid;
     const std::string file_name = tokens[5];
     if (!common::ConvertFromString(tokens[4], &cid)) {
-      common::ErrnoError err = hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header,
-                                                  "Invalid channel id.", IsKeepAlive, hinf);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+      SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, "Invalid channel id.", IsKeepAlive, hinf);
       goto finish;
     }
 
@@ -195,25 +257,28 @@ void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size
     cerr = manager_->ClientFindHttpDirectoryOrUrlForChannel(maybe_auth, sid, cid, &directory, &url);
     if (cerr) {
       const std::string err_desc = cerr->GetDescription();
-      common::ErrnoError errn =
-          hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header, err_desc.c_str(), IsKeepAlive, hinf);
-      if (errn) {
-        DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
-      }
+      SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, err_desc.c_str(), IsKeepAlive, hinf);
       goto finish;
     }
 
     if (!directory.IsValid()) {
       DCHECK(url.IsValid());
-      const std::string url_str = url.GetUrl();
+      std::string url_str = url.GetUrl();
+      common::http::http_status redirect_status = common::http::HS_PERMANENT_REDIRECT;
+      base::EdgeNode edge;
+      if (edges_ && edges_->IsBalancedUrl(url_str) && edges_->SelectEdge(sid, &edge)) {
+        // edge choice depends on load, players must not cache it
+        url_str = base::ReplaceUrlOrigin(url_str, edge.url);
+        redirect_status = kHttpTemporaryRedirect;
+      }
       const std::string redirect_header = common::MemSPrintf("Location: %s\r\n", url_str);
-      common::ErrnoError err =
-          hclient->SendHeaders(protocol, common::http::HS_PERMANENT_REDIRECT, redirect_header.c_str(), nullptr, nullptr,
-                               nullptr, IsKeepAlive, hinf);
+      common::ErrnoError err = SendHeaders(hclient, protocol, redirect_status, redirect_header.c_str(), nullptr,
+                                           nullptr, nullptr, IsKeepAlive, hinf);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       } else {
-        DEBUG_LOG() << "Sent redirect to: " << url_str;
+        LIMITED_DEBUG_LOG(100) << "Sent redirect to: " << url_str;
+        base::RuntimeStats::GetInstance().ChangeSubscriberStream(hclient->GetCurrentStreamID(), sid);
         hclient->SetCurrentStreamID(sid);
       }
       goto finish;
@@ -221,11 +286,7 @@ void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size
 
     auto file_path = directory.MakeFileStringPath(file_name);
     if (!file_path) {
-      common::ErrnoError err =
-          hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header, "File not found.", IsKeepAlive, hinf);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+      SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, "File not found.", IsKeepAlive, hinf);
       goto finish;
     }
 
@@ -233,37 +294,25 @@ void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size
     int open_flags = O_RDONLY;
     struct stat sb;
     if (stat(file_path_str.c_str(), &sb) < 0) {
-      common::ErrnoError err =
-          hclient->SendError(protocol, common::http::HS_NOT_FOUND, extra_header, "File not found.", IsKeepAlive, hinf);
-      WARNING_LOG() << "File path: " << file_path_str << ", not found";
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+      LIMITED_WARNING_LOG(10) << "File path: " << file_path_str << ", not found";
+      SendError(hclient, protocol, common::http::HS_NOT_FOUND, extra_header, "File not found.", IsKeepAlive, hinf);
       goto finish;
     }
 
     if (S_ISDIR(sb.st_mode)) {
-      common::ErrnoError err =
-          hclient->SendError(protocol, common::http::HS_BAD_REQUEST, extra_header, "Bad filename.", IsKeepAlive, hinf);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+      SendError(hclient, protocol, common::http::HS_BAD_REQUEST, extra_header, "Bad filename.", IsKeepAlive, hinf);
       goto finish;
     }
 
     int file = open(file_path_str.c_str(), open_flags);
     if (file == INVALID_DESCRIPTOR) { /* open the file for reading */
-      common::ErrnoError err = hclient->SendError(protocol, common::http::HS_FORBIDDEN, extra_header,
-                                                  "File is protected.", IsKeepAlive, hinf);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+      SendError(hclient, protocol, common::http::HS_FORBIDDEN, extra_header, "File is protected.", IsKeepAlive, hinf);
       goto finish;
     }
 
     const std::string mime = path.GetMime();
-    common::ErrnoError err = hclient->SendHeaders(protocol, common::http::HS_OK, extra_header, mime.c_str(),
-                                                  &sb.st_size, &sb.st_mtime, IsKeepAlive, hinf);
+    common::ErrnoError err = SendHeaders(hclient, protocol, common::http::HS_OK, extra_header, mime.c_str(),
+                                         &sb.st_size, &sb.st_mtime, IsKeepAlive, hinf);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       ::close(file);
@@ -271,11 +320,12 @@ void HttpHandler::ProcessReceived(HttpClient* hclient, const char* request, size
     }
 
     if (hrequest.GetMethod() == common::http::http_method::HM_GET) {
-      common::ErrnoError err = hclient->SendFileByFd(protocol, file, sb.st_size);
+      common::ErrnoError err = SendFile(hclient, protocol, file, sb.st_size);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       } else {
-        DEBUG_LOG() << "Sent file path: " << file_path_str << ", size: " << sb.st_size;
+        LIMITED_DEBUG_LOG(100) << "Sent file path: " << file_path_str << ", size: " << sb.st_size;
+        base::RuntimeStats::GetInstance().ChangeSubscriberStream(hclient->GetCurrentStreamID(), sid);
         hclient->SetCurrentStreamID(sid);
       }
     }
@@ -290,6 +340,82 @@ finish:
   }
 }
 
+common::ErrnoError HttpHandler::SendMetrics(HttpClient* hclient,
+                                            common::http::http_protocol protocol,
+                                            bool with_body,
+                                            bool keep_alive,
+                                            const common::libev::http::HttpServerInfo& hinf) {
+  const std::string body = base::MetricsRegistry::GetInstance().Render();
+  off_t body_size = body.size();
+  common::ErrnoError err = SendHeaders(hclient, protocol, common::http::HS_OK, nullptr, kMetricsContentType, &body_size,
+                                       nullptr, keep_alive, hinf);
+  if (err || !with_body) {
+    return err;
+  }
+
+  size_t offset = 0;
+  while (offset < body.size()) {
+    size_t nwrite = 0;
+    err = hclient->SingleWrite(body.data() + offset, body.size() - offset, &nwrite);
+    if (err) {
+      return err;
+    }
+    offset += nwrite;
+  }
+  sent_bytes_metric_->Increment(body.size());
+  return common::ErrnoError();
+}
+
+void HttpHandler::SendError(HttpClient* hclient,
+                            common::http::http_protocol protocol,
+                            common::http::http_status status,
+                            const char* extra_header,
+                            const char* text,
+                            bool keep_alive,
+                            const common::libev::http::HttpServerInfo& hinf) {
+  common::ErrnoError err = hclient->SendError(protocol, status, extra_header, text, keep_alive, hinf);
+  RecordResponse(status);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+}
+
+common::ErrnoError HttpHandler::SendHeaders(HttpClient* hclient,
+                                            common::http::http_protocol protocol,
+                                            common::http::http_status status,
+                                            const char* extra_header,
+                                            const char* mime,
+                                            off_t* length,
+                                            time_t* mtime,
+                                            bool keep_alive,
+                                            const common::libev::http::HttpServerInfo& hinf) {
+  common::ErrnoError err = hclient->SendHeaders(protocol, status, extra_header, mime, length, mtime, keep_alive, hinf);
+  RecordResponse(status);
+  return err;
+}
+
+common::ErrnoError HttpHandler::SendFile(HttpClient* hclient,
+                                         common::http::http_protocol protocol,
+                                         int file,
+                                         off_t size) {
+  common::ErrnoError err = hclient->SendFileByFd(protocol, file, size);
+  if (!err) {
+    sent_bytes_metric_->Increment(size);
+  }
+  return err;
+}
+
+void HttpHandler::RecordResponse(common::http::http_status status) {
+  auto it = status_metrics_.find(status);
+  if (it == status_metrics_.end()) {
+    const std::string labels = base::MakeMetricLabel("status", common::ConvertToString(static_cast<int>(status)));
+    base::MetricCounter* counter = base::MetricsRegistry::GetInstance().GetCounter(
+        "fastocloud_http_responses_total", "Http responses by status code.", labels);
+    it = status_metrics_.insert(std::make_pair(status, counter)).first;
+  }
+  it->second->Increment();
+}
+
 }  // namespace http
 }  // namespace server
 }  // namespace fastocloud
@@ -14,13 +14,27 @@
 
 #pragma once
 
+#include <map>
+
+#include <common/libev/http/http_client.h>
+
 #include "base/iserver_handler.h"
+#include "base/loop_lag_monitor.h"
+#include "base/object_pool.h"
+#include "base/token_bucket.h"
+
+#include "config.h"
+
+#include "http/auth_cache.h"
 
 namespace fastocloud {
 namespace server {
 namespace base {
+class EdgeRegistry;
 class ISubscribersManager;
-}
+class MetricCounter;
+class TrafficCapture;
+}  // namespace base
 namespace http {
 
 class HttpClient;
@@ -28,8 +42,16 @@ class HttpClient;
 class HttpHandler : public base::IServerHandler {
  public:
   enum { BUF_SIZE = 4096 };
+  // segments of one player are served from cached login, only first request of period is rate limited;
+  // password change or ban in db applies to cached logins after up to auth_cache_ttl_seconds
+  enum { auth_cache_ttl_seconds = 30, auth_cache_max_entries = 1 << 16 };
   typedef base::IServerHandler base_class;
-  explicit HttpHandler(base::ISubscribersManager* manager);
+  // capture is optional, inbound requests are recorded when set;
+  // proxy streams of origins mirrored by edges are redirected through them when registry has healthy ones
+  HttpHandler(base::ISubscribersManager* manager,
+              const Config& config,
+              base::TrafficCapture* capture,
+              base::EdgeRegistry* edges);
 
   void PreLooped(common::libev::IoLoop* server) override;
 
@@ -46,10 +68,49 @@ class HttpHandler : public base::IServerHandler {
 
   void PostLooped(common::libev::IoLoop* server) override;
 
+  const base::LoopLagMonitor& GetLoopLagMonitor() const;
+
  private:
   void ProcessReceived(HttpClient* hclient, const char* request, size_t req_len);
+  // prometheus text exposition of process metrics, served before authorization
+  common::ErrnoError SendMetrics(HttpClient* hclient,
+                                 common::http::http_protocol protocol,
+                                 bool with_body,
+                                 bool keep_alive,
+                                 const common::libev::http::HttpServerInfo& hinf) WARN_UNUSED_RESULT;
+  // every response goes through these, so status and body bytes are counted in one place;
+  // error response failures are logged here
+  void SendError(HttpClient* hclient,
+                 common::http::http_protocol protocol,
+                 common::http::http_status status,
+                 const char* extra_header,
+                 const char* text,
+                 bool keep_alive,
+                 const common::libev::http::HttpServerInfo& hinf);
+  common::ErrnoError SendHeaders(HttpClient* hclient,
+                                 common::http::http_protocol protocol,
+                                 common::http::http_status status,
+                                 const char* extra_header,
+                                 const char* mime,
+                                 off_t* length,
+                                 time_t* mtime,
+                                 bool keep_alive,
+                                 const common::libev::http::HttpServerInfo& hinf) WARN_UNUSED_RESULT;
+  common::ErrnoError SendFile(HttpClient* hclient, common::http::http_protocol protocol, int file, off_t size)
+      WARN_UNUSED_RESULT;
+  void RecordResponse(common::http::http_status status);
 
   base::ISubscribersManager* const manager_;
+  base::AdmissionControl admission_;
+  AuthCache auth_cache_;
+  common::libev::timer_id_t lag_timer_id_;
+  base::LoopLagMonitor lag_monitor_;
+  base::ObjectPoolMetrics pool_metrics_;
+  base::TrafficCapture* const capture_;
+  base::EdgeRegistry* const edges_;
+  const bool metrics_enabled_;
+  std::map<common::http::http_status, base::MetricCounter*> status_metrics_;
+  base::MetricCounter* const sent_bytes_metric_;
 };
 
 }  // namespace http
@@ -16,6 +16,8 @@
 
 #include <common/libev/http/http_server.h>
 
+#include "base/socket_tuning.h"
+
 namespace fastocloud {
 namespace server {
 namespace http {
@@ -25,8 +27,12 @@ class HttpServer : public common::libev::http::HttpServer {
   typedef common::libev::http::HttpServer base_class;
   explicit HttpServer(const common::net::HostAndPort& host, common::libev::IoLoopObserver* observer = nullptr);
 
+  void SetSocketTuning(const base::SocketTuning& tuning);
+
  private:
   common::libev::tcp::TcpClient* CreateClient(const common::net::socket_info& info) override;
+
+  base::SocketTuning tuning_;
 };
 
 }  // namespace http
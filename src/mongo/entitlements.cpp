@@ -0,0 +1,209 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/entitlements.h"
+
+#include <algorithm>
+
+#include "base/metrics.h"
+
+namespace {
+fastocloud::server::base::MetricCounter* GetLookupsMetric(const char* result) {
+  const std::string labels = fastocloud::server::base::MakeMetricLabel("cache", "entitlements") + "," +
+                             fastocloud::server::base::MakeMetricLabel("result", result);
+  return fastocloud::server::base::MetricsRegistry::GetInstance().GetCounter("fastocloud_cache_lookups_total",
+                                                                             "Cache lookups by result.", labels);
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace mongo {
+
+Entitlements::Entitlements(common::time64_t ttl_msec)
+    : ttl_msec_(ttl_msec),
+      mutex_(),
+      ordinals_(),
+      users_(),
+      sweep_size_(min_sweep_users),
+      hits_metric_(GetLookupsMetric("hit")),
+      misses_metric_(GetLookupsMetric("miss")) {}
+
+void Entitlements::SetUser(const std::string& login,
+                           const streams_t& streams,
+                           const streams_t& vods,
+                           const streams_t& catchups) {
+  const streams_t* lists[ENTITLEMENT_KINDS_COUNT] = {&streams, &vods, &catchups};
+  const common::time64_t now = base::GetMonotonicMsec();
+  UserEntitlements user;
+  user.loaded_msec = now;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t kind = 0; kind < ENTITLEMENT_KINDS_COUNT; ++kind) {
+    const streams_t* list = lists[kind];
+    for (size_t i = 0; i < list->size(); ++i) {
+      user.kinds[kind].Add(GetOrCreateOrdinal((*list)[i]));
+    }
+  }
+  users_[login] = user;
+  if (users_.size() >= sweep_size_) {
+    RemoveExpired(now);
+    sweep_size_ = std::max<size_t>(users_.size() * 2, min_sweep_users);
+  }
+}
+
+void Entitlements::Grant(const std::string& login, EntitlementKind kind, const fastotv::stream_id_t& sid) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  UserEntitlements* user = FindUser(login);
+  if (!user) {
+    return;
+  }
+
+  user->kinds[kind].Add(GetOrCreateOrdinal(sid));
+}
+
+void Entitlements::Revoke(const std::string& login, EntitlementKind kind, const fastotv::stream_id_t& sid) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  UserEntitlements* user = FindUser(login);
+  if (!user) {
+    return;
+  }
+
+  uint32_t ordinal;
+  if (FindOrdinal(sid, &ordinal)) {
+    user->kinds[kind].Remove(ordinal);
+  }
+}
+
+EntitlementState Entitlements::Check(const std::string& login,
+                                     EntitlementKind kind,
+                                     const fastotv::stream_id_t& sid) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const UserEntitlements* user = FindUser(login);
+  if (!user) {
+    return CountLookup(ENTITLEMENT_UNKNOWN);
+  }
+
+  uint32_t ordinal;
+  if (!FindOrdinal(sid, &ordinal)) {
+    return CountLookup(ENTITLEMENT_DENIED);
+  }
+  return CountLookup(user->kinds[kind].Contains(ordinal) ? ENTITLEMENT_GRANTED : ENTITLEMENT_DENIED);
+}
+
+EntitlementState Entitlements::CheckAny(const std::string& login,
+                                        const fastotv::stream_id_t& sid,
+                                        EntitlementKind* kind) const {
+  if (!kind) {
+    return ENTITLEMENT_UNKNOWN;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  const UserEntitlements* user = FindUser(login);
+  if (!user) {
+    return CountLookup(ENTITLEMENT_UNKNOWN);
+  }
+
+  uint32_t ordinal;
+  if (!FindOrdinal(sid, &ordinal)) {
+    return CountLookup(ENTITLEMENT_DENIED);
+  }
+
+  for (size_t i = 0; i < ENTITLEMENT_KINDS_COUNT; ++i) {
+    if (user->kinds[i].Contains(ordinal)) {
+      *kind = static_cast<EntitlementKind>(i);
+      return CountLookup(ENTITLEMENT_GRANTED);
+    }
+  }
+  return CountLookup(ENTITLEMENT_DENIED);
+}
+
+EntitlementState Entitlements::CountLookup(EntitlementState state) const {
+  if (state == ENTITLEMENT_UNKNOWN) {
+    misses_metric_->Increment();
+  } else {
+    hits_metric_->Increment();
+  }
+  return state;
+}
+
+size_t Entitlements::GetUsersCount() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return users_.size();
+}
+
+size_t Entitlements::GetMemoryUsage() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  size_t result = 0;
+  for (auto it = users_.begin(); it != users_.end(); ++it) {
+    for (size_t i = 0; i < ENTITLEMENT_KINDS_COUNT; ++i) {
+      result += it->second.kinds[i].GetMemoryUsage();
+    }
+  }
+  return result;
+}
+
+const Entitlements::UserEntitlements* Entitlements::FindUser(const std::string& login) const {
+  const auto it = users_.find(login);
+  if (it == users_.end() || IsExpired(it->second, base::GetMonotonicMsec())) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+Entitlements::UserEntitlements* Entitlements::FindUser(const std::string& login) {
+  const auto it = users_.find(login);
+  if (it == users_.end() || IsExpired(it->second, base::GetMonotonicMsec())) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+bool Entitlements::IsExpired(const UserEntitlements& user, common::time64_t now_msec) const {
+  return now_msec - user.loaded_msec >= ttl_msec_;
+}
+
+void Entitlements::RemoveExpired(common::time64_t now_msec) {
+  for (auto it = users_.begin(); it != users_.end();) {
+    if (IsExpired(it->second, now_msec)) {
+      it = users_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+uint32_t Entitlements::GetOrCreateOrdinal(const fastotv::stream_id_t& sid) {
+  const auto it = ordinals_.find(sid);
+  if (it != ordinals_.end()) {
+    return it->second;
+  }
+
+  const uint32_t ordinal = static_cast<uint32_t>(ordinals_.size());
+  ordinals_[sid] = ordinal;
+  return ordinal;
+}
+
+bool Entitlements::FindOrdinal(const fastotv::stream_id_t& sid, uint32_t* ordinal) const {
+  const auto it = ordinals_.find(sid);
+  if (it == ordinals_.end()) {
+    return false;
+  }
+
+  *ordinal = it->second;
+  return true;
+}
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,100 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/time.h>
+
+#include <fastotv/types.h>
+
+#include "base/roaring_bitmap.h"
+
+namespace fastocloud {
+namespace server {
+namespace base {
+class MetricCounter;
+}  // namespace base
+namespace mongo {
+
+enum EntitlementKind { STREAM_ENTITLEMENT = 0, VOD_ENTITLEMENT, CATCHUP_ENTITLEMENT, ENTITLEMENT_KINDS_COUNT };
+
+enum EntitlementState {
+  ENTITLEMENT_UNKNOWN = 0,  // user is not cached, ask db
+  ENTITLEMENT_GRANTED,
+  ENTITLEMENT_DENIED
+};
+
+// Streams of recently logged in users as bitmaps over dense stream ordinals.
+// Ordinals are assigned once per stream id and never reused, so bitmaps stay valid for the process lifetime.
+// Users are loaded from subscriber document and treated as unknown once older than ttl, so changes made
+// directly in db are picked up by next lookup after ttl; entries outlive connections and are dropped lazily.
+class Entitlements {
+ public:
+  typedef std::vector<fastotv::stream_id_t> streams_t;
+  enum { min_sweep_users = 1024 };
+
+  explicit Entitlements(common::time64_t ttl_msec);
+
+  // replaces cached user, called with fresh subscriber document
+  void SetUser(const std::string& login, const streams_t& streams, const streams_t& vods, const streams_t& catchups);
+
+  // no-op for users who are not cached
+  void Grant(const std::string& login, EntitlementKind kind, const fastotv::stream_id_t& sid);
+  void Revoke(const std::string& login, EntitlementKind kind, const fastotv::stream_id_t& sid);
+
+  EntitlementState Check(const std::string& login, EntitlementKind kind, const fastotv::stream_id_t& sid) const;
+  // checks all kinds, kind of first match is stored into kind
+  EntitlementState CheckAny(const std::string& login, const fastotv::stream_id_t& sid, EntitlementKind* kind) const;
+
+  size_t GetUsersCount() const;
+  size_t GetMemoryUsage() const;
+
+ private:
+  Entitlements(const Entitlements&) = delete;
+  Entitlements& operator=(const Entitlements&) = delete;
+
+  struct UserEntitlements {
+    base::RoaringBitmap kinds[ENTITLEMENT_KINDS_COUNT];
+    common::time64_t loaded_msec;
+  };
+
+  // nullptr for missing and expired users
+  const UserEntitlements* FindUser(const std::string& login) const;
+  UserEntitlements* FindUser(const std::string& login);
+  bool IsExpired(const UserEntitlements& user, common::time64_t now_msec) const;
+  void RemoveExpired(common::time64_t now_msec);
+  uint32_t GetOrCreateOrdinal(const fastotv::stream_id_t& sid);
+  bool FindOrdinal(const fastotv::stream_id_t& sid, uint32_t* ordinal) const;
+  // unknown state is a miss, caller goes to db
+  EntitlementState CountLookup(EntitlementState state) const;
+
+  const common::time64_t ttl_msec_;
+  mutable std::mutex mutex_;
+  std::unordered_map<fastotv::stream_id_t, uint32_t> ordinals_;
+  std::unordered_map<std::string, UserEntitlements> users_;
+  size_t sweep_size_;
+  base::MetricCounter* const hits_metric_;
+  base::MetricCounter* const misses_metric_;
+};
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
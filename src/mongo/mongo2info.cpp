@@ -21,9 +21,18 @@ namespace fastocloud {
 namespace server {
 namespace mongo {
 
+namespace {
+// decoding runs for every stream of a subscriber, keep the output buffer between documents
+std::vector<fastotv::OutputUri>* GetScratchOutputUrls() {
+  static thread_local std::vector<fastotv::OutputUri> urls;
+  return &urls;
+}
+}  // namespace
+
 namespace details {
 std::vector<common::uri::Url> MakeUrlsFromOutput(const std::vector<fastotv::OutputUri>& output) {
   std::vector<common::uri::Url> result;
+  result.reserve(output.size());
   for (size_t i = 0; i < output.size(); ++i) {
     result.push_back(output[i].GetOutput());
   }
@@ -51,6 +60,7 @@ bool MakeVodInfo(const bson_t* sdoc,
   int iarc;
   fastotv::commands_info::MovieInfo mov;
   fastotv::commands_info::StreamBaseInfo::parts_t parts;
+  std::vector<fastotv::OutputUri>* urls = GetScratchOutputUrls();
   int check_sum = 0;
   bool have_audio = true;
   bool have_video = true;
@@ -94,12 +104,11 @@ bool MakeVodInfo(const bson_t* sdoc,
       mov.SetPreviewIcon(common::uri::Url(bson_iter_utf8(&iter, NULL)));
       check_sum++;
     } else if (strcmp(key, STREAM_OUTPUT_FIELD) == 0) {
-      std::vector<fastotv::OutputUri> urls;
-      if (!GetOutputUrlData(&iter, &urls)) {
+      if (!GetOutputUrlData(&iter, urls)) {
         return false;
       }
 
-      mov.SetUrls(details::MakeUrlsFromOutput(urls));
+      mov.SetUrls(details::MakeUrlsFromOutput(*urls));
       check_sum++;
     } else if (strcmp(key, STREAM_HAVE_AUDIO_FIELD) == 0) {
       if (!BSON_ITER_HOLDS_BOOL(&iter)) {
@@ -119,8 +128,7 @@ bool MakeVodInfo(const bson_t* sdoc,
 
       while (bson_iter_next(&bparts)) {
         const bson_oid_t* oid = bson_iter_oid(&bparts);
-        std::string part_str = common::ConvertToString(oid);
-        parts.push_back(part_str);
+        parts.push_back(common::ConvertToString(oid));
       }
     } else if (strcmp(key, STREAM_HAVE_VIDEO_FIELD) == 0) {
       if (!BSON_ITER_HOLDS_BOOL(&iter)) {
@@ -199,6 +207,7 @@ bool MakeCatchupInfo(const bson_t* sdoc,
   std::string group;
   fastotv::commands_info::EpgInfo epg;
   fastotv::commands_info::StreamBaseInfo::parts_t parts;
+  std::vector<fastotv::OutputUri>* urls = GetScratchOutputUrls();
   fastotv::timestamp_t start;
   fastotv::timestamp_t stop;
   int check_sum = 0;
@@ -256,8 +265,7 @@ bool MakeCatchupInfo(const bson_t* sdoc,
 
       while (bson_iter_next(&bparts)) {
         const bson_oid_t* oid = bson_iter_oid(&bparts);
-        std::string part_str = common::ConvertToString(oid);
-        parts.push_back(part_str);
+        parts.push_back(common::ConvertToString(oid));
       }
     } else if (strcmp(key, STREAM_HAVE_VIDEO_FIELD) == 0) {
       if (!BSON_ITER_HOLDS_BOOL(&iter)) {
@@ -285,11 +293,10 @@ bool MakeCatchupInfo(const bson_t* sdoc,
       epg.SetIconUrl(common::uri::Url(bson_iter_utf8(&iter, NULL)));
       check_sum++;
     } else if (strcmp(key, STREAM_OUTPUT_FIELD) == 0) {
-      std::vector<fastotv::OutputUri> urls;
-      if (!GetOutputUrlData(&iter, &urls)) {
+      if (!GetOutputUrlData(&iter, urls)) {
         return false;
       }
-      epg.SetUrls(details::MakeUrlsFromOutput(urls));
+      epg.SetUrls(details::MakeUrlsFromOutput(*urls));
       check_sum++;
     }
   }
@@ -323,6 +330,7 @@ bool MakeChannelInfo(const bson_t* sdoc,
   std::string group;
   fastotv::commands_info::EpgInfo epg;
   fastotv::commands_info::StreamBaseInfo::parts_t parts;
+  std::vector<fastotv::OutputUri>* urls = GetScratchOutputUrls();
   int check_sum = 0;
   int iarc;
   bool have_audio = true;
@@ -378,8 +386,7 @@ bool MakeChannelInfo(const bson_t* sdoc,
 
       while (bson_iter_next(&bparts)) {
         const bson_oid_t* oid = bson_iter_oid(&bparts);
-        std::string part_str = common::ConvertToString(oid);
-        parts.push_back(part_str);
+        parts.push_back(common::ConvertToString(oid));
       }
     } else if (strcmp(key, STREAM_HAVE_VIDEO_FIELD) == 0) {
       if (!BSON_ITER_HOLDS_BOOL(&iter)) {
@@ -394,11 +401,10 @@ bool MakeChannelInfo(const bson_t* sdoc,
       epg.SetIconUrl(common::uri::Url(bson_iter_utf8(&iter, NULL)));
       check_sum++;
     } else if (strcmp(key, STREAM_OUTPUT_FIELD) == 0) {
-      std::vector<fastotv::OutputUri> urls;
-      if (!GetOutputUrlData(&iter, &urls)) {
+      if (!GetOutputUrlData(&iter, urls)) {
         return false;
       }
-      epg.SetUrls(details::MakeUrlsFromOutput(urls));
+      epg.SetUrls(details::MakeUrlsFromOutput(*urls));
       check_sum++;
     }
   }
@@ -497,7 +503,8 @@ bool GetOutputUrlData(bson_iter_t* iter, std::vector<fastotv::OutputUri>* urls)
     return false;
   }
 
-  std::vector<fastotv::OutputUri> lurls;
+  // filled in place, callers reuse capacity of the same vector between documents
+  urls->clear();
   while (bson_iter_next(&ar)) {
     bson_iter_t bid;
     if (bson_iter_recurse(&ar, &bid) && bson_iter_find(&bid, STREAM_OUTPUT_URLS_ID_FIELD) &&
@@ -510,22 +517,20 @@ bool GetOutputUrlData(bson_iter_t* iter, std::vector<fastotv::OutputUri>* urls)
         bson_iter_t bhttp_root;
         if (bson_iter_recurse(&ar, &bhttp_root) && bson_iter_find(&bhttp_root, STREAM_OUTPUT_URLS_HTTP_ROOT_FIELD) &&
             BSON_ITER_HOLDS_UTF8(&bhttp_root)) {
-          common::file_system::ascii_directory_string_path http_root =
-              common::file_system::ascii_directory_string_path(bson_iter_utf8(&bhttp_root, NULL));
+          const common::file_system::ascii_directory_string_path http_root(bson_iter_utf8(&bhttp_root, NULL));
           bson_iter_t bhls_type;
           if (bson_iter_recurse(&ar, &bhls_type) && bson_iter_find(&bhls_type, STREAM_OUTPUT_URLS_HLS_TYPE_FIELD) &&
               BSON_ITER_HOLDS_INT32(&bhls_type)) {
-            fastotv::OutputUri out(lcid, uri);
+            urls->push_back(fastotv::OutputUri(lcid, uri));
+            fastotv::OutputUri& out = urls->back();
             out.SetHttpRoot(http_root);
             out.SetHlsType(static_cast<fastotv::OutputUri::HlsType>(bson_iter_int32(&bhls_type)));
-            lurls.push_back(out);
           }
         }
       }
     }
   }
 
-  *urls = lurls;
   return true;
 }
 
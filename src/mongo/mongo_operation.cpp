@@ -0,0 +1,282 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/mongo_operation.h"
+
+#include <algorithm>
+
+#include <common/logging.h>
+
+#include "base/async_log.h"
+#include "base/metrics.h"
+#include "base/request_tracer.h"
+
+namespace {
+enum : size_t { max_shape_depth = 8 };
+
+thread_local const fastocloud::server::mongo::MongoOperationScope* g_current_scope = nullptr;
+
+void AppendShape(bson_iter_t* iter, bool is_array, size_t depth, std::string* out);
+
+void AppendValueShape(bson_iter_t* iter, size_t depth, std::string* out) {
+  const bson_type_t type = bson_iter_type(iter);
+  if (type != BSON_TYPE_DOCUMENT && type != BSON_TYPE_ARRAY) {
+    out->append("?");
+    return;
+  }
+
+  bson_iter_t child;
+  if (depth >= max_shape_depth || !bson_iter_recurse(iter, &child)) {
+    out->append(type == BSON_TYPE_ARRAY ? "[...]" : "{...}");
+    return;
+  }
+  AppendShape(&child, type == BSON_TYPE_ARRAY, depth + 1, out);
+}
+
+void AppendShape(bson_iter_t* iter, bool is_array, size_t depth, std::string* out) {
+  out->append(is_array ? "[" : "{");
+  bool first = true;
+  while (bson_iter_next(iter)) {
+    if (is_array) {
+      // elements of $in and similar lists differ only in values
+      AppendValueShape(iter, depth, out);
+      if (bson_iter_next(iter)) {
+        out->append(", ...");
+      }
+      break;
+    }
+
+    if (!first) {
+      out->append(", ");
+    }
+    first = false;
+    out->append(bson_iter_key(iter));
+    out->append(": ");
+    AppendValueShape(iter, depth, out);
+  }
+  out->append(is_array ? "]" : "}");
+}
+
+uint64_t GetElapsedUsec(uint64_t start_usec) {
+  return fastocloud::server::base::GetMonotonicUsec() - start_usec;
+}
+
+void AddTraceSpan(const char* command, mongoc_collection_t* collection, uint64_t start_usec) {
+  fastocloud::server::base::RequestTrace* trace = fastocloud::server::base::RequestTrace::GetCurrent();
+  if (trace) {
+    trace->AddSpan(std::string(command) + " " + mongoc_collection_get_name(collection), "db", start_usec,
+                   fastocloud::server::base::GetMonotonicUsec());
+  }
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace mongo {
+
+MongoOperation::MongoOperation(const char* name)
+    : name_(name),
+      latency_(base::MetricsRegistry::GetInstance().GetHistogram("fastocloud_mongo_operation_duration_seconds",
+                                                                 "Duration of subscribers manager db operations.",
+                                                                 base::MakeMetricLabel("operation", name))) {}
+
+const char* MongoOperation::GetName() const {
+  return name_;
+}
+
+base::MetricHistogram* MongoOperation::GetLatency() const {
+  return latency_;
+}
+
+MongoOperationScope::MongoOperationScope(const MongoOperation* operation)
+    : operation_(operation), parent_(g_current_scope), start_usec_(base::GetMonotonicUsec()) {
+  g_current_scope = this;
+}
+
+MongoOperationScope::~MongoOperationScope() {
+  const uint64_t end_usec = base::GetMonotonicUsec();
+  operation_->GetLatency()->Record(end_usec - start_usec_);
+  base::RequestTrace* trace = base::RequestTrace::GetCurrent();
+  if (trace) {
+    trace->AddSpan(operation_->GetName(), "db", start_usec_, end_usec);
+  }
+  g_current_scope = parent_;
+}
+
+const char* MongoOperationScope::GetCurrentName() {
+  return g_current_scope ? g_current_scope->operation_->GetName() : "unknown";
+}
+
+SlowQuery::SlowQuery()
+    : operation(),
+      command(),
+      collection(),
+      shape(),
+      count(0),
+      max_usec(0),
+      total_usec(0),
+      last_documents(0),
+      last_bytes(0),
+      last_seen(0) {}
+
+SlowQueryLog::SlowQueryLog() : threshold_usec_(0), mutex_(), top_() {}
+
+SlowQueryLog& SlowQueryLog::GetInstance() {
+  static SlowQueryLog log;
+  return log;
+}
+
+void SlowQueryLog::SetThreshold(uint32_t threshold_msec) {
+  threshold_usec_ = static_cast<uint64_t>(threshold_msec) * 1000;
+}
+
+bool SlowQueryLog::IsSlow(uint64_t duration_usec) const {
+  const uint64_t threshold_usec = threshold_usec_;
+  return threshold_usec != 0 && duration_usec >= threshold_usec;
+}
+
+void SlowQueryLog::Record(const char* command,
+                          mongoc_collection_t* collection,
+                          const std::string& shape,
+                          uint64_t duration_usec,
+                          size_t documents,
+                          size_t bytes) {
+  const char* operation = MongoOperationScope::GetCurrentName();
+  const char* collection_name = mongoc_collection_get_name(collection);
+  LIMITED_WARNING_LOG(10) << "Slow db " << command << " in " << operation << " on " << collection_name << " took "
+                          << duration_usec / 1000 << " msec, documents: " << documents << ", bytes: " << bytes
+                          << ", query: " << shape;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = std::find_if(top_.begin(), top_.end(), [&](const SlowQuery& query) {
+    return query.shape == shape && query.operation == operation && query.command == command &&
+           query.collection == collection_name;
+  });
+  if (it == top_.end()) {
+    if (top_.size() < top_size) {
+      top_.push_back(SlowQuery());
+      it = top_.end() - 1;
+    } else {
+      // replace fastest shape if this one is slower
+      it = std::min_element(top_.begin(), top_.end(),
+                            [](const SlowQuery& a, const SlowQuery& b) { return a.max_usec < b.max_usec; });
+      if (it->max_usec >= duration_usec) {
+        return;
+      }
+      *it = SlowQuery();
+    }
+    it->operation = operation;
+    it->command = command;
+    it->collection = collection_name;
+    it->shape = shape;
+  }
+
+  it->count++;
+  it->max_usec = std::max(it->max_usec, duration_usec);
+  it->total_usec += duration_usec;
+  it->last_documents = documents;
+  it->last_bytes = bytes;
+  it->last_seen = common::time::current_utc_mstime();
+}
+
+std::vector<SlowQuery> SlowQueryLog::GetTop() const {
+  std::vector<SlowQuery> result;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    result = top_;
+  }
+  std::sort(result.begin(), result.end(),
+            [](const SlowQuery& a, const SlowQuery& b) { return a.max_usec > b.max_usec; });
+  return result;
+}
+
+std::string MakeQueryShape(const bson_t* query) {
+  bson_iter_t iter;
+  if (!query || !bson_iter_init(&iter, query)) {
+    return "{}";
+  }
+
+  std::string shape;
+  AppendShape(&iter, false, 0, &shape);
+  return shape;
+}
+
+MongoFindCursor::MongoFindCursor(mongoc_collection_t* collection, const bson_t* query)
+    : collection_(collection),
+      query_(query),
+      cursor_(nullptr),
+      start_usec_(base::GetMonotonicUsec()),
+      elapsed_usec_(0),
+      documents_(0),
+      bytes_(0) {
+  cursor_ = mongoc_collection_find(collection_, MONGOC_QUERY_NONE, 0, 0, 0, query_, NULL, NULL);
+  elapsed_usec_ += GetElapsedUsec(start_usec_);
+}
+
+MongoFindCursor::~MongoFindCursor() {
+  if (cursor_) {
+    mongoc_cursor_destroy(cursor_);
+  }
+
+  // trace span covers cursor lifetime, caller's work between documents included
+  AddTraceSpan("find", collection_, start_usec_);
+  SlowQueryLog& log = SlowQueryLog::GetInstance();
+  if (log.IsSlow(elapsed_usec_)) {
+    log.Record("find", collection_, MakeQueryShape(query_), elapsed_usec_, documents_, bytes_);
+  }
+}
+
+bool MongoFindCursor::Next(const bson_t** doc) {
+  if (!cursor_) {
+    return false;
+  }
+
+  // first call sends query, next ones fetch more batches when current one is used up
+  const uint64_t start_usec = base::GetMonotonicUsec();
+  const bool result = mongoc_cursor_next(cursor_, doc);
+  elapsed_usec_ += GetElapsedUsec(start_usec);
+  if (result) {
+    documents_++;
+    bytes_ += (*doc)->len;
+  }
+  return result;
+}
+
+bool MongoUpdate(mongoc_collection_t* collection, const bson_t* selector, const bson_t* update, bson_error_t* error) {
+  const uint64_t start_usec = base::GetMonotonicUsec();
+  const bool result = mongoc_collection_update(collection, MONGOC_UPDATE_NONE, selector, update, NULL, error);
+  const uint64_t elapsed_usec = GetElapsedUsec(start_usec);
+  AddTraceSpan("update", collection, start_usec);
+  SlowQueryLog& log = SlowQueryLog::GetInstance();
+  if (log.IsSlow(elapsed_usec)) {
+    log.Record("update", collection, MakeQueryShape(selector) + " " + MakeQueryShape(update), elapsed_usec, 0, 0);
+  }
+  return result;
+}
+
+bool MongoInsert(mongoc_collection_t* collection, const bson_t* document, bson_error_t* error) {
+  const uint64_t start_usec = base::GetMonotonicUsec();
+  const bool result = mongoc_collection_insert(collection, MONGOC_INSERT_NONE, document, NULL, error);
+  const uint64_t elapsed_usec = GetElapsedUsec(start_usec);
+  AddTraceSpan("insert", collection, start_usec);
+  SlowQueryLog& log = SlowQueryLog::GetInstance();
+  if (log.IsSlow(elapsed_usec)) {
+    log.Record("insert", collection, MakeQueryShape(document), elapsed_usec, 0, 0);
+  }
+  return result;
+}
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
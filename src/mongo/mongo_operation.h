@@ -0,0 +1,142 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <mongoc.h>
+
+#include <common/time.h>
+
+namespace fastocloud {
+namespace server {
+namespace base {
+class MetricHistogram;
+}  // namespace base
+namespace mongo {
+
+// One subscribers manager function, latency of whole function goes to metrics,
+// name labels db operations issued while it runs.
+class MongoOperation {
+ public:
+  explicit MongoOperation(const char* name);
+
+  const char* GetName() const;
+  base::MetricHistogram* GetLatency() const;
+
+ private:
+  const char* const name_;
+  base::MetricHistogram* const latency_;
+};
+
+// marks current thread as running operation, scopes nest and the innermost one names db calls
+class MongoOperationScope {
+ public:
+  explicit MongoOperationScope(const MongoOperation* operation);
+  ~MongoOperationScope();
+
+  static const char* GetCurrentName();
+
+ private:
+  MongoOperationScope(const MongoOperationScope&) = delete;
+  MongoOperationScope& operator=(const MongoOperationScope&) = delete;
+
+  const MongoOperation* const operation_;
+  const MongoOperationScope* const parent_;
+  const uint64_t start_usec_;
+};
+
+struct SlowQuery {
+  SlowQuery();
+
+  std::string operation;   // subscribers manager function
+  std::string command;     // find, update or insert
+  std::string collection;
+  std::string shape;       // query with values replaced by ?
+  uint64_t count;          // slow runs of this shape
+  uint64_t max_usec;
+  uint64_t total_usec;
+  size_t last_documents;
+  size_t last_bytes;
+  common::time64_t last_seen;  // utc msec
+};
+
+// Db operations slower than threshold are logged and kept as top of slowest query shapes.
+class SlowQueryLog {
+ public:
+  enum : size_t { top_size = 32 };
+
+  static SlowQueryLog& GetInstance();
+
+  // msec, 0 disables
+  void SetThreshold(uint32_t threshold_msec);
+  bool IsSlow(uint64_t duration_usec) const;
+
+  void Record(const char* command,
+              mongoc_collection_t* collection,
+              const std::string& shape,
+              uint64_t duration_usec,
+              size_t documents,
+              size_t bytes);
+
+  // sorted by max duration, slowest first
+  std::vector<SlowQuery> GetTop() const;
+
+ private:
+  SlowQueryLog();
+  SlowQueryLog(const SlowQueryLog&) = delete;
+  SlowQueryLog& operator=(const SlowQueryLog&) = delete;
+
+  std::atomic<uint64_t> threshold_usec_;
+  mutable std::mutex mutex_;
+  std::vector<SlowQuery> top_;
+};
+
+// query with every value replaced by ?, nested documents keep their keys, arrays show first element only
+std::string MakeQueryShape(const bson_t* query);
+
+// Find cursor timing only calls into driver, so caller's work between documents isn't counted.
+class MongoFindCursor {
+ public:
+  // query must outlive cursor
+  MongoFindCursor(mongoc_collection_t* collection, const bson_t* query);
+  ~MongoFindCursor();
+
+  bool Next(const bson_t** doc);
+
+ private:
+  MongoFindCursor(const MongoFindCursor&) = delete;
+  MongoFindCursor& operator=(const MongoFindCursor&) = delete;
+
+  mongoc_collection_t* const collection_;
+  const bson_t* const query_;
+  mongoc_cursor_t* cursor_;
+  const uint64_t start_usec_;
+  uint64_t elapsed_usec_;
+  size_t documents_;
+  size_t bytes_;
+};
+
+bool MongoUpdate(mongoc_collection_t* collection, const bson_t* selector, const bson_t* update, bson_error_t* error);
+bool MongoInsert(mongoc_collection_t* collection, const bson_t* document, bson_error_t* error);
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,61 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// database layout written by the admin panel, shared by server and dataset generator
+
+#define DB_NAME "iptv"
+#define SUBSCRIBERS_COLLECTION "subscribers"
+#define SERVERS_COLLECTION "services"
+#define STREAMS_COLLECTION "streams"
+
+#define PROXY_STR "pyfastocloud_models.stream.entry.ProxyStream"
+#define VOD_PROXY_STR "pyfastocloud_models.stream.entry.ProxyVodStream"
+#define COD_RELAY_STR "pyfastocloud_models.stream.entry.CodRelayStream"
+#define COD_ENCODE_STR "pyfastocloud_models.stream.entry.CodEncodeStream"
+#define RELAY_STR "pyfastocloud_models.stream.entry.RelayStream"
+#define ENCODE_STR "pyfastocloud_models.stream.entry.EncodeStream"
+#define VOD_RELAY_STR "pyfastocloud_models.stream.entry.VodRelayStream"
+#define VOD_ENCODE_STR "pyfastocloud_models.stream.entry.VodEncodeStream"
+#define TIMESHIFT_RECORDER_STR "pyfastocloud_models.stream.entry.TimeshiftRecorderStream"
+#define TIMESHIFT_PLAYER_STR "pyfastocloud_models.stream.entry.TimeshiftPlayerStream"
+#define CATCHUP_STR "pyfastocloud_models.stream.entry.CatchupStream"
+#define TEST_LIFE_STR "pyfastocloud_models.stream.entry.TestLifeStream"
+
+#define FAVORITE_FIELD "favorite"
+#define RECENT_FIELD "recent"
+#define PRIVATE_FIELD "private"
+#define INTERRUPTION_TIME_FIELD "interruption_time"
+#define USER_STREAM_ID_FIELD "sid"
+#define USER_STREAMS_FIELD "streams"
+#define USER_VODS_FIELD "vods"
+#define USER_CATCHUPS_FIELD "catchups"
+
+#define SERVER_STREAMS_FIELD "streams"
+
+#define INPUT_URL_CLS "pyfastocloud_models.common_entries.InputUrl"
+#define OUTPUT_URL_CLS "pyfastocloud_models.common_entries.OutputUrl"
+#define CATCHUP_USER_CLS_VALUE "pyfastocloud_models.subscriber.entry.UserStream"
+
+namespace fastocloud {
+namespace server {
+namespace mongo {
+
+enum UserStatus { USER_NOT_ACTIVE = 0, USER_ACTIVE = 1, USER_DELETED = 2 };
+enum DeviceStatus { DEVICE_NOT_ACTIVE = 0, DEVICE_ACTIVE = 1, DEVICE_BANNED = 2 };
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
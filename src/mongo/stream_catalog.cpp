@@ -0,0 +1,352 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/stream_catalog.h"
+
+#include "base/metrics.h"
+
+#include "mongo/mongo2info.h"
+
+namespace {
+fastocloud::server::base::MetricCounter* GetLookupsMetric(const char* result) {
+  const std::string labels = fastocloud::server::base::MakeMetricLabel("cache", "stream_catalog") + "," +
+                             fastocloud::server::base::MakeMetricLabel("result", result);
+  return fastocloud::server::base::MetricsRegistry::GetInstance().GetCounter("fastocloud_cache_lookups_total",
+                                                                             "Cache lookups by result.", labels);
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace mongo {
+
+StreamCatalogStats::StreamCatalogStats() : channels(0), vods(0), strings(0), string_bytes(0), hits(0), misses(0) {}
+
+StreamCatalog::StreamCatalog(common::time64_t ttl_msec)
+    : ttl_msec_(ttl_msec),
+      mutex_(),
+      epoch_start_msec_(0),
+      strings_(),
+      ordinals_(),
+      channels_count_(0),
+      vods_count_(0),
+      sids_(),
+      groups_(),
+      iarcs_(),
+      flags_(),
+      display_names_(),
+      icons_(),
+      parts_offsets_(1, 0),
+      parts_(),
+      urls_offsets_(1, 0),
+      urls_(),
+      tvg_ids_(),
+      descriptions_(),
+      countries_(),
+      trailer_urls_(),
+      user_scores_(),
+      prime_dates_(),
+      durations_(),
+      vod_types_(),
+      hits_(0),
+      misses_(0),
+      hits_metric_(GetLookupsMetric("hit")),
+      misses_metric_(GetLookupsMetric("miss")) {}
+
+bool StreamCatalog::IsEnabled() const {
+  return ttl_msec_ != 0;
+}
+
+void StreamCatalog::Refresh() {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  const common::time64_t now = common::time::current_utc_mstime();
+  if (epoch_start_msec_ == 0) {
+    epoch_start_msec_ = now;
+  } else if (now - epoch_start_msec_ >= ttl_msec_) {
+    ClearColumns();
+    epoch_start_msec_ = now;
+  }
+}
+
+StreamCatalog::ordinal_t StreamCatalog::FindChannel(const fastotv::stream_id_t& sid) {
+  return Find(sid, CHANNEL_STREAM);
+}
+
+StreamCatalog::ordinal_t StreamCatalog::AddChannel(const fastotv::commands_info::ChannelInfo& chan) {
+  if (!IsEnabled()) {
+    return invalid_ordinal;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  const fastotv::commands_info::EpgInfo epg = chan.GetEpg();
+  const ordinal_t ordinal = Append(chan, epg.GetUrls(), CHANNEL_STREAM);
+  display_names_[ordinal] = strings_.Intern(epg.GetDisplayName());
+  icons_[ordinal] = strings_.InternUrl(epg.GetIconUrl().GetUrl());
+  tvg_ids_[ordinal] = strings_.Intern(epg.GetTvgID());
+  channels_count_++;
+  return ordinal;
+}
+
+bool StreamCatalog::GetChannel(ordinal_t ordinal,
+                               const UserStreamInfo& uinfo,
+                               fastotv::commands_info::ChannelInfo* chan) const {
+  if (!chan) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!IsValidOrdinal(ordinal, CHANNEL_STREAM)) {
+    return false;
+  }
+
+  fastotv::commands_info::EpgInfo epg;
+  epg.SetTvgID(strings_.Get(tvg_ids_[ordinal]));
+  epg.SetDisplayName(strings_.Get(display_names_[ordinal]));
+  epg.SetIconUrl(common::uri::Url(strings_.GetUrl(icons_[ordinal])));
+  epg.SetUrls(GetUrls(ordinal));
+  const uint8_t flags = flags_[ordinal];
+  *chan = fastotv::commands_info::ChannelInfo(strings_.Get(sids_[ordinal]), strings_.Get(groups_[ordinal]),
+                                              iarcs_[ordinal], uinfo.favorite, uinfo.recent, uinfo.interruption_time,
+                                              epg, flags & HAVE_VIDEO, flags & HAVE_AUDIO, GetParts(ordinal));
+  return true;
+}
+
+StreamCatalog::ordinal_t StreamCatalog::FindVod(const fastotv::stream_id_t& sid) {
+  return Find(sid, VOD_STREAM);
+}
+
+StreamCatalog::ordinal_t StreamCatalog::AddVod(const fastotv::commands_info::VodInfo& vod) {
+  if (!IsEnabled()) {
+    return invalid_ordinal;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  const fastotv::commands_info::MovieInfo mov = vod.GetMovieInfo();
+  const ordinal_t ordinal = Append(vod, mov.GetUrls(), VOD_STREAM);
+  display_names_[ordinal] = strings_.Intern(mov.GetDisplayName());
+  icons_[ordinal] = strings_.InternUrl(mov.GetPreviewIcon().GetUrl());
+  descriptions_[ordinal] = strings_.Intern(mov.GetDescription());
+  countries_[ordinal] = strings_.Intern(mov.GetCountry());
+  trailer_urls_[ordinal] = strings_.InternUrl(mov.GetTrailerUrl().GetUrl());
+  user_scores_[ordinal] = mov.GetUserScore();
+  prime_dates_[ordinal] = mov.GetPrimeDate();
+  durations_[ordinal] = mov.GetDuration();
+  vod_types_[ordinal] = mov.GetType();
+  vods_count_++;
+  return ordinal;
+}
+
+bool StreamCatalog::GetVod(ordinal_t ordinal,
+                           const UserStreamInfo& uinfo,
+                           fastotv::commands_info::VodInfo* vod) const {
+  if (!vod) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!IsValidOrdinal(ordinal, VOD_STREAM)) {
+    return false;
+  }
+
+  fastotv::commands_info::MovieInfo mov;
+  mov.SetDisplayName(strings_.Get(display_names_[ordinal]));
+  mov.SetDescription(strings_.Get(descriptions_[ordinal]));
+  mov.SetPreviewIcon(common::uri::Url(strings_.GetUrl(icons_[ordinal])));
+  mov.SetTrailerUrl(common::uri::Url(strings_.GetUrl(trailer_urls_[ordinal])));
+  mov.SetUserScore(user_scores_[ordinal]);
+  mov.SetPrimeDate(prime_dates_[ordinal]);
+  mov.SetCountry(strings_.Get(countries_[ordinal]));
+  mov.SetDuration(durations_[ordinal]);
+  mov.SetType(vod_types_[ordinal]);
+  mov.SetUrls(GetUrls(ordinal));
+  const uint8_t flags = flags_[ordinal];
+  *vod = fastotv::commands_info::VodInfo(strings_.Get(sids_[ordinal]), strings_.Get(groups_[ordinal]),
+                                         iarcs_[ordinal], uinfo.favorite, uinfo.recent, uinfo.interruption_time, mov,
+                                         flags & HAVE_VIDEO, flags & HAVE_AUDIO, GetParts(ordinal));
+  return true;
+}
+
+void StreamCatalog::RemoveStream(const fastotv::stream_id_t& sid) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  string_id_t id;
+  if (!strings_.Find(sid, &id)) {
+    return;
+  }
+
+  const auto it = ordinals_.find(id);
+  if (it == ordinals_.end()) {
+    return;
+  }
+
+  // columns of removed stream stay till the end of epoch, handed out ordinals remain readable
+  if (flags_[it->second] & CHANNEL_STREAM) {
+    channels_count_--;
+  } else {
+    vods_count_--;
+  }
+  ordinals_.erase(it);
+}
+
+void StreamCatalog::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ClearColumns();
+  epoch_start_msec_ = 0;
+}
+
+StreamCatalogStats StreamCatalog::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  StreamCatalogStats stats;
+  stats.channels = channels_count_;
+  stats.vods = vods_count_;
+  stats.strings = strings_.GetSize();
+  stats.string_bytes = strings_.GetBytes();
+  stats.hits = hits_;
+  stats.misses = misses_;
+  return stats;
+}
+
+StreamCatalog::ordinal_t StreamCatalog::Find(const fastotv::stream_id_t& sid, uint8_t kind) {
+  if (!IsEnabled()) {
+    return invalid_ordinal;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  string_id_t id;
+  if (strings_.Find(sid, &id)) {
+    const auto it = ordinals_.find(id);
+    if (it != ordinals_.end() && (flags_[it->second] & kind)) {
+      hits_++;
+      hits_metric_->Increment();
+      return it->second;
+    }
+  }
+
+  misses_++;
+  misses_metric_->Increment();
+  return invalid_ordinal;
+}
+
+StreamCatalog::ordinal_t StreamCatalog::Append(const fastotv::commands_info::StreamBaseInfo& info,
+                                               const std::vector<common::uri::Url>& urls,
+                                               uint8_t kind) {
+  const ordinal_t ordinal = static_cast<ordinal_t>(sids_.size());
+  const string_id_t sid = strings_.Intern(info.GetStreamID());
+  const auto it = ordinals_.find(sid);
+  if (it != ordinals_.end()) {
+    // stream was decoded again, old columns are left unreachable
+    if (flags_[it->second] & CHANNEL_STREAM) {
+      channels_count_--;
+    } else {
+      vods_count_--;
+    }
+    it->second = ordinal;
+  } else {
+    ordinals_[sid] = ordinal;
+  }
+
+  uint8_t flags = kind;
+  if (info.IsEnableVideo()) {
+    flags |= HAVE_VIDEO;
+  }
+  if (info.IsEnableAudio()) {
+    flags |= HAVE_AUDIO;
+  }
+
+  sids_.push_back(sid);
+  groups_.push_back(strings_.Intern(info.GetGroup()));
+  iarcs_.push_back(info.GetIARC());
+  flags_.push_back(flags);
+  display_names_.push_back(base::StringPool::empty_string_id);
+  icons_.push_back(compact_url_t());
+
+  const fastotv::commands_info::StreamBaseInfo::parts_t parts = info.GetParts();
+  for (size_t i = 0; i < parts.size(); ++i) {
+    parts_.push_back(strings_.Intern(parts[i]));
+  }
+  parts_offsets_.push_back(static_cast<uint32_t>(parts_.size()));
+
+  for (size_t i = 0; i < urls.size(); ++i) {
+    urls_.push_back(strings_.InternUrl(urls[i].GetUrl()));
+  }
+  urls_offsets_.push_back(static_cast<uint32_t>(urls_.size()));
+
+  tvg_ids_.push_back(base::StringPool::empty_string_id);
+  descriptions_.push_back(base::StringPool::empty_string_id);
+  countries_.push_back(base::StringPool::empty_string_id);
+  trailer_urls_.push_back(compact_url_t());
+  user_scores_.push_back(0);
+  prime_dates_.push_back(0);
+  durations_.push_back(0);
+  vod_types_.push_back(fastotv::commands_info::MovieInfo::Type());
+  return ordinal;
+}
+
+bool StreamCatalog::IsValidOrdinal(ordinal_t ordinal, uint8_t kind) const {
+  return ordinal < flags_.size() && (flags_[ordinal] & kind);
+}
+
+fastotv::commands_info::StreamBaseInfo::parts_t StreamCatalog::GetParts(ordinal_t ordinal) const {
+  const uint32_t begin = parts_offsets_[ordinal];
+  const uint32_t end = parts_offsets_[ordinal + 1];
+  fastotv::commands_info::StreamBaseInfo::parts_t parts;
+  parts.reserve(end - begin);
+  for (uint32_t i = begin; i < end; ++i) {
+    parts.push_back(strings_.Get(parts_[i]));
+  }
+  return parts;
+}
+
+std::vector<common::uri::Url> StreamCatalog::GetUrls(ordinal_t ordinal) const {
+  const uint32_t begin = urls_offsets_[ordinal];
+  const uint32_t end = urls_offsets_[ordinal + 1];
+  std::vector<common::uri::Url> urls;
+  urls.reserve(end - begin);
+  for (uint32_t i = begin; i < end; ++i) {
+    urls.push_back(common::uri::Url(strings_.GetUrl(urls_[i])));
+  }
+  return urls;
+}
+
+void StreamCatalog::ClearColumns() {
+  strings_.Clear();
+  ordinals_.clear();
+  channels_count_ = 0;
+  vods_count_ = 0;
+  sids_.clear();
+  groups_.clear();
+  iarcs_.clear();
+  flags_.clear();
+  display_names_.clear();
+  icons_.clear();
+  parts_offsets_.assign(1, 0);
+  parts_.clear();
+  urls_offsets_.assign(1, 0);
+  urls_.clear();
+  tvg_ids_.clear();
+  descriptions_.clear();
+  countries_.clear();
+  trailer_urls_.clear();
+  user_scores_.clear();
+  prime_dates_.clear();
+  durations_.clear();
+  vod_types_.clear();
+}
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,134 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/time.h>
+
+#include <fastotv/commands_info/channel_info.h>
+#include <fastotv/commands_info/vod_info.h>
+
+#include "base/string_pool.h"
+
+namespace fastocloud {
+namespace server {
+namespace base {
+class MetricCounter;
+}  // namespace base
+namespace mongo {
+
+struct UserStreamInfo;
+
+struct StreamCatalogStats {
+  StreamCatalogStats();
+
+  size_t channels;
+  size_t vods;
+  size_t strings;
+  size_t string_bytes;
+  uint64_t hits;
+  uint64_t misses;
+};
+
+// Decoded streams shared by all subscribers, stored column wise and addressed by dense ordinal.
+// Strings are interned, fastotv infos are materialized with user specific fields only when list is built.
+// Whole catalog is dropped on Refresh once ttl passes since first insert, ordinals stay valid till then.
+class StreamCatalog {
+ public:
+  typedef uint32_t ordinal_t;
+  typedef base::StringPool::string_id_t string_id_t;
+  typedef base::StringPool::CompactUrl compact_url_t;
+  enum : ordinal_t { invalid_ordinal = static_cast<ordinal_t>(-1) };
+
+  // ttl == 0 disables caching
+  explicit StreamCatalog(common::time64_t ttl_msec);
+
+  bool IsEnabled() const;
+  void Refresh();
+
+  ordinal_t FindChannel(const fastotv::stream_id_t& sid);
+  ordinal_t AddChannel(const fastotv::commands_info::ChannelInfo& chan);
+  bool GetChannel(ordinal_t ordinal, const UserStreamInfo& uinfo, fastotv::commands_info::ChannelInfo* chan) const;
+
+  ordinal_t FindVod(const fastotv::stream_id_t& sid);
+  ordinal_t AddVod(const fastotv::commands_info::VodInfo& vod);
+  bool GetVod(ordinal_t ordinal, const UserStreamInfo& uinfo, fastotv::commands_info::VodInfo* vod) const;
+
+  void RemoveStream(const fastotv::stream_id_t& sid);
+  void Clear();
+
+  StreamCatalogStats GetStats() const;
+
+ private:
+  StreamCatalog(const StreamCatalog&) = delete;
+  StreamCatalog& operator=(const StreamCatalog&) = delete;
+
+  enum StreamFlags : uint8_t { CHANNEL_STREAM = 1 << 0, VOD_STREAM = 1 << 1, HAVE_VIDEO = 1 << 2, HAVE_AUDIO = 1 << 3 };
+
+  ordinal_t Find(const fastotv::stream_id_t& sid, uint8_t kind);
+  ordinal_t Append(const fastotv::commands_info::StreamBaseInfo& info,
+                   const std::vector<common::uri::Url>& urls,
+                   uint8_t kind);
+  bool IsValidOrdinal(ordinal_t ordinal, uint8_t kind) const;
+  fastotv::commands_info::StreamBaseInfo::parts_t GetParts(ordinal_t ordinal) const;
+  std::vector<common::uri::Url> GetUrls(ordinal_t ordinal) const;
+  void ClearColumns();
+
+  const common::time64_t ttl_msec_;
+  mutable std::mutex mutex_;
+  common::time64_t epoch_start_msec_;
+  base::StringPool strings_;
+  std::unordered_map<string_id_t, ordinal_t> ordinals_;
+  size_t channels_count_;
+  size_t vods_count_;
+
+  // common columns
+  std::vector<string_id_t> sids_;
+  std::vector<string_id_t> groups_;
+  std::vector<int> iarcs_;
+  std::vector<uint8_t> flags_;
+  std::vector<string_id_t> display_names_;
+  std::vector<compact_url_t> icons_;  // channel logo or vod preview icon
+  // variable sized columns, entries of ordinal are [offsets[ordinal], offsets[ordinal + 1])
+  std::vector<uint32_t> parts_offsets_;
+  std::vector<string_id_t> parts_;
+  std::vector<uint32_t> urls_offsets_;
+  std::vector<compact_url_t> urls_;
+  // channel columns
+  std::vector<string_id_t> tvg_ids_;
+  // vod columns
+  std::vector<string_id_t> descriptions_;
+  std::vector<string_id_t> countries_;
+  std::vector<compact_url_t> trailer_urls_;
+  std::vector<double> user_scores_;
+  std::vector<fastotv::timestamp_t> prime_dates_;
+  std::vector<fastotv::timestamp_t> durations_;
+  std::vector<fastotv::commands_info::MovieInfo::Type> vod_types_;
+
+  uint64_t hits_;
+  uint64_t misses_;
+  base::MetricCounter* const hits_metric_;
+  base::MetricCounter* const misses_metric_;
+};
+
+}  // namespace mongo
+}  // namespace server
+}  // namespace fastocloud
@@ -16,6 +16,9 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <common/file_system/string_path_utils.h>
 #include <common/sprintf.h>
@@ -28,44 +31,13 @@
 
 #include "mongo/mongo2info.h"
 #include "mongo/mongo_engine.h"
-
-#define DB_NAME "iptv"
-#define SUBSCRIBERS_COLLECTION "subscribers"
-#define SERVERS_COLLECTION "services"
-#define STREAMS_COLLECTION "streams"
-
-#define PROXY_STR "pyfastocloud_models.stream.entry.ProxyStream"
-#define VOD_PROXY_STR "pyfastocloud_models.stream.entry.ProxyVodStream"
-#define COD_RELAY_STR "pyfastocloud_models.stream.entry.CodRelayStream"
-#define COD_ENCODE_STR "pyfastocloud_models.stream.entry.CodEncodeStream"
-#define RELAY_STR "pyfastocloud_models.stream.entry.RelayStream"
-#define ENCODE_STR "pyfastocloud_models.stream.entry.EncodeStream"
-#define VOD_RELAY_STR "pyfastocloud_models.stream.entry.VodRelayStream"
-#define VOD_ENCODE_STR "pyfastocloud_models.stream.entry.VodEncodeStream"
-#define TIMESHIFT_RECORDER_STR "pyfastocloud_models.stream.entry.TimeshiftRecorderStream"
-#define TIMESHIFT_PLAYER_STR "pyfastocloud_models.stream.entry.TimeshiftPlayerStream"
-#define CATCHUP_STR "pyfastocloud_models.stream.entry.CatchupStream"
-#define TEST_LIFE_STR "pyfastocloud_models.stream.entry.TestLifeStream"
-
-#define FAVORITE_FIELD "favorite"
-#define RECENT_FIELD "recent"
-#define PRIVATE_FIELD "private"
-#define INTERRUPTION_TIME_FIELD "interruption_time"
-#define USER_STREAM_ID_FIELD "sid"
-#define USER_STREAMS_FIELD "streams"
-#define USER_VODS_FIELD "vods"
-#define USER_CATCHUPS_FIELD "catchups"
-
-#define SERVER_STREAMS_FIELD "streams"
-
-#define INPUT_URL_CLS "pyfastocloud_models.common_entries.InputUrl"
-#define OUTPUT_URL_CLS "pyfastocloud_models.common_entries.OutputUrl"
-#define CATCHUP_USER_CLS_VALUE "pyfastocloud_models.subscriber.entry.UserStream"
+#include "mongo/mongo_operation.h"
+#include "mongo/schema.h"
 
 namespace {
 
-enum UserStatus { USER_NOT_ACTIVE = 0, USER_ACTIVE = 1, USER_DELETED = 2 };
-enum DeviceStatus { DEVICE_NOT_ACTIVE = 0, DEVICE_ACTIVE = 1, DEVICE_BANNED = 2 };
+// streams removed from subscriber in db stop being playable after this at the latest
+const common::time64_t kEntitlementsTTLMsec = 60 * 1000;
 
 fastotv::StreamType MongoStreamType2StreamType(const char* data) {
   if (strcmp(data, PROXY_STR) == 0) {
@@ -122,7 +94,7 @@ void CreateInputUrl(bson_t* result, const std::vector<fastotv::InputUri>& urls)
   BSON_APPEND_ARRAY_BEGIN(result, STREAM_INPUT_FIELD, &child);
   char buf[16];
   for (size_t i = 0; i < urls.size(); ++i) {
-    const fastotv::InputUri iurl = urls[i];
+    const fastotv::InputUri& iurl = urls[i];
     bson_t url;
     const char* key;
     size_t keylen = bson_uint32_to_string(i, &key, buf, sizeof(buf));
@@ -155,17 +127,16 @@ void CreateOutputUrl(bson_t* result, const std::vector<fastotv::OutputUri>& urls
   BSON_APPEND_ARRAY_BEGIN(result, STREAM_OUTPUT_FIELD, &child);
   char buf[16];
   for (size_t i = 0; i < urls.size(); ++i) {
-    const auto out = urls[i];
+    const fastotv::OutputUri& out = urls[i];
     bson_t url;
     const char* key;
     size_t keylen = bson_uint32_to_string(i, &key, buf, sizeof(buf));
     bson_append_document_begin(&child, key, keylen, &url);
     BSON_APPEND_UTF8(&url, "_cls", OUTPUT_URL_CLS);
     BSON_APPEND_INT32(&url, "id", out.GetID());
-    const auto url_str = out.GetOutput().GetUrl();
+    const std::string url_str = out.GetOutput().GetUrl();
     BSON_APPEND_UTF8(&url, "uri", url_str.c_str());
-    const auto http_root = out.GetHttpRoot();
-    const std::string http_root_str = http_root.GetPath();
+    const std::string http_root_str = out.GetHttpRoot().GetPath();
     BSON_APPEND_UTF8(&url, "http_root", http_root_str.c_str());
     BSON_APPEND_INT32(&url, "hls_type", out.GetHlsType());
     bson_append_document_end(&child, &url);
@@ -183,6 +154,7 @@ std::vector<fastotv::OutputUri> CreateCatchupOutputUrl(
   const std::string from = common::MemSPrintf("/%d/", origin_type);
 
   std::vector<fastotv::OutputUri> patched;
+  patched.reserve(urls.size());
   for (size_t i = 0; i < urls.size(); ++i) {
     fastotv::OutputUri out = urls[i];
     const common::uri::Url origin_url = out.GetOutput();
@@ -207,7 +179,7 @@ std::vector<fastotv::OutputUri> CreateCatchupOutputUrl(
       common::ReplaceFirstSubstringAfterOffset(&origin_http_root_str, 0, from, repl);
       out.SetHttpRoot(common::file_system::ascii_directory_string_path(origin_http_root_str));
     }
-    patched.push_back(out);
+    patched.push_back(std::move(out));
   }
   CreateOutputUrl(result, patched);
   return patched;
@@ -241,6 +213,129 @@ UserStreamInfo makeUserStreamInfo(bson_iter_t* iter) {
   return uinf;
 }
 
+// query stream by id, decode it and put into catalog
+bool LoadChannel(mongoc_collection_t* streams,
+                 const bson_oid_t* sid,
+                 const UserStreamInfo& uinf,
+                 StreamCatalog* catalog,
+                 fastotv::commands_info::ChannelInfo* chan) {
+  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(sid)));
+  MongoFindCursor stream_cursor(streams, stream_query.get());
+  const bson_t* sdoc;
+  if (!stream_cursor.Next(&sdoc)) {
+    return false;
+  }
+
+  bson_iter_t bcls;
+  if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
+    return false;
+  }
+
+  fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
+  if (!MakeChannelInfo(sdoc, st, uinf, chan)) {
+    return false;
+  }
+
+  catalog->AddChannel(*chan);
+  return true;
+}
+
+bool LoadVod(mongoc_collection_t* streams,
+             const bson_oid_t* sid,
+             const UserStreamInfo& uinf,
+             StreamCatalog* catalog,
+             fastotv::commands_info::VodInfo* vod) {
+  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(sid)));
+  MongoFindCursor stream_cursor(streams, stream_query.get());
+  const bson_t* sdoc;
+  if (!stream_cursor.Next(&sdoc)) {
+    return false;
+  }
+
+  bson_iter_t bcls;
+  if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
+    return false;
+  }
+
+  fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
+  if (!MakeVodInfo(sdoc, st, uinf, vod)) {
+    return false;
+  }
+
+  catalog->AddVod(*vod);
+  return true;
+}
+
+// resolves channel location of stream listed in user array of given kind, proxies are served by url
+common::Error FindHttpDirectoryOrUrlInStream(mongoc_collection_t* streams,
+                                             const bson_oid_t* sid,
+                                             EntitlementKind kind,
+                                             fastotv::channel_id_t cid,
+                                             base::ISubscribersManager::http_directory_t* directory,
+                                             common::uri::Url* url) {
+  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(sid)));
+  MongoFindCursor stream_cursor(streams, stream_query.get());
+  const bson_t* sdoc;
+  if (!stream_cursor.Next(&sdoc)) {
+    return common::make_error("Stream type not supported");
+  }
+
+  bson_iter_t bcls;
+  if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
+    return common::make_error("Invalid stream");
+  }
+
+  fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
+  bool is_proxy = false;
+  if (kind == STREAM_ENTITLEMENT) {
+    is_proxy = st == fastotv::PROXY;
+  } else if (kind == VOD_ENTITLEMENT) {
+    is_proxy = st == fastotv::VOD_PROXY;
+  }
+
+  if (is_proxy) {
+    common::uri::Url lurl;
+    if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
+      *url = lurl;
+      return common::Error();
+    }
+  } else {
+    base::ISubscribersManager::http_directory_t ldir;
+    if (GetHttpRootFromStream(sdoc, st, cid, &ldir)) {
+      if (common::file_system::is_directory_exist(ldir.GetPath())) {
+        *directory = ldir;
+        return common::Error();
+      }
+
+      common::uri::Url lurl;
+      if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
+        *url = lurl;
+        return common::Error();
+      }
+    }
+  }
+  return common::make_error("Cant parse stream urls");
+}
+
+std::vector<fastotv::stream_id_t> GetUserStreamIDs(const bson_t* doc, const char* field) {
+  std::vector<fastotv::stream_id_t> result;
+  bson_iter_t bstreams;
+  bson_iter_t ar;
+  if (!bson_iter_init_find(&bstreams, doc, field) || !BSON_ITER_HOLDS_ARRAY(&bstreams) ||
+      !bson_iter_recurse(&bstreams, &ar)) {
+    return result;
+  }
+
+  while (bson_iter_next(&ar)) {
+    bson_iter_t bsid;
+    if (BSON_ITER_HOLDS_DOCUMENT(&ar) && bson_iter_recurse(&ar, &bsid) && bson_iter_find(&bsid, USER_STREAM_ID_FIELD) &&
+        BSON_ITER_HOLDS_OID(&bsid)) {
+      result.push_back(common::ConvertToString(bson_iter_oid(&bsid)));
+    }
+  }
+  return result;
+}
+
 common::Error AddStreamToServer(mongoc_collection_t* servers,
                                 const bson_oid_t* server_oid,
                                 const bson_oid_t* stream_oid) {
@@ -249,8 +344,7 @@ common::Error AddStreamToServer(mongoc_collection_t* servers,
   bson_t* push_command = BCON_NEW("$push", "{", SERVER_STREAMS_FIELD, BCON_OID(stream_oid), "}");
   const unique_ptr_bson_t query_server_update(server_id);
   const unique_ptr_bson_t update_query_server_update(push_command);
-  if (!mongoc_collection_update(servers, MONGOC_UPDATE_NONE, query_server_update.get(),
-                                update_query_server_update.get(), NULL, &error)) {
+  if (!MongoUpdate(servers, query_server_update.get(), update_query_server_update.get(), &error)) {
     return common::make_error(error.message);
   }
 
@@ -266,8 +360,7 @@ common::Error AddStreamToUserStreamsArray(mongoc_collection_t* subscribers,
                                                      BCON_OID(stream_oid), FAVORITE_FIELD, BCON_BOOL(false),
                                                      PRIVATE_FIELD, BCON_BOOL(false), RECENT_FIELD, BCON_DATE_TIME(0),
                                                      INTERRUPTION_TIME_FIELD, BCON_INT32(0), "}", "}"));
-  if (!mongoc_collection_update(subscribers, MONGOC_UPDATE_NONE, query_user.get(), update_query_user.get(), NULL,
-                                &error)) {
+  if (!MongoUpdate(subscribers, query_user.get(), update_query_user.get(), &error)) {
     return common::make_error(error.message);
   }
   return common::Error();
@@ -282,8 +375,7 @@ common::Error AddStreamToUserVodsArray(mongoc_collection_t* subscribers,
                                                      BCON_OID(stream_oid), FAVORITE_FIELD, BCON_BOOL(false),
                                                      PRIVATE_FIELD, BCON_BOOL(false), RECENT_FIELD, BCON_DATE_TIME(0),
                                                      INTERRUPTION_TIME_FIELD, BCON_INT32(0), "}", "}"));
-  if (!mongoc_collection_update(subscribers, MONGOC_UPDATE_NONE, query_user.get(), update_query_user.get(), NULL,
-                                &error)) {
+  if (!MongoUpdate(subscribers, query_user.get(), update_query_user.get(), &error)) {
     return common::make_error(error.message);
   }
   return common::Error();
@@ -298,8 +390,7 @@ common::Error AddStreamToUserCatchupsArray(mongoc_collection_t* subscribers,
       BCON_NEW("$push", "{", USER_CATCHUPS_FIELD, "{", USER_STREAM_ID_FIELD, BCON_OID(stream_oid), FAVORITE_FIELD,
                BCON_BOOL(false), PRIVATE_FIELD, BCON_BOOL(false), RECENT_FIELD, BCON_DATE_TIME(0),
                INTERRUPTION_TIME_FIELD, BCON_INT32(0), "_cls", CATCHUP_USER_CLS_VALUE, "}", "}"));
-  if (!mongoc_collection_update(subscribers, MONGOC_UPDATE_NONE, query_user.get(), update_query_user.get(), NULL,
-                                &error)) {
+  if (!MongoUpdate(subscribers, query_user.get(), update_query_user.get(), &error)) {
     return common::make_error(error.message);
   }
   return common::Error();
@@ -312,7 +403,7 @@ common::Error RemoveStreamFromUserStreamsArray(mongoc_collection_t* subscribers,
   const unique_ptr_bson_t update_query(
       BCON_NEW("$pull", "{", USER_STREAMS_FIELD, "{", USER_STREAM_ID_FIELD, BCON_OID(stream_oid), "}", "}"));
   bson_error_t error;
-  if (!mongoc_collection_update(subscribers, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+  if (!MongoUpdate(subscribers, query.get(), update_query.get(), &error)) {
     return common::make_error(error.message);
   }
   return common::Error();
@@ -325,7 +416,7 @@ common::Error RemoveStreamFromUserVodsArray(mongoc_collection_t* subscribers,
   const unique_ptr_bson_t update_query(
       BCON_NEW("$pull", "{", USER_VODS_FIELD, "{", USER_STREAM_ID_FIELD, BCON_OID(stream_oid), "}", "}"));
   bson_error_t error;
-  if (!mongoc_collection_update(subscribers, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+  if (!MongoUpdate(subscribers, query.get(), update_query.get(), &error)) {
     return common::make_error(error.message);
   }
   return common::Error();
@@ -338,7 +429,7 @@ common::Error RemoveStreamFromUserCatchupsArray(mongoc_collection_t* subscribers
   const unique_ptr_bson_t update_query(
       BCON_NEW("$pull", "{", USER_CATCHUPS_FIELD, "{", USER_STREAM_ID_FIELD, BCON_OID(stream_oid), "}", "}"));
   bson_error_t error;
-  if (!mongoc_collection_update(subscribers, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+  if (!MongoUpdate(subscribers, query.get(), update_query.get(), &error)) {
     return common::make_error(error.message);
   }
   return common::Error();
@@ -347,9 +438,12 @@ common::Error RemoveStreamFromUserCatchupsArray(mongoc_collection_t* subscribers
 }  // namespace
 
 SubscribersManager::SubscribersManager(const common::net::HostAndPort& catchup_host,
-                                       const common::file_system::ascii_directory_string_path& catchups_http_root)
+                                       const common::file_system::ascii_directory_string_path& catchups_http_root,
+                                       uint32_t catalog_cache_ttl)
     : connections_mutex_(),
       connections_(),
+      catalog_(static_cast<common::time64_t>(catalog_cache_ttl) * 1000),
+      entitlements_(kEntitlementsTTLMsec),
       client_(nullptr),
       subscribers_(nullptr),
       servers_(nullptr),
@@ -392,6 +486,7 @@ common::ErrnoError SubscribersManager::ConnectToDatabase(const std::string& mong
 }
 
 common::ErrnoError SubscribersManager::Disconnect() {
+  catalog_.Clear();
   if (streams_) {
     mongoc_collection_destroy(streams_);
     streams_ = nullptr;
@@ -454,6 +549,7 @@ common::Error SubscribersManager::UnRegisterInnerConnectionByHost(base::Subscrib
   }
 
   if (hs->second.empty()) {
+    // entitlements are kept until ttl, http players reconnect for every segment
     connections_.erase(hs);
   }
   return common::Error();
@@ -489,6 +585,8 @@ size_t SubscribersManager::GetAndUpdateOnlineUserByStreamID(fastotv::stream_id_t
 
 common::Error SubscribersManager::ClientActivate(const fastotv::commands_info::LoginInfo& uauth,
                                                  fastotv::commands_info::DevicesInfo* dev) {
+  static const MongoOperation operation("client_activate");
+  const MongoOperationScope scope(&operation);
   if (!uauth.IsValid() || !dev) {
     return common::make_error_inval();
   }
@@ -500,10 +598,9 @@ common::Error SubscribersManager::ClientActivate(const fastotv::commands_info::L
   const std::string login = uauth.GetLogin();
   const unique_ptr_bson_t query(bson_new());
   BSON_APPEND_UTF8(query.get(), "email", login.c_str());
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  MongoFindCursor cursor(subscribers_, query.get());
   const bson_t* doc;
-  if (!cursor || !mongoc_cursor_next(cursor.get(), &doc)) {
+  if (!cursor.Next(&doc)) {
     return common::make_error("User not found");
   }
 
@@ -574,6 +671,8 @@ common::Error SubscribersManager::ClientLogin(fastotv::user_id_t uid,
                                               const std::string& password,
                                               fastotv::device_id_t dev,
                                               base::ServerDBAuthInfo* ser) {
+  static const MongoOperation operation("client_login_by_id");
+  const MongoOperationScope scope(&operation);
   if (uid.empty() || password.empty() || dev.empty()) {
     return common::make_error_inval();
   }
@@ -588,10 +687,9 @@ common::Error SubscribersManager::ClientLogin(fastotv::user_id_t uid,
   }
 
   const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  MongoFindCursor cursor(subscribers_, query.get());
   const bson_t* doc;
-  if (!cursor || !mongoc_cursor_next(cursor.get(), &doc)) {
+  if (!cursor.Next(&doc)) {
     return common::make_error("User not found");
   }
 
@@ -620,6 +718,8 @@ common::Error SubscribersManager::ClientLogin(fastotv::user_id_t uid,
 
 common::Error SubscribersManager::ClientLogin(const fastotv::commands_info::AuthInfo& uauth,
                                               base::ServerDBAuthInfo* ser) {
+  static const MongoOperation operation("client_login");
+  const MongoOperationScope scope(&operation);
   if (!uauth.IsValid() || !ser) {
     return common::make_error_inval();
   }
@@ -631,10 +731,9 @@ common::Error SubscribersManager::ClientLogin(const fastotv::commands_info::Auth
   const std::string login = uauth.GetLogin();
   const unique_ptr_bson_t query(bson_new());
   BSON_APPEND_UTF8(query.get(), "email", login.c_str());
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  MongoFindCursor cursor(subscribers_, query.get());
   const bson_t* doc;
-  if (!cursor || !mongoc_cursor_next(cursor.get(), &doc)) {
+  if (!cursor.Next(&doc)) {
     return common::make_error("User not found");
   }
 
@@ -739,12 +838,13 @@ common::Error SubscribersManager::ClientLoginImpl(fastotv::user_id_t uid,
               // update({"email":"test@gmail.com", "devices._id": ObjectId("5d9c57ae9303fc2a7b2ad571")}, {"$set": {
               // "devices.$.status": NumberInt(1) }})
               bson_error_t error;
-              if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, uquery.get(), update_query.get(), NULL,
-                                            &error)) {
+              if (!MongoUpdate(subscribers_, uquery.get(), update_query.get(), &error)) {
                 DEBUG_LOG() << "Failed to activate device error: " << error.message;
               }
             }
 
+            entitlements_.SetUser(login, GetUserStreamIDs(doc, USER_STREAMS_FIELD),
+                                  GetUserStreamIDs(doc, USER_VODS_FIELD), GetUserStreamIDs(doc, USER_CATCHUPS_FIELD));
             return common::Error();
           }
         }
@@ -765,6 +865,8 @@ common::Error SubscribersManager::ClientGetChannels(const fastotv::commands_info
                                                     fastotv::commands_info::ChannelsInfo* pchans,
                                                     fastotv::commands_info::VodsInfo* pvods,
                                                     fastotv::commands_info::CatchupsInfo* catchups) {
+  static const MongoOperation operation("client_get_channels");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || !chans || !vods || !pchans || !pvods || !catchups) {
     return common::make_error_inval();
   }
@@ -776,13 +878,15 @@ common::Error SubscribersManager::ClientGetChannels(const fastotv::commands_info
   const std::string login = auth.GetLogin();
   const unique_ptr_bson_t query(bson_new());
   BSON_APPEND_UTF8(query.get(), "email", login.c_str());
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  MongoFindCursor cursor(subscribers_, query.get());
   const bson_t* doc;
-  if (!cursor || !mongoc_cursor_next(cursor.get(), &doc)) {
+  if (!cursor.Next(&doc)) {
     return common::make_error("User not found");
   }
 
+  entitlements_.SetUser(login, GetUserStreamIDs(doc, USER_STREAMS_FIELD), GetUserStreamIDs(doc, USER_VODS_FIELD),
+                        GetUserStreamIDs(doc, USER_CATCHUPS_FIELD));
+  catalog_.Refresh();
   bson_iter_t bstreams;
   fastotv::commands_info::ChannelsInfo lchans;
   fastotv::commands_info::ChannelsInfo lpchans;
@@ -801,25 +905,15 @@ common::Error SubscribersManager::ClientGetChannels(const fastotv::commands_info
             bson_iter_init(&iter, &rec);
             if (bson_iter_find(&iter, USER_STREAM_ID_FIELD)) {
               const bson_oid_t* oid = bson_iter_oid(&iter);
-              const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(oid)));
-              const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-                  mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-              const bson_t* sdoc;
-              if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-                bson_iter_t bcls;
-                if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-                  continue;
-                }
-
-                UserStreamInfo uinf = makeUserStreamInfo(&iter);
-                fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-                fastotv::commands_info::ChannelInfo ch;
-                if (MakeChannelInfo(sdoc, st, uinf, &ch)) {
-                  if (uinf.priv) {
-                    lpchans.Add(ch);
-                  } else {
-                    lchans.Add(ch);
-                  }
+              const fastotv::stream_id_t sid = common::ConvertToString(oid);
+              const UserStreamInfo uinf = makeUserStreamInfo(&iter);
+              fastotv::commands_info::ChannelInfo ch;
+              if (catalog_.GetChannel(catalog_.FindChannel(sid), uinf, &ch) ||
+                  LoadChannel(streams_, oid, uinf, &catalog_, &ch)) {
+                if (uinf.priv) {
+                  lpchans.Add(ch);
+                } else {
+                  lchans.Add(ch);
                 }
               }
             }
@@ -847,25 +941,15 @@ common::Error SubscribersManager::ClientGetChannels(const fastotv::commands_info
             bson_iter_init(&iter, &rec);
             if (bson_iter_find(&iter, USER_STREAM_ID_FIELD)) {
               const bson_oid_t* oid = bson_iter_oid(&iter);
-              const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(oid)));
-              const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-                  mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-              const bson_t* sdoc;
-              if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-                bson_iter_t bcls;
-                if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-                  continue;
-                }
-
-                UserStreamInfo uinf = makeUserStreamInfo(&iter);
-                fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-                fastotv::commands_info::VodInfo ch;
-                if (MakeVodInfo(sdoc, st, uinf, &ch)) {
-                  if (uinf.priv) {
-                    lpvods.Add(ch);
-                  } else {
-                    lvods.Add(ch);
-                  }
+              const fastotv::stream_id_t sid = common::ConvertToString(oid);
+              const UserStreamInfo uinf = makeUserStreamInfo(&iter);
+              fastotv::commands_info::VodInfo ch;
+              if (catalog_.GetVod(catalog_.FindVod(sid), uinf, &ch) ||
+                  LoadVod(streams_, oid, uinf, &catalog_, &ch)) {
+                if (uinf.priv) {
+                  lpvods.Add(ch);
+                } else {
+                  lvods.Add(ch);
                 }
               }
             }
@@ -893,10 +977,9 @@ common::Error SubscribersManager::ClientGetChannels(const fastotv::commands_info
             if (bson_iter_find(&iter, USER_STREAM_ID_FIELD)) {
               const bson_oid_t* oid = bson_iter_oid(&iter);
               const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(oid)));
-              const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-                  mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
+              MongoFindCursor stream_cursor(streams_, stream_query.get());
               const bson_t* sdoc;
-              if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
+              if (stream_cursor.Next(&sdoc)) {
                 bson_iter_t bcls;
                 if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
                   continue;
@@ -917,13 +1000,13 @@ common::Error SubscribersManager::ClientGetChannels(const fastotv::commands_info
     }
   }
 
-  *vods = lvods;
-  *chans = lchans;
-  *pchans = lpchans;
-  *pvods = lpvods;
-  *catchups = lcatchups;
   DEBUG_LOG() << "Vods: " << lvods.Size() << " Channels: " << lchans.Size() << " PChannels: " << lpchans.Size()
               << " PVods: " << lpvods.Size() << " Catchups: " << lcatchups.Size();
+  *vods = std::move(lvods);
+  *chans = std::move(lchans);
+  *pchans = std::move(lpchans);
+  *pvods = std::move(lpvods);
+  *catchups = std::move(lcatchups);
   return common::Error();
 }
 
@@ -932,6 +1015,8 @@ common::Error SubscribersManager::ClientFindHttpDirectoryOrUrlForChannel(const f
                                                                          fastotv::channel_id_t cid,
                                                                          http_directory_t* directory,
                                                                          common::uri::Url* url) {
+  static const MongoOperation operation("client_find_http_directory_or_url_for_channel");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id || !directory || !url) {
     return common::make_error_inval();
   }
@@ -941,15 +1026,29 @@ common::Error SubscribersManager::ClientFindHttpDirectoryOrUrlForChannel(const f
   }
 
   const std::string login = auth.GetLogin();
+  EntitlementKind kind;
+  const EntitlementState state = entitlements_.CheckAny(login, sid, &kind);
+  if (state == ENTITLEMENT_DENIED) {
+    return common::make_error("Stream not found");
+  } else if (state == ENTITLEMENT_GRANTED) {
+    bson_oid_t bsid;
+    if (!common::ConvertFromString(sid, &bsid)) {
+      return common::make_error("Invalid stream id");
+    }
+    return FindHttpDirectoryOrUrlInStream(streams_, &bsid, kind, cid, directory, url);
+  }
+
   const unique_ptr_bson_t query(bson_new());
   BSON_APPEND_UTF8(query.get(), "email", login.c_str());
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  MongoFindCursor cursor(subscribers_, query.get());
   const bson_t* doc;
-  if (!cursor || !mongoc_cursor_next(cursor.get(), &doc)) {
+  if (!cursor.Next(&doc)) {
     return common::make_error("User not found");
   }
 
+  // next segments of this player are checked against bitmaps
+  entitlements_.SetUser(login, GetUserStreamIDs(doc, USER_STREAMS_FIELD), GetUserStreamIDs(doc, USER_VODS_FIELD),
+                        GetUserStreamIDs(doc, USER_CATCHUPS_FIELD));
   {
     bson_iter_t bstreams;
     if (bson_iter_init_find(&bstreams, doc, USER_STREAMS_FIELD) && BSON_ITER_HOLDS_ARRAY(&bstreams)) {
@@ -969,43 +1068,7 @@ common::Error SubscribersManager::ClientFindHttpDirectoryOrUrlForChannel(const f
                 const bson_oid_t* oid = bson_iter_oid(&iter);
                 std::string sid_str = common::ConvertToString(oid);
                 if (sid_str == sid) {
-                  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(oid)));
-                  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-                      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-                  const bson_t* sdoc;
-                  if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-                    bson_iter_t bcls;
-                    if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-                      return common::make_error("Invalid stream");
-                    }
-
-                    fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-                    bool is_proxy = st == fastotv::PROXY;
-
-                    if (is_proxy) {
-                      common::uri::Url lurl;
-                      if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
-                        *url = lurl;
-                        return common::Error();
-                      }
-                    } else {
-                      http_directory_t ldir;
-                      if (GetHttpRootFromStream(sdoc, st, cid, &ldir)) {
-                        if (common::file_system::is_directory_exist(ldir.GetPath())) {
-                          *directory = ldir;
-                          return common::Error();
-                        }
-
-                        common::uri::Url lurl;
-                        if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
-                          *url = lurl;
-                          return common::Error();
-                        }
-                      }
-                    }
-                    return common::make_error("Cant parse stream urls");
-                  }
-                  return common::make_error("Stream type not supported");
+                  return FindHttpDirectoryOrUrlInStream(streams_, oid, STREAM_ENTITLEMENT, cid, directory, url);
                 }
               }
             }
@@ -1035,43 +1098,7 @@ common::Error SubscribersManager::ClientFindHttpDirectoryOrUrlForChannel(const f
                 const bson_oid_t* oid = bson_iter_oid(&iter);
                 std::string sid_str = common::ConvertToString(oid);
                 if (sid_str == sid) {
-                  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(oid)));
-                  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-                      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-                  const bson_t* sdoc;
-                  if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-                    bson_iter_t bcls;
-                    if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-                      return common::make_error("Invalid stream");
-                    }
-
-                    fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-                    bool is_proxy = st == fastotv::VOD_PROXY;
-
-                    if (is_proxy) {
-                      common::uri::Url lurl;
-                      if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
-                        *url = lurl;
-                        return common::Error();
-                      }
-                    } else {
-                      http_directory_t ldir;
-                      if (GetHttpRootFromStream(sdoc, st, cid, &ldir)) {
-                        if (common::file_system::is_directory_exist(ldir.GetPath())) {
-                          *directory = ldir;
-                          return common::Error();
-                        }
-
-                        common::uri::Url lurl;
-                        if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
-                          *url = lurl;
-                          return common::Error();
-                        }
-                      }
-                    }
-                    return common::make_error("Cant parse stream urls");
-                  }
-                  return common::make_error("Stream type not supported");
+                  return FindHttpDirectoryOrUrlInStream(streams_, oid, VOD_ENTITLEMENT, cid, directory, url);
                 }
               }
             }
@@ -1101,43 +1128,7 @@ common::Error SubscribersManager::ClientFindHttpDirectoryOrUrlForChannel(const f
                 const bson_oid_t* oid = bson_iter_oid(&iter);
                 std::string sid_str = common::ConvertToString(oid);
                 if (sid_str == sid) {
-                  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(oid)));
-                  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-                      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-                  const bson_t* sdoc;
-                  if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-                    bson_iter_t bcls;
-                    if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-                      return common::make_error("Invalid stream");
-                    }
-
-                    fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-                    bool is_proxy = false;
-
-                    if (is_proxy) {
-                      common::uri::Url lurl;
-                      if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
-                        *url = lurl;
-                        return common::Error();
-                      }
-                    } else {
-                      http_directory_t ldir;
-                      if (GetHttpRootFromStream(sdoc, st, cid, &ldir)) {
-                        if (common::file_system::is_directory_exist(ldir.GetPath())) {
-                          *directory = ldir;
-                          return common::Error();
-                        }
-
-                        common::uri::Url lurl;
-                        if (GetUrlFromStream(sdoc, st, cid, &lurl)) {
-                          *url = lurl;
-                          return common::Error();
-                        }
-                      }
-                    }
-                    return common::make_error("Cant parse stream urls");
-                  }
-                  return common::make_error("Stream type not supported");
+                  return FindHttpDirectoryOrUrlInStream(streams_, oid, CATCHUP_ENTITLEMENT, cid, directory, url);
                 }
               }
             }
@@ -1153,6 +1144,8 @@ common::Error SubscribersManager::ClientFindHttpDirectoryOrUrlForChannel(const f
 
 common::Error SubscribersManager::SetFavorite(const base::ServerDBAuthInfo& auth,
                                               const fastotv::commands_info::FavoriteInfo& favorite) {
+  static const MongoOperation operation("set_favorite");
+  const MongoOperationScope scope(&operation);
   if (!favorite.IsValid()) {
     return common::make_error_inval();
   }
@@ -1168,9 +1161,8 @@ common::Error SubscribersManager::SetFavorite(const base::ServerDBAuthInfo& auth
 
   const bson_t* sdoc;
   const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&sid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-  if (!stream_cursor || !mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
+  if (!stream_cursor.Next(&sdoc)) {
     return common::make_error("Stream not found");
   }
 
@@ -1190,7 +1182,7 @@ common::Error SubscribersManager::SetFavorite(const base::ServerDBAuthInfo& auth
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_VODS_FIELD ".$." FAVORITE_FIELD, BCON_BOOL(favorite.GetFavorite()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set favorite error: " << error.message;
     }
   } else if (st == fastotv::CATCHUP) {
@@ -1198,7 +1190,7 @@ common::Error SubscribersManager::SetFavorite(const base::ServerDBAuthInfo& auth
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_CATCHUPS_FIELD ".$." FAVORITE_FIELD, BCON_BOOL(favorite.GetFavorite()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set favorite error: " << error.message;
     }
   } else {
@@ -1206,7 +1198,7 @@ common::Error SubscribersManager::SetFavorite(const base::ServerDBAuthInfo& auth
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_STREAMS_FIELD ".$." FAVORITE_FIELD, BCON_BOOL(favorite.GetFavorite()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set favorite error: " << error.message;
     }
   }
@@ -1216,6 +1208,8 @@ common::Error SubscribersManager::SetFavorite(const base::ServerDBAuthInfo& auth
 
 common::Error SubscribersManager::SetRecent(const base::ServerDBAuthInfo& auth,
                                             const fastotv::commands_info::RecentStreamTimeInfo& recent) {
+  static const MongoOperation operation("set_recent");
+  const MongoOperationScope scope(&operation);
   if (!recent.IsValid()) {
     return common::make_error_inval();
   }
@@ -1231,9 +1225,8 @@ common::Error SubscribersManager::SetRecent(const base::ServerDBAuthInfo& auth,
 
   const bson_t* sdoc;
   const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&sid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-  if (!stream_cursor || !mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
+  if (!stream_cursor.Next(&sdoc)) {
     return common::make_error("Stream not found");
   }
 
@@ -1253,7 +1246,7 @@ common::Error SubscribersManager::SetRecent(const base::ServerDBAuthInfo& auth,
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_VODS_FIELD ".$." RECENT_FIELD, BCON_DATE_TIME(recent.GetTimestamp()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set recent error: " << error.message;
     }
   } else if (st == fastotv::CATCHUP) {
@@ -1261,7 +1254,7 @@ common::Error SubscribersManager::SetRecent(const base::ServerDBAuthInfo& auth,
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_CATCHUPS_FIELD ".$." RECENT_FIELD, BCON_DATE_TIME(recent.GetTimestamp()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set recent error: " << error.message;
     }
   } else {
@@ -1269,7 +1262,7 @@ common::Error SubscribersManager::SetRecent(const base::ServerDBAuthInfo& auth,
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_STREAMS_FIELD ".$." RECENT_FIELD, BCON_DATE_TIME(recent.GetTimestamp()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set recent error: " << error.message;
     }
   }
@@ -1279,6 +1272,8 @@ common::Error SubscribersManager::SetRecent(const base::ServerDBAuthInfo& auth,
 
 common::Error SubscribersManager::SetInterruptTime(const base::ServerDBAuthInfo& auth,
                                                    const fastotv::commands_info::InterruptStreamTimeInfo& inter) {
+  static const MongoOperation operation("set_interrupt_time");
+  const MongoOperationScope scope(&operation);
   if (!inter.IsValid()) {
     return common::make_error_inval();
   }
@@ -1294,9 +1289,8 @@ common::Error SubscribersManager::SetInterruptTime(const base::ServerDBAuthInfo&
 
   const bson_t* sdoc;
   const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&sid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-  if (!stream_cursor || !mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
+  if (!stream_cursor.Next(&sdoc)) {
     return common::make_error("Stream not found");
   }
 
@@ -1317,7 +1311,7 @@ common::Error SubscribersManager::SetInterruptTime(const base::ServerDBAuthInfo&
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_VODS_FIELD ".$." INTERRUPTION_TIME_FIELD, BCON_INT32(inter.GetTime()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set interrupt time error: " << error.message;
     }
   } else if (st == fastotv::CATCHUP) {
@@ -1325,7 +1319,7 @@ common::Error SubscribersManager::SetInterruptTime(const base::ServerDBAuthInfo&
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_CATCHUPS_FIELD ".$." INTERRUPTION_TIME_FIELD, BCON_INT32(inter.GetTime()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set interrupt time error: " << error.message;
     }
   } else {
@@ -1333,7 +1327,7 @@ common::Error SubscribersManager::SetInterruptTime(const base::ServerDBAuthInfo&
     const unique_ptr_bson_t update_query(
         BCON_NEW("$set", "{", USER_STREAMS_FIELD ".$." INTERRUPTION_TIME_FIELD, BCON_INT32(inter.GetTime()), "}"));
     bson_error_t error;
-    if (!mongoc_collection_update(subscribers_, MONGOC_UPDATE_NONE, query.get(), update_query.get(), NULL, &error)) {
+    if (!MongoUpdate(subscribers_, query.get(), update_query.get(), &error)) {
       DEBUG_LOG() << "Failed to set interrupt time error: " << error.message;
     }
   }
@@ -1344,6 +1338,8 @@ common::Error SubscribersManager::SetInterruptTime(const base::ServerDBAuthInfo&
 common::Error SubscribersManager::FindStream(const base::ServerDBAuthInfo& auth,
                                              fastotv::stream_id_t sid,
                                              fastotv::commands_info::ChannelInfo* chan) const {
+  static const MongoOperation operation("find_stream");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id || !chan) {
     return common::make_error_inval();
   }
@@ -1362,32 +1358,38 @@ common::Error SubscribersManager::FindStream(const base::ServerDBAuthInfo& auth,
     return common::make_error("Invalid stream id");
   }
 
-  const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid), USER_STREAMS_FIELD ".sid", BCON_OID(&bsid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_user_cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  const EntitlementState state = entitlements_.Check(auth.GetLogin(), STREAM_ENTITLEMENT, sid);
+  if (state == ENTITLEMENT_DENIED) {
+    return common::make_error("Stream not found");
+  }
+
   const bson_t* sdoc;
-  if (stream_user_cursor && mongoc_cursor_next(stream_user_cursor.get(), &sdoc)) {
+  UserStreamInfo uinf;
+  if (state == ENTITLEMENT_UNKNOWN) {
+    const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid), USER_STREAMS_FIELD ".sid", BCON_OID(&bsid)));
+    MongoFindCursor stream_user_cursor(subscribers_, query.get());
+    if (!stream_user_cursor.Next(&sdoc)) {
+      return common::make_error("Stream not found");
+    }
+
     bson_iter_t iter;
     bson_iter_init(&iter, sdoc);
-    UserStreamInfo uinf = makeUserStreamInfo(&iter);
-
-    const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
-    const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-        mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-    if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-      bson_iter_t bcls;
-      if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-        return common::make_error("Invalid stream");
-      }
+    uinf = makeUserStreamInfo(&iter);
+  }
 
-      fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-      if (IsVod(st)) {
-      } else {
-        fastotv::commands_info::ChannelInfo ch;
-        if (MakeChannelInfo(sdoc, st, uinf, &ch)) {
-          *chan = ch;
-          return common::Error();
-        }
+  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
+  if (stream_cursor.Next(&sdoc)) {
+    bson_iter_t bcls;
+    if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
+      return common::make_error("Invalid stream");
+    }
+
+    fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
+    if (IsVod(st)) {
+    } else {
+      if (MakeChannelInfo(sdoc, st, uinf, chan)) {
+        return common::Error();
       }
     }
   }
@@ -1397,6 +1399,8 @@ common::Error SubscribersManager::FindStream(const base::ServerDBAuthInfo& auth,
 common::Error SubscribersManager::FindVod(const base::ServerDBAuthInfo& auth,
                                           fastotv::stream_id_t sid,
                                           fastotv::commands_info::VodInfo* vod) const {
+  static const MongoOperation operation("find_vod");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id || !vod) {
     return common::make_error_inval();
   }
@@ -1415,31 +1419,37 @@ common::Error SubscribersManager::FindVod(const base::ServerDBAuthInfo& auth,
     return common::make_error("Invalid stream id");
   }
 
-  const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid), USER_VODS_FIELD ".sid", BCON_OID(&bsid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_user_cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  const EntitlementState state = entitlements_.Check(auth.GetLogin(), VOD_ENTITLEMENT, sid);
+  if (state == ENTITLEMENT_DENIED) {
+    return common::make_error("Stream not found");
+  }
+
   const bson_t* sdoc;
-  if (stream_user_cursor && mongoc_cursor_next(stream_user_cursor.get(), &sdoc)) {
+  UserStreamInfo uinf;
+  if (state == ENTITLEMENT_UNKNOWN) {
+    const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid), USER_VODS_FIELD ".sid", BCON_OID(&bsid)));
+    MongoFindCursor stream_user_cursor(subscribers_, query.get());
+    if (!stream_user_cursor.Next(&sdoc)) {
+      return common::make_error("Stream not found");
+    }
+
     bson_iter_t iter;
     bson_iter_init(&iter, sdoc);
-    UserStreamInfo uinf = makeUserStreamInfo(&iter);
-
-    const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
-    const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-        mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-    if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-      bson_iter_t bcls;
-      if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-        return common::make_error("Invalid stream");
-      }
+    uinf = makeUserStreamInfo(&iter);
+  }
 
-      fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-      if (IsVod(st)) {
-        fastotv::commands_info::VodInfo ch;
-        if (MakeVodInfo(sdoc, st, uinf, &ch)) {
-          *vod = ch;
-          return common::Error();
-        }
+  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
+  if (stream_cursor.Next(&sdoc)) {
+    bson_iter_t bcls;
+    if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
+      return common::make_error("Invalid stream");
+    }
+
+    fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
+    if (IsVod(st)) {
+      if (MakeVodInfo(sdoc, st, uinf, vod)) {
+        return common::Error();
       }
     }
   }
@@ -1449,6 +1459,8 @@ common::Error SubscribersManager::FindVod(const base::ServerDBAuthInfo& auth,
 common::Error SubscribersManager::FindCatchup(const base::ServerDBAuthInfo& auth,
                                               fastotv::stream_id_t sid,
                                               fastotv::commands_info::CatchupInfo* cat) const {
+  static const MongoOperation operation("find_catchup");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id || !cat) {
     return common::make_error_inval();
   }
@@ -1467,32 +1479,38 @@ common::Error SubscribersManager::FindCatchup(const base::ServerDBAuthInfo& auth
     return common::make_error("Invalid stream id");
   }
 
-  const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid), USER_CATCHUPS_FIELD ".sid", BCON_OID(&bsid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_user_cursor(
-      mongoc_collection_find(subscribers_, MONGOC_QUERY_NONE, 0, 0, 0, query.get(), NULL, NULL));
+  const EntitlementState state = entitlements_.Check(auth.GetLogin(), CATCHUP_ENTITLEMENT, sid);
+  if (state == ENTITLEMENT_DENIED) {
+    return common::make_error("Stream not found");
+  }
+
   const bson_t* sdoc;
-  if (stream_user_cursor && mongoc_cursor_next(stream_user_cursor.get(), &sdoc)) {
+  UserStreamInfo uinf;
+  if (state == ENTITLEMENT_UNKNOWN) {
+    const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(&oid), USER_CATCHUPS_FIELD ".sid", BCON_OID(&bsid)));
+    MongoFindCursor stream_user_cursor(subscribers_, query.get());
+    if (!stream_user_cursor.Next(&sdoc)) {
+      return common::make_error("Stream not found");
+    }
+
     bson_iter_t iter;
     bson_iter_init(&iter, sdoc);
-    UserStreamInfo uinf = makeUserStreamInfo(&iter);
-
-    const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
-    const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-        mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
-    if (stream_cursor && mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
-      bson_iter_t bcls;
-      if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
-        return common::make_error("Invalid stream");
-      }
+    uinf = makeUserStreamInfo(&iter);
+  }
 
-      fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
-      if (IsVod(st)) {
-      } else {
-        fastotv::commands_info::CatchupInfo ch;
-        if (MakeCatchupInfo(sdoc, st, uinf, &ch)) {
-          *cat = ch;
-          return common::Error();
-        }
+  const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
+  if (stream_cursor.Next(&sdoc)) {
+    bson_iter_t bcls;
+    if (!bson_iter_init_find(&bcls, sdoc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls)) {
+      return common::make_error("Invalid stream");
+    }
+
+    fastotv::StreamType st = MongoStreamType2StreamType(bson_iter_utf8(&bcls, NULL));
+    if (IsVod(st)) {
+    } else {
+      if (MakeCatchupInfo(sdoc, st, uinf, cat)) {
+        return common::Error();
       }
     }
   }
@@ -1506,6 +1524,8 @@ common::Error SubscribersManager::CreateCatchup(const base::ServerDBAuthInfo& au
                                                 fastotv::timestamp_t stop,
                                                 fastotv::commands_info::CatchupInfo* cat,
                                                 bool* is_created) {
+  static const MongoOperation operation("create_catchup");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id || !cat || !is_created) {
     return common::make_error_inval();
   }
@@ -1520,17 +1540,12 @@ common::Error SubscribersManager::CreateCatchup(const base::ServerDBAuthInfo& au
     return err;
   }
 
-  fastotv::commands_info::CatchupInfo catchup;
-  err = CreateOrFindCatchup(ch, title, start, stop, &catchup, is_created);
-  if (err) {
-    return err;
-  }
-
-  *cat = catchup;
-  return common::Error();
+  return CreateOrFindCatchup(ch, title, start, stop, cat, is_created);
 }
 
 common::Error SubscribersManager::RemoveUserStream(const base::ServerDBAuthInfo& auth, fastotv::stream_id_t sid) {
+  static const MongoOperation operation("remove_user_stream");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id) {
     return common::make_error_inval();
   }
@@ -1554,10 +1569,13 @@ common::Error SubscribersManager::RemoveUserStream(const base::ServerDBAuthInfo&
     return err;
   }
 
+  entitlements_.Revoke(auth.GetLogin(), STREAM_ENTITLEMENT, sid);
   return common::Error();
 }
 
 common::Error SubscribersManager::AddUserStream(const base::ServerDBAuthInfo& auth, fastotv::stream_id_t sid) {
+  static const MongoOperation operation("add_user_stream");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id) {
     return common::make_error_inval();
   }
@@ -1576,15 +1594,18 @@ common::Error SubscribersManager::AddUserStream(const base::ServerDBAuthInfo& au
     return common::make_error("Invalid stream id");
   }
 
-  common::Error err = AddStreamToUserStreamsArray(subscribers_, &oid, &oid);
+  common::Error err = AddStreamToUserStreamsArray(subscribers_, &oid, &bsid);
   if (err) {
     return err;
   }
 
+  entitlements_.Grant(auth.GetLogin(), STREAM_ENTITLEMENT, sid);
   return common::Error();
 }
 
 common::Error SubscribersManager::RemoveUserVod(const base::ServerDBAuthInfo& auth, fastotv::stream_id_t sid) {
+  static const MongoOperation operation("remove_user_vod");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id) {
     return common::make_error_inval();
   }
@@ -1608,10 +1629,13 @@ common::Error SubscribersManager::RemoveUserVod(const base::ServerDBAuthInfo& au
     return err;
   }
 
+  entitlements_.Revoke(auth.GetLogin(), VOD_ENTITLEMENT, sid);
   return common::Error();
 }
 
 common::Error SubscribersManager::AddUserVod(const base::ServerDBAuthInfo& auth, fastotv::stream_id_t sid) {
+  static const MongoOperation operation("add_user_vod");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id) {
     return common::make_error_inval();
   }
@@ -1635,10 +1659,13 @@ common::Error SubscribersManager::AddUserVod(const base::ServerDBAuthInfo& auth,
     return err;
   }
 
+  entitlements_.Grant(auth.GetLogin(), VOD_ENTITLEMENT, sid);
   return common::Error();
 }
 
 common::Error SubscribersManager::RemoveUserCatchup(const base::ServerDBAuthInfo& auth, fastotv::stream_id_t sid) {
+  static const MongoOperation operation("remove_user_catchup");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id) {
     return common::make_error_inval();
   }
@@ -1662,10 +1689,13 @@ common::Error SubscribersManager::RemoveUserCatchup(const base::ServerDBAuthInfo
     return err;
   }
 
+  entitlements_.Revoke(auth.GetLogin(), CATCHUP_ENTITLEMENT, sid);
   return common::Error();
 }
 
 common::Error SubscribersManager::AddUserCatchup(const base::ServerDBAuthInfo& auth, fastotv::stream_id_t sid) {
+  static const MongoOperation operation("add_user_catchup");
+  const MongoOperationScope scope(&operation);
   if (!auth.IsValid() || sid == fastotv::invalid_stream_id) {
     return common::make_error_inval();
   }
@@ -1689,6 +1719,7 @@ common::Error SubscribersManager::AddUserCatchup(const base::ServerDBAuthInfo& a
     return err;
   }
 
+  entitlements_.Grant(auth.GetLogin(), CATCHUP_ENTITLEMENT, sid);
   return common::Error();
 }
 
@@ -1698,6 +1729,8 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
                                                       fastotv::timestamp_t stop,
                                                       fastotv::commands_info::CatchupInfo* cat,
                                                       bool* is_created) {
+  static const MongoOperation operation("create_or_find_catchup");
+  const MongoOperationScope scope(&operation);
   auto epg = based_on.GetEpg();
   epg.ClearPrograms();
   epg.SetDisplayName(title);
@@ -1717,10 +1750,9 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
       }
 
       const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&sid)));
-      const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-          mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
+      MongoFindCursor stream_cursor(streams_, stream_query.get());
       const bson_t* sdoc;
-      if (!stream_cursor || !mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
+      if (!stream_cursor.Next(&sdoc)) {
         continue;
       }
 
@@ -1744,10 +1776,8 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
       fastotv::timestamp_t stream_stop = bson_iter_date_time(&bstop);
       if (stream_name == title && stream_start == start && stop == stream_stop) {
         UserStreamInfo uinf;
-        fastotv::commands_info::CatchupInfo orig;
-        if (MakeCatchupInfo(sdoc, fastotv::CATCHUP, uinf, &orig)) {
-          INFO_LOG() << "Cached catchup: " << orig.GetStreamID();
-          *cat = orig;
+        if (MakeCatchupInfo(sdoc, fastotv::CATCHUP, uinf, cat)) {
+          INFO_LOG() << "Cached catchup: " << cat->GetStreamID();
           *is_created = false;
           return common::Error();
         }
@@ -1762,19 +1792,17 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
   }
 
   const unique_ptr_bson_t stream_query(BCON_NEW("_id", BCON_OID(&bsid)));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_cursor(
-      mongoc_collection_find(streams_, MONGOC_QUERY_NONE, 0, 0, 0, stream_query.get(), NULL, NULL));
+  MongoFindCursor stream_cursor(streams_, stream_query.get());
   const bson_t* sdoc;
-  if (!stream_cursor || !mongoc_cursor_next(stream_cursor.get(), &sdoc)) {
+  if (!stream_cursor.Next(&sdoc)) {
     return common::make_error("Stream not found");
   }
 
   const unique_ptr_bson_t server_stream_query(
       BCON_NEW(SERVER_STREAMS_FIELD, "{", "$elemMatch", "{", "$eq", BCON_OID(&bsid), "}", "}"));
-  const std::unique_ptr<mongoc_cursor_t, MongoCursorDeleter> stream_server_cursor(
-      mongoc_collection_find(servers_, MONGOC_QUERY_NONE, 0, 0, 0, server_stream_query.get(), NULL, NULL));
+  MongoFindCursor stream_server_cursor(servers_, server_stream_query.get());
   const bson_t* server_sdoc;
-  if (!stream_server_cursor || !mongoc_cursor_next(stream_server_cursor.get(), &server_sdoc)) {
+  if (!stream_server_cursor.Next(&server_sdoc)) {
     return common::make_error("Server not found");
   }
 
@@ -1831,10 +1859,10 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
   int log_level = common::logging::LOG_LEVEL_INFO;
   BSON_APPEND_INT32(doc.get(), STREAM_LOG_LEVEL_FIELD, log_level);
   std::vector<fastotv::InputUri> catchup_inputs;
+  catchup_inputs.reserve(output_urls.size());
   for (size_t i = 0; i < output_urls.size(); ++i) {
-    auto ourl = output_urls[i];
-    fastotv::InputUri iurl(ourl.GetID(), ourl.GetOutput());
-    catchup_inputs.push_back(iurl);
+    const fastotv::OutputUri& ourl = output_urls[i];
+    catchup_inputs.push_back(fastotv::InputUri(ourl.GetID(), ourl.GetOutput()));
   }
   CreateInputUrl(doc.get(), catchup_inputs);
   BSON_APPEND_BOOL(doc.get(), STREAM_HAVE_VIDEO_FIELD, based_on.IsEnableVideo());
@@ -1863,7 +1891,7 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
   BSON_APPEND_DATE_TIME(doc.get(), CATCHUP_STOP_FIELD, stop);
 
   bson_error_t error;
-  if (!mongoc_collection_insert(streams_, MONGOC_INSERT_NONE, doc.get(), NULL, &error)) {
+  if (!MongoInsert(streams_, doc.get(), &error)) {
     DEBUG_LOG() << "Failed create catchup error: " << error.message;
     return common::make_error(error.message);
   }
@@ -1871,11 +1899,11 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
   // link catchup to stream parts array
   const unique_ptr_bson_t query_main_stream(BCON_NEW("_id", BCON_OID(&bsid)));
   const unique_ptr_bson_t update_main_stream(BCON_NEW("$push", "{", STREAM_PARTS_FIELD, BCON_OID(&catchupid), "}"));
-  if (!mongoc_collection_update(streams_, MONGOC_UPDATE_NONE, stream_query.get(), update_main_stream.get(), NULL,
-                                &error)) {
+  if (!MongoUpdate(streams_, stream_query.get(), update_main_stream.get(), &error)) {
     DEBUG_LOG() << "Failed to add stream to parts stream array: " << error.message;
     return common::make_error(error.message);
   }
+  catalog_.RemoveStream(sid);
 
   const bson_oid_t* server_oid = bson_iter_oid(&server_id);
   common::Error err = AddStreamToServer(servers_, server_oid, &catchupid);
@@ -1888,7 +1916,7 @@ common::Error SubscribersManager::CreateOrFindCatchup(const fastotv::commands_in
   copy.SetEpg(epg);
   copy.SetStreamID(cid_str);
   *is_created = true;
-  *cat = copy;
+  *cat = std::move(copy);
   return common::Error();
 }
 
@@ -23,6 +23,9 @@
 
 #include "base/isubscribers_manager.h"
 
+#include "mongo/entitlements.h"
+#include "mongo/stream_catalog.h"
+
 typedef struct _mongoc_client_t mongoc_client_t;
 typedef struct _mongoc_collection_t mongoc_collection_t;
 typedef struct _bson_t bson_t;
@@ -34,8 +37,10 @@ namespace mongo {
 class SubscribersManager : public base::ISubscribersManager {
  public:
   typedef std::unordered_map<fastotv::user_id_t, std::vector<base::SubscriberInfo*>> inner_connections_t;
+  // catalog_cache_ttl in seconds, 0 disables stream catalog cache
   SubscribersManager(const common::net::HostAndPort& catchup_host,
-                     const common::file_system::ascii_directory_string_path& catchups_http_root);
+                     const common::file_system::ascii_directory_string_path& catchups_http_root,
+                     uint32_t catalog_cache_ttl);
 
   common::ErrnoError ConnectToDatabase(const std::string& mongodb_url) WARN_UNUSED_RESULT;
   common::ErrnoError Disconnect() WARN_UNUSED_RESULT;
@@ -121,6 +126,9 @@ class SubscribersManager : public base::ISubscribersManager {
 
   std::mutex connections_mutex_;
   inner_connections_t connections_;
+  StreamCatalog catalog_;
+  // per user stream ids of logged in users, lets lookups skip subscribers collection
+  Entitlements entitlements_;
 
   mongoc_client_t* client_;
   mongoc_collection_t* subscribers_;
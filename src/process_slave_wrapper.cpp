@@ -21,14 +21,24 @@
 #include <common/daemon/commands/stop_info.h>
 #include <common/license/check_expire_license.h>
 #include <common/net/net.h>
+#include <common/time.h>
+
+#include "base/async_log.h"
+#include "base/edge_registry.h"
+#include "base/metrics.h"
+#include "base/request_tracer.h"
+#include "base/runtime_stats.h"
+#include "base/traffic_capture.h"
 
 #include "daemon/client.h"
 #include "daemon/commands.h"
+#include "daemon/edge_info.h"
 #include "daemon/server.h"
 
 #include "http/handler.h"
 #include "http/server.h"
 
+#include "mongo/mongo_operation.h"
 #include "mongo/subscribers_manager.h"
 
 #include "subscribers/handler.h"
@@ -44,21 +54,79 @@ ProcessSlaveWrapper::ProcessSlaveWrapper(const Config& config)
       subscribers_handler_(nullptr),
       http_server_(nullptr),
       http_handler_(nullptr),
-      ping_client_timer_(INVALID_TIMER_ID) {
+      capture_(nullptr),
+      tracer_(nullptr),
+      edges_(nullptr),
+      ping_client_timer_(INVALID_TIMER_ID),
+      lag_timer_(INVALID_TIMER_ID),
+      lag_monitor_("daemon", config.loop_lag_degraded_threshold, config.loop_lag_overloaded_threshold) {
   loop_ = new DaemonServer(config.host, this);
   loop_->SetName("client_server");
 
+  mongo::SlowQueryLog::GetInstance().SetThreshold(config.mongo_slow_threshold);
   mongo::SubscribersManager* sub_manager =
-      new mongo::SubscribersManager(config.catchup_host, config.catchups_http_root);
+      new mongo::SubscribersManager(config.catchup_host, config.catchups_http_root, config.catalog_cache_ttl);
   sub_manager->ConnectToDatabase(config.mongodb_url);
   sub_manager_ = sub_manager;
 
-  subscribers_handler_ = new subscribers::SubscribersHandler(this, sub_manager_, config.epg_url);
-  subscribers_server_ = new subscribers::SubscribersServer(config.subscribers_host, subscribers_handler_);
+  if (!config.capture_path.empty()) {
+    base::TrafficCapture* capture = new base::TrafficCapture(config.capture_path, config.capture_buffer_size);
+    common::ErrnoError err = capture->Start();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      delete capture;
+    } else {
+      INFO_LOG() << "Capturing inbound traffic into: " << config.capture_path;
+      capture_ = capture;
+    }
+  }
+
+  if (!config.trace_path.empty()) {
+    base::RequestTracer* tracer = new base::RequestTracer(config.trace_path, config.trace_sample_interval);
+    common::ErrnoError err = tracer->Start();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      delete tracer;
+    } else {
+      INFO_LOG() << "Tracing every " << config.trace_sample_interval << " request into: " << config.trace_path;
+      tracer_ = tracer;
+    }
+  }
+
+  base::EdgeRegistry::BalanceStrategy balance = base::EdgeRegistry::LEAST_CONNECTIONS;
+  if (!base::BalanceStrategyFromString(config.edge_balance, &balance)) {
+    WARNING_LOG() << "Unknown edge balance: " << config.edge_balance << ", using "
+                  << base::BalanceStrategyToString(balance);
+  }
+  const std::vector<std::string> edge_origins = base::ParseEdgeOrigins(config.edge_origins);
+  edges_ = new base::EdgeRegistry(balance, config.edge_load_factor, config.edge_report_timeout, edge_origins);
+  const std::vector<base::EdgeNode> static_edges = base::ParseStaticEdges(config.edges);
+  for (size_t i = 0; i < static_edges.size(); ++i) {
+    edges_->AddStatic(static_edges[i]);
+  }
+  if (!static_edges.empty() && edge_origins.empty()) {
+    WARNING_LOG() << "Static edges configured without edge origins, proxy streams are not redirected";
+  } else if (!static_edges.empty()) {
+    INFO_LOG() << "Redirecting proxy streams of " << edge_origins.size() << " origin(s) through "
+               << static_edges.size() << " static edge(s), balance: " << base::BalanceStrategyToString(balance);
+  }
+
+  subscribers_handler_ = new subscribers::SubscribersHandler(this, sub_manager_, config, capture_, tracer_);
+  base::SocketTuning tuning;
+  tuning.no_delay = config.tcp_nodelay;
+  tuning.send_buffer = config.tcp_send_buffer;
+  tuning.receive_buffer = config.tcp_receive_buffer;
+
+  subscribers::SubscribersServer* subscribers_server =
+      new subscribers::SubscribersServer(config.subscribers_host, subscribers_handler_);
+  subscribers_server->SetSocketTuning(tuning);
+  subscribers_server_ = subscribers_server;
   subscribers_server_->SetName("subscribers_server");
 
-  http_handler_ = new http::HttpHandler(sub_manager_);
-  http_server_ = new http::HttpServer(config.http_host, http_handler_);
+  http_handler_ = new http::HttpHandler(sub_manager_, config, capture_, edges_);
+  http::HttpServer* http_server = new http::HttpServer(config.http_host, http_handler_);
+  http_server->SetSocketTuning(tuning);
+  http_server_ = http_server;
   http_server_->SetName("http_server");
 }
 
@@ -90,20 +158,34 @@ ProcessSlaveWrapper::~ProcessSlaveWrapper() {
   destroy(&http_handler_);
   destroy(&subscribers_server_);
   destroy(&subscribers_handler_);
+  if (capture_) {
+    capture_->Stop();
+    INFO_LOG() << "Traffic capture stopped, recorded: " << capture_->GetRecorded()
+               << ", dropped: " << capture_->GetDropped() << ", write errors: " << capture_->GetWriteErrors();
+  }
+  destroy(&capture_);
+  if (tracer_) {
+    tracer_->Stop();
+    INFO_LOG() << "Request tracing stopped, written: " << tracer_->GetWritten()
+               << ", dropped: " << tracer_->GetDropped();
+  }
+  destroy(&tracer_);
+  destroy(&edges_);
   destroy(&sub_manager_);
   destroy(&loop_);
 }
 
 int ProcessSlaveWrapper::Exec() {
   subscribers::SubscribersServer* subs_server = static_cast<subscribers::SubscribersServer*>(subscribers_server_);
-  std::thread subs_thread = std::thread([subs_server] {
+  const int backlog = config_.listen_backlog;
+  std::thread subs_thread = std::thread([subs_server, backlog] {
     common::ErrnoError err = subs_server->Bind(true);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
     }
 
-    err = subs_server->Listen(5);
+    err = subs_server->Listen(backlog);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
@@ -114,14 +196,14 @@ int ProcessSlaveWrapper::Exec() {
   });
 
   http::HttpServer* http_server = static_cast<http::HttpServer*>(http_server_);
-  std::thread http_thread = std::thread([http_server] {
+  std::thread http_thread = std::thread([http_server, backlog] {
     common::ErrnoError err = http_server->Bind(true);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
     }
 
-    err = http_server->Listen(5);
+    err = http_server->Listen(backlog);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
@@ -139,7 +221,7 @@ int ProcessSlaveWrapper::Exec() {
     goto finished;
   }
 
-  err = server->Listen(5);
+  err = server->Listen(backlog);
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     goto finished;
@@ -155,6 +237,9 @@ finished:
 
 void ProcessSlaveWrapper::PreLooped(common::libev::IoLoop* server) {
   ping_client_timer_ = server->CreateTimer(ping_timeout_clients_seconds, true);
+  lag_monitor_.Start(base::GetMonotonicMsec());
+  lag_timer_ = server->CreateTimer(base::LoopLagMonitor::check_interval_seconds, true);
+  base::RuntimeStats::GetInstance().Sample(base::GetMonotonicUsec());
 }
 
 void ProcessSlaveWrapper::Accepted(common::libev::IoClient* client) {
@@ -171,7 +256,13 @@ void ProcessSlaveWrapper::Closed(common::libev::IoClient* client) {
 }
 
 void ProcessSlaveWrapper::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
-  if (ping_client_timer_ == id) {
+  if (lag_timer_ == id) {
+    lag_monitor_.Check(base::GetMonotonicMsec(), 0);
+    base::RuntimeStats& stats = base::RuntimeStats::GetInstance();
+    stats.UpdateLoop(base::LoopStats("daemon", server->GetClients().size(), lag_monitor_));
+    stats.Sample(base::GetMonotonicUsec());
+    edges_->Expire(common::time::current_utc_mstime());
+  } else if (ping_client_timer_ == id) {
     std::vector<common::libev::IoClient*> online_clients = server->GetClients();
     for (size_t i = 0; i < online_clients.size(); ++i) {
       common::libev::IoClient* client = online_clients[i];
@@ -183,8 +274,8 @@ void ProcessSlaveWrapper::TimerEmited(common::libev::IoLoop* server, common::lib
           ignore_result(dclient->Close());
           delete dclient;
         } else {
-          INFO_LOG() << "Sent ping to client[" << client->GetFormatedName() << "], from server["
-                     << server->GetFormatedName() << "], " << online_clients.size() << " client(s) connected.";
+          ASYNC_INFO_LOG() << "Sent ping to client[" << client->GetFormatedName() << "], from server["
+                           << server->GetFormatedName() << "], " << online_clients.size() << " client(s) connected.";
         }
       }
     }
@@ -227,31 +318,25 @@ common::ErrnoError ProcessSlaveWrapper::DaemonDataReceived(ProtocoledDaemonClien
     return err;  // i don't want handle spam, comand must be foramated according protocol
   }
 
-  fastotv::protocol::request_t* req = nullptr;
-  fastotv::protocol::response_t* resp = nullptr;
-  common::Error err_parse = common::protocols::json_rpc::ParseJsonRPC(input_command, &req, &resp);
+  base::JsonRpcFrame frame;
+  common::Error err_parse = parser_.Parse(input_command, &frame);
   if (err_parse) {
     const std::string err_str = err_parse->GetDescription();
     return common::make_errno_error(err_str, EAGAIN);
   }
 
-  if (req) {
+  if (frame.IsRequest()) {
     DEBUG_LOG() << "Received daemon request: " << input_command;
-    err = HandleRequestServiceCommand(dclient, req);
+    err = HandleRequestServiceCommand(dclient, frame);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
-    delete req;
-  } else if (resp) {
+  } else {
     DEBUG_LOG() << "Received daemon responce: " << input_command;
-    err = HandleResponceServiceCommand(dclient, resp);
+    err = HandleResponceServiceCommand(dclient, frame);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
-    delete resp;
-  } else {
-    DNOTREACHED();
-    return common::make_errno_error("Invalid command type.", EINVAL);
   }
 
   return common::ErrnoError();
@@ -279,21 +364,18 @@ void ProcessSlaveWrapper::PostLooped(common::libev::IoLoop* server) {
     server->RemoveTimer(ping_client_timer_);
     ping_client_timer_ = INVALID_TIMER_ID;
   }
+  if (lag_timer_ != INVALID_TIMER_ID) {
+    server->RemoveTimer(lag_timer_);
+    lag_timer_ = INVALID_TIMER_ID;
+  }
 }
 
 common::ErrnoError ProcessSlaveWrapper::HandleRequestClientStopService(ProtocoledDaemonClient* dclient,
-                                                                       const fastotv::protocol::request_t* req) {
+                                                                       const base::JsonRpcFrame& req) {
   CHECK(loop_->IsLoopThread());
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jstop = json_tokener_parse(params_ptr);
-    if (!jstop) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     common::daemon::commands::StopInfo stop_info;
-    common::Error err_des = stop_info.DeSerialize(jstop);
-    json_object_put(jstop);
+    common::Error err_des = stop_info.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -304,7 +386,7 @@ common::ErrnoError ProcessSlaveWrapper::HandleRequestClientStopService(Protocole
       return common::make_errno_error_inval();
     }
 
-    common::ErrnoError err = dclient->StopSuccess(req->id);
+    common::ErrnoError err = dclient->StopSuccess(req.id);
     subscribers_server_->Stop();
     http_server_->Stop();
     loop_->Stop();
@@ -315,20 +397,13 @@ common::ErrnoError ProcessSlaveWrapper::HandleRequestClientStopService(Protocole
 }
 
 common::ErrnoError ProcessSlaveWrapper::HandleRequestClientActivate(ProtocoledDaemonClient* dclient,
-                                                                    const fastotv::protocol::request_t* req) {
+                                                                    const base::JsonRpcFrame& req) {
   CHECK(loop_->IsLoopThread());
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jactivate = json_tokener_parse(params_ptr);
-    if (!jactivate) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     common::daemon::commands::ActivateInfo activate_info;
-    common::Error err_des = activate_info.DeSerialize(jactivate);
-    json_object_put(jactivate);
+    common::Error err_des = activate_info.DeSerialize(req.params);
     if (err_des) {
-      ignore_result(dclient->ActivateFail(req->id, err_des));
+      ignore_result(dclient->ActivateFail(req.id, err_des));
       return common::make_errno_error(err_des->GetDescription(), EAGAIN);
     }
 
@@ -337,11 +412,11 @@ common::ErrnoError ProcessSlaveWrapper::HandleRequestClientActivate(ProtocoledDa
     common::Error err_exp =
         common::license::GetExpireTimeFromKey(PROJECT_NAME_LOWERCASE, *config_.license_key, *expire_key, &tm);
     if (err_exp) {
-      ignore_result(dclient->ActivateFail(req->id, err_exp));
+      ignore_result(dclient->ActivateFail(req.id, err_exp));
       return common::make_errno_error(err_exp->GetDescription(), EINVAL);
     }
 
-    common::ErrnoError err_ser = dclient->ActivateSuccess(req->id);
+    common::ErrnoError err_ser = dclient->ActivateSuccess(req.id);
     if (err_ser) {
       return err_ser;
     }
@@ -354,19 +429,12 @@ common::ErrnoError ProcessSlaveWrapper::HandleRequestClientActivate(ProtocoledDa
 }
 
 common::ErrnoError ProcessSlaveWrapper::HandleResponcePingService(ProtocoledDaemonClient* dclient,
-                                                                  const fastotv::protocol::response_t* resp) {
+                                                                  const base::JsonRpcFrame& resp) {
   UNUSED(dclient);
   CHECK(loop_->IsLoopThread());
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jclient_ping = json_tokener_parse(params_ptr);
-    if (!jclient_ping) {
-      return common::make_errno_error_inval();
-    }
-
+  if (resp.IsMessage()) {
     common::daemon::commands::ClientPingInfo client_ping_info;
-    common::Error err_des = client_ping_info.DeSerialize(jclient_ping);
-    json_object_put(jclient_ping);
+    common::Error err_des = client_ping_info.DeSerialize(resp.result);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -377,70 +445,142 @@ common::ErrnoError ProcessSlaveWrapper::HandleResponcePingService(ProtocoledDaem
 }
 
 common::ErrnoError ProcessSlaveWrapper::HandleResponceCatchupCreatedService(ProtocoledDaemonClient* dclient,
-                                                                            const fastotv::protocol::response_t* resp) {
+                                                                            const base::JsonRpcFrame& resp) {
   UNUSED(dclient);
   CHECK(loop_->IsLoopThread());
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jcatchup = json_tokener_parse(params_ptr);
-    if (!jcatchup) {
-      return common::make_errno_error_inval();
-    }
-
+  if (resp.IsMessage()) {
     return common::ErrnoError();
   }
   return common::ErrnoError();
 }
 
 common::ErrnoError ProcessSlaveWrapper::HandleRequestClientPingService(ProtocoledDaemonClient* dclient,
-                                                                       const fastotv::protocol::request_t* req) {
+                                                                       const base::JsonRpcFrame& req) {
   CHECK(loop_->IsLoopThread());
   if (!dclient->IsVerified()) {
     return common::make_errno_error_inval();
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jstop = json_tokener_parse(params_ptr);
-    if (!jstop) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     common::daemon::commands::ClientPingInfo client_ping_info;
-    common::Error err_des = client_ping_info.DeSerialize(jstop);
-    json_object_put(jstop);
+    common::Error err_des = client_ping_info.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    return dclient->Pong(req->id);
+    // summary without per stream watchers keeps pong small
+    const ServerStatsInfo pong(base::RuntimeStats::GetInstance().GetSnapshot(), common::time::current_utc_mstime(),
+                               false);
+    return dclient->Pong(req.id, pong);
   }
 
   return common::make_errno_error_inval();
 }
 
+common::ErrnoError ProcessSlaveWrapper::HandleRequestGetSlowQueries(ProtocoledDaemonClient* dclient,
+                                                                    const base::JsonRpcFrame& req) {
+  CHECK(loop_->IsLoopThread());
+  if (!dclient->IsVerified()) {
+    return common::make_errno_error_inval();
+  }
+
+  const SlowQueriesInfo queries(mongo::SlowQueryLog::GetInstance().GetTop());
+  return dclient->SlowQueries(req.id, queries);
+}
+
+common::ErrnoError ProcessSlaveWrapper::HandleRequestGetStats(ProtocoledDaemonClient* dclient,
+                                                              const base::JsonRpcFrame& req) {
+  CHECK(loop_->IsLoopThread());
+  if (!dclient->IsVerified()) {
+    return common::make_errno_error_inval();
+  }
+
+  const ServerStatsInfo stats(base::RuntimeStats::GetInstance().GetSnapshot(), common::time::current_utc_mstime(),
+                              true);
+  return dclient->Stats(req.id, stats);
+}
+
+common::ErrnoError ProcessSlaveWrapper::HandleRequestEdgeReport(ProtocoledDaemonClient* dclient,
+                                                                const base::JsonRpcFrame& req) {
+  CHECK(loop_->IsLoopThread());
+  if (!dclient->IsVerified()) {
+    return common::make_errno_error_inval();
+  }
+
+  if (!req.params) {
+    return common::make_errno_error_inval();
+  }
+
+  EdgeInfo edge_info;
+  common::Error err_des = edge_info.DeSerialize(req.params);
+  if (err_des) {
+    ignore_result(dclient->EdgeReportFail(req.id, err_des));
+    const std::string err_str = err_des->GetDescription();
+    return common::make_errno_error(err_str, EAGAIN);
+  }
+
+  if (!edges_->Report(edge_info.GetNode(), common::time::current_utc_mstime())) {
+    const common::Error err = common::make_error("Edge not accepted, registry is full");
+    ignore_result(dclient->EdgeReportFail(req.id, err));
+    return common::make_errno_error(err->GetDescription(), EAGAIN);
+  }
+  return dclient->EdgeReportSuccess(req.id);
+}
+
+common::ErrnoError ProcessSlaveWrapper::HandleRequestSetLogLevel(ProtocoledDaemonClient* dclient,
+                                                                 const base::JsonRpcFrame& req) {
+  CHECK(loop_->IsLoopThread());
+  if (!dclient->IsVerified()) {
+    return common::make_errno_error_inval();
+  }
+
+  if (!req.params) {
+    return common::make_errno_error_inval();
+  }
+
+  LogLevelInfo level_info;
+  common::Error err_des = level_info.DeSerialize(req.params);
+  if (err_des) {
+    ignore_result(dclient->SetLogLevelFail(req.id, err_des));
+    const std::string err_str = err_des->GetDescription();
+    return common::make_errno_error(err_str, EAGAIN);
+  }
+
+  base::SetLogLevel(level_info.GetLevel());
+  NOTICE_LOG() << "Log level changed to: " << common::logging::log_level_to_text(level_info.GetLevel());
+  return dclient->SetLogLevelSuccess(req.id, level_info);
+}
+
 common::ErrnoError ProcessSlaveWrapper::HandleRequestServiceCommand(ProtocoledDaemonClient* dclient,
-                                                                    const fastotv::protocol::request_t* req) {
-  if (req->method == DAEMON_STOP_SERVICE) {
+                                                                    const base::JsonRpcFrame& req) {
+  if (req.IsMethod(DAEMON_STOP_SERVICE)) {
     return HandleRequestClientStopService(dclient, req);
-  } else if (req->method == DAEMON_PING_SERVICE) {
+  } else if (req.IsMethod(DAEMON_PING_SERVICE)) {
     return HandleRequestClientPingService(dclient, req);
+  } else if (req.IsMethod(DAEMON_GET_SLOW_QUERIES)) {
+    return HandleRequestGetSlowQueries(dclient, req);
+  } else if (req.IsMethod(DAEMON_GET_STATS)) {
+    return HandleRequestGetStats(dclient, req);
+  } else if (req.IsMethod(DAEMON_EDGE_REPORT)) {
+    return HandleRequestEdgeReport(dclient, req);
+  } else if (req.IsMethod(DAEMON_SET_LOG_LEVEL)) {
+    return HandleRequestSetLogLevel(dclient, req);
   }
 
-  WARNING_LOG() << "Received unknown method: " << req->method;
+  WARNING_LOG() << "Received unknown method: " << req.method;
   return common::ErrnoError();
 }
 
 common::ErrnoError ProcessSlaveWrapper::HandleResponceServiceCommand(ProtocoledDaemonClient* dclient,
-                                                                     const fastotv::protocol::response_t* resp) {
+                                                                     const base::JsonRpcFrame& resp) {
   CHECK(loop_->IsLoopThread());
   if (!dclient->IsVerified()) {
     return common::make_errno_error_inval();
   }
 
   fastotv::protocol::request_t req;
-  if (dclient->PopRequestByID(resp->id, &req)) {
+  if (dclient->PopRequestByID(resp.id, &req)) {
     if (req.method == DAEMON_SERVER_PING) {
       ignore_result(HandleResponcePingService(dclient, resp));
     } else if (req.method == DAEMON_SERVER_CATCHUP_CREATED) {
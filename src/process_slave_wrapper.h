@@ -21,6 +21,9 @@
 #include <fastotv/protocol/protocol.h>
 #include <fastotv/protocol/types.h>
 
+#include "base/json_rpc_parser.h"
+#include "base/loop_lag_monitor.h"
+
 #include "subscribers/handler_observer.h"
 
 #include "config.h"
@@ -31,8 +34,11 @@ namespace server {
 class ProtocoledDaemonClient;
 
 namespace base {
+class EdgeRegistry;
 class ISubscribersManager;
-}
+class RequestTracer;
+class TrafficCapture;
+}  // namespace base
 
 class ProcessSlaveWrapper : public common::libev::IoLoopObserver, public subscribers::ISubscribersHandlerObserver {
  public:
@@ -64,9 +70,9 @@ class ProcessSlaveWrapper : public common::libev::IoLoopObserver, public subscri
   void PostLooped(common::libev::IoLoop* server) override;
 
   virtual common::ErrnoError HandleRequestServiceCommand(ProtocoledDaemonClient* dclient,
-                                                         const fastotv::protocol::request_t* req) WARN_UNUSED_RESULT;
+                                                         const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
   virtual common::ErrnoError HandleResponceServiceCommand(ProtocoledDaemonClient* dclient,
-                                                          const fastotv::protocol::response_t* resp) WARN_UNUSED_RESULT;
+                                                          const base::JsonRpcFrame& resp) WARN_UNUSED_RESULT;
 
   virtual void CatchupCreated(subscribers::SubscribersHandler* handler,
                               const fastotv::commands_info::CatchupInfo& chan) override;
@@ -78,16 +84,24 @@ class ProcessSlaveWrapper : public common::libev::IoLoopObserver, public subscri
 
   // service
   common::ErrnoError HandleRequestClientActivate(ProtocoledDaemonClient* dclient,
-                                                 const fastotv::protocol::request_t* req) WARN_UNUSED_RESULT;
+                                                 const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
   common::ErrnoError HandleRequestClientPingService(ProtocoledDaemonClient* dclient,
-                                                    const fastotv::protocol::request_t* req) WARN_UNUSED_RESULT;
+                                                    const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
   common::ErrnoError HandleRequestClientStopService(ProtocoledDaemonClient* dclient,
-                                                    const fastotv::protocol::request_t* req) WARN_UNUSED_RESULT;
+                                                    const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
+  common::ErrnoError HandleRequestGetSlowQueries(ProtocoledDaemonClient* dclient,
+                                                 const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
+  common::ErrnoError HandleRequestGetStats(ProtocoledDaemonClient* dclient,
+                                           const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
+  common::ErrnoError HandleRequestEdgeReport(ProtocoledDaemonClient* dclient,
+                                             const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
+  common::ErrnoError HandleRequestSetLogLevel(ProtocoledDaemonClient* dclient,
+                                              const base::JsonRpcFrame& req) WARN_UNUSED_RESULT;
 
   common::ErrnoError HandleResponcePingService(ProtocoledDaemonClient* dclient,
-                                               const fastotv::protocol::response_t* resp) WARN_UNUSED_RESULT;
+                                               const base::JsonRpcFrame& resp) WARN_UNUSED_RESULT;
   common::ErrnoError HandleResponceCatchupCreatedService(ProtocoledDaemonClient* dclient,
-                                                         const fastotv::protocol::response_t* resp) WARN_UNUSED_RESULT;
+                                                         const base::JsonRpcFrame& resp) WARN_UNUSED_RESULT;
 
   const Config config_;
 
@@ -98,9 +112,18 @@ class ProcessSlaveWrapper : public common::libev::IoLoopObserver, public subscri
   // http
   common::libev::IoLoop* http_server_;
   common::libev::IoLoopObserver* http_handler_;
+  // optional, shared by subscribers and http loops
+  base::TrafficCapture* capture_;
+  // optional, traces sampled subscribers requests
+  base::RequestTracer* tracer_;
+  // edges proxy streams are redirected to, empty registry keeps redirects to stream urls
+  base::EdgeRegistry* edges_;
 
   base::ISubscribersManager* sub_manager_;
   common::libev::timer_id_t ping_client_timer_;
+  common::libev::timer_id_t lag_timer_;
+  base::LoopLagMonitor lag_monitor_;
+  base::JsonRpcParser parser_;
 };
 
 }  // namespace server
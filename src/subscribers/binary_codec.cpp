@@ -0,0 +1,279 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "subscribers/binary_codec.h"
+
+#include <string.h>
+
+#include "base/msgpack.h"
+
+namespace {
+const int kBinaryServerErrorCode = -32000;
+
+bool KeyEquals(const char* key, size_t key_size, const char* expected) {
+  return strlen(expected) == key_size && memcmp(key, expected, key_size) == 0;
+}
+
+// Calls visitor for every key of the params map, visitor must consume the value.
+template <typename Visitor>
+common::Error VisitParams(const fastocloud::server::subscribers::BinaryRequest& req, Visitor visitor) {
+  if (!req.params) {
+    return common::make_error("Params required");
+  }
+
+  fastocloud::server::base::MsgPackReader reader(req.params, req.params_size);
+  uint32_t fields = 0;
+  if (!reader.ReadMap(&fields)) {
+    return common::make_error("Params should be a map");
+  }
+
+  for (uint32_t i = 0; i < fields; ++i) {
+    const char* key = nullptr;
+    size_t key_size = 0;
+    if (!reader.ReadString(&key, &key_size)) {
+      return common::make_error("Invalid params key");
+    }
+
+    bool handled = false;
+    if (!visitor(key, key_size, &reader, &handled)) {
+      return common::make_error("Invalid params value");
+    }
+    if (!handled && !reader.Skip()) {
+      return common::make_error("Invalid params value");
+    }
+  }
+  return common::Error();
+}
+
+void PackEnvelope(const std::string& id, const char* field, fastocloud::server::base::MsgPackWriter* writer) {
+  writer->PackMap(2);
+  writer->PackString(BINARY_ID_FIELD, sizeof(BINARY_ID_FIELD) - 1);
+  writer->PackString(id);
+  writer->PackString(field, strlen(field));
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace subscribers {
+
+BinaryRequest::BinaryRequest() : id(), method(), params(nullptr), params_size(0) {}
+
+bool IsBinaryFrame(const std::string& frame) {
+  return !frame.empty() && base::IsMsgPackMapMarker(static_cast<uint8_t>(frame[0]));
+}
+
+common::Error DecodeBinaryRequest(const std::string& frame, BinaryRequest* req) {
+  if (!req) {
+    return common::make_error_inval();
+  }
+
+  base::MsgPackReader reader(frame.data(), frame.size());
+  uint32_t fields = 0;
+  if (!reader.ReadMap(&fields)) {
+    return common::make_error("Binary request should be a map");
+  }
+
+  BinaryRequest lreq;
+  for (uint32_t i = 0; i < fields; ++i) {
+    const char* key = nullptr;
+    size_t key_size = 0;
+    if (!reader.ReadString(&key, &key_size)) {
+      return common::make_error("Invalid binary request key");
+    }
+
+    if (KeyEquals(key, key_size, BINARY_ID_FIELD)) {
+      if (!reader.ReadString(&lreq.id)) {
+        return common::make_error("Invalid binary request id");
+      }
+    } else if (KeyEquals(key, key_size, BINARY_METHOD_FIELD)) {
+      if (!reader.ReadString(&lreq.method)) {
+        return common::make_error("Invalid binary request method");
+      }
+    } else if (KeyEquals(key, key_size, BINARY_PARAMS_FIELD)) {
+      const size_t start = reader.GetPosition();
+      if (!reader.Skip()) {
+        return common::make_error("Invalid binary request params");
+      }
+      lreq.params = frame.data() + start;
+      lreq.params_size = reader.GetPosition() - start;
+    } else if (!reader.Skip()) {
+      return common::make_error("Invalid binary request");
+    }
+  }
+
+  if (lreq.method.empty()) {
+    return common::make_error("Binary request method required");
+  }
+
+  *req = lreq;
+  return common::Error();
+}
+
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::RuntimeChannelLiteInfo* run) {
+  if (!run) {
+    return common::make_error_inval();
+  }
+
+  fastotv::stream_id_t sid;
+  common::Error err = VisitParams(req, [&sid](const char* key, size_t key_size, base::MsgPackReader* reader,
+                                              bool* handled) -> bool {
+    if (KeyEquals(key, key_size, BINARY_STREAM_ID_FIELD)) {
+      *handled = true;
+      return reader->ReadString(&sid);
+    }
+    return true;
+  });
+  if (err) {
+    return err;
+  }
+
+  if (sid.empty()) {
+    return common::make_error(BINARY_STREAM_ID_FIELD " field required");
+  }
+
+  *run = fastotv::commands_info::RuntimeChannelLiteInfo(sid);
+  return common::Error();
+}
+
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::FavoriteInfo* fav) {
+  if (!fav) {
+    return common::make_error_inval();
+  }
+
+  fastotv::stream_id_t sid;
+  bool favorite = false;
+  common::Error err = VisitParams(req, [&sid, &favorite](const char* key, size_t key_size,
+                                                         base::MsgPackReader* reader, bool* handled) -> bool {
+    if (KeyEquals(key, key_size, BINARY_STREAM_ID_FIELD)) {
+      *handled = true;
+      return reader->ReadString(&sid);
+    } else if (KeyEquals(key, key_size, BINARY_FAVORITE_FIELD)) {
+      *handled = true;
+      return reader->ReadBool(&favorite);
+    }
+    return true;
+  });
+  if (err) {
+    return err;
+  }
+
+  if (sid.empty()) {
+    return common::make_error(BINARY_STREAM_ID_FIELD " field required");
+  }
+
+  *fav = fastotv::commands_info::FavoriteInfo(sid, favorite);
+  return common::Error();
+}
+
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::RecentStreamTimeInfo* rec) {
+  if (!rec) {
+    return common::make_error_inval();
+  }
+
+  fastotv::stream_id_t sid;
+  int64_t timestamp = 0;
+  common::Error err = VisitParams(req, [&sid, &timestamp](const char* key, size_t key_size,
+                                                          base::MsgPackReader* reader, bool* handled) -> bool {
+    if (KeyEquals(key, key_size, BINARY_STREAM_ID_FIELD)) {
+      *handled = true;
+      return reader->ReadString(&sid);
+    } else if (KeyEquals(key, key_size, BINARY_TIMESTAMP_FIELD)) {
+      *handled = true;
+      return reader->ReadInt(&timestamp);
+    }
+    return true;
+  });
+  if (err) {
+    return err;
+  }
+
+  if (sid.empty()) {
+    return common::make_error(BINARY_STREAM_ID_FIELD " field required");
+  }
+
+  *rec = fastotv::commands_info::RecentStreamTimeInfo(sid, timestamp);
+  return common::Error();
+}
+
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::InterruptStreamTimeInfo* inter) {
+  if (!inter) {
+    return common::make_error_inval();
+  }
+
+  fastotv::stream_id_t sid;
+  int64_t time = 0;
+  common::Error err = VisitParams(req, [&sid, &time](const char* key, size_t key_size, base::MsgPackReader* reader,
+                                                     bool* handled) -> bool {
+    if (KeyEquals(key, key_size, BINARY_STREAM_ID_FIELD)) {
+      *handled = true;
+      return reader->ReadString(&sid);
+    } else if (KeyEquals(key, key_size, BINARY_TIME_FIELD)) {
+      *handled = true;
+      return reader->ReadInt(&time);
+    }
+    return true;
+  });
+  if (err) {
+    return err;
+  }
+
+  if (sid.empty()) {
+    return common::make_error(BINARY_STREAM_ID_FIELD " field required");
+  }
+
+  *inter = fastotv::commands_info::InterruptStreamTimeInfo(sid, time);
+  return common::Error();
+}
+
+void EncodeBinarySuccess(const std::string& id, std::string* out) {
+  base::MsgPackWriter writer(out);
+  PackEnvelope(id, BINARY_RESULT_FIELD, &writer);
+  writer.PackBool(true);
+}
+
+void EncodeBinaryPong(const std::string& id, common::time64_t timestamp, std::string* out) {
+  base::MsgPackWriter writer(out);
+  PackEnvelope(id, BINARY_RESULT_FIELD, &writer);
+  writer.PackMap(1);
+  writer.PackString(BINARY_TIMESTAMP_FIELD, sizeof(BINARY_TIMESTAMP_FIELD) - 1);
+  writer.PackInt(timestamp);
+}
+
+void EncodeBinaryRuntimeChannelInfo(const std::string& id,
+                                    const fastotv::stream_id_t& sid,
+                                    size_t watchers,
+                                    std::string* out) {
+  base::MsgPackWriter writer(out);
+  PackEnvelope(id, BINARY_RESULT_FIELD, &writer);
+  writer.PackMap(2);
+  writer.PackString(BINARY_STREAM_ID_FIELD, sizeof(BINARY_STREAM_ID_FIELD) - 1);
+  writer.PackString(sid);
+  writer.PackString(BINARY_WATCHERS_FIELD, sizeof(BINARY_WATCHERS_FIELD) - 1);
+  writer.PackInt(static_cast<int64_t>(watchers));
+}
+
+void EncodeBinaryError(const std::string& id, const std::string& message, std::string* out) {
+  base::MsgPackWriter writer(out);
+  PackEnvelope(id, BINARY_ERROR_FIELD, &writer);
+  writer.PackMap(2);
+  writer.PackString(BINARY_ERROR_CODE_FIELD, sizeof(BINARY_ERROR_CODE_FIELD) - 1);
+  writer.PackInt(kBinaryServerErrorCode);
+  writer.PackString(BINARY_ERROR_MESSAGE_FIELD, sizeof(BINARY_ERROR_MESSAGE_FIELD) - 1);
+  writer.PackString(message);
+}
+
+}  // namespace subscribers
+}  // namespace server
+}  // namespace fastocloud
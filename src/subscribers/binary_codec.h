@@ -0,0 +1,86 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+#include <common/error.h>
+#include <common/time.h>
+
+#include <fastotv/commands_info/favorite_info.h>
+#include <fastotv/commands_info/interrupt_stream_time_info.h>
+#include <fastotv/commands_info/recent_stream_time_info.h>
+#include <fastotv/commands_info/runtime_channel_info.h>
+
+// optional field of CLIENT_LOGIN params, value is an encoding name
+#define CLIENT_LOGIN_ENCODING_FIELD "encoding"
+#define ENCODING_MSGPACK "msgpack"
+
+#define BINARY_ID_FIELD "id"
+#define BINARY_METHOD_FIELD "method"
+#define BINARY_PARAMS_FIELD "params"
+#define BINARY_RESULT_FIELD "result"
+#define BINARY_ERROR_FIELD "error"
+#define BINARY_ERROR_CODE_FIELD "code"
+#define BINARY_ERROR_MESSAGE_FIELD "message"
+
+#define BINARY_STREAM_ID_FIELD "sid"
+#define BINARY_FAVORITE_FIELD "favorite"
+#define BINARY_TIMESTAMP_FIELD "timestamp"
+#define BINARY_TIME_FIELD "time"
+#define BINARY_WATCHERS_FIELD "watchers"
+
+namespace fastocloud {
+namespace server {
+namespace subscribers {
+
+// MessagePack mirror of the json-rpc envelope: {id, method, params} -> {id, result} | {id, error}.
+// Only high frequency methods are supported in binary form:
+// CLIENT_PING, CLIENT_GET_RUNTIME_CHANNEL_INFO, CLIENT_SET_FAVORITE, CLIENT_SET_RECENT, CLIENT_INTERRUPT_STREAM_TIME.
+enum Encoding { JSON_ENCODING = 0, MSGPACK_ENCODING = 1 };
+
+struct BinaryRequest {
+  BinaryRequest();
+
+  std::string id;
+  std::string method;
+  const char* params;  // points into the decoded frame
+  size_t params_size;
+};
+
+bool IsBinaryFrame(const std::string& frame);
+
+common::Error DecodeBinaryRequest(const std::string& frame, BinaryRequest* req) WARN_UNUSED_RESULT;
+
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::RuntimeChannelLiteInfo* run)
+    WARN_UNUSED_RESULT;
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::FavoriteInfo* fav)
+    WARN_UNUSED_RESULT;
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::RecentStreamTimeInfo* rec)
+    WARN_UNUSED_RESULT;
+common::Error DecodeBinaryParams(const BinaryRequest& req, fastotv::commands_info::InterruptStreamTimeInfo* inter)
+    WARN_UNUSED_RESULT;
+
+void EncodeBinarySuccess(const std::string& id, std::string* out);
+void EncodeBinaryPong(const std::string& id, common::time64_t timestamp, std::string* out);
+void EncodeBinaryRuntimeChannelInfo(const std::string& id,
+                                    const fastotv::stream_id_t& sid,
+                                    size_t watchers,
+                                    std::string* out);
+void EncodeBinaryError(const std::string& id, const std::string& message, std::string* out);
+
+}  // namespace subscribers
+}  // namespace server
+}  // namespace fastocloud
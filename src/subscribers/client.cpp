@@ -14,12 +14,44 @@
 
 #include "subscribers/client.h"
 
+#include <errno.h>
+
+#include <ev.h>
+
+#include <string>
+
+#include "base/metrics.h"
+#include "base/request_tracer.h"
+
 namespace fastocloud {
 namespace server {
 namespace subscribers {
 
 SubscriberClient::SubscriberClient(common::libev::IoLoop* server, const common::net::socket_info& info)
-    : base_class(server, info), client_info_() {}
+    : base_class(server, info),
+      client_info_(),
+      compression_(NO_COMPRESSION),
+      encoding_(JSON_ENCODING),
+      last_activity_(0),
+      output_(),
+      output_offset_(0),
+      output_high_watermark_(output_default_high_watermark),
+      output_limit_(output_default_limit),
+      output_overflowed_(false),
+      output_blocked_time_(0),
+      liveness_wheel_(nullptr) {}
+
+void* SubscriberClient::operator new(size_t size) {
+  return base::ObjectPool<SubscriberClient>::Allocate(size);
+}
+
+void SubscriberClient::operator delete(void* ptr, size_t size) {
+  base::ObjectPool<SubscriberClient>::Deallocate(ptr, size);
+}
+
+base::ObjectPoolStats SubscriberClient::GetPoolStats() {
+  return base::ObjectPool<SubscriberClient>::GetStats();
+}
 
 const char* SubscriberClient::ClassName() const {
   return "SubscriberClient";
@@ -33,6 +65,185 @@ SubscriberClient::client_info_t SubscriberClient::GetClInfo() const {
   return client_info_;
 }
 
+void SubscriberClient::SetLastActivity(tick_t tick) {
+  last_activity_ = tick;
+}
+
+SubscriberClient::tick_t SubscriberClient::GetLastActivity() const {
+  return last_activity_;
+}
+
+common::ErrnoError SubscriberClient::StartCompression(CompressionCodec codec) {
+  if (codec == NO_COMPRESSION || compression_ != NO_COMPRESSION) {
+    return common::make_errno_error_inval();
+  }
+
+  char marker[compression_marker_size];
+  MakeCompressionMarker(codec, marker);
+  common::ErrnoError err = QueueWrite(marker, sizeof(marker));
+  if (err) {
+    return err;
+  }
+
+  compression_ = codec;
+  return common::ErrnoError();
+}
+
+CompressionCodec SubscriberClient::GetCompression() const {
+  return compression_;
+}
+
+void SubscriberClient::SetEncoding(Encoding encoding) {
+  encoding_ = encoding;
+}
+
+Encoding SubscriberClient::GetEncoding() const {
+  return encoding_;
+}
+
+common::ErrnoError SubscriberClient::WriteBinaryFrame(const std::string& payload) {
+  const uint32_t size = payload.size();
+  std::string frame;
+  frame.reserve(sizeof(size) + payload.size());
+  frame.push_back(static_cast<char>((size >> 24) & 0xFF));
+  frame.push_back(static_cast<char>((size >> 16) & 0xFF));
+  frame.push_back(static_cast<char>((size >> 8) & 0xFF));
+  frame.push_back(static_cast<char>(size & 0xFF));
+  frame.append(payload);
+
+  size_t nwrite = 0;
+  return Write(frame.data(), frame.size(), &nwrite);
+}
+
+void SubscriberClient::SetOutputLimits(size_t high_watermark, size_t limit) {
+  output_high_watermark_ = high_watermark;
+  output_limit_ = limit < high_watermark ? high_watermark : limit;
+  UpdateIoFlags();
+}
+
+void SubscriberClient::SetLivenessWheel(base::TimingWheel* wheel) {
+  liveness_wheel_ = wheel;
+}
+
+common::ErrnoError SubscriberClient::FlushOutput() {
+  while (output_offset_ < output_.size()) {
+    size_t nwrite = 0;
+    common::ErrnoError err =
+        base_class::DoSingleWrite(output_.data() + output_offset_, output_.size() - output_offset_, &nwrite);
+    if (err) {
+      const int code = err->GetErrorCode();
+      if (code != EAGAIN && code != EWOULDBLOCK && code != EINTR) {
+        return err;
+      }
+      break;
+    }
+    if (nwrite == 0) {
+      break;
+    }
+    output_offset_ += nwrite;
+  }
+
+  if (output_offset_ == output_.size()) {
+    output_.clear();
+    output_offset_ = 0;
+  } else if (output_offset_ > output_.size() / 2) {
+    output_.erase(0, output_offset_);
+    output_offset_ = 0;
+  }
+
+  UpdateIoFlags();
+  return common::ErrnoError();
+}
+
+size_t SubscriberClient::GetOutputQueueSize() const {
+  return output_.size() - output_offset_;
+}
+
+bool SubscriberClient::IsOutputOverflowed() const {
+  return output_overflowed_;
+}
+
+common::time64_t SubscriberClient::GetOutputBlockedTime() const {
+  return output_blocked_time_;
+}
+
+common::ErrnoError SubscriberClient::ServerBusy(fastotv::protocol::sequance_id_t id, const std::string& reason) {
+  const fastotv::protocol::response_t resp = fastotv::protocol::response_t::MakeError(
+      id, common::protocols::json_rpc::JsonRPCError::MakeServerErrorFromText(reason));
+  return WriteResponse(resp);
+}
+
+common::ErrnoError SubscriberClient::RequestFail(fastotv::protocol::sequance_id_t id, common::Error err) {
+  const std::string error_str = err->GetDescription();
+  const fastotv::protocol::response_t resp = fastotv::protocol::response_t::MakeError(
+      id, common::protocols::json_rpc::JsonRPCError::MakeServerErrorFromText(error_str));
+  return WriteResponse(resp);
+}
+
+common::ErrnoError SubscriberClient::DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) {
+  if (!data || !nwrite_out) {
+    return common::make_errno_error_inval();
+  }
+
+  const base::ScopedTraceSpan span("write", "socket");
+  if (compression_ == NO_COMPRESSION) {
+    common::ErrnoError err = QueueWrite(data, size);
+    if (err) {
+      return err;
+    }
+
+    *nwrite_out = size;
+    return common::ErrnoError();
+  }
+
+  std::string chunk;
+  common::Error err = DeflateCompressor::GetThreadInstance()->CompressChunk(data, size, &chunk);
+  if (err) {
+    return common::make_errno_error(err->GetDescription(), EINVAL);
+  }
+
+  // chunk can't be written partially, caller sees the whole uncompressed block as sent
+  common::ErrnoError errn = QueueWrite(chunk.data(), chunk.size());
+  if (errn) {
+    return errn;
+  }
+
+  *nwrite_out = size;
+  return common::ErrnoError();
+}
+
+common::ErrnoError SubscriberClient::QueueWrite(const void* data, size_t size) {
+  // single frame may overshoot limit, so big channel lists are not refused
+  if (GetOutputQueueSize() >= output_limit_) {
+    // writers may still use client, so it isn't closed here but checked on next tick
+    if (!output_overflowed_ && liveness_wheel_) {
+      liveness_wheel_->Schedule(this, 1);
+    }
+    output_overflowed_ = true;
+    return common::make_errno_error("Output queue limit exceeded", ENOBUFS);
+  }
+
+  output_.append(static_cast<const char*>(data), size);
+  return FlushOutput();
+}
+
+void SubscriberClient::UpdateIoFlags() {
+  const size_t queued = GetOutputQueueSize();
+  if (!output_blocked_time_ && queued > output_high_watermark_) {
+    output_blocked_time_ = base::GetMonotonicMsec();
+  } else if (output_blocked_time_ && queued <= output_high_watermark_ / 4) {
+    output_blocked_time_ = 0;
+  }
+
+  int flags = output_blocked_time_ ? 0 : EV_READ;
+  if (queued) {
+    flags |= EV_WRITE;
+  }
+  if (flags != GetFlags()) {
+    SetFlags(flags);
+  }
+}
+
 }  // namespace subscribers
 }  // namespace server
 }  // namespace fastocloud
@@ -14,29 +14,89 @@
 
 #pragma once
 
+#include <string>
+
+#include <common/time.h>
+
 #include <fastotv/commands_info/client_info.h>
 #include <fastotv/server/client.h>
 
+#include "base/object_pool.h"
 #include "base/subscriber_info.h"
+#include "base/timing_wheel.h"
+
+#include "subscribers/binary_codec.h"
+#include "subscribers/compression.h"
 
 namespace fastocloud {
 namespace server {
 namespace subscribers {
 
-class SubscriberClient : public fastotv::server::Client, public base::SubscriberInfo {
+// wheel node schedules next liveness check of the connection
+class SubscriberClient : public fastotv::server::Client, public base::SubscriberInfo, public base::TimingWheelNode {
  public:
   typedef common::Optional<fastotv::commands_info::ClientInfo> client_info_t;
   typedef fastotv::server::Client base_class;
+  typedef base::TimingWheelNode::tick_t tick_t;
+  enum : size_t { output_default_high_watermark = 1024 * 1024, output_default_limit = 4 * 1024 * 1024 };
 
   SubscriberClient(common::libev::IoLoop* server, const common::net::socket_info& info);
 
+  // reconnect storms recreate thousands of clients, reuse memory of closed ones
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+  static base::ObjectPoolStats GetPoolStats();
+
   const char* ClassName() const override;
 
   void SetClInfo(const client_info_t& info);
   client_info_t GetClInfo() const;
 
+  void SetLastActivity(tick_t tick);
+  tick_t GetLastActivity() const;
+
+  // sends switch marker, all next writes are compressed
+  common::ErrnoError StartCompression(CompressionCodec codec) WARN_UNUSED_RESULT;
+  CompressionCodec GetCompression() const;
+
+  void SetEncoding(Encoding encoding);
+  Encoding GetEncoding() const;
+  common::ErrnoError WriteBinaryFrame(const std::string& payload) WARN_UNUSED_RESULT;
+  // generic json-rpc error for requests refused before their handler runs
+  common::ErrnoError ServerBusy(fastotv::protocol::sequance_id_t id, const std::string& reason) WARN_UNUSED_RESULT;
+  // generic json-rpc error for requests without own fail response
+  common::ErrnoError RequestFail(fastotv::protocol::sequance_id_t id, common::Error err) WARN_UNUSED_RESULT;
+
+  // output queue, reading is paused above high watermark and resumed at a quarter of it,
+  // writes while queue is over limit fail and mark client overflowed
+  void SetOutputLimits(size_t high_watermark, size_t limit);
+  // wheel of loop thread, overflowed client is moved to its next tick for eviction
+  void SetLivenessWheel(base::TimingWheel* wheel);
+  common::ErrnoError FlushOutput() WARN_UNUSED_RESULT;
+  size_t GetOutputQueueSize() const;
+  bool IsOutputOverflowed() const;
+  // monotonic msec since reading is paused, 0 while client is read
+  common::time64_t GetOutputBlockedTime() const;
+
+ protected:
+  common::ErrnoError DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) override;
+
  private:
+  common::ErrnoError QueueWrite(const void* data, size_t size) WARN_UNUSED_RESULT;
+  void UpdateIoFlags();
+
   client_info_t client_info_;
+  CompressionCodec compression_;
+  Encoding encoding_;
+  tick_t last_activity_;
+
+  std::string output_;
+  size_t output_offset_;
+  size_t output_high_watermark_;
+  size_t output_limit_;
+  bool output_overflowed_;
+  common::time64_t output_blocked_time_;
+  base::TimingWheel* liveness_wheel_;
 };
 
 }  // namespace subscribers
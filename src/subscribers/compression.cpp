@@ -0,0 +1,140 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "subscribers/compression.h"
+
+#include <string.h>
+
+#include <common/sprintf.h>
+
+namespace {
+// Placeholder dictionary of version 1: hand picked keys and constants of channel list responses,
+// not trained on recorded traffic. Frequent substrings are placed at the end where deflate distances are the shortest.
+// Replacing it with one trained on captured responses needs a new kCompressionDictionaryVersion,
+// clients must use the same bytes for a version.
+const char kChannelsDictionary[] =
+    "application/vnd.apple.mpegurl.mp4.mkv.jpg.png"
+    "\"prime_date\":\"country\":\"duration\":\"user_score\":\"trailer_url\":\"preview_icon\":\"description\":"
+    "\"vods\":[],\"private_vods\":[],\"catchups\":[],\"private_channels\":[],\"channels\":[],"
+    "\"start\":\"stop\":\"programs\":[],\"title\":\"type\":0,\"parts\":[],"
+    "\"error\":{\"code\":-32000,\"message\":\"}"
+    "https://fastotv.com/epg/https://fastocloud.com/images/unknown_channel.pnghttps://"
+    "\"interruption_time\":0,\"recent\":0,\"favorite\":false,\"iarc\":18,\"group\":\""
+    "\"video\":true,\"audio\":true,"
+    "\"display_name\":\"icon\":\"urls\":[\"http://"
+    "/master.m3u8\"]},\"epg\":{\"id\":\""
+    "{\"jsonrpc\":\"2.0\",\"id\":\"00000000000000\",\"result\":{\"id\":\"";
+
+const uint32_t kMaxChunkSize = 0x7FFFFFFF;
+
+void WriteChunkHeader(uint32_t value, char* out) {
+  out[0] = static_cast<char>((value >> 24) & 0xFF);
+  out[1] = static_cast<char>((value >> 16) & 0xFF);
+  out[2] = static_cast<char>((value >> 8) & 0xFF);
+  out[3] = static_cast<char>(value & 0xFF);
+}
+
+void AppendStoredChunk(const void* data, size_t size, std::string* out) {
+  char header[fastocloud::server::subscribers::compression_chunk_header_size];
+  WriteChunkHeader(static_cast<uint32_t>(size) | fastocloud::server::subscribers::kCompressionStoredChunkFlag,
+                   header);
+  out->assign(header, sizeof(header));
+  out->append(static_cast<const char*>(data), size);
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace subscribers {
+
+const uint32_t kCompressionStoredChunkFlag = 0x80000000;
+const uint8_t kCompressionDictionaryVersion = 1;
+const char* const kCompressionDictionary = kChannelsDictionary;
+const size_t kCompressionDictionarySize = sizeof(kChannelsDictionary) - 1;
+
+void MakeCompressionMarker(CompressionCodec codec, char marker[compression_marker_size]) {
+  marker[0] = static_cast<char>(0xFF);
+  marker[1] = 'Z';
+  marker[2] = static_cast<char>(codec);
+  marker[3] = static_cast<char>(kCompressionDictionaryVersion);
+}
+
+DeflateCompressor::DeflateCompressor() : stream_(), inited_(false) {
+  memset(&stream_, 0, sizeof(stream_));
+  // raw deflate, small window: chunks are independent and the dictionary is under 1KB
+  int res = deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -12, 8, Z_DEFAULT_STRATEGY);
+  inited_ = res == Z_OK;
+}
+
+DeflateCompressor::~DeflateCompressor() {
+  if (inited_) {
+    deflateEnd(&stream_);
+  }
+}
+
+DeflateCompressor* DeflateCompressor::GetThreadInstance() {
+  static thread_local DeflateCompressor compressor;
+  return &compressor;
+}
+
+common::Error DeflateCompressor::CompressChunk(const void* data, size_t size, std::string* out) {
+  if (!data || !out || size > kMaxChunkSize) {
+    return common::make_error_inval();
+  }
+
+  if (size < compression_min_chunk_size) {
+    AppendStoredChunk(data, size, out);
+    return common::Error();
+  }
+
+  if (!inited_) {
+    return common::make_error("Deflate stream not initialized");
+  }
+
+  int res = deflateReset(&stream_);
+  if (res != Z_OK) {
+    return common::make_error(common::MemSPrintf("deflateReset failed: %d", res));
+  }
+
+  res = deflateSetDictionary(&stream_, reinterpret_cast<const Bytef*>(kCompressionDictionary),
+                             kCompressionDictionarySize);
+  if (res != Z_OK) {
+    return common::make_error(common::MemSPrintf("deflateSetDictionary failed: %d", res));
+  }
+
+  const uLong bound = deflateBound(&stream_, size);
+  out->resize(compression_chunk_header_size + bound);
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<void*>(data));
+  stream_.avail_in = size;
+  stream_.next_out = reinterpret_cast<Bytef*>(&(*out)[compression_chunk_header_size]);
+  stream_.avail_out = bound;
+  res = deflate(&stream_, Z_FINISH);
+  if (res != Z_STREAM_END) {
+    return common::make_error(common::MemSPrintf("deflate failed: %d", res));
+  }
+
+  const uint32_t compressed_size = bound - stream_.avail_out;
+  if (compressed_size >= size) {
+    AppendStoredChunk(data, size, out);
+    return common::Error();
+  }
+
+  WriteChunkHeader(compressed_size, &(*out)[0]);
+  out->resize(compression_chunk_header_size + compressed_size);
+  return common::Error();
+}
+
+}  // namespace subscribers
+}  // namespace server
+}  // namespace fastocloud
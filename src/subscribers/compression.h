@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <zlib.h>
+
+#include <common/error.h>
+
+// optional field of CLIENT_LOGIN params, value is a codec name
+#define CLIENT_LOGIN_COMPRESSION_FIELD "compression"
+#define COMPRESSION_DEFLATE "deflate"
+
+namespace fastocloud {
+namespace server {
+namespace subscribers {
+
+// Wire format after a successful negotiated login:
+// 1. server sends a 4 byte switch marker { 0xFF, 'Z', codec, dictionary },
+//    it can't be confused with a frame length because frames are never that big;
+// 2. every following write is sent as a chunk: 4 byte big endian header + body,
+//    header high bit set means the body is stored as is, otherwise the body is raw deflate
+//    data compressed independently with the preset dictionary.
+// Inflated chunks concatenated give the regular length-prefixed json-rpc stream.
+enum CompressionCodec : uint8_t { NO_COMPRESSION = 0, DEFLATE_COMPRESSION = 1 };
+
+enum {
+  compression_marker_size = 4,
+  compression_chunk_header_size = 4,
+  compression_min_chunk_size = 64  // smaller writes are stored
+};
+
+extern const uint32_t kCompressionStoredChunkFlag;
+extern const uint8_t kCompressionDictionaryVersion;
+// preset dictionary of kCompressionDictionaryVersion, clients inflate chunks with the same bytes
+extern const char* const kCompressionDictionary;
+extern const size_t kCompressionDictionarySize;
+
+void MakeCompressionMarker(CompressionCodec codec, char marker[compression_marker_size]);
+
+// One instance per loop thread, every chunk is compressed from a reset state,
+// so connections don't keep their own deflate window.
+class DeflateCompressor {
+ public:
+  DeflateCompressor();
+  ~DeflateCompressor();
+
+  static DeflateCompressor* GetThreadInstance();
+
+  common::Error CompressChunk(const void* data, size_t size, std::string* out) WARN_UNUSED_RESULT;
+
+ private:
+  DeflateCompressor(const DeflateCompressor&) = delete;
+  DeflateCompressor& operator=(const DeflateCompressor&) = delete;
+
+  z_stream stream_;
+  bool inited_;
+};
+
+}  // namespace subscribers
+}  // namespace server
+}  // namespace fastocloud
@@ -14,10 +14,15 @@
 
 #include "subscribers/handler.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <common/libev/io_loop.h>
+#include <common/time.h>
 
 #include <fastotv/commands/commands.h>
 #include <fastotv/commands_info/catchup_generate_info.h>
@@ -25,31 +30,93 @@
 #include <fastotv/commands_info/favorite_info.h>
 #include <fastotv/commands_info/recent_stream_time_info.h>
 
+#include "base/async_log.h"
 #include "base/isubscribers_manager.h"
+#include "base/metrics.h"
+#include "base/runtime_stats.h"
+#include "base/traffic_capture.h"
 
+#include "subscribers/binary_codec.h"
 #include "subscribers/client.h"
 #include "subscribers/handler_observer.h"
 
+namespace {
+const char kTooManyRequestsMessage[] = "Too many requests, try again later.";
+const char kServerBusyMessage[] = "Server busy, try again later.";
+
+fastocloud::server::base::TimingWheel::tick_t GetCurrentTick() {
+  return fastocloud::server::base::GetMonotonicMsec() / 1000;
+}
+
+fastocloud::server::subscribers::CompressionCodec GetRequestedCompression(json_object* jauth) {
+  json_object* jcompression = nullptr;
+  if (!json_object_object_get_ex(jauth, CLIENT_LOGIN_COMPRESSION_FIELD, &jcompression)) {
+    return fastocloud::server::subscribers::NO_COMPRESSION;
+  }
+
+  const char* compression = json_object_get_string(jcompression);
+  if (compression && strcmp(compression, COMPRESSION_DEFLATE) == 0) {
+    return fastocloud::server::subscribers::DEFLATE_COMPRESSION;
+  }
+  return fastocloud::server::subscribers::NO_COMPRESSION;
+}
+
+fastocloud::server::subscribers::Encoding GetRequestedEncoding(json_object* jauth) {
+  json_object* jencoding = nullptr;
+  if (!json_object_object_get_ex(jauth, CLIENT_LOGIN_ENCODING_FIELD, &jencoding)) {
+    return fastocloud::server::subscribers::JSON_ENCODING;
+  }
+
+  const char* encoding = json_object_get_string(jencoding);
+  if (encoding && strcmp(encoding, ENCODING_MSGPACK) == 0) {
+    return fastocloud::server::subscribers::MSGPACK_ENCODING;
+  }
+  return fastocloud::server::subscribers::JSON_ENCODING;
+}
+}  // namespace
+
 namespace fastocloud {
 namespace server {
 namespace subscribers {
 
 SubscribersHandler::SubscribersHandler(ISubscribersHandlerObserver* observer,
                                        base::ISubscribersManager* manager,
-                                       const common::uri::Url& epg_url)
-    : base_class(),
-      epg_url_(epg_url),
+                                       const Config& config,
+                                       base::TrafficCapture* capture,
+                                       base::RequestTracer* tracer)
+    : base_class("subscribers"),
+      config_(config),
       ping_client_id_timer_(INVALID_TIMER_ID),
+      liveness_wheel_(GetCurrentTick()),
+      ping_spread_counter_(0),
+      admission_(config.rate_limit_per_host, config.rate_limit_per_user, config.rate_limit_per_device),
+      loop_(nullptr),
+      pending_requests_(),
+      pending_methods_(),
+      drain_scheduled_(false),
+      request_metrics_(),
+      lag_monitor_("subscribers", config.loop_lag_degraded_threshold, config.loop_lag_overloaded_threshold),
+      pool_metrics_("subscribers_client"),
       manager_(manager),
-      observer_(observer) {}
+      observer_(observer),
+      capture_(capture),
+      tracer_(tracer) {}
 
 void SubscribersHandler::PreLooped(common::libev::IoLoop* server) {
-  UNUSED(server);
-  ping_client_id_timer_ = server->CreateTimer(ping_timeout_clients, true);
+  loop_ = server;
+  lag_monitor_.Start(base::GetMonotonicMsec());
+  ping_client_id_timer_ = server->CreateTimer(liveness_tick_seconds, true);
 }
 
 void SubscribersHandler::Accepted(common::libev::IoClient* client) {
   base_class::Accepted(client);
+  SubscriberClient* iclient = static_cast<SubscriberClient*>(client);
+  iclient->SetLastActivity(liveness_wheel_.GetCurrentTick());
+  iclient->SetOutputLimits(config_.subscribers_output_high_watermark, config_.subscribers_output_queue_limit);
+  iclient->SetLivenessWheel(&liveness_wheel_);
+  // round robin offsets spread first pings of reconnect bursts over the whole interval
+  const size_t offset = ping_spread_counter_++ % config_.subscribers_ping_interval;
+  liveness_wheel_.Schedule(iclient, offset + 1);
 }
 
 void SubscribersHandler::Moved(common::libev::IoLoop* server, common::libev::IoClient* client) {
@@ -58,6 +125,11 @@ void SubscribersHandler::Moved(common::libev::IoLoop* server, common::libev::IoC
 
 void SubscribersHandler::Closed(common::libev::IoClient* client) {
   SubscriberClient* iclient = static_cast<SubscriberClient*>(client);
+  if (capture_) {
+    capture_->RecordClose(base::TrafficRecord::SUBSCRIBERS_SOURCE, iclient->GetInfo().fd());
+  }
+  liveness_wheel_.Cancel(iclient);
+  RemovePendingRequests(iclient);
   const auto server_user_auth = iclient->GetLogin();
   common::Error unreg_err = manager_->UnRegisterInnerConnectionByHost(iclient);
   if (unreg_err) {
@@ -70,38 +142,81 @@ void SubscribersHandler::Closed(common::libev::IoClient* client) {
     return;
   }
 
-  INFO_LOG() << "Bye registered user: " << server_user_auth->GetLogin();
+  base::RuntimeStats::GetInstance().RemoveSubscriber(server_user_auth->GetUserID(), iclient->GetCurrentStreamID());
+  LIMITED_INFO_LOG(100) << "Bye registered user: " << server_user_auth->GetLogin();
   base_class::Closed(client);
 }
 
 void SubscribersHandler::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
+  UNUSED(server);
   if (ping_client_id_timer_ == id) {
-    std::vector<common::libev::IoClient*> online_clients = server->GetClients();
-    for (size_t i = 0; i < online_clients.size(); ++i) {
-      common::libev::IoClient* client = online_clients[i];
-      SubscriberClient* iclient = static_cast<SubscriberClient*>(client);
-      if (iclient) {
-        common::ErrnoError err = iclient->Ping();
-        if (err) {
-          DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-          ignore_result(client->Close());
-          delete client;
-        } else {
-          const auto user_auth = iclient->GetLogin();
-          if (user_auth) {
-            const auto client_info = iclient->GetClInfo();
-            if (!client_info) {
-              ignore_result(iclient->GetClientInfo());
-            }
-          }
-          INFO_LOG() << "Sent ping to client[" << client->GetFormatedName() << "], from server["
-                     << server->GetFormatedName() << "], " << online_clients.size() << " client(s) connected.";
-        }
-      }
+    // only login queue is scheduled work, deferred bulk requests don't count as lag
+    const uint64_t now_usec = base::GetMonotonicUsec();
+    const PendingRequest* oldest_login = pending_requests_.GetOldestLogin();
+    const common::time64_t queue_age = oldest_login ? (now_usec - oldest_login->enqueued_usec) / 1000 : 0;
+    if (lag_monitor_.Check(now_usec / 1000, queue_age)) {
+      SchedulePendingRequests();
+    }
+
+    PublishStats();
+    const base::TimingWheel::tick_t tick = GetCurrentTick();
+    std::vector<base::TimingWheelNode*> expired;
+    liveness_wheel_.Advance(tick, &expired);
+    for (size_t i = 0; i < expired.size(); ++i) {
+      CheckClientLiveness(static_cast<SubscriberClient*>(expired[i]));
     }
   }
 }
 
+void SubscribersHandler::PublishStats() {
+  base::RuntimeStats::GetInstance().UpdateLoop(base::LoopStats("subscribers", GetOnlineClients(), lag_monitor_));
+  pool_metrics_.Update(SubscriberClient::GetPoolStats());
+}
+
+void SubscribersHandler::CheckClientLiveness(SubscriberClient* client) {
+  const base::TimingWheel::tick_t idle = liveness_wheel_.GetCurrentTick() - client->GetLastActivity();
+  if (idle >= config_.subscribers_idle_timeout) {
+    LIMITED_WARNING_LOG(10) << "Close idle client[" << client->GetFormatedName() << "], no activity for " << idle
+                            << " sec.";
+    ignore_result(client->Close());
+    delete client;
+    return;
+  }
+
+  if (IsSlowConsumer(client)) {
+    LIMITED_WARNING_LOG(10) << "Evict slow consumer[" << client->GetFormatedName() << "], "
+                            << client->GetOutputQueueSize() << " bytes queued.";
+    ignore_result(client->Close());
+    delete client;
+    return;
+  }
+
+  if (client->GetOutputBlockedTime()) {
+    // don't queue pings for blocked peer, recheck it when it can reach slow consumer timeout
+    const uint32_t recheck = std::min(config_.subscribers_ping_interval, config_.subscribers_slow_consumer_timeout);
+    liveness_wheel_.Schedule(client, recheck);
+    return;
+  }
+
+  common::ErrnoError err = client->Ping();
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    ignore_result(client->Close());
+    delete client;
+    return;
+  }
+
+  const auto user_auth = client->GetLogin();
+  if (user_auth) {
+    const auto client_info = client->GetClInfo();
+    if (!client_info) {
+      ignore_result(client->GetClientInfo());
+    }
+  }
+  LIMITED_DEBUG_LOG(20) << "Sent ping to client[" << client->GetFormatedName() << "]";
+  liveness_wheel_.Schedule(client, config_.subscribers_ping_interval);
+}
+
 void SubscribersHandler::Accepted(common::libev::IoChild* child) {
   UNUSED(child);
 }
@@ -120,6 +235,7 @@ void SubscribersHandler::ChildStatusChanged(common::libev::IoChild* child, int s
 void SubscribersHandler::DataReceived(common::libev::IoClient* client) {
   std::string buff;
   SubscriberClient* iclient = static_cast<SubscriberClient*>(client);
+  const uint64_t received_usec = base::GetMonotonicUsec();
   common::ErrnoError err = iclient->ReadCommand(&buff);
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -128,11 +244,19 @@ void SubscribersHandler::DataReceived(common::libev::IoClient* client) {
     return;
   }
 
-  HandleInnerDataReceived(iclient, buff);
+  iclient->SetLastActivity(liveness_wheel_.GetCurrentTick());
+  // handlers may delete client, overflowed clients are evicted by liveness check of next tick
+  HandleInnerDataReceived(iclient, buff, received_usec);
 }
 
 void SubscribersHandler::DataReadyToWrite(common::libev::IoClient* client) {
-  UNUSED(client);
+  SubscriberClient* iclient = static_cast<SubscriberClient*>(client);
+  common::ErrnoError err = iclient->FlushOutput();
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    ignore_result(client->Close());
+    delete client;
+  }
 }
 
 void SubscribersHandler::PostLooped(common::libev::IoLoop* server) {
@@ -140,79 +264,403 @@ void SubscribersHandler::PostLooped(common::libev::IoLoop* server) {
     server->RemoveTimer(ping_client_id_timer_);
     ping_client_id_timer_ = INVALID_TIMER_ID;
   }
+  pending_requests_.Clear();
+  loop_ = nullptr;
+}
+
+const base::LoopLagMonitor& SubscribersHandler::GetLoopLagMonitor() const {
+  return lag_monitor_;
+}
+
+bool SubscribersHandler::IsSlowConsumer(SubscriberClient* client) const {
+  if (client->IsOutputOverflowed()) {
+    return true;
+  }
+
+  const common::time64_t blocked = client->GetOutputBlockedTime();
+  if (!blocked) {
+    return false;
+  }
+  const common::time64_t timeout_msec = static_cast<common::time64_t>(config_.subscribers_slow_consumer_timeout) * 1000;
+  return base::GetMonotonicMsec() - blocked >= timeout_msec;
+}
+
+bool SubscribersHandler::IsAdmitted(SubscriberClient* client,
+                                    const std::string& login,
+                                    const fastotv::device_id_t& device) {
+  if (admission_.Admit(client->GetInfo().host(), login, device, base::GetMonotonicMsec())) {
+    return true;
+  }
+
+  LIMITED_WARNING_LOG(10) << "Rate limited client[" << client->GetFormatedName() << "], login: " << login;
+  return false;
 }
 
 common::ErrnoError SubscribersHandler::HandleInnerDataReceived(SubscriberClient* client,
-                                                               const std::string& input_command) {
-  fastotv::protocol::request_t* req = nullptr;
-  fastotv::protocol::response_t* resp = nullptr;
-  common::Error err_parse = common::protocols::json_rpc::ParseJsonRPC(input_command, &req, &resp);
+                                                               const std::string& input_command,
+                                                               uint64_t received_usec) {
+  if (capture_) {
+    capture_->RecordFrame(base::TrafficRecord::SUBSCRIBERS_SOURCE, client->GetInfo().fd(), input_command.data(),
+                          input_command.size());
+  }
+
+  if (IsBinaryFrame(input_command)) {
+    return HandleInnerBinaryReceived(client, input_command, received_usec);
+  }
+
+  const uint64_t parse_start_usec = base::GetMonotonicUsec();
+  base::JsonRpcFrame frame;
+  common::Error err_parse = parser_.Parse(input_command, &frame);
   if (err_parse) {
     const std::string err_str = err_parse->GetDescription();
     return common::make_errno_error(err_str, EAGAIN);
   }
 
-  if (req) {
-    INFO_LOG() << "Received request: " << input_command;
-    common::ErrnoError err = HandleRequestCommand(client, req);
+  if (frame.IsRequest()) {
+    base::RequestTrace trace = StartTrace(received_usec);
+    trace.AddSpan("read", "socket", received_usec, parse_start_usec);
+    trace.AddSpan("parse", "loop", parse_start_usec, base::GetMonotonicUsec());
+    LIMITED_INFO_LOG(100) << "Received request: " << input_command;
+    common::ErrnoError err = HandleRequestCommand(client, frame, input_command, received_usec, &trace);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
-    delete req;
-  } else if (resp) {
-    INFO_LOG() << "Received responce: " << input_command;
-    common::ErrnoError err = HandleResponceCommand(client, resp);
+  } else {
+    LIMITED_INFO_LOG(100) << "Received responce: " << input_command;
+    common::ErrnoError err = HandleResponceCommand(client, frame);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
-    delete resp;
-  } else {
-    DNOTREACHED();
-    return common::make_errno_error("Invalid command type", EINVAL);
   }
 
   return common::ErrnoError();
 }
 
+common::ErrnoError SubscribersHandler::HandleInnerBinaryReceived(SubscriberClient* client,
+                                                                 const std::string& input_command,
+                                                                 uint64_t received_usec) {
+  if (client->GetEncoding() != MSGPACK_ENCODING) {
+    return common::make_errno_error("Binary encoding not negotiated", EINVAL);
+  }
+
+  const uint64_t parse_start_usec = base::GetMonotonicUsec();
+  BinaryRequest req;
+  common::Error err = DecodeBinaryRequest(input_command, &req);
+  if (err) {
+    const std::string err_str = err->GetDescription();
+    return common::make_errno_error(err_str, EAGAIN);
+  }
+
+  base::RequestTrace trace = StartTrace(received_usec);
+  trace.SetMethod(req.method);
+  trace.AddSpan("read", "socket", received_usec, parse_start_usec);
+  trace.AddSpan("parse", "loop", parse_start_usec, base::GetMonotonicUsec());
+  const RequestMethod* method = FindRequestMethod(req.method.c_str());
+  if (method && pending_requests_.MustQueue(client, method->cost)) {
+    if (!EnqueueRequest(client, method, input_command, true, received_usec, &trace)) {
+      std::string resp;
+      EncodeBinaryError(req.id, kServerBusyMessage, &resp);
+      return client->WriteBinaryFrame(resp);
+    }
+    return common::ErrnoError();
+  }
+
+  return RunBinaryRequest(client, req, received_usec, &trace);
+}
+
+common::ErrnoError SubscribersHandler::RunBinaryRequest(SubscriberClient* client,
+                                                        const BinaryRequest& req,
+                                                        uint64_t received_usec,
+                                                        base::RequestTrace* trace) {
+  const base::ScopedTraceActivation activation(trace);
+  std::string resp;
+  base::ServerDBAuthInfo auth;
+  common::Error err = manager_->CheckIsLoginClient(client, &auth);
+  if (err) {
+    EncodeBinaryError(req.id, err->GetDescription(), &resp);
+    ignore_result(client->WriteBinaryFrame(resp));
+    FinishTrace(trace);
+    ignore_result(client->Close());
+    delete client;
+    return common::make_errno_error(err->GetDescription(), EINVAL);
+  }
+
+  bool handled;
+  {
+    const base::ScopedTraceSpan span("handler", "loop");
+    handled = HandleBinaryRequestCommand(client, auth, req, &resp);
+  }
+  common::ErrnoError err_write = client->WriteBinaryFrame(resp);
+  const RequestMethod* method = FindRequestMethod(req.method.c_str());
+  if (method) {
+    RecordRequest(method, received_usec, !handled);
+  }
+  FinishTrace(trace);
+  return err_write;
+}
+
+bool SubscribersHandler::HandleBinaryRequestCommand(SubscriberClient* client,
+                                                    const base::ServerDBAuthInfo& auth,
+                                                    const BinaryRequest& req,
+                                                    std::string* resp) {
+  if (req.method == CLIENT_PING) {
+    EncodeBinaryPong(req.id, common::time::current_utc_mstime(), resp);
+    return true;
+  }
+
+  common::Error err;
+  if (req.method == CLIENT_GET_RUNTIME_CHANNEL_INFO) {
+    fastotv::commands_info::RuntimeChannelLiteInfo run;
+    err = DecodeBinaryParams(req, &run);
+    if (!err) {
+      const fastotv::stream_id_t sid = run.GetStreamID();
+      size_t watchers = manager_->GetAndUpdateOnlineUserByStreamID(sid);  // calc watchers
+      base::RuntimeStats::GetInstance().ChangeSubscriberStream(client->GetCurrentStreamID(), sid);
+      client->SetCurrentStreamID(sid);  // add to watcher
+      EncodeBinaryRuntimeChannelInfo(req.id, sid, watchers, resp);
+      return true;
+    }
+  } else if (req.method == CLIENT_SET_FAVORITE) {
+    fastotv::commands_info::FavoriteInfo fav;
+    err = DecodeBinaryParams(req, &fav);
+    if (!err) {
+      err = manager_->SetFavorite(auth, fav);
+    }
+  } else if (req.method == CLIENT_SET_RECENT) {
+    fastotv::commands_info::RecentStreamTimeInfo rec;
+    err = DecodeBinaryParams(req, &rec);
+    if (!err) {
+      err = manager_->SetRecent(auth, rec);
+    }
+  } else if (req.method == CLIENT_INTERRUPT_STREAM_TIME) {
+    fastotv::commands_info::InterruptStreamTimeInfo inter;
+    err = DecodeBinaryParams(req, &inter);
+    if (!err) {
+      err = manager_->SetInterruptTime(auth, inter);
+    }
+  } else {
+    LIMITED_WARNING_LOG(10) << "Received unknown binary command: " << req.method;
+    err = common::make_error("Method not supported in binary encoding");
+  }
+
+  if (err) {
+    EncodeBinaryError(req.id, err->GetDescription(), resp);
+    return false;
+  }
+
+  EncodeBinarySuccess(req.id, resp);
+  return true;
+}
+
+const SubscribersHandler::RequestMethod* SubscribersHandler::FindRequestMethod(const char* method) {
+  static const RequestMethod methods[] = {
+      {CLIENT_PING, &SubscribersHandler::HandleRequestClientPing, IMMEDIATE_REQUEST, 0},
+      {CLIENT_GET_RUNTIME_CHANNEL_INFO, &SubscribersHandler::HandleRequestClientGetRuntimeChannelInfo,
+       IMMEDIATE_REQUEST, 0},
+      {CLIENT_GET_SERVER_INFO, &SubscribersHandler::HandleRequestClientGetServerInfo, IMMEDIATE_REQUEST, 0},
+      {CLIENT_SET_FAVORITE, &SubscribersHandler::HandleRequestClientSetFavorite, IMMEDIATE_REQUEST, 0},
+      {CLIENT_SET_RECENT, &SubscribersHandler::HandleRequestClientSetRecent, IMMEDIATE_REQUEST, 0},
+      {CLIENT_INTERRUPT_STREAM_TIME, &SubscribersHandler::HandleRequestInterruptStreamTime, IMMEDIATE_REQUEST, 0},
+      {CLIENT_LOGIN, &SubscribersHandler::HandleRequestClientLogin, LOGIN_REQUEST, 0},
+      {CLIENT_ACTIVATE_DEVICE, &SubscribersHandler::HandleRequestClientActivate, LOGIN_REQUEST, 16},
+      // channel lists are the most expensive, reconnect burst can't take whole bulk queue with them
+      {CLIENT_GET_CHANNELS, &SubscribersHandler::HandleRequestClientGetChannels, BULK_REQUEST, 64},
+      {CLIENT_REQUEST_CATCHUP, &SubscribersHandler::HandleRequestGenerateCatchup, BULK_REQUEST, 16},
+      {CLIENT_REQUEST_UNDO_CATCHUP, &SubscribersHandler::HandleRequestUndoCatchup, BULK_REQUEST, 16}};
+
+  for (size_t i = 0; i < SIZEOFMASS(methods); ++i) {
+    if (strcmp(methods[i].method, method) == 0) {
+      return &methods[i];
+    }
+  }
+  return nullptr;
+}
+
 common::ErrnoError SubscribersHandler::HandleRequestCommand(SubscriberClient* client,
-                                                            fastotv::protocol::request_t* req) {
-  SubscriberClient* iclient = static_cast<SubscriberClient*>(client);
-  if (req->method == CLIENT_ACTIVATE_DEVICE) {
-    return HandleRequestClientActivate(iclient, req);
-  } else if (req->method == CLIENT_LOGIN) {
-    return HandleRequestClientLogin(iclient, req);
-  } else if (req->method == CLIENT_PING) {
-    return HandleRequestClientPing(iclient, req);
-  } else if (req->method == CLIENT_GET_SERVER_INFO) {
-    return HandleRequestClientGetServerInfo(iclient, req);
-  } else if (req->method == CLIENT_GET_CHANNELS) {
-    return HandleRequestClientGetChannels(iclient, req);
-  } else if (req->method == CLIENT_GET_RUNTIME_CHANNEL_INFO) {
-    return HandleRequestClientGetRuntimeChannelInfo(iclient, req);
-  } else if (req->method == CLIENT_SET_FAVORITE) {
-    return HandleRequestClientSetFavorite(iclient, req);
-  } else if (req->method == CLIENT_SET_RECENT) {
-    return HandleRequestClientSetRecent(iclient, req);
-  } else if (req->method == CLIENT_INTERRUPT_STREAM_TIME) {
-    return HandleRequestInterruptStreamTime(iclient, req);
-  } else if (req->method == CLIENT_REQUEST_CATCHUP) {
-    return HandleRequestGenerateCatchup(iclient, req);
-  } else if (req->method == CLIENT_REQUEST_UNDO_CATCHUP) {
-    return HandleRequestUndoCatchup(iclient, req);
-  }
-
-  WARNING_LOG() << "Received unknown command: " << req->method;
+                                                            const base::JsonRpcFrame& req,
+                                                            const std::string& command,
+                                                            uint64_t received_usec,
+                                                            base::RequestTrace* trace) {
+  const RequestMethod* method = FindRequestMethod(req.method);
+  if (!method) {
+    LIMITED_WARNING_LOG(10) << "Received unknown command: " << req.method;
+    trace->SetMethod(req.method);
+    FinishTrace(trace);
+    return common::ErrnoError();
+  }
+
+  trace->SetMethod(method->method);
+  if (!pending_requests_.MustQueue(client, method->cost)) {
+    common::ErrnoError err = RunRequestHandler(method, client, req, trace);
+    RecordRequest(method, received_usec, static_cast<bool>(err));
+    FinishTrace(trace);
+    return err;
+  }
+
+  if (!EnqueueRequest(client, method, command, false, received_usec, trace)) {
+    ignore_result(client->ServerBusy(req.id, kServerBusyMessage));
+  }
   return common::ErrnoError();
 }
 
-common::ErrnoError SubscribersHandler::HandleResponceCommand(SubscriberClient* client,
-                                                             fastotv::protocol::response_t* resp) {
+bool SubscribersHandler::EnqueueRequest(SubscriberClient* client,
+                                        const RequestMethod* method,
+                                        const std::string& command,
+                                        bool binary,
+                                        uint64_t received_usec,
+                                        base::RequestTrace* trace) {
+  size_t& method_queued = pending_methods_[method];
+  const bool overloaded = lag_monitor_.GetLoadLevel() == base::LoopLagMonitor::OVERLOADED;
+  if (pending_requests_.GetQueueSize(client, method->cost) >= config_.subscribers_request_queue_limit ||
+      (method->max_queued && method_queued >= method->max_queued) || (overloaded && method->cost == LOGIN_REQUEST)) {
+    LIMITED_WARNING_LOG(10) << "Shed request " << method->method << " from client[" << client->GetFormatedName() << "]";
+    GetRequestMetrics(method)->shed->Increment();
+    FinishTrace(trace);
+    return false;
+  }
+
+  PendingRequest pending = {method, command, binary, received_usec, base::GetMonotonicUsec(), std::move(*trace)};
+  pending_requests_.Push(client, method->cost, std::move(pending));
+  method_queued++;
+  SchedulePendingRequests();
+  return true;
+}
+
+void SubscribersHandler::SchedulePendingRequests() {
+  if (drain_scheduled_ || !loop_ || !pending_requests_.HasRunnable(lag_monitor_.GetLoadLevel())) {
+    return;
+  }
+
+  // runs after io events already pending in this loop iteration
+  drain_scheduled_ = true;
+  loop_->ExecInLoopThread([this]() { DrainPendingRequests(); });
+}
+
+void SubscribersHandler::DrainPendingRequests() {
+  drain_scheduled_ = false;
+  for (size_t i = 0; i < pending_requests_batch; ++i) {
+    SubscriberClient* client = nullptr;
+    PendingRequest pending;
+    if (!pending_requests_.Pop(lag_monitor_.GetLoadLevel(), &client, &pending)) {
+      break;
+    }
+
+    pending_methods_[pending.method]--;
+    RunPendingRequest(client, &pending);
+  }
+
+  SchedulePendingRequests();
+}
+
+void SubscribersHandler::RunPendingRequest(SubscriberClient* client, PendingRequest* pending) {
+  const uint64_t dequeued_usec = base::GetMonotonicUsec();
+  pending->trace.AddSpan("queue", "loop", pending->enqueued_usec, dequeued_usec);
+  if (pending->binary) {
+    BinaryRequest req;
+    common::Error err_decode = DecodeBinaryRequest(pending->command, &req);
+    pending->trace.AddSpan("parse", "loop", dequeued_usec, base::GetMonotonicUsec());
+    if (err_decode) {
+      DEBUG_MSG_ERROR(err_decode, common::logging::LOG_LEVEL_ERR);
+      RecordRequest(pending->method, pending->received_usec, true);
+      FinishTrace(&pending->trace);
+      return;
+    }
+
+    common::ErrnoError err = RunBinaryRequest(client, req, pending->received_usec, &pending->trace);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
+    return;
+  }
+
+  base::JsonRpcFrame frame;
+  common::Error err_parse = parser_.Parse(pending->command, &frame);
+  pending->trace.AddSpan("parse", "loop", dequeued_usec, base::GetMonotonicUsec());
+  if (err_parse) {
+    DEBUG_MSG_ERROR(err_parse, common::logging::LOG_LEVEL_ERR);
+    RecordRequest(pending->method, pending->received_usec, true);
+    FinishTrace(&pending->trace);
+    return;
+  }
+
+  common::ErrnoError err = RunRequestHandler(pending->method, client, frame, &pending->trace);
+  RecordRequest(pending->method, pending->received_usec, static_cast<bool>(err));
+  FinishTrace(&pending->trace);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+}
+
+void SubscribersHandler::RemovePendingRequests(SubscriberClient* client) {
+  std::vector<PendingRequest> removed;
+  pending_requests_.Remove(client, &removed);
+  const uint64_t now_usec = base::GetMonotonicUsec();
+  for (size_t i = 0; i < removed.size(); ++i) {
+    pending_methods_[removed[i].method]--;
+    // client left while request waited, trace ends with queue stage and no handler
+    removed[i].trace.AddSpan("queue", "loop", removed[i].enqueued_usec, now_usec);
+    FinishTrace(&removed[i].trace);
+  }
+}
+
+SubscribersHandler::RequestMetrics* SubscribersHandler::GetRequestMetrics(const RequestMethod* method) {
+  auto it = request_metrics_.find(method);
+  if (it != request_metrics_.end()) {
+    return &it->second;
+  }
+
+  base::MetricsRegistry& registry = base::MetricsRegistry::GetInstance();
+  const std::string labels = base::MakeMetricLabel("method", method->method);
+  RequestMetrics metrics;
+  metrics.requests = registry.GetCounter("fastocloud_rpc_requests_total", "Handled subscriber requests.", labels);
+  metrics.errors =
+      registry.GetCounter("fastocloud_rpc_errors_total", "Subscriber requests answered with error.", labels);
+  metrics.shed = registry.GetCounter("fastocloud_rpc_shed_total", "Subscriber requests refused by full queue.", labels);
+  metrics.latency = registry.GetHistogram("fastocloud_rpc_request_duration_seconds",
+                                          "Subscriber request time from receive to response, queue wait included.",
+                                          labels);
+  return &request_metrics_.insert(std::make_pair(method, metrics)).first->second;
+}
+
+void SubscribersHandler::RecordRequest(const RequestMethod* method, uint64_t received_usec, bool failed) {
+  RequestMetrics* metrics = GetRequestMetrics(method);
+  metrics->requests->Increment();
+  if (failed) {
+    metrics->errors->Increment();
+  }
+  metrics->latency->Record(base::GetMonotonicUsec() - received_usec);
+}
+
+base::RequestTrace SubscribersHandler::StartTrace(uint64_t received_usec) {
+  if (!tracer_) {
+    return base::RequestTrace();
+  }
+  return tracer_->StartTrace(received_usec);
+}
+
+void SubscribersHandler::FinishTrace(base::RequestTrace* trace) {
+  if (tracer_) {
+    tracer_->FinishTrace(trace);
+  }
+}
+
+common::ErrnoError SubscribersHandler::RunRequestHandler(const RequestMethod* method,
+                                                         SubscriberClient* client,
+                                                         const base::JsonRpcFrame& req,
+                                                         base::RequestTrace* trace) {
+  const base::ScopedTraceActivation activation(trace);
+  const base::ScopedTraceSpan span("handler", "loop");
+  return (this->*method->handler)(client, req);
+}
+
+common::ErrnoError SubscribersHandler::HandleResponceCommand(SubscriberClient* client, const base::JsonRpcFrame& resp) {
   fastotv::protocol::request_t req;
   SubscriberClient* sclient = static_cast<SubscriberClient*>(client);
   SubscriberClient::callback_t cb;
-  if (sclient->PopRequestByID(resp->id, &req, &cb)) {
+  if (sclient->PopRequestByID(resp.id, &req, &cb)) {
     if (cb) {
-      cb(resp);
+      fastotv::protocol::response_t lresp = resp.MakeResponse();
+      cb(&lresp);
     }
     if (req.method == SERVER_PING) {
       return HandleResponceServerPing(sclient, resp);
@@ -227,31 +675,29 @@ common::ErrnoError SubscribersHandler::HandleResponceCommand(SubscriberClient* c
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientActivate(SubscriberClient* client,
-                                                                   fastotv::protocol::request_t* req) {
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jauth = json_tokener_parse(params_ptr);
-    if (!jauth) {
-      return common::make_errno_error_inval();
-    }
-
+                                                                   const base::JsonRpcFrame& req) {
+  if (req.params) {
     fastotv::commands_info::LoginInfo uauth;
-    common::Error err = uauth.DeSerialize(jauth);
-    json_object_put(jauth);
+    common::Error err = uauth.DeSerialize(req.params);
     if (err) {
-      client->ActivateDeviceFail(req->id, err);
+      client->ActivateDeviceFail(req.id, err);
       return common::make_errno_error(err->GetDescription(), EINVAL);
     }
 
+    if (!IsAdmitted(client, uauth.GetLogin(), fastotv::device_id_t())) {
+      client->ActivateDeviceFail(req.id, common::make_error(kTooManyRequestsMessage));
+      return common::make_errno_error(kTooManyRequestsMessage, EAGAIN);
+    }
+
     fastotv::commands_info::DevicesInfo devices;
     err = manager_->ClientActivate(uauth, &devices);
     if (err) {
-      client->ActivateDeviceFail(req->id, err);
+      client->ActivateDeviceFail(req.id, err);
       return common::make_errno_error(err->GetDescription(), EINVAL);
     }
 
-    client->ActivateDeviceSuccess(req->id, devices);
-    INFO_LOG() << "Active registered user: " << uauth.GetLogin();
+    client->ActivateDeviceSuccess(req.id, devices);
+    LIMITED_INFO_LOG(100) << "Active registered user: " << uauth.GetLogin();
     return common::ErrnoError();
   }
 
@@ -259,37 +705,46 @@ common::ErrnoError SubscribersHandler::HandleRequestClientActivate(SubscriberCli
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientLogin(SubscriberClient* client,
-                                                                fastotv::protocol::request_t* req) {
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jauth = json_tokener_parse(params_ptr);
-    if (!jauth) {
-      return common::make_errno_error_inval();
-    }
-
+                                                                const base::JsonRpcFrame& req) {
+  if (req.params) {
     fastotv::commands_info::AuthInfo uauth;
-    common::Error err = uauth.DeSerialize(jauth);
-    json_object_put(jauth);
+    common::Error err = uauth.DeSerialize(req.params);
+    const CompressionCodec compression = GetRequestedCompression(req.params);
+    const Encoding encoding = GetRequestedEncoding(req.params);
     if (err) {
-      client->LoginFail(req->id, err);
+      client->LoginFail(req.id, err);
       return common::make_errno_error(err->GetDescription(), EINVAL);
     }
 
+    if (!IsAdmitted(client, uauth.GetLogin(), uauth.GetDeviceID())) {
+      client->LoginFail(req.id, common::make_error(kTooManyRequestsMessage));
+      return common::make_errno_error(kTooManyRequestsMessage, EAGAIN);
+    }
+
     base::ServerDBAuthInfo ser;
     err = manager_->ClientLogin(uauth, &ser);
     if (err) {
-      client->LoginFail(req->id, err);
+      client->LoginFail(req.id, err);
       return common::make_errno_error(err->GetDescription(), EINVAL);
     }
 
-    common::ErrnoError errn = client->LoginSuccess(req->id, ser);
+    common::ErrnoError errn = client->LoginSuccess(req.id, ser);
     if (errn) {
       return errn;
     }
 
+    client->SetEncoding(encoding);
+    if (config_.subscribers_compression && compression != NO_COMPRESSION) {
+      errn = client->StartCompression(compression);
+      if (errn) {
+        return errn;
+      }
+    }
+
     err = manager_->RegisterInnerConnectionByHost(client, ser);
     DCHECK(!err) << "Register inner connection error: " << err->GetDescription();
-    INFO_LOG() << "Welcome registered user: " << ser.GetLogin();
+    base::RuntimeStats::GetInstance().AddSubscriber(ser.GetUserID());
+    LIMITED_INFO_LOG(100) << "Welcome registered user: " << ser.GetLogin();
     return common::ErrnoError();
   }
 
@@ -297,63 +752,65 @@ common::ErrnoError SubscribersHandler::HandleRequestClientLogin(SubscriberClient
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientPing(SubscriberClient* client,
-                                                               fastotv::protocol::request_t* req) {
+                                                               const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo user;
   common::Error err = manager_->CheckIsLoginClient(client, &user);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jstop = json_tokener_parse(params_ptr);
-    if (!jstop) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     common::daemon::commands::ClientPingInfo ping_info;
-    common::Error err_des = ping_info.DeSerialize(jstop);
-    json_object_put(jstop);
+    common::Error err_des = ping_info.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    return client->Pong(req->id);
+    return client->Pong(req.id);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientGetServerInfo(SubscriberClient* client,
-                                                                        fastotv::protocol::request_t* req) {
+                                                                        const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo user;
   common::Error err = manager_->CheckIsLoginClient(client, &user);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  fastotv::commands_info::ServerInfo serv(epg_url_);
-  return client->GetServerInfoSuccess(req->id, serv);
+  fastotv::commands_info::ServerInfo serv(config_.epg_url);
+  return client->GetServerInfoSuccess(req.id, serv);
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientGetChannels(SubscriberClient* client,
-                                                                      fastotv::protocol::request_t* req) {
+                                                                      const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
-  common::Error err = manager_->CheckIsLoginClient(client, &auth);
+  common::Error err;
+  {
+    const base::ScopedTraceSpan span("auth", "loop");
+    err = manager_->CheckIsLoginClient(client, &auth);
+  }
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
+  if (!IsAdmitted(client, auth.GetLogin(), auth.GetDeviceID())) {
+    client->GetChannelsFail(req.id, common::make_error(kTooManyRequestsMessage));
+    return common::make_errno_error(kTooManyRequestsMessage, EAGAIN);
+  }
+
   fastotv::commands_info::ChannelsInfo chans;
   fastotv::commands_info::VodsInfo vods;
   fastotv::commands_info::ChannelsInfo pchans;
@@ -361,34 +818,29 @@ common::ErrnoError SubscribersHandler::HandleRequestClientGetChannels(Subscriber
   fastotv::commands_info::CatchupsInfo catchups;
   err = manager_->ClientGetChannels(auth, &chans, &vods, &pchans, &pvods, &catchups);
   if (err) {
-    client->GetChannelsFail(req->id, err);
+    client->GetChannelsFail(req.id, err);
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  return client->GetChannelsSuccess(req->id, chans, vods, pchans, pvods, catchups);
+  // serialization and socket write
+  const base::ScopedTraceSpan span("respond", "loop");
+  return client->GetChannelsSuccess(req.id, chans, vods, pchans, pvods, catchups);
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientGetRuntimeChannelInfo(SubscriberClient* client,
-                                                                                fastotv::protocol::request_t* req) {
+                                                                                const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
   common::Error err = manager_->CheckIsLoginClient(client, &auth);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jrun = json_tokener_parse(params_ptr);
-    if (!jrun) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     fastotv::commands_info::RuntimeChannelLiteInfo run;
-    common::Error err_des = run.DeSerialize(jrun);
-    json_object_put(jrun);
+    common::Error err_des = run.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -396,35 +848,29 @@ common::ErrnoError SubscribersHandler::HandleRequestClientGetRuntimeChannelInfo(
 
     const fastotv::stream_id_t sid = run.GetStreamID();
     size_t watchers = manager_->GetAndUpdateOnlineUserByStreamID(sid);  // calc watchers
-    client->SetCurrentStreamID(sid);                                    // add to watcher
+    base::RuntimeStats::GetInstance().ChangeSubscriberStream(client->GetCurrentStreamID(), sid);
+    client->SetCurrentStreamID(sid);  // add to watcher
 
-    return client->GetRuntimeChannelInfoSuccess(req->id, sid, watchers);
+    return client->GetRuntimeChannelInfoSuccess(req.id, sid, watchers);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientSetFavorite(SubscriberClient* client,
-                                                                      fastotv::protocol::request_t* req) {
+                                                                      const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
   common::Error err = manager_->CheckIsLoginClient(client, &auth);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jfav = json_tokener_parse(params_ptr);
-    if (!jfav) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     fastotv::commands_info::FavoriteInfo fav;
-    common::Error err_des = fav.DeSerialize(jfav);
-    json_object_put(jfav);
+    common::Error err_des = fav.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -432,34 +878,33 @@ common::ErrnoError SubscribersHandler::HandleRequestClientSetFavorite(Subscriber
 
     // write to DB
     auto login = client->GetLogin();
-    manager_->SetFavorite(*login, fav);
-    return client->GetFavoriteInfoSuccess(req->id);
+    err = manager_->SetFavorite(*login, fav);
+    if (err) {
+      const std::string err_str = err->GetDescription();
+      ignore_result(client->RequestFail(req.id, err));
+      return common::make_errno_error(err_str, EINVAL);
+    }
+
+    return client->GetFavoriteInfoSuccess(req.id);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestClientSetRecent(SubscriberClient* client,
-                                                                    fastotv::protocol::request_t* req) {
+                                                                    const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
   common::Error err = manager_->CheckIsLoginClient(client, &auth);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jfav = json_tokener_parse(params_ptr);
-    if (!jfav) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     fastotv::commands_info::RecentStreamTimeInfo fav;
-    common::Error err_des = fav.DeSerialize(jfav);
-    json_object_put(jfav);
+    common::Error err_des = fav.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -467,34 +912,33 @@ common::ErrnoError SubscribersHandler::HandleRequestClientSetRecent(SubscriberCl
 
     // write to DB
     auto login = client->GetLogin();
-    manager_->SetRecent(*login, fav);
-    return client->GetRecentInfoSuccess(req->id);
+    err = manager_->SetRecent(*login, fav);
+    if (err) {
+      const std::string err_str = err->GetDescription();
+      ignore_result(client->RequestFail(req.id, err));
+      return common::make_errno_error(err_str, EINVAL);
+    }
+
+    return client->GetRecentInfoSuccess(req.id);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestInterruptStreamTime(SubscriberClient* client,
-                                                                        fastotv::protocol::request_t* req) {
+                                                                        const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
   common::Error err = manager_->CheckIsLoginClient(client, &auth);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jinter = json_tokener_parse(params_ptr);
-    if (!jinter) {
-      return common::make_errno_error_inval();
-    }
-
+  if (req.params) {
     fastotv::commands_info::InterruptStreamTimeInfo inter;
-    common::Error err_des = inter.DeSerialize(jinter);
-    json_object_put(jinter);
+    common::Error err_des = inter.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -502,34 +946,38 @@ common::ErrnoError SubscribersHandler::HandleRequestInterruptStreamTime(Subscrib
 
     // write to DB
     auto login = client->GetLogin();
-    manager_->SetInterruptTime(*login, inter);
-    return client->GetInterruptStreamTimeInfoSuccess(req->id);
+    err = manager_->SetInterruptTime(*login, inter);
+    if (err) {
+      const std::string err_str = err->GetDescription();
+      ignore_result(client->RequestFail(req.id, err));
+      return common::make_errno_error(err_str, EINVAL);
+    }
+
+    return client->GetInterruptStreamTimeInfoSuccess(req.id);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestGenerateCatchup(SubscriberClient* client,
-                                                                    fastotv::protocol::request_t* req) {
+                                                                    const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
   common::Error err = manager_->CheckIsLoginClient(client, &auth);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jcatch = json_tokener_parse(params_ptr);
-    if (!jcatch) {
-      return common::make_errno_error_inval();
-    }
+  if (!IsAdmitted(client, auth.GetLogin(), auth.GetDeviceID())) {
+    client->CatchupGenerateFail(req.id, common::make_error(kTooManyRequestsMessage));
+    return common::make_errno_error(kTooManyRequestsMessage, EAGAIN);
+  }
 
+  if (req.params) {
     fastotv::commands_info::CatchupGenerateInfo cat_gen;
-    common::Error err_des = cat_gen.DeSerialize(jcatch);
-    json_object_put(jcatch);
+    common::Error err_des = cat_gen.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -541,14 +989,14 @@ common::ErrnoError SubscribersHandler::HandleRequestGenerateCatchup(SubscriberCl
                                                 cat_gen.GetStop(), &chan, &is_created);
     if (err) {
       const std::string err_str = err->GetDescription();
-      client->CatchupGenerateFail(req->id, err);
+      client->CatchupGenerateFail(req.id, err);
       return common::make_errno_error(err_str, EAGAIN);
     }
 
     err = manager_->AddUserCatchup(auth, chan.GetStreamID());
     if (err) {
       const std::string err_str = err->GetDescription();
-      client->CatchupGenerateFail(req->id, err);
+      client->CatchupGenerateFail(req.id, err);
       return common::make_errno_error(err_str, EAGAIN);
     }
 
@@ -559,33 +1007,31 @@ common::ErrnoError SubscribersHandler::HandleRequestGenerateCatchup(SubscriberCl
     }
 
     fastotv::commands_info::CatchupQueueInfo qcatch(chan);
-    return client->CatchupGenerateSuccess(req->id, qcatch);
+    return client->CatchupGenerateSuccess(req.id, qcatch);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleRequestUndoCatchup(SubscriberClient* client,
-                                                                fastotv::protocol::request_t* req) {
+                                                                const base::JsonRpcFrame& req) {
   base::ServerDBAuthInfo auth;
   common::Error err = manager_->CheckIsLoginClient(client, &auth);
   if (err) {
-    ignore_result(client->CheckLoginFail(req->id, err));
+    ignore_result(client->CheckLoginFail(req.id, err));
     ignore_result(client->Close());
     delete client;
     return common::make_errno_error(err->GetDescription(), EINVAL);
   }
 
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jcatch = json_tokener_parse(params_ptr);
-    if (!jcatch) {
-      return common::make_errno_error_inval();
-    }
+  if (!IsAdmitted(client, auth.GetLogin(), auth.GetDeviceID())) {
+    client->CatchupUndoFail(req.id, common::make_error(kTooManyRequestsMessage));
+    return common::make_errno_error(kTooManyRequestsMessage, EAGAIN);
+  }
 
+  if (req.params) {
     fastotv::commands_info::CatchupUndoInfo cat_undo;
-    common::Error err_des = cat_undo.DeSerialize(jcatch);
-    json_object_put(jcatch);
+    common::Error err_des = cat_undo.DeSerialize(req.params);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -594,29 +1040,22 @@ common::ErrnoError SubscribersHandler::HandleRequestUndoCatchup(SubscriberClient
     err = manager_->RemoveUserCatchup(auth, cat_undo.GetStreamID());
     if (err) {
       const std::string err_str = err->GetDescription();
-      client->CatchupUndoFail(req->id, err);
+      client->CatchupUndoFail(req.id, err);
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    return client->CatchupUndoSuccess(req->id);
+    return client->CatchupUndoSuccess(req.id);
   }
 
   return common::make_errno_error_inval();
 }
 
 common::ErrnoError SubscribersHandler::HandleResponceServerPing(SubscriberClient* client,
-                                                                fastotv::protocol::response_t* resp) {
+                                                                const base::JsonRpcFrame& resp) {
   UNUSED(client);
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jclient_ping = json_tokener_parse(params_ptr);
-    if (!jclient_ping) {
-      return common::make_errno_error_inval();
-    }
-
+  if (resp.IsMessage()) {
     common::daemon::commands::ClientPingInfo client_ping_info;
-    common::Error err_des = client_ping_info.DeSerialize(jclient_ping);
-    json_object_put(jclient_ping);
+    common::Error err_des = client_ping_info.DeSerialize(resp.result);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -627,17 +1066,10 @@ common::ErrnoError SubscribersHandler::HandleResponceServerPing(SubscriberClient
 }
 
 common::ErrnoError SubscribersHandler::HandleResponceServerGetClientInfo(SubscriberClient* client,
-                                                                         fastotv::protocol::response_t* resp) {
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jclient_info = json_tokener_parse(params_ptr);
-    if (!jclient_info) {
-      return common::make_errno_error_inval();
-    }
-
+                                                                         const base::JsonRpcFrame& resp) {
+  if (resp.IsMessage()) {
     fastotv::commands_info::ClientInfo cinf;
-    common::Error err_des = cinf.DeSerialize(jclient_info);
-    json_object_put(jclient_info);
+    common::Error err_des = cinf.DeSerialize(resp.result);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -14,34 +14,52 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 
-#include <common/uri/url.h>
-
 #include <fastotv/protocol/types.h>
 
 #include "base/iserver_handler.h"
+#include "base/json_rpc_parser.h"
+#include "base/loop_lag_monitor.h"
+#include "base/object_pool.h"
+#include "base/request_tracer.h"
+#include "base/timing_wheel.h"
+#include "base/token_bucket.h"
+
+#include "subscribers/request_queues.h"
+
+#include "config.h"
 
 namespace fastocloud {
 namespace server {
 namespace base {
 class ISubscribersManager;
-}
+class MetricCounter;
+class MetricHistogram;
+class ServerDBAuthInfo;
+class TrafficCapture;
+}  // namespace base
 namespace subscribers {
 
 class SubscriberClient;
+struct BinaryRequest;
 class ISubscribersHandlerObserver;
 
 class SubscribersHandler : public base::IServerHandler {
  public:
   typedef base::IServerHandler base_class;
   enum {
-    ping_timeout_clients = 60  // sec
+    liveness_tick_seconds = 1,   // wheel resolution
+    pending_requests_batch = 8   // queued requests handled per loop iteration
   };
 
+  // capture and tracer are optional, inbound frames are recorded and sampled requests traced when set
   explicit SubscribersHandler(ISubscribersHandlerObserver* observer,
                               base::ISubscribersManager* manager,
-                              const common::uri::Url& epg_url);
+                              const Config& config,
+                              base::TrafficCapture* capture,
+                              base::RequestTracer* tracer);
 
   void PreLooped(common::libev::IoLoop* server) override;
 
@@ -58,33 +76,127 @@ class SubscribersHandler : public base::IServerHandler {
 
   void PostLooped(common::libev::IoLoop* server) override;
 
+  const base::LoopLagMonitor& GetLoopLagMonitor() const;
+
  private:
-  common::ErrnoError HandleInnerDataReceived(SubscriberClient* client, const std::string& input_command);
-  common::ErrnoError HandleRequestCommand(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleResponceCommand(SubscriberClient* client, fastotv::protocol::response_t* resp);
-
-  common::ErrnoError HandleRequestClientActivate(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientLogin(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientPing(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientGetServerInfo(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientGetChannels(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientGetRuntimeChannelInfo(SubscriberClient* client,
-                                                              fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientSetFavorite(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestClientSetRecent(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestInterruptStreamTime(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestGenerateCatchup(SubscriberClient* client, fastotv::protocol::request_t* req);
-  common::ErrnoError HandleRequestUndoCatchup(SubscriberClient* client, fastotv::protocol::request_t* req);
-
-  common::ErrnoError HandleResponceServerPing(SubscriberClient* client, fastotv::protocol::response_t* resp);
-  common::ErrnoError HandleResponceServerGetClientInfo(SubscriberClient* client, fastotv::protocol::response_t* resp);
+  // immediate requests are answered while reading, others wait in bounded request queues drained after
+  // pending io; overloaded loop also refuses new logins. Binary frames go through the same queues.
+  typedef common::ErrnoError (SubscribersHandler::*request_handler_t)(SubscriberClient* client,
+                                                                      const base::JsonRpcFrame& req);
+  struct RequestMethod {
+    const char* method;
+    request_handler_t handler;
+    RequestCost cost;
+    size_t max_queued;  // queued requests of method over all clients, 0 for queue limit only
+  };
+  struct PendingRequest {
+    const RequestMethod* method;
+    std::string command;     // raw frame, parsed views die with next parse
+    bool binary;             // command is msgpack frame
+    uint64_t received_usec;  // monotonic, latency metric includes time in queue
+    uint64_t enqueued_usec;  // monotonic, age of login queue counts as loop lag
+    base::RequestTrace trace;
+  };
+  struct RequestMetrics {
+    base::MetricCounter* requests;
+    base::MetricCounter* errors;
+    base::MetricCounter* shed;
+    base::MetricHistogram* latency;
+  };
+
+  static const RequestMethod* FindRequestMethod(const char* method);
+  // false if request was shed, caller answers it with server busy error
+  bool EnqueueRequest(SubscriberClient* client,
+                      const RequestMethod* method,
+                      const std::string& command,
+                      bool binary,
+                      uint64_t received_usec,
+                      base::RequestTrace* trace);
+  void SchedulePendingRequests();
+  void DrainPendingRequests();
+  void RunPendingRequest(SubscriberClient* client, PendingRequest* pending);
+  void RemovePendingRequests(SubscriberClient* client);
+  void PublishStats();
+
+  // metrics of known methods only, unknown names from clients would grow label set
+  RequestMetrics* GetRequestMetrics(const RequestMethod* method);
+  void RecordRequest(const RequestMethod* method, uint64_t received_usec, bool failed);
+
+  base::RequestTrace StartTrace(uint64_t received_usec);
+  void FinishTrace(base::RequestTrace* trace);
+  // runs handler with trace active, so db queries and socket writes are added as its stages
+  common::ErrnoError RunRequestHandler(const RequestMethod* method,
+                                       SubscriberClient* client,
+                                       const base::JsonRpcFrame& req,
+                                       base::RequestTrace* trace);
+
+  // pings client or closes it after idle timeout, reschedules next check
+  void CheckClientLiveness(SubscriberClient* client);
+  // true for clients over output queue limit or blocked longer than slow consumer timeout
+  bool IsSlowConsumer(SubscriberClient* client) const;
+  // admission check for db backed requests, source host is taken from client socket
+  bool IsAdmitted(SubscriberClient* client, const std::string& login, const fastotv::device_id_t& device);
+
+  // received_usec is monotonic time when reading of command started
+  common::ErrnoError HandleInnerDataReceived(SubscriberClient* client,
+                                             const std::string& input_command,
+                                             uint64_t received_usec);
+  common::ErrnoError HandleInnerBinaryReceived(SubscriberClient* client,
+                                               const std::string& input_command,
+                                               uint64_t received_usec);
+  common::ErrnoError HandleRequestCommand(SubscriberClient* client,
+                                          const base::JsonRpcFrame& req,
+                                          const std::string& command,
+                                          uint64_t received_usec,
+                                          base::RequestTrace* trace);
+  common::ErrnoError HandleResponceCommand(SubscriberClient* client, const base::JsonRpcFrame& resp);
+
+  common::ErrnoError HandleRequestClientActivate(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientLogin(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientPing(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientGetServerInfo(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientGetChannels(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientGetRuntimeChannelInfo(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientSetFavorite(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestClientSetRecent(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestInterruptStreamTime(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestGenerateCatchup(SubscriberClient* client, const base::JsonRpcFrame& req);
+  common::ErrnoError HandleRequestUndoCatchup(SubscriberClient* client, const base::JsonRpcFrame& req);
+
+  // checks login and runs decoded binary request, writes its response frame
+  common::ErrnoError RunBinaryRequest(SubscriberClient* client,
+                                      const BinaryRequest& req,
+                                      uint64_t received_usec,
+                                      base::RequestTrace* trace);
+  // false if error response was encoded
+  bool HandleBinaryRequestCommand(SubscriberClient* client,
+                                  const base::ServerDBAuthInfo& auth,
+                                  const BinaryRequest& req,
+                                  std::string* resp);
+
+  common::ErrnoError HandleResponceServerPing(SubscriberClient* client, const base::JsonRpcFrame& resp);
+  common::ErrnoError HandleResponceServerGetClientInfo(SubscriberClient* client, const base::JsonRpcFrame& resp);
 
  private:
-  const common::uri::Url epg_url_;
+  const Config config_;
+  base::JsonRpcParser parser_;
 
   common::libev::timer_id_t ping_client_id_timer_;
+  base::TimingWheel liveness_wheel_;
+  size_t ping_spread_counter_;
+  base::AdmissionControl admission_;
+
+  common::libev::IoLoop* loop_;
+  RequestQueues<SubscriberClient, PendingRequest> pending_requests_;
+  std::map<const RequestMethod*, size_t> pending_methods_;
+  bool drain_scheduled_;
+  std::map<const RequestMethod*, RequestMetrics> request_metrics_;
+  base::LoopLagMonitor lag_monitor_;
+  base::ObjectPoolMetrics pool_metrics_;
   base::ISubscribersManager* const manager_;
   ISubscribersHandlerObserver* const observer_;
+  base::TrafficCapture* const capture_;
+  base::RequestTracer* const tracer_;
 };
 
 }  // namespace subscribers
@@ -0,0 +1,151 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "base/loop_lag_monitor.h"
+
+namespace fastocloud {
+namespace server {
+namespace subscribers {
+
+enum RequestCost { IMMEDIATE_REQUEST, LOGIN_REQUEST, BULK_REQUEST };
+
+// Requests waiting for loop, login queue runs before bulk queue, degraded loop defers bulk queue.
+// Queued requests of one client wait in one queue whatever their cost, so they run in order of arrival.
+// Immediate requests don't wait for client's queued bulk requests, load can defer those for long
+// and pings behind them would time out; they only wait behind client's queued login they depend on.
+template <typename Client, typename Request>
+class RequestQueues {
+ public:
+  RequestQueues() : login_(), bulk_(), clients_() {}
+
+  // false if request can run right now
+  bool MustQueue(Client* client, RequestCost cost) const {
+    if (cost != IMMEDIATE_REQUEST) {
+      return true;
+    }
+
+    const auto it = clients_.find(client);
+    return it != clients_.end() && it->second.queue == &login_;
+  }
+
+  // size of queue which next request of client would wait in
+  size_t GetQueueSize(Client* client, RequestCost cost) const {
+    const auto it = clients_.find(client);
+    if (it != clients_.end()) {
+      return it->second.queue->size();
+    }
+    return cost == BULK_REQUEST ? bulk_.size() : login_.size();
+  }
+
+  void Push(Client* client, RequestCost cost, Request&& request) {
+    const auto it = clients_.find(client);
+    if (it != clients_.end()) {
+      it->second.queue->push_back(Entry(client, std::move(request)));
+      it->second.requests++;
+      return;
+    }
+
+    std::deque<Entry>* queue = cost == BULK_REQUEST ? &bulk_ : &login_;
+    queue->push_back(Entry(client, std::move(request)));
+    PendingClient pending_client = {queue, 1};
+    clients_.insert(std::make_pair(client, pending_client));
+  }
+
+  bool HasRunnable(base::LoopLagMonitor::LoadLevel level) const {
+    return !login_.empty() || (!bulk_.empty() && level == base::LoopLagMonitor::NORMAL_LOAD);
+  }
+
+  // takes oldest request runnable at load level, false if there is none
+  bool Pop(base::LoopLagMonitor::LoadLevel level, Client** client, Request* request) {
+    std::deque<Entry>* queue = nullptr;
+    if (!login_.empty()) {
+      queue = &login_;
+    } else if (!bulk_.empty() && level == base::LoopLagMonitor::NORMAL_LOAD) {
+      queue = &bulk_;
+    } else {
+      return false;
+    }
+
+    *client = queue->front().client;
+    *request = std::move(queue->front().request);
+    queue->pop_front();
+    Release(*client);
+    return true;
+  }
+
+  // moves out all queued requests of client, in order of arrival
+  void Remove(Client* client, std::vector<Request>* removed) {
+    const auto it = clients_.find(client);
+    if (it == clients_.end()) {
+      return;
+    }
+
+    std::deque<Entry>* queue = it->second.queue;
+    const auto removed_it = std::stable_partition(queue->begin(), queue->end(),
+                                                  [client](const Entry& entry) { return entry.client != client; });
+    for (auto rit = removed_it; rit != queue->end(); ++rit) {
+      removed->push_back(std::move(rit->request));
+    }
+    queue->erase(removed_it, queue->end());
+    clients_.erase(it);
+  }
+
+  // oldest request of login queue, it is scheduled work at any load level
+  const Request* GetOldestLogin() const { return login_.empty() ? nullptr : &login_.front().request; }
+
+  bool HasQueued(Client* client) const { return clients_.find(client) != clients_.end(); }
+
+  void Clear() {
+    login_.clear();
+    bulk_.clear();
+    clients_.clear();
+  }
+
+ private:
+  struct Entry {
+    Entry(Client* owner, Request&& req) : client(owner), request(std::move(req)) {}
+
+    Client* client;
+    Request request;
+  };
+  struct PendingClient {
+    std::deque<Entry>* queue;  // all queued requests of client wait in one queue
+    size_t requests;
+  };
+
+  void Release(Client* client) {
+    const auto it = clients_.find(client);
+    if (it != clients_.end() && --it->second.requests == 0) {
+      clients_.erase(it);
+    }
+  }
+
+  std::deque<Entry> login_;
+  std::deque<Entry> bulk_;
+  std::map<Client*, PendingClient> clients_;
+};
+
+}  // namespace subscribers
+}  // namespace server
+}  // namespace fastocloud
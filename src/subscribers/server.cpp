@@ -21,9 +21,17 @@ namespace server {
 namespace subscribers {
 
 SubscribersServer::SubscribersServer(const common::net::HostAndPort& host, common::libev::IoLoopObserver* observer)
-    : base_class(host, false, observer) {}
+    : base_class(host, false, observer), tuning_() {}
+
+void SubscribersServer::SetSocketTuning(const base::SocketTuning& tuning) {
+  tuning_ = tuning;
+}
 
 common::libev::tcp::TcpClient* SubscribersServer::CreateClient(const common::net::socket_info& info) {
+  common::ErrnoError err = base::ApplySocketTuning(info.fd(), tuning_);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_WARNING);
+  }
   return new SubscriberClient(this, info);
 }
 
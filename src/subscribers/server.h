@@ -16,6 +16,8 @@
 
 #include <common/libev/tcp/tcp_server.h>
 
+#include "base/socket_tuning.h"
+
 namespace fastocloud {
 namespace server {
 namespace subscribers {
@@ -25,8 +27,12 @@ class SubscribersServer : public common::libev::tcp::TcpServer {
   typedef common::libev::tcp::TcpServer base_class;
   explicit SubscribersServer(const common::net::HostAndPort& host, common::libev::IoLoopObserver* observer = nullptr);
 
+  void SetSocketTuning(const base::SocketTuning& tuning);
+
  private:
   common::libev::tcp::TcpClient* CreateClient(const common::net::socket_info& info) override;
+
+  base::SocketTuning tuning_;
 };
 
 }  // namespace subscribers
@@ -0,0 +1,105 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "allocation_counter.h"
+#include "stream_documents.h"
+
+#include "mongo/mongo2info.h"
+
+namespace {
+void SetAllocationsCounter(benchmark::State& state, size_t allocations) {
+  state.counters["allocs_per_stream"] =
+      benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+void BM_MakeChannelInfo(benchmark::State& state) {
+  bson_t* doc = fastocloud::server::tests::MakeChannelDocument(state.range(0));
+  const fastocloud::server::mongo::UserStreamInfo uinfo;
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    fastotv::commands_info::ChannelInfo chan;
+    if (!fastocloud::server::mongo::MakeChannelInfo(doc, fastotv::RELAY, uinfo, &chan)) {
+      state.SkipWithError("MakeChannelInfo failed");
+      break;
+    }
+    benchmark::DoNotOptimize(chan);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * doc->len);
+  bson_destroy(doc);
+}
+
+void BM_MakeVodInfo(benchmark::State& state) {
+  bson_t* doc = fastocloud::server::tests::MakeVodDocument(state.range(0));
+  const fastocloud::server::mongo::UserStreamInfo uinfo;
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    fastotv::commands_info::VodInfo vod;
+    if (!fastocloud::server::mongo::MakeVodInfo(doc, fastotv::VOD_RELAY, uinfo, &vod)) {
+      state.SkipWithError("MakeVodInfo failed");
+      break;
+    }
+    benchmark::DoNotOptimize(vod);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * doc->len);
+  bson_destroy(doc);
+}
+
+void BM_MakeCatchupInfo(benchmark::State& state) {
+  bson_t* doc = fastocloud::server::tests::MakeCatchupDocument(state.range(0));
+  const fastocloud::server::mongo::UserStreamInfo uinfo;
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    fastotv::commands_info::CatchupInfo cat;
+    if (!fastocloud::server::mongo::MakeCatchupInfo(doc, fastotv::CATCHUP, uinfo, &cat)) {
+      state.SkipWithError("MakeCatchupInfo failed");
+      break;
+    }
+    benchmark::DoNotOptimize(cat);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * doc->len);
+  bson_destroy(doc);
+}
+
+void BM_GetOutputUrlData(benchmark::State& state) {
+  bson_t* doc = fastocloud::server::tests::MakeChannelDocument(state.range(0));
+  std::vector<fastotv::OutputUri> urls;
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    bson_iter_t iter;
+    if (!bson_iter_init_find(&iter, doc, STREAM_OUTPUT_FIELD) ||
+        !fastocloud::server::mongo::GetOutputUrlData(&iter, &urls)) {
+      state.SkipWithError("GetOutputUrlData failed");
+      break;
+    }
+    benchmark::DoNotOptimize(urls);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+  bson_destroy(doc);
+}
+}  // namespace
+
+// argument is the number of output urls, panel streams have one per quality
+BENCHMARK(BM_MakeChannelInfo)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_MakeVodInfo)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_MakeCatchupInfo)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_GetOutputUrlData)->Arg(1)->Arg(4)->Arg(16);
+
+BENCHMARK_MAIN();
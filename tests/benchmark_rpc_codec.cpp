@@ -0,0 +1,307 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <fastotv/commands/commands.h>
+#include <fastotv/commands_info/auth_info.h>
+#include <fastotv/commands_info/catchup_generate_info.h>
+#include <fastotv/commands_info/catchup_undo_info.h>
+#include <fastotv/commands_info/favorite_info.h>
+#include <fastotv/commands_info/interrupt_stream_time_info.h>
+#include <fastotv/commands_info/recent_stream_time_info.h>
+#include <fastotv/commands_info/runtime_channel_info.h>
+#include <fastotv/protocol/types.h>
+
+#include "allocation_counter.h"
+
+#include "base/json_rpc_parser.h"
+#include "base/msgpack.h"
+#include "subscribers/binary_codec.h"
+
+namespace {
+const char kRequestID[] = "000000000000001a";
+const char kStreamID[] = "5e1a5b2f8b1c9a0001234567";
+const size_t kWatchers = 42;
+const char kLogin[] = "user@fastocloud.com";
+const char kPassword[] = "password";
+const char kDeviceID[] = "5e1a5b2f8b1c9a0007654321";
+const fastotv::timestamp_t kTimestamp = 1580000000000;
+
+void SetAllocationsCounter(benchmark::State& state, size_t allocations) {
+  state.counters["allocs_per_rpc"] =
+      benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+template <typename T>
+std::string MakeJsonFrame(const char* method, const T& params) {
+  std::string params_str;
+  common::Error err = params.SerializeToString(&params_str);
+  if (err) {
+    return std::string();
+  }
+  return std::string("{\"jsonrpc\":\"2.0\",\"id\":\"") + kRequestID + "\",\"method\":\"" + method +
+         "\",\"params\":" + params_str + "}";
+}
+
+std::string MakeJsonFrame(const char* method) {
+  return std::string("{\"jsonrpc\":\"2.0\",\"id\":\"") + kRequestID + "\",\"method\":\"" + method + "\"}";
+}
+
+// every CLIENT_* request the subscribers handler serves, params are empty for envelope only requests
+struct ClientMethod {
+  const char* name;
+  const char* method;
+  std::function<common::Error(std::string*)> serialize;
+  std::function<common::Error(json_object*)> deserialize;
+};
+
+template <typename T>
+ClientMethod MakeClientMethod(const char* name, const char* method, const T& params) {
+  ClientMethod result = {name, method, [params](std::string* out) { return params.SerializeToString(out); },
+                         [](json_object* jparams) {
+                           T decoded;
+                           common::Error err = decoded.DeSerialize(jparams);
+                           benchmark::DoNotOptimize(decoded);
+                           return err;
+                         }};
+  return result;
+}
+
+ClientMethod MakeClientMethod(const char* name, const char* method) {
+  ClientMethod result = {name, method, nullptr, nullptr};
+  return result;
+}
+
+const std::vector<ClientMethod>& GetClientMethods() {
+  static const std::vector<ClientMethod> methods = {
+      MakeClientMethod(
+          "login", CLIENT_LOGIN,
+          fastotv::commands_info::AuthInfo(fastotv::commands_info::LoginInfo(kLogin, kPassword), kDeviceID)),
+      MakeClientMethod("activate_device", CLIENT_ACTIVATE_DEVICE, fastotv::commands_info::LoginInfo(kLogin, kPassword)),
+      MakeClientMethod("get_runtime_channel_info", CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                       fastotv::commands_info::RuntimeChannelLiteInfo(kStreamID)),
+      MakeClientMethod("set_favorite", CLIENT_SET_FAVORITE, fastotv::commands_info::FavoriteInfo(kStreamID, true)),
+      MakeClientMethod("set_recent", CLIENT_SET_RECENT,
+                       fastotv::commands_info::RecentStreamTimeInfo(kStreamID, kTimestamp)),
+      MakeClientMethod("interrupt_stream_time", CLIENT_INTERRUPT_STREAM_TIME,
+                       fastotv::commands_info::InterruptStreamTimeInfo(kStreamID, kTimestamp)),
+      MakeClientMethod("request_catchup", CLIENT_REQUEST_CATCHUP,
+                       fastotv::commands_info::CatchupGenerateInfo(kStreamID, "News at nine", kTimestamp,
+                                                                   kTimestamp + 3600000)),
+      MakeClientMethod("request_undo_catchup", CLIENT_REQUEST_UNDO_CATCHUP,
+                       fastotv::commands_info::CatchupUndoInfo(kStreamID)),
+      MakeClientMethod("ping", CLIENT_PING),
+      MakeClientMethod("get_server_info", CLIENT_GET_SERVER_INFO),
+      MakeClientMethod("get_channels", CLIENT_GET_CHANNELS)};
+  return methods;
+}
+
+// benchmark argument is index in client methods table
+void ClientMethodArgs(benchmark::internal::Benchmark* benchmark) {
+  for (size_t i = 0; i < GetClientMethods().size(); ++i) {
+    benchmark->Arg(static_cast<int64_t>(i));
+  }
+}
+
+std::string MakeJsonFrame(const ClientMethod& method) {
+  if (!method.serialize) {
+    return MakeJsonFrame(method.method);
+  }
+
+  std::string params_str;
+  common::Error err = method.serialize(&params_str);
+  if (err) {
+    return std::string();
+  }
+  return std::string("{\"jsonrpc\":\"2.0\",\"id\":\"") + kRequestID + "\",\"method\":\"" + method.method +
+         "\",\"params\":" + params_str + "}";
+}
+
+std::string MakeBinaryFrame(const char* method, const fastotv::commands_info::FavoriteInfo& fav) {
+  std::string frame;
+  fastocloud::server::base::MsgPackWriter writer(&frame);
+  writer.PackMap(3);
+  writer.PackString(BINARY_ID_FIELD);
+  writer.PackString(kRequestID);
+  writer.PackString(BINARY_METHOD_FIELD);
+  writer.PackString(method);
+  writer.PackString(BINARY_PARAMS_FIELD);
+  writer.PackMap(2);
+  writer.PackString(BINARY_STREAM_ID_FIELD);
+  writer.PackString(fav.GetChannel());
+  writer.PackString(BINARY_FAVORITE_FIELD);
+  writer.PackBool(fav.GetFavorite());
+  return frame;
+}
+
+std::string MakeBinaryFrame(const char* method, const fastotv::commands_info::RuntimeChannelLiteInfo& run) {
+  std::string frame;
+  fastocloud::server::base::MsgPackWriter writer(&frame);
+  writer.PackMap(3);
+  writer.PackString(BINARY_ID_FIELD);
+  writer.PackString(kRequestID);
+  writer.PackString(BINARY_METHOD_FIELD);
+  writer.PackString(method);
+  writer.PackString(BINARY_PARAMS_FIELD);
+  writer.PackMap(1);
+  writer.PackString(BINARY_STREAM_ID_FIELD);
+  writer.PackString(run.GetStreamID());
+  return frame;
+}
+
+// json path as done by SubscribersHandler: envelope parse, then params parse
+template <typename T>
+void BM_JsonDecodeRequest(benchmark::State& state, const char* method, T params) {
+  const std::string frame = MakeJsonFrame(method, params);
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    fastotv::protocol::request_t* req = nullptr;
+    fastotv::protocol::response_t* resp = nullptr;
+    common::Error err = common::protocols::json_rpc::ParseJsonRPC(frame, &req, &resp);
+    if (err || !req || !req->params) {
+      state.SkipWithError("ParseJsonRPC failed");
+      break;
+    }
+
+    json_object* jparams = json_tokener_parse(req->params->c_str());
+    T decoded;
+    err = decoded.DeSerialize(jparams);
+    json_object_put(jparams);
+    delete req;
+    benchmark::DoNotOptimize(decoded);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+}
+
+// single pass json path: reused tokener, params deserialized from the parsed tree
+void BM_SinglePassDecodeRequest(benchmark::State& state) {
+  const ClientMethod& method = GetClientMethods()[state.range(0)];
+  state.SetLabel(method.name);
+  const std::string frame = MakeJsonFrame(method);
+  fastocloud::server::base::JsonRpcParser parser;
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    fastocloud::server::base::JsonRpcFrame req;
+    common::Error err = parser.Parse(frame, &req);
+    if (err || !req.IsMethod(method.method)) {
+      state.SkipWithError("JsonRpcParser::Parse failed");
+      break;
+    }
+
+    if (method.deserialize) {
+      err = method.deserialize(req.params);
+    }
+    benchmark::DoNotOptimize(req);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+}
+
+// client side of the method, params serialized and wrapped into the envelope
+void BM_JsonEncodeRequest(benchmark::State& state) {
+  const ClientMethod& method = GetClientMethods()[state.range(0)];
+  state.SetLabel(method.name);
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    std::string frame = MakeJsonFrame(method);
+    if (frame.empty()) {
+      state.SkipWithError("SerializeToString failed");
+      break;
+    }
+    benchmark::DoNotOptimize(frame);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+}
+
+template <typename T>
+void BM_BinaryDecodeRequest(benchmark::State& state, const char* method, T params) {
+  const std::string frame = MakeBinaryFrame(method, params);
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    fastocloud::server::subscribers::BinaryRequest req;
+    common::Error err = fastocloud::server::subscribers::DecodeBinaryRequest(frame, &req);
+    T decoded;
+    if (!err) {
+      err = fastocloud::server::subscribers::DecodeBinaryParams(req, &decoded);
+    }
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(decoded);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+}
+
+// json-c envelope + result tree, the same work the protocol library does per response
+void BM_JsonEncodeRuntimeChannelInfo(benchmark::State& state) {
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (auto _ : state) {
+    json_object* jresult = json_object_new_object();
+    json_object_object_add(jresult, "id", json_object_new_string(kStreamID));
+    json_object_object_add(jresult, "watchers", json_object_new_int64(kWatchers));
+    json_object* jresp = json_object_new_object();
+    json_object_object_add(jresp, "jsonrpc", json_object_new_string("2.0"));
+    json_object_object_add(jresp, "id", json_object_new_string(kRequestID));
+    json_object_object_add(jresp, "result", jresult);
+    std::string out = json_object_to_json_string_ext(jresp, JSON_C_TO_STRING_PLAIN);
+    json_object_put(jresp);
+    benchmark::DoNotOptimize(out);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+}
+
+void BM_BinaryEncodeRuntimeChannelInfo(benchmark::State& state) {
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    fastocloud::server::subscribers::EncodeBinaryRuntimeChannelInfo(kRequestID, kStreamID, kWatchers, &out);
+    benchmark::DoNotOptimize(out);
+  }
+  SetAllocationsCounter(state, fastocloud::server::tests::GetAllocationsCount() - start_allocations);
+}
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_JsonDecodeRequest,
+                  set_favorite,
+                  CLIENT_SET_FAVORITE,
+                  fastotv::commands_info::FavoriteInfo(kStreamID, true));
+BENCHMARK_CAPTURE(BM_BinaryDecodeRequest,
+                  set_favorite,
+                  CLIENT_SET_FAVORITE,
+                  fastotv::commands_info::FavoriteInfo(kStreamID, true));
+BENCHMARK_CAPTURE(BM_JsonDecodeRequest,
+                  get_runtime_channel_info,
+                  CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                  fastotv::commands_info::RuntimeChannelLiteInfo(kStreamID));
+BENCHMARK_CAPTURE(BM_BinaryDecodeRequest,
+                  get_runtime_channel_info,
+                  CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                  fastotv::commands_info::RuntimeChannelLiteInfo(kStreamID));
+
+BENCHMARK(BM_SinglePassDecodeRequest)->Apply(ClientMethodArgs);
+BENCHMARK(BM_JsonEncodeRequest)->Apply(ClientMethodArgs);
+
+BENCHMARK(BM_JsonEncodeRuntimeChannelInfo);
+BENCHMARK(BM_BinaryEncodeRuntimeChannelInfo);
+
+BENCHMARK_MAIN();
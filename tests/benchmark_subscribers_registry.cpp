@@ -0,0 +1,115 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/subscriber_info.h"
+#include "mongo/subscribers_manager.h"
+
+namespace {
+const size_t kConnectionsPerUser = 2;
+const size_t kStreams = 1000;
+const char kPassword[] = "password";
+
+fastotv::stream_id_t MakeStreamID(size_t index) {
+  return "5e1a5b2f8b1c9a" + std::to_string(1000000000 + index);
+}
+
+fastocloud::server::base::ServerDBAuthInfo MakeAuth(size_t user) {
+  const std::string login = "user" + std::to_string(user) + "@fastocloud.com";
+  const fastotv::commands_info::AuthInfo auth(fastotv::commands_info::LoginInfo(login, kPassword),
+                                              "device" + std::to_string(user));
+  const fastotv::commands_info::ServerAuthInfo sauth(auth, 0);
+  return fastocloud::server::base::ServerDBAuthInfo("uid" + std::to_string(user), sauth);
+}
+
+// connected clients of a loaded node: every user has a couple of devices watching one of the streams
+class Registry {
+ public:
+  explicit Registry(size_t connections)
+      : manager_(common::net::HostAndPort::CreateLocalHost(8000),
+                 common::file_system::ascii_directory_string_path("/tmp/"),
+                 0),
+        clients_(connections),
+        users_(connections / kConnectionsPerUser + 1) {
+    for (size_t i = 0; i < users_.size(); ++i) {
+      users_[i] = MakeAuth(i);
+    }
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      clients_[i].SetCurrentStreamID(MakeStreamID(i % kStreams));
+      common::Error err = manager_.RegisterInnerConnectionByHost(&clients_[i], users_[i / kConnectionsPerUser]);
+      if (err) {
+        break;
+      }
+    }
+  }
+
+  ~Registry() {
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      ignore_result(manager_.UnRegisterInnerConnectionByHost(&clients_[i]));
+    }
+  }
+
+  fastocloud::server::mongo::SubscribersManager* GetManager() { return &manager_; }
+
+  const fastocloud::server::base::ServerDBAuthInfo& GetUser(size_t index) const {
+    return users_[index % users_.size()];
+  }
+
+ private:
+  fastocloud::server::mongo::SubscribersManager manager_;
+  std::vector<fastocloud::server::base::SubscriberInfo> clients_;
+  std::vector<fastocloud::server::base::ServerDBAuthInfo> users_;
+};
+
+// one more device of an online user connects and goes away, the reconnect storm unit of work
+void BM_RegisterUnregister(benchmark::State& state) {
+  Registry registry(state.range(0));
+  fastocloud::server::mongo::SubscribersManager* manager = registry.GetManager();
+  fastocloud::server::base::SubscriberInfo client;
+  size_t user = 0;
+  for (auto _ : state) {
+    common::Error err = manager->RegisterInnerConnectionByHost(&client, registry.GetUser(user++));
+    if (!err) {
+      err = manager->UnRegisterInnerConnectionByHost(&client);
+    }
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// runs for every CLIENT_GET_RUNTIME_CHANNEL_INFO request
+void BM_CountWatchers(benchmark::State& state) {
+  Registry registry(state.range(0));
+  fastocloud::server::mongo::SubscribersManager* manager = registry.GetManager();
+  size_t stream = 0;
+  for (auto _ : state) {
+    size_t watchers = manager->GetAndUpdateOnlineUserByStreamID(MakeStreamID(stream++ % kStreams));
+    benchmark::DoNotOptimize(watchers);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+}  // namespace
+
+BENCHMARK(BM_RegisterUnregister)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CountWatchers)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stream_documents.h"
+
+namespace {
+// typical admin panel descriptions are a paragraph or two
+const size_t kDescriptionSize = 1024;
+const fastotv::timestamp_t kCatchupStart = 1580000000000;
+const fastotv::timestamp_t kCatchupStop = 1580003600000;
+
+void AppendOutputs(bson_t* doc, uint32_t count) {
+  bson_t outputs;
+  BSON_APPEND_ARRAY_BEGIN(doc, STREAM_OUTPUT_FIELD, &outputs);
+  for (uint32_t i = 0; i < count; ++i) {
+    char buf[16];
+    const char* key;
+    size_t keylen = bson_uint32_to_string(i, &key, buf, sizeof(buf));
+    bson_t url;
+    bson_append_document_begin(&outputs, key, keylen, &url);
+    BSON_APPEND_INT32(&url, STREAM_OUTPUT_URLS_ID_FIELD, i);
+    BSON_APPEND_UTF8(&url, STREAM_OUTPUT_URLS_URI_FIELD, fastocloud::server::tests::MakeOutputUrl(i).c_str());
+    BSON_APPEND_UTF8(&url, STREAM_OUTPUT_URLS_HTTP_ROOT_FIELD, fastocloud::server::tests::MakeOutputHttpRoot().c_str());
+    BSON_APPEND_INT32(&url, STREAM_OUTPUT_URLS_HLS_TYPE_FIELD, 0);
+    bson_append_document_end(&outputs, &url);
+  }
+  bson_append_array_end(doc, &outputs);
+}
+
+void AppendBase(bson_t* doc, const char* cls, uint32_t parts_count) {
+  bson_oid_t sid;
+  bson_oid_init_from_string(&sid, fastocloud::server::tests::kStreamID);
+  BSON_APPEND_OID(doc, STREAM_ID_FIELD, &sid);
+  BSON_APPEND_UTF8(doc, STREAM_CLS_FIELD, cls);
+  BSON_APPEND_UTF8(doc, STREAM_NAME_FIELD, fastocloud::server::tests::kStreamName);
+  BSON_APPEND_UTF8(doc, STREAM_GROUP_FIELD, fastocloud::server::tests::kStreamGroup);
+  BSON_APPEND_INT32(doc, STREAM_IARC_FIELD, fastocloud::server::tests::kStreamIARC);
+  BSON_APPEND_BOOL(doc, STREAM_HAVE_VIDEO_FIELD, true);
+  BSON_APPEND_BOOL(doc, STREAM_HAVE_AUDIO_FIELD, true);
+
+  bson_t parts;
+  BSON_APPEND_ARRAY_BEGIN(doc, STREAM_PARTS_FIELD, &parts);
+  bson_oid_t pid;
+  bson_oid_init_from_string(&pid, fastocloud::server::tests::kPartID);
+  for (uint32_t i = 0; i < parts_count; ++i) {
+    char buf[16];
+    const char* key;
+    size_t keylen = bson_uint32_to_string(i, &key, buf, sizeof(buf));
+    bson_append_oid(&parts, key, keylen, &pid);
+  }
+  bson_append_array_end(doc, &parts);
+}
+
+void AppendTvg(bson_t* doc) {
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_ID_FIELD, fastocloud::server::tests::kChannelTvgID);
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_LOGO_FIELD, fastocloud::server::tests::kChannelTvgLogo);
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace tests {
+
+const char kStreamID[] = "5e1a5b2f8b1c9a0001234567";
+const char kPartID[] = "5e1a5b2f8b1c9a0007654321";
+const char kStreamGroup[] = "News";
+const char kStreamName[] = "First channel with a long display name";
+const int kStreamIARC = 18;
+const char kChannelTvgID[] = "first.channel.tvg.id";
+const char kChannelTvgLogo[] = "https://fastocloud.com/images/unknown_channel.png";
+
+std::string MakeOutputUrl(uint32_t index) {
+  return "http://localhost:8000/3/" + std::string(kStreamID) + "/" + std::to_string(index) + "/master.m3u8";
+}
+
+std::string MakeOutputHttpRoot() {
+  return "/home/fastocloud/streamer/hls/3/" + std::string(kStreamID);
+}
+
+bson_t* MakeChannelDocument(uint32_t outputs) {
+  bson_t* doc = bson_new();
+  AppendBase(doc, "pyfastocloud_models.stream.entry.RelayStream", 1);
+  AppendTvg(doc);
+  AppendOutputs(doc, outputs);
+  return doc;
+}
+
+bson_t* MakeVodDocument(uint32_t outputs) {
+  bson_t* doc = bson_new();
+  AppendBase(doc, "pyfastocloud_models.stream.entry.VodRelayStream", 0);
+  const std::string description(kDescriptionSize, 'd');
+  BSON_APPEND_UTF8(doc, VOD_DESCRIPTION_FIELD, description.c_str());
+  BSON_APPEND_UTF8(doc, VOD_PRVIEW_ICON_FIELD, "https://fastocloud.com/images/unknown_preview.png");
+  BSON_APPEND_UTF8(doc, VOD_TRAILER_URL_FIELD, "https://fastocloud.com/trailers/first.mp4");
+  BSON_APPEND_DOUBLE(doc, VOD_USER_SCORE_FIELD, 7.5);
+  BSON_APPEND_DATE_TIME(doc, VOD_PRIME_DATE_FIELD, kCatchupStart);
+  BSON_APPEND_UTF8(doc, VOD_COUNTRY_FIELD, "USA");
+  BSON_APPEND_INT32(doc, VOD_DURATION_FIELD, 5400000);
+  BSON_APPEND_INT32(doc, VOD_TYPE_FIELD, 0);
+  AppendOutputs(doc, outputs);
+  return doc;
+}
+
+bson_t* MakeCatchupDocument(uint32_t outputs) {
+  bson_t* doc = bson_new();
+  AppendBase(doc, "pyfastocloud_models.stream.entry.CatchupStream", 1);
+  AppendTvg(doc);
+  BSON_APPEND_DATE_TIME(doc, CATCHUP_START_FIELD, kCatchupStart);
+  BSON_APPEND_DATE_TIME(doc, CATCHUP_STOP_FIELD, kCatchupStop);
+  AppendOutputs(doc, outputs);
+  return doc;
+}
+
+}  // namespace tests
+}  // namespace server
+}  // namespace fastocloud
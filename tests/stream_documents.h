@@ -0,0 +1,46 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "mongo/mongo2info.h"
+
+namespace fastocloud {
+namespace server {
+namespace tests {
+
+// stream documents as the admin panel stores them, shared by mongo2info tests and benchmarks
+extern const char kStreamID[];
+extern const char kPartID[];
+extern const char kStreamGroup[];
+extern const char kStreamName[];
+extern const int kStreamIARC;
+extern const char kChannelTvgID[];
+extern const char kChannelTvgLogo[];
+
+std::string MakeOutputUrl(uint32_t index);
+std::string MakeOutputHttpRoot();
+
+// outputs is the number of output urls, panel streams have one per quality
+bson_t* MakeChannelDocument(uint32_t outputs);
+bson_t* MakeVodDocument(uint32_t outputs);
+bson_t* MakeCatchupDocument(uint32_t outputs);
+
+}  // namespace tests
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,157 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "base/token_bucket.h"
+#include "http/auth_cache.h"
+
+namespace {
+const char kHost[] = "192.168.1.10";
+const char kUser[] = "5e1a5b2f8b1c9a0001234567";
+const char kPassword[] = "2c26b46b68ffc68ff99b453c1d30413413422d706483bfa0f98a5e886266e7ae";
+const char kDevice[] = "5e1a5b2f8b1c9a0007654321";
+const common::time64_t kTTL = 30000;
+const common::time64_t kSegmentDuration = 2000;
+// default limits from service.conf
+const uint32_t kPerHost = 300;
+const uint32_t kPerUser = 60;
+const uint32_t kPerDevice = 30;
+
+fastocloud::server::base::ServerDBAuthInfo MakeAuth() {
+  const fastotv::commands_info::AuthInfo auth(fastotv::commands_info::LoginInfo("test@fastocloud.com", kPassword),
+                                              kDevice);
+  return fastocloud::server::base::ServerDBAuthInfo(kUser, fastotv::commands_info::ServerAuthInfo(auth, 0));
+}
+}  // namespace
+
+TEST(AuthCache, find_until_expired) {
+  fastocloud::server::http::AuthCache cache(kTTL, 16);
+  const std::string key = fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, kDevice);
+  fastocloud::server::base::ServerDBAuthInfo auth;
+  ASSERT_FALSE(cache.Find(key, 0, &auth));
+
+  cache.Insert(key, MakeAuth(), 0);
+  ASSERT_TRUE(cache.Find(key, kTTL - 1, &auth));
+  ASSERT_TRUE(auth.Equals(MakeAuth()));
+  ASSERT_FALSE(cache.Find(key, kTTL, &auth));
+  ASSERT_EQ(cache.GetSize(), 0);
+}
+
+TEST(AuthCache, key_includes_host_and_credentials) {
+  fastocloud::server::http::AuthCache cache(kTTL, 16);
+  cache.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, kDevice), MakeAuth(), 0);
+  fastocloud::server::base::ServerDBAuthInfo auth;
+  ASSERT_FALSE(cache.Find(fastocloud::server::http::AuthCache::MakeKey("10.0.0.1", kUser, kPassword, kDevice), 0,
+                          &auth));
+  ASSERT_FALSE(cache.Find(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, "wrong", kDevice), 0, &auth));
+  ASSERT_FALSE(cache.Find(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "other"), 0, &auth));
+}
+
+TEST(AuthCache, bounded) {
+  fastocloud::server::http::AuthCache cache(kTTL, 4);
+  for (int i = 0; i < 10; ++i) {
+    cache.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, std::to_string(i)), MakeAuth(),
+                 i);
+  }
+  ASSERT_EQ(cache.GetSize(), 4);
+
+  fastocloud::server::http::AuthCache disabled(0, 4);
+  disabled.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, kDevice), MakeAuth(), 0);
+  ASSERT_EQ(disabled.GetSize(), 0);
+}
+
+TEST(AuthCache, full_cache_evicts_oldest) {
+  fastocloud::server::http::AuthCache cache(kTTL, 4);
+  for (int i = 0; i < 4; ++i) {
+    cache.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, std::to_string(i)), MakeAuth(),
+                 i);
+  }
+  // refreshed entry is the newest one
+  cache.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "0"), MakeAuth(), 4);
+  cache.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "4"), MakeAuth(), 5);
+  ASSERT_EQ(cache.GetSize(), 4u);
+
+  fastocloud::server::base::ServerDBAuthInfo auth;
+  ASSERT_FALSE(cache.Find(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "1"), 6, &auth));
+  ASSERT_TRUE(cache.Find(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "0"), 6, &auth));
+  ASSERT_TRUE(cache.Find(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "4"), 6, &auth));
+
+  // expired entries leave before live ones are evicted
+  cache.Insert(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "5"), MakeAuth(), kTTL + 3);
+  ASSERT_EQ(cache.GetSize(), 3u);
+  ASSERT_TRUE(cache.Find(fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, "0"), kTTL + 3, &auth));
+}
+
+TEST(AuthCache, key_hides_password) {
+  const std::string key = fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, kDevice);
+  ASSERT_EQ(key.find(kPassword), std::string::npos);
+  ASSERT_NE(key, fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, "wrong", kDevice));
+}
+
+TEST(AuthCache, player_fetching_segments_is_not_throttled) {
+  // new connection per segment for ten minutes, the way http handler authorizes it
+  fastocloud::server::base::AdmissionControl admission(kPerHost, kPerUser, kPerDevice);
+  fastocloud::server::http::AuthCache cache(kTTL, 16);
+  const std::string key = fastocloud::server::http::AuthCache::MakeKey(kHost, kUser, kPassword, kDevice);
+  size_t logins = 0;
+  for (common::time64_t now = 0; now < 10 * 60 * 1000; now += kSegmentDuration) {
+    fastocloud::server::base::ServerDBAuthInfo auth;
+    if (cache.Find(key, now, &auth)) {
+      continue;
+    }
+    ASSERT_TRUE(admission.Admit(kHost, kUser, kDevice, now)) << "throttled at " << now;
+    cache.Insert(key, MakeAuth(), now);
+    logins++;
+  }
+  ASSERT_EQ(logins, 20);
+}
+
+TEST(AuthCache, segments_without_cache_are_throttled) {
+  // separate audio and video renditions with every segment rate limited, device budget runs out
+  fastocloud::server::base::AdmissionControl admission(kPerHost, kPerUser, kPerDevice);
+  size_t rejected = 0;
+  for (common::time64_t now = 0; now < 10 * 60 * 1000; now += kSegmentDuration / 2) {
+    if (!admission.Admit(kHost, kUser, kDevice, now)) {
+      rejected++;
+    }
+  }
+  ASSERT_GT(rejected, 0);
+}
+
+TEST(TokenBucketTable, full_table_keeps_active_buckets) {
+  // one token per minute, exhausted key has to stay exhausted while unique keys flood the table
+  fastocloud::server::base::TokenBucketTable table(1, 2, 64);
+  ASSERT_TRUE(table.Consume(kHost, 0));
+  ASSERT_TRUE(table.Consume(kHost, 0));
+  for (int i = 0; i < 50000; ++i) {
+    ASSERT_TRUE(table.Consume(std::to_string(i), i));
+    if (i % 16 == 0) {
+      ASSERT_FALSE(table.Consume(kHost, i)) << "active bucket reset at " << i;
+    }
+  }
+  ASSERT_LE(table.GetSize(), 96);
+}
+
+TEST(TokenBucketTable, full_buckets_are_dropped) {
+  fastocloud::server::base::TokenBucketTable table(60, 1, 64);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(table.Consume(std::to_string(i), i * 1000));
+  }
+  // every bucket but the last one refilled in a second
+  ASSERT_LE(table.GetSize(), 64);
+  ASSERT_FALSE(table.Consume("999", 999 * 1000));
+}
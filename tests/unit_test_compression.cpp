@@ -0,0 +1,148 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include <zlib.h>
+
+#include "subscribers/compression.h"
+
+namespace {
+namespace subscribers = fastocloud::server::subscribers;
+typedef subscribers::DeflateCompressor DeflateCompressor;
+
+uint32_t ReadChunkHeader(const std::string& chunk) {
+  const unsigned char* header = reinterpret_cast<const unsigned char*>(chunk.data());
+  return (static_cast<uint32_t>(header[0]) << 24) | (static_cast<uint32_t>(header[1]) << 16) |
+         (static_cast<uint32_t>(header[2]) << 8) | header[3];
+}
+
+// client side of a chunk, raw inflate with the preset dictionary
+bool InflateChunk(const std::string& chunk, size_t size, std::string* out) {
+  const uint32_t header = ReadChunkHeader(chunk);
+  const std::string body = chunk.substr(subscribers::compression_chunk_header_size);
+  if (header & subscribers::kCompressionStoredChunkFlag) {
+    *out = body;
+    return (header & ~subscribers::kCompressionStoredChunkFlag) == body.size();
+  }
+  if (header != body.size()) {
+    return false;
+  }
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -15) != Z_OK) {
+    return false;
+  }
+  bool ok = inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(subscribers::kCompressionDictionary),
+                                 subscribers::kCompressionDictionarySize) == Z_OK;
+  out->resize(size);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+  stream.avail_in = body.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  stream.avail_out = size;
+  ok = ok && inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0;
+  inflateEnd(&stream);
+  return ok;
+}
+
+std::string MakeChannelsResponse(size_t channels) {
+  std::string response = "{\"jsonrpc\":\"2.0\",\"id\":\"00000000000001\",\"result\":{\"channels\":[";
+  for (size_t i = 0; i < channels; ++i) {
+    const std::string id = std::to_string(1000 + i);
+    response += i ? ",{" : "{";
+    response += "\"id\":\"" + id + "\",\"epg\":{\"id\":\"channel" + id + "\",\"display_name\":\"Channel " + id +
+                "\",\"icon\":\"https://fastocloud.com/images/unknown_channel.png\",\"urls\":[\"http://localhost:8000/" +
+                id + "/0/master.m3u8\"],\"programs\":[]},\"group\":\"News\",\"iarc\":18,\"favorite\":false,"
+                "\"recent\":0,\"interruption_time\":0,\"video\":true,\"audio\":true,\"parts\":[]}";
+  }
+  response += "],\"vods\":[],\"catchups\":[]}}";
+  return response;
+}
+}  // namespace
+
+TEST(Compression, round_trip) {
+  DeflateCompressor compressor;
+  const size_t counts[] = {1, 10, 1000};
+  for (size_t count : counts) {
+    const std::string response = MakeChannelsResponse(count);
+    std::string chunk;
+    ASSERT_FALSE(compressor.CompressChunk(response.data(), response.size(), &chunk));
+    ASSERT_FALSE(ReadChunkHeader(chunk) & subscribers::kCompressionStoredChunkFlag);
+    ASSERT_LT(chunk.size(), response.size() / 2);
+
+    std::string inflated;
+    ASSERT_TRUE(InflateChunk(chunk, response.size(), &inflated)) << count;
+    ASSERT_EQ(inflated, response);
+  }
+}
+
+TEST(Compression, chunks_are_independent) {
+  // one compressor per loop serves every connection, each chunk must inflate on its own
+  DeflateCompressor* compressor = DeflateCompressor::GetThreadInstance();
+  ASSERT_EQ(compressor, DeflateCompressor::GetThreadInstance());
+  const std::string first = MakeChannelsResponse(3);
+  const std::string second = MakeChannelsResponse(5);
+  std::string first_chunk;
+  std::string second_chunk;
+  ASSERT_FALSE(compressor->CompressChunk(first.data(), first.size(), &first_chunk));
+  ASSERT_FALSE(compressor->CompressChunk(second.data(), second.size(), &second_chunk));
+
+  std::string inflated;
+  ASSERT_TRUE(InflateChunk(second_chunk, second.size(), &inflated));
+  ASSERT_EQ(inflated, second);
+  ASSERT_TRUE(InflateChunk(first_chunk, first.size(), &inflated));
+  ASSERT_EQ(inflated, first);
+}
+
+TEST(Compression, stored_chunks) {
+  DeflateCompressor compressor;
+  const std::string small = "{\"id\":\"1\",\"result\":\"pong\"}";
+  ASSERT_LT(small.size(), subscribers::compression_min_chunk_size);
+  std::string chunk;
+  ASSERT_FALSE(compressor.CompressChunk(small.data(), small.size(), &chunk));
+  ASSERT_EQ(ReadChunkHeader(chunk), small.size() | subscribers::kCompressionStoredChunkFlag);
+  std::string stored;
+  ASSERT_TRUE(InflateChunk(chunk, small.size(), &stored));
+  ASSERT_EQ(stored, small);
+
+  // random bytes don't shrink, they are stored too
+  std::string noise(4096, 0);
+  uint32_t state = 1;
+  for (size_t i = 0; i < noise.size(); ++i) {
+    state = state * 1103515245 + 12345;
+    noise[i] = static_cast<char>(state >> 24);
+  }
+  ASSERT_FALSE(compressor.CompressChunk(noise.data(), noise.size(), &chunk));
+  ASSERT_EQ(ReadChunkHeader(chunk), noise.size() | subscribers::kCompressionStoredChunkFlag);
+  ASSERT_TRUE(InflateChunk(chunk, noise.size(), &stored));
+  ASSERT_EQ(stored, noise);
+
+  ASSERT_TRUE(compressor.CompressChunk(nullptr, 1, &chunk));
+  ASSERT_TRUE(compressor.CompressChunk(small.data(), small.size(), nullptr));
+}
+
+TEST(Compression, switch_marker) {
+  char marker[subscribers::compression_marker_size];
+  subscribers::MakeCompressionMarker(subscribers::DEFLATE_COMPRESSION, marker);
+  ASSERT_EQ(static_cast<uint8_t>(marker[0]), 0xFF);
+  ASSERT_EQ(marker[1], 'Z');
+  ASSERT_EQ(marker[2], subscribers::DEFLATE_COMPRESSION);
+  ASSERT_EQ(static_cast<uint8_t>(marker[3]), subscribers::kCompressionDictionaryVersion);
+}
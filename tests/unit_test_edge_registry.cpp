@@ -0,0 +1,235 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/edge_registry.h"
+
+namespace {
+const char kStreamUrl[] = "http://upstream.example.com:8080/live/5e1a5b2f8b1c9a0001234567/0/master.m3u8?token=abc";
+const uint32_t kLoadFactor = 125;
+const uint32_t kReportTimeout = 30;
+const common::time64_t kReportTimeoutMsec = kReportTimeout * 1000;
+const common::time64_t kNow = 1600000000000;
+
+std::vector<std::string> MakeOrigins() {
+  return fastocloud::server::base::ParseEdgeOrigins("http://upstream.example.com:8080");
+}
+
+fastocloud::server::base::EdgeNode MakeReport(const std::string& id, uint32_t connections, uint32_t capacity) {
+  fastocloud::server::base::EdgeNode node;
+  node.id = id;
+  node.url = "http://" + id + ".example.com";
+  node.connections = connections;
+  node.capacity = capacity;
+  return node;
+}
+
+std::string MakeStreamKey(size_t index) {
+  return "stream_" + std::to_string(index);
+}
+
+// edge id selected for every key, keys without edge are skipped
+std::map<std::string, std::string> SelectEdges(fastocloud::server::base::EdgeRegistry* registry, size_t keys) {
+  std::map<std::string, std::string> result;
+  for (size_t i = 0; i < keys; ++i) {
+    fastocloud::server::base::EdgeNode edge;
+    if (registry->SelectEdge(MakeStreamKey(i), &edge)) {
+      result[MakeStreamKey(i)] = edge.id;
+    }
+  }
+  return result;
+}
+}  // namespace
+
+TEST(EdgeRegistry, replace_url_origin) {
+  ASSERT_EQ(fastocloud::server::base::ReplaceUrlOrigin(kStreamUrl, "https://edge1.example.com/"),
+            "https://edge1.example.com/live/5e1a5b2f8b1c9a0001234567/0/master.m3u8?token=abc");
+  ASSERT_EQ(fastocloud::server::base::ReplaceUrlOrigin("http://upstream.example.com", "http://edge1.example.com"),
+            "http://edge1.example.com");
+  ASSERT_EQ(fastocloud::server::base::ReplaceUrlOrigin("/live/master.m3u8", "http://edge1.example.com"),
+            "/live/master.m3u8");
+}
+
+TEST(EdgeRegistry, url_origin) {
+  ASSERT_EQ(fastocloud::server::base::GetUrlOrigin("HTTP://Upstream.Example.com:8080/live?a=b"),
+            "http://upstream.example.com:8080");
+  ASSERT_EQ(fastocloud::server::base::GetUrlOrigin("http://upstream.example.com?a=b"), "http://upstream.example.com");
+  ASSERT_EQ(fastocloud::server::base::GetUrlOrigin("http://"), "");
+  ASSERT_EQ(fastocloud::server::base::GetUrlOrigin("upstream.example.com/live"), "");
+
+  const std::vector<std::string> origins =
+      fastocloud::server::base::ParseEdgeOrigins("http://a.example.com/,,invalid,https://B.example.com:8443");
+  ASSERT_EQ(origins.size(), 2u);
+  ASSERT_EQ(origins[0], "http://a.example.com");
+  ASSERT_EQ(origins[1], "https://b.example.com:8443");
+
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::LEAST_CONNECTIONS,
+                                                  kLoadFactor, kReportTimeout, MakeOrigins());
+  ASSERT_TRUE(registry.IsBalancedUrl(kStreamUrl));
+  ASSERT_FALSE(registry.IsBalancedUrl("http://upstream.example.com/live/master.m3u8"));
+  ASSERT_FALSE(registry.IsBalancedUrl("http://other.example.com:8080/live/master.m3u8"));
+}
+
+TEST(EdgeRegistry, parse_static_edges) {
+  const std::vector<fastocloud::server::base::EdgeNode> edges =
+      fastocloud::server::base::ParseStaticEdges("http://e1.example.com;100,http://e2.example.com,,bad;x,http://e3;0");
+  ASSERT_EQ(edges.size(), 3u);
+  ASSERT_EQ(edges[0].id, "http://e1.example.com");
+  ASSERT_EQ(edges[0].url, "http://e1.example.com");
+  ASSERT_EQ(edges[0].capacity, 100u);
+  ASSERT_EQ(edges[1].id, "http://e2.example.com");
+  ASSERT_EQ(edges[1].capacity, 0u);
+  ASSERT_EQ(edges[2].id, "http://e3");
+  ASSERT_EQ(edges[2].capacity, 0u);
+  ASSERT_TRUE(fastocloud::server::base::ParseStaticEdges("").empty());
+}
+
+TEST(EdgeRegistry, ring_is_stable_when_edge_leaves) {
+  // load factor high enough that bounds never spill streams
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::LEAST_CONNECTIONS, 100000,
+                                                  kReportTimeout, MakeOrigins());
+  const char* ids[] = {"edge1", "edge2", "edge3", "edge4"};
+  for (const char* id : ids) {
+    ASSERT_TRUE(registry.Report(MakeReport(id, 0, 0), kNow));
+  }
+  const std::map<std::string, std::string> before = SelectEdges(&registry, 1000);
+  ASSERT_EQ(before.size(), 1000u);
+
+  fastocloud::server::base::EdgeNode leaving = MakeReport("edge4", 0, 0);
+  leaving.healthy = false;
+  for (const char* id : ids) {
+    ASSERT_TRUE(registry.Report(id == std::string("edge4") ? leaving : MakeReport(id, 0, 0), kNow + 1));
+  }
+  const std::map<std::string, std::string> after = SelectEdges(&registry, 1000);
+  ASSERT_EQ(after.size(), 1000u);
+
+  size_t moved = 0;
+  for (const auto& stream : before) {
+    const std::string& edge = after.find(stream.first)->second;
+    ASSERT_NE(edge, "edge4");
+    if (stream.second != "edge4") {
+      ASSERT_EQ(edge, stream.second) << stream.first;
+    } else {
+      moved++;
+    }
+  }
+  ASSERT_GT(moved, 0u);
+}
+
+TEST(EdgeRegistry, bound_is_respected) {
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::LEAST_CONNECTIONS,
+                                                  kLoadFactor, kReportTimeout, MakeOrigins());
+  const size_t edges_count = 4;
+  for (size_t i = 0; i < edges_count; ++i) {
+    ASSERT_TRUE(registry.Report(MakeReport("edge" + std::to_string(i), 0, 0), kNow));
+  }
+
+  // one hot stream, viewers spill over to next edges on the ring
+  const size_t viewers = 1000;
+  std::map<std::string, size_t> loads;
+  for (size_t i = 0; i < viewers; ++i) {
+    fastocloud::server::base::EdgeNode edge;
+    ASSERT_TRUE(registry.SelectEdge("hot_stream", &edge));
+    loads[edge.id]++;
+  }
+
+  const size_t bound = static_cast<size_t>(ceil(kLoadFactor / 100.0 * viewers / edges_count));
+  ASSERT_EQ(loads.size(), edges_count);
+  for (const auto& load : loads) {
+    ASSERT_LE(load.second, bound) << load.first;
+  }
+}
+
+TEST(EdgeRegistry, capacity_cutoff) {
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::LEAST_CONNECTIONS,
+                                                  kLoadFactor, kReportTimeout, MakeOrigins());
+  fastocloud::server::base::EdgeNode small;
+  small.id = small.url = "http://small.example.com";
+  small.capacity = 5;
+  registry.AddStatic(small);
+  ASSERT_TRUE(registry.Report(MakeReport("full", 10, 10), kNow));
+
+  std::map<std::string, size_t> loads;
+  for (size_t i = 0; i < 5; ++i) {
+    fastocloud::server::base::EdgeNode edge;
+    ASSERT_TRUE(registry.SelectEdge(MakeStreamKey(i), &edge));
+    loads[edge.id]++;
+  }
+  ASSERT_EQ(loads[small.id], 5u);
+
+  fastocloud::server::base::EdgeNode edge;
+  ASSERT_FALSE(registry.SelectEdge(MakeStreamKey(5), &edge));
+}
+
+TEST(EdgeRegistry, fallback_to_least_loaded) {
+  // busy edge is far over its bound, the other one is full, so no edge passes ring walk
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::LEAST_CONNECTIONS,
+                                                  kLoadFactor, kReportTimeout, MakeOrigins());
+  ASSERT_TRUE(registry.Report(MakeReport("busy", 1000, 0), kNow));
+  ASSERT_TRUE(registry.Report(MakeReport("full", 10, 10), kNow));
+  for (size_t i = 0; i < 100; ++i) {
+    fastocloud::server::base::EdgeNode edge;
+    ASSERT_TRUE(registry.SelectEdge(MakeStreamKey(i), &edge));
+    ASSERT_EQ(edge.id, "busy");
+  }
+}
+
+TEST(EdgeRegistry, response_time_without_reports) {
+  // static edge never reports response time, it counts with average of reporting edges
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::RESPONSE_TIME, kLoadFactor,
+                                                  kReportTimeout, MakeOrigins());
+  fastocloud::server::base::EdgeNode silent;
+  silent.id = silent.url = "http://silent.example.com";
+  registry.AddStatic(silent);
+  fastocloud::server::base::EdgeNode reporting = MakeReport("reporting", 0, 0);
+  reporting.response_time = 40;
+  ASSERT_TRUE(registry.Report(reporting, kNow));
+
+  std::map<std::string, size_t> loads;
+  for (const auto& stream : SelectEdges(&registry, 1000)) {
+    loads[stream.second]++;
+  }
+  ASSERT_GT(loads[silent.id], 400u);
+  ASSERT_GT(loads["reporting"], 400u);
+}
+
+TEST(EdgeRegistry, learned_edges_are_bounded_and_forgotten) {
+  fastocloud::server::base::EdgeRegistry registry(fastocloud::server::base::EdgeRegistry::LEAST_CONNECTIONS,
+                                                  kLoadFactor, kReportTimeout, MakeOrigins());
+  for (size_t i = 0; i < fastocloud::server::base::EdgeRegistry::max_edges; ++i) {
+    ASSERT_TRUE(registry.Report(MakeReport("edge" + std::to_string(i), 0, 0), kNow));
+  }
+  ASSERT_FALSE(registry.Report(MakeReport("one_too_many", 0, 0), kNow));
+  ASSERT_TRUE(registry.Report(MakeReport("edge0", 1, 0), kNow));
+
+  // silent edges become unhealthy first, then are removed
+  registry.Expire(kNow + kReportTimeoutMsec + 1);
+  fastocloud::server::base::EdgeNode edge;
+  ASSERT_FALSE(registry.SelectEdge(MakeStreamKey(0), &edge));
+  ASSERT_EQ(registry.GetEdges().size(), fastocloud::server::base::EdgeRegistry::max_edges);
+
+  const common::time64_t forget_msec = kReportTimeoutMsec * fastocloud::server::base::EdgeRegistry::forget_timeouts;
+  registry.Expire(kNow + forget_msec + 1);
+  ASSERT_TRUE(registry.GetEdges().empty());
+  ASSERT_TRUE(registry.Report(MakeReport("one_too_many", 0, 0), kNow + forget_msec + 1));
+  ASSERT_TRUE(registry.SelectEdge(MakeStreamKey(0), &edge));
+  ASSERT_EQ(edge.id, "one_too_many");
+}
@@ -0,0 +1,137 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <json-c/json_object.h>
+
+#include "base/json_rpc_parser.h"
+
+namespace {
+typedef fastocloud::server::base::JsonRpcFrame JsonRpcFrame;
+typedef fastocloud::server::base::JsonRpcParser JsonRpcParser;
+
+std::string MakeNestedParams(size_t depth) {
+  return "{\"id\":\"1\",\"method\":\"nested\",\"params\":" + std::string(depth, '[') + std::string(depth, ']') + "}";
+}
+}  // namespace
+
+TEST(JsonRpcParser, request_and_response) {
+  JsonRpcParser parser;
+  JsonRpcFrame frame;
+  ASSERT_FALSE(
+      parser.Parse("{\"jsonrpc\":\"2.0\",\"id\":\"1\",\"method\":\"client_ping\",\"params\":{\"a\":1}}", &frame));
+  ASSERT_TRUE(frame.IsRequest());
+  ASSERT_TRUE(frame.IsMethod("client_ping"));
+  ASSERT_FALSE(frame.IsMethod("client_pin"));
+  ASSERT_TRUE(frame.params);
+  ASSERT_TRUE(json_object_is_type(frame.params, json_type_object));
+
+  ASSERT_FALSE(parser.Parse("{\"jsonrpc\":\"2.0\",\"id\":\"2\",\"result\":\"pong\"}", &frame));
+  ASSERT_TRUE(frame.IsResponse());
+  ASSERT_TRUE(frame.IsMessage());
+  ASSERT_FALSE(frame.method);
+  ASSERT_FALSE(frame.params);
+  ASSERT_STREQ(json_object_get_string(frame.result), "pong");
+
+  ASSERT_FALSE(
+      parser.Parse("{\"jsonrpc\":\"2.0\",\"id\":\"3\",\"error\":{\"code\":-1,\"message\":\"Not found\"}}", &frame));
+  ASSERT_TRUE(frame.IsResponse());
+  ASSERT_TRUE(frame.IsError());
+  ASSERT_FALSE(frame.IsMessage());
+  ASSERT_EQ(frame.GetErrorDescription(), "Not found");
+}
+
+TEST(JsonRpcParser, malformed_frames) {
+  const char* frames[] = {"",
+                          "{",
+                          "{\"id\":\"1\",\"method\":",
+                          "not json",
+                          "[{\"id\":\"1\",\"method\":\"client_ping\"}]",
+                          "\"client_ping\"",
+                          "{\"id\":\"1\",\"method\":5}",
+                          "{\"id\":\"1\",\"method\":null}",
+                          "{\"id\":\"1\"}",
+                          "{\"id\":\"1\",\"params\":{}}"};
+  JsonRpcParser parser;
+  for (const char* data : frames) {
+    JsonRpcFrame frame;
+    ASSERT_TRUE(parser.Parse(data, &frame)) << data;
+    ASSERT_FALSE(frame.method) << data;
+  }
+
+  // tokener is reset between frames, garbage doesn't leak into the next one
+  JsonRpcFrame frame;
+  ASSERT_TRUE(parser.Parse("{\"id\":\"1\",\"method\":\"client_", &frame));
+  ASSERT_FALSE(parser.Parse("{\"id\":\"2\",\"method\":\"client_ping\"}", &frame));
+  ASSERT_TRUE(frame.IsMethod("client_ping"));
+  ASSERT_TRUE(parser.Parse("{\"id\":\"1\",\"method\":\"client_ping\"}", nullptr));
+}
+
+TEST(JsonRpcParser, nesting_limit) {
+  JsonRpcParser parser;
+  JsonRpcFrame frame;
+  ASSERT_FALSE(parser.Parse(MakeNestedParams(16), &frame));
+  ASSERT_TRUE(frame.IsMethod("nested"));
+  ASSERT_TRUE(json_object_is_type(frame.params, json_type_array));
+
+  // deeper than default tokener depth of 32 is refused instead of recursing
+  ASSERT_TRUE(parser.Parse(MakeNestedParams(64), &frame));
+  ASSERT_FALSE(frame.method);
+  ASSERT_TRUE(parser.Parse(MakeNestedParams(100000), &frame));
+}
+
+TEST(JsonRpcParser, escapes) {
+  JsonRpcParser parser;
+  JsonRpcFrame frame;
+  ASSERT_FALSE(parser.Parse(
+      "{\"id\":\"1\",\"method\":\"client_\\u0070ing\",\"params\":{\"name\":\"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\"}}",
+      &frame));
+  ASSERT_TRUE(frame.IsMethod("client_ping"));
+  json_object* jname = nullptr;
+  ASSERT_TRUE(json_object_object_get_ex(frame.params, "name", &jname));
+  ASSERT_STREQ(json_object_get_string(jname), "a\"b\\c\n\xc3\xa9\xf0\x9f\x98\x80");
+
+  ASSERT_FALSE(parser.Parse("{\"id\":\"1\",\"error\":{\"message\":\"line\\tbreak\\/\"}}", &frame));
+  ASSERT_EQ(frame.GetErrorDescription(), "line\tbreak/");
+
+  ASSERT_TRUE(parser.Parse("{\"id\":\"1\",\"method\":\"client_\\x70ing\"}", &frame));
+}
+
+TEST(JsonRpcParser, id_types) {
+  JsonRpcParser parser;
+  JsonRpcFrame frame;
+  ASSERT_FALSE(parser.Parse("{\"id\":\"abc\",\"method\":\"client_ping\"}", &frame));
+  ASSERT_TRUE(frame.id);
+  ASSERT_EQ(*frame.id, "abc");
+
+  // numbers are accepted in their textual form
+  ASSERT_FALSE(parser.Parse("{\"id\":42,\"method\":\"client_ping\"}", &frame));
+  ASSERT_TRUE(frame.id);
+  ASSERT_EQ(*frame.id, "42");
+
+  // notifications, id is absent or null
+  ASSERT_FALSE(parser.Parse("{\"id\":null,\"method\":\"client_ping\"}", &frame));
+  ASSERT_FALSE(frame.id);
+  ASSERT_FALSE(parser.Parse("{\"method\":\"client_ping\"}", &frame));
+  ASSERT_FALSE(frame.id);
+
+  // previous frame id doesn't survive a failed parse
+  ASSERT_FALSE(parser.Parse("{\"id\":\"7\",\"result\":{}}", &frame));
+  ASSERT_TRUE(frame.id);
+  ASSERT_TRUE(parser.Parse("{", &frame));
+  ASSERT_FALSE(frame.id);
+}
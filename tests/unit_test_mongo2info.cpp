@@ -0,0 +1,102 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "stream_documents.h"
+
+#include "mongo/mongo2info.h"
+
+namespace {
+const uint32_t kOutputs = 2;
+const size_t kDecodes = 1000;
+// decode may pay for oid to string conversions and its scratch strings on top of what building info costs
+const size_t kDecodeOverheadAllocations = 4;
+
+// allocations of building the same channel info from literals, the floor any decode has to pay
+size_t CountChannelInfoAllocations(fastotv::commands_info::ChannelInfo* chan) {
+  std::vector<fastotv::OutputUri> outputs;
+  outputs.reserve(kOutputs);
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (uint32_t i = 0; i < kOutputs; ++i) {
+    outputs.push_back(fastotv::OutputUri(i, common::uri::Url(fastocloud::server::tests::MakeOutputUrl(i))));
+    outputs.back().SetHttpRoot(
+        common::file_system::ascii_directory_string_path(fastocloud::server::tests::MakeOutputHttpRoot()));
+  }
+
+  fastotv::commands_info::EpgInfo epg;
+  epg.SetTvgID(fastocloud::server::tests::kChannelTvgID);
+  epg.SetDisplayName(fastocloud::server::tests::kStreamName);
+  epg.SetIconUrl(common::uri::Url(fastocloud::server::tests::kChannelTvgLogo));
+  epg.SetUrls(fastocloud::server::mongo::details::MakeUrlsFromOutput(outputs));
+  fastotv::commands_info::StreamBaseInfo::parts_t parts;
+  parts.push_back(fastocloud::server::tests::kPartID);
+  *chan = fastotv::commands_info::ChannelInfo(fastocloud::server::tests::kStreamID,
+                                              fastocloud::server::tests::kStreamGroup,
+                                              fastocloud::server::tests::kStreamIARC, false, false, 0, epg, true, true,
+                                              parts);
+  return fastocloud::server::tests::GetAllocationsCount() - start_allocations;
+}
+}  // namespace
+
+TEST(Mongo2Info, MakeChannelInfo) {
+  bson_t* doc = fastocloud::server::tests::MakeChannelDocument(kOutputs);
+  fastotv::commands_info::ChannelInfo chan;
+  ASSERT_TRUE(fastocloud::server::mongo::MakeChannelInfo(doc, fastotv::RELAY,
+                                                         fastocloud::server::mongo::UserStreamInfo(), &chan));
+  ASSERT_EQ(chan.GetStreamID(), fastocloud::server::tests::kStreamID);
+  ASSERT_EQ(chan.GetGroup(), fastocloud::server::tests::kStreamGroup);
+  ASSERT_EQ(chan.GetIARC(), fastocloud::server::tests::kStreamIARC);
+  ASSERT_EQ(chan.GetParts().size(), 1u);
+  ASSERT_EQ(chan.GetEpg().GetUrls().size(), kOutputs);
+  bson_destroy(doc);
+}
+
+TEST(Mongo2Info, GetOutputUrlDataReusesVector) {
+  bson_t* doc = fastocloud::server::tests::MakeChannelDocument(kOutputs);
+  std::vector<fastotv::OutputUri> urls;
+  for (size_t i = 0; i < 2; ++i) {
+    bson_iter_t iter;
+    ASSERT_TRUE(bson_iter_init_find(&iter, doc, STREAM_OUTPUT_FIELD));
+    ASSERT_TRUE(fastocloud::server::mongo::GetOutputUrlData(&iter, &urls));
+    ASSERT_EQ(urls.size(), kOutputs);
+  }
+  ASSERT_EQ(urls[1].GetID(), 1);
+  bson_destroy(doc);
+}
+
+TEST(Mongo2Info, AllocationsPerDecodedStream) {
+  // regression guard, copies of the output urls or of the whole info per stream break it
+  bson_t* doc = fastocloud::server::tests::MakeChannelDocument(kOutputs);
+  fastotv::commands_info::ChannelInfo chan;
+  const fastocloud::server::mongo::UserStreamInfo uinfo;
+  ASSERT_TRUE(fastocloud::server::mongo::MakeChannelInfo(doc, fastotv::RELAY, uinfo, &chan));  // warms scratch
+  const size_t start_allocations = fastocloud::server::tests::GetAllocationsCount();
+  for (size_t i = 0; i < kDecodes; ++i) {
+    ASSERT_TRUE(fastocloud::server::mongo::MakeChannelInfo(doc, fastotv::RELAY, uinfo, &chan));
+  }
+  const size_t allocations_per_stream =
+      (fastocloud::server::tests::GetAllocationsCount() - start_allocations) / kDecodes;
+
+  fastotv::commands_info::ChannelInfo reference;
+  const size_t reference_allocations = CountChannelInfoAllocations(&reference);
+  ASSERT_EQ(reference.GetStreamID(), chan.GetStreamID());
+  ASSERT_EQ(reference.GetEpg().GetUrls().size(), chan.GetEpg().GetUrls().size());
+  ASSERT_LE(allocations_per_stream, reference_allocations + kDecodeOverheadAllocations);
+  bson_destroy(doc);
+}
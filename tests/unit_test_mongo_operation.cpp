@@ -0,0 +1,83 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "mongo/mongo_operation.h"
+
+namespace {
+std::string MakeShape(bson_t* query) {
+  const std::string shape = fastocloud::server::mongo::MakeQueryShape(query);
+  bson_destroy(query);
+  return shape;
+}
+}  // namespace
+
+TEST(MakeQueryShape, values_become_placeholders) {
+  ASSERT_EQ(MakeShape(BCON_NEW("login", BCON_UTF8("user@fastogt.com"), "status", BCON_INT32(1), "exp",
+                               BCON_DATE_TIME(1580000000000), "active", BCON_BOOL(true), "note", BCON_NULL)),
+            "{login: ?, status: ?, exp: ?, active: ?, note: ?}");
+
+  // same query with other values has the same shape
+  ASSERT_EQ(MakeShape(BCON_NEW("login", BCON_UTF8("other"), "status", BCON_INT32(2))),
+            MakeShape(BCON_NEW("login", BCON_UTF8("user"), "status", BCON_INT32(0))));
+
+  bson_oid_t oid;
+  bson_oid_init_from_string(&oid, "5e0000000000000000000001");
+  ASSERT_EQ(MakeShape(BCON_NEW("_id", BCON_OID(&oid))), "{_id: ?}");
+}
+
+TEST(MakeQueryShape, nested_documents_keep_keys) {
+  ASSERT_EQ(MakeShape(BCON_NEW("$set", "{", "devices.$.status", BCON_INT32(1), "}")), "{$set: {devices.$.status: ?}}");
+  ASSERT_EQ(MakeShape(BCON_NEW("created", "{", "$gte", BCON_INT64(1), "$lt", BCON_INT64(2), "}")),
+            "{created: {$gte: ?, $lt: ?}}");
+  ASSERT_EQ(MakeShape(BCON_NEW("empty", "{", "}")), "{empty: {}}");
+}
+
+TEST(MakeQueryShape, arrays_show_first_element) {
+  ASSERT_EQ(MakeShape(BCON_NEW("_id", "{", "$in", "[", BCON_UTF8("a"), BCON_UTF8("b"), BCON_UTF8("c"), "]", "}")),
+            "{_id: {$in: [?, ...]}}");
+  ASSERT_EQ(MakeShape(BCON_NEW("_id", "{", "$in", "[", BCON_UTF8("a"), "]", "}")), "{_id: {$in: [?]}}");
+  ASSERT_EQ(MakeShape(BCON_NEW("_id", "{", "$in", "[", "]", "}")), "{_id: {$in: []}}");
+
+  // list length doesn't change shape
+  ASSERT_EQ(MakeShape(BCON_NEW("sid", "{", "$in", "[", BCON_INT32(1), BCON_INT32(2), "]", "}")),
+            MakeShape(BCON_NEW("sid", "{", "$in", "[", BCON_INT32(1), BCON_INT32(2), BCON_INT32(3), "]", "}")));
+
+  ASSERT_EQ(MakeShape(BCON_NEW("$or", "[", "{", "login", BCON_UTF8("a"), "}", "{", "email", BCON_UTF8("b"), "}", "]")),
+            "{$or: [{login: ?}, ...]}");
+  ASSERT_EQ(MakeShape(BCON_NEW("matrix", "[", "[", BCON_INT32(1), BCON_INT32(2), "]", "[", BCON_INT32(3), "]", "]")),
+            "{matrix: [[?, ...], ...]}");
+}
+
+TEST(MakeQueryShape, empty_and_deep_queries) {
+  ASSERT_EQ(fastocloud::server::mongo::MakeQueryShape(nullptr), "{}");
+  ASSERT_EQ(MakeShape(bson_new()), "{}");
+
+  // innermost of ten nested documents is past the depth limit
+  bson_t* query = BCON_NEW("a", BCON_INT32(1));
+  for (int i = 0; i < 9; ++i) {
+    bson_t* outer = BCON_NEW("a", BCON_DOCUMENT(query));
+    bson_destroy(query);
+    query = outer;
+  }
+  std::string expected;
+  for (int i = 0; i < 9; ++i) {
+    expected += "{a: ";
+  }
+  expected += "{...}" + std::string(9, '}');
+  ASSERT_EQ(MakeShape(query), expected);
+}
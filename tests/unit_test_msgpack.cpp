@@ -0,0 +1,217 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/msgpack.h"
+
+namespace {
+typedef fastocloud::server::base::MsgPackReader MsgPackReader;
+typedef fastocloud::server::base::MsgPackWriter MsgPackWriter;
+}  // namespace
+
+TEST(MsgPack, int_boundaries) {
+  // first and last value of every encoding width
+  const int64_t values[] = {0, 1, 127, 128, 255, 256, 65535, 65536, UINT32_MAX, 1LL << 32, INT64_MAX,
+                            -1, -32, -33, INT8_MIN, -129, INT16_MIN, -32769, INT32_MIN, -(1LL << 32), INT64_MIN};
+  std::string packed;
+  MsgPackWriter writer(&packed);
+  for (int64_t value : values) {
+    writer.PackInt(value);
+  }
+
+  MsgPackReader reader(packed.data(), packed.size());
+  for (int64_t value : values) {
+    int64_t result = 0;
+    ASSERT_TRUE(reader.ReadInt(&result));
+    ASSERT_EQ(result, value);
+  }
+  ASSERT_TRUE(reader.IsEnd());
+}
+
+TEST(MsgPack, smallest_int_encoding) {
+  const struct {
+    int64_t value;
+    size_t size;
+  } cases[] = {{127, 1}, {128, 2}, {256, 3}, {65536, 5}, {1LL << 32, 9}, {-32, 1}, {-33, 2}, {-129, 3}, {-32769, 5},
+               {INT32_MIN - 1LL, 9}};
+  for (const auto& test : cases) {
+    std::string packed;
+    MsgPackWriter writer(&packed);
+    writer.PackInt(test.value);
+    ASSERT_EQ(packed.size(), test.size) << test.value;
+  }
+}
+
+TEST(MsgPack, string_lengths) {
+  const size_t lengths[] = {0, 31, 32, 255, 256, 65535, 65536};
+  for (size_t length : lengths) {
+    const std::string value(length, 'x');
+    std::string packed;
+    MsgPackWriter writer(&packed);
+    writer.PackString(value);
+
+    MsgPackReader reader(packed.data(), packed.size());
+    std::string result;
+    ASSERT_TRUE(reader.ReadString(&result)) << length;
+    ASSERT_EQ(result, value);
+    ASSERT_TRUE(reader.IsEnd());
+  }
+}
+
+TEST(MsgPack, containers_and_scalars) {
+  std::string packed;
+  MsgPackWriter writer(&packed);
+  writer.PackMap(3);
+  writer.PackString("id");
+  writer.PackString("1");
+  writer.PackString("values");
+  writer.PackArray(16);
+  for (int64_t i = 0; i < 16; ++i) {
+    writer.PackInt(i);
+  }
+  writer.PackString("flags");
+  writer.PackArray(2);
+  writer.PackNil();
+  writer.PackBool(true);
+
+  MsgPackReader reader(packed.data(), packed.size());
+  ASSERT_TRUE(reader.IsMapNext());
+  uint32_t size = 0;
+  ASSERT_TRUE(reader.ReadMap(&size));
+  ASSERT_EQ(size, 3);
+
+  std::string key;
+  std::string value;
+  ASSERT_TRUE(reader.ReadString(&key));
+  ASSERT_TRUE(reader.ReadString(&value));
+  ASSERT_EQ(key, "id");
+  ASSERT_EQ(value, "1");
+
+  ASSERT_TRUE(reader.ReadString(&key));
+  ASSERT_TRUE(reader.ReadArray(&size));
+  ASSERT_EQ(size, 16);
+  for (int64_t i = 0; i < 16; ++i) {
+    int64_t item = -1;
+    ASSERT_TRUE(reader.ReadInt(&item));
+    ASSERT_EQ(item, i);
+  }
+
+  ASSERT_TRUE(reader.ReadString(&key));
+  ASSERT_TRUE(reader.ReadArray(&size));
+  ASSERT_EQ(size, 2);
+  bool flag = false;
+  ASSERT_FALSE(reader.ReadBool(&flag));
+  ASSERT_TRUE(reader.ReadNil());
+  ASSERT_TRUE(reader.ReadBool(&flag));
+  ASSERT_TRUE(flag);
+  ASSERT_TRUE(reader.IsEnd());
+}
+
+TEST(MsgPack, truncated_input_keeps_position) {
+  std::string packed;
+  MsgPackWriter writer(&packed);
+  writer.PackString(std::string(40, 'x'));
+  writer.PackInt(65536);
+
+  MsgPackReader string_reader(packed.data(), 20);
+  std::string value;
+  ASSERT_FALSE(string_reader.ReadString(&value));
+  ASSERT_EQ(string_reader.GetPosition(), 0);
+
+  const size_t int_start = packed.size() - 5;
+  MsgPackReader int_reader(packed.data() + int_start, 3);
+  int64_t result = 0;
+  ASSERT_FALSE(int_reader.ReadInt(&result));
+  ASSERT_EQ(int_reader.GetPosition(), 0);
+
+  MsgPackReader empty_reader(packed.data(), 0);
+  ASSERT_TRUE(empty_reader.IsEnd());
+  ASSERT_FALSE(empty_reader.ReadNil());
+  ASSERT_FALSE(empty_reader.Skip());
+}
+
+TEST(MsgPack, rejects_wrong_types) {
+  std::string packed;
+  MsgPackWriter writer(&packed);
+  writer.PackString("text");
+  // uint64 above INT64_MAX doesn't fit the reader's type
+  packed.push_back(static_cast<char>(0xcf));
+  packed.append(8, static_cast<char>(0xff));
+
+  MsgPackReader reader(packed.data(), packed.size());
+  int64_t ivalue = 0;
+  uint32_t size = 0;
+  ASSERT_FALSE(reader.ReadInt(&ivalue));
+  ASSERT_FALSE(reader.ReadMap(&size));
+  ASSERT_FALSE(reader.ReadArray(&size));
+  ASSERT_FALSE(reader.IsMapNext());
+  ASSERT_TRUE(reader.Skip());
+  ASSERT_FALSE(reader.ReadInt(&ivalue));
+  ASSERT_TRUE(reader.Skip());
+  ASSERT_TRUE(reader.IsEnd());
+}
+
+TEST(MsgPack, skip_nested_values) {
+  std::string packed;
+  MsgPackWriter writer(&packed);
+  writer.PackMap(2);
+  writer.PackString("list");
+  writer.PackArray(3);
+  writer.PackInt(-1000);
+  writer.PackString(std::string(300, 'y'));
+  writer.PackMap(1);
+  writer.PackString("inner");
+  writer.PackNil();
+  writer.PackString("bin");
+  packed.push_back(static_cast<char>(0xc4));  // bin8 of 3 bytes, only skipped
+  packed.push_back(3);
+  packed.append("abc");
+  writer.PackBool(false);
+
+  MsgPackReader reader(packed.data(), packed.size());
+  ASSERT_TRUE(reader.Skip());
+  bool flag = true;
+  ASSERT_TRUE(reader.ReadBool(&flag));
+  ASSERT_FALSE(flag);
+  ASSERT_TRUE(reader.IsEnd());
+
+  MsgPackReader truncated(packed.data(), packed.size() - 3);
+  ASSERT_FALSE(truncated.Skip());
+}
+
+TEST(MsgPack, skip_nesting_limit) {
+  std::string allowed;
+  MsgPackWriter allowed_writer(&allowed);
+  for (int i = 0; i < 32; ++i) {
+    allowed_writer.PackArray(1);
+  }
+  allowed_writer.PackNil();
+  MsgPackReader allowed_reader(allowed.data(), allowed.size());
+  ASSERT_TRUE(allowed_reader.Skip());
+  ASSERT_TRUE(allowed_reader.IsEnd());
+
+  std::string nested;
+  MsgPackWriter nested_writer(&nested);
+  for (int i = 0; i < 33; ++i) {
+    nested_writer.PackArray(1);
+  }
+  nested_writer.PackNil();
+  MsgPackReader nested_reader(nested.data(), nested.size());
+  ASSERT_FALSE(nested_reader.Skip());
+}
@@ -0,0 +1,123 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <thread>
+#include <vector>
+
+#include "base/metrics.h"
+#include "base/object_pool.h"
+
+namespace {
+const size_t kMaxFreeBlocks = 8;
+
+class Pooled {
+ public:
+  Pooled() : value_(0) {}
+  virtual ~Pooled() {}
+
+  static void* operator new(size_t size) {
+    return fastocloud::server::base::ObjectPool<Pooled, kMaxFreeBlocks>::Allocate(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    fastocloud::server::base::ObjectPool<Pooled, kMaxFreeBlocks>::Deallocate(ptr, size);
+  }
+  static fastocloud::server::base::ObjectPoolStats GetStats() {
+    return fastocloud::server::base::ObjectPool<Pooled, kMaxFreeBlocks>::GetStats();
+  }
+
+  long double value_;
+};
+
+class Derived : public Pooled {
+ public:
+  char extra_[64];
+};
+}  // namespace
+
+TEST(ObjectPool, reuses_freed_blocks) {
+  std::thread([]() {
+    Pooled* first = new Pooled;
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(first) % alignof(long double), 0);
+    delete first;
+    Pooled* second = new Pooled;
+    ASSERT_EQ(first, second);
+    delete second;
+
+    const fastocloud::server::base::ObjectPoolStats stats = Pooled::GetStats();
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.free_blocks, 1);
+  }).join();
+}
+
+TEST(ObjectPool, free_list_is_capped) {
+  std::thread([]() {
+    std::vector<Pooled*> objects;
+    for (size_t i = 0; i < kMaxFreeBlocks * 2; ++i) {
+      objects.push_back(new Pooled);
+    }
+    for (size_t i = 0; i < objects.size(); ++i) {
+      delete objects[i];
+    }
+    ASSERT_EQ(Pooled::GetStats().free_blocks, kMaxFreeBlocks);
+  }).join();
+}
+
+TEST(ObjectPool, derived_class_bypasses_pool) {
+  std::thread([]() {
+    Pooled* derived = new Derived;
+    delete derived;
+    const fastocloud::server::base::ObjectPoolStats stats = Pooled::GetStats();
+    ASSERT_EQ(stats.misses, 0);
+    ASSERT_EQ(stats.free_blocks, 0);
+  }).join();
+}
+
+TEST(ObjectPool, foreign_blocks_are_not_cached) {
+  // objects moved to another loop are freed there, that thread must not keep them
+  std::vector<Pooled*> objects;
+  std::thread([&objects]() {
+    for (size_t i = 0; i < kMaxFreeBlocks; ++i) {
+      objects.push_back(new Pooled);
+    }
+  }).join();
+
+  std::thread([&objects]() {
+    for (size_t i = 0; i < objects.size(); ++i) {
+      delete objects[i];
+    }
+    const fastocloud::server::base::ObjectPoolStats stats = Pooled::GetStats();
+    ASSERT_EQ(stats.remote_frees, kMaxFreeBlocks);
+    ASSERT_EQ(stats.free_blocks, 0);
+  }).join();
+}
+
+TEST(ObjectPool, metrics_follow_stats) {
+  fastocloud::server::base::ObjectPoolMetrics metrics("test_pool");
+  fastocloud::server::base::ObjectPoolStats stats;
+  stats.hits = 5;
+  stats.misses = 2;
+  stats.free_blocks = 3;
+  metrics.Update(stats);
+  stats.hits = 9;
+  metrics.Update(stats);
+
+  fastocloud::server::base::MetricsRegistry& registry = fastocloud::server::base::MetricsRegistry::GetInstance();
+  ASSERT_EQ(registry.GetCounterSum("fastocloud_object_pool_hits_total"), 9);
+  ASSERT_EQ(registry.GetCounterSum("fastocloud_object_pool_misses_total"), 2);
+}
@@ -0,0 +1,117 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "subscribers/request_queues.h"
+
+namespace {
+struct Client {};
+typedef fastocloud::server::subscribers::RequestQueues<Client, std::string> queues_t;
+typedef fastocloud::server::base::LoopLagMonitor lag_t;
+}  // namespace
+
+using fastocloud::server::subscribers::BULK_REQUEST;
+using fastocloud::server::subscribers::IMMEDIATE_REQUEST;
+using fastocloud::server::subscribers::LOGIN_REQUEST;
+
+TEST(RequestQueues, ping_runs_while_bulk_pending_and_loop_degraded) {
+  queues_t queues;
+  Client client;
+  ASSERT_TRUE(queues.MustQueue(&client, BULK_REQUEST));
+  queues.Push(&client, BULK_REQUEST, "get_channels");
+  ASSERT_FALSE(queues.HasRunnable(lag_t::DEGRADED_LOAD));
+
+  // ping of client with deferred bulk request is answered right away
+  ASSERT_FALSE(queues.MustQueue(&client, IMMEDIATE_REQUEST));
+  Client* popped = nullptr;
+  std::string request;
+  ASSERT_FALSE(queues.Pop(lag_t::DEGRADED_LOAD, &popped, &request));
+  ASSERT_FALSE(queues.Pop(lag_t::OVERLOADED, &popped, &request));
+
+  ASSERT_TRUE(queues.Pop(lag_t::NORMAL_LOAD, &popped, &request));
+  ASSERT_EQ(popped, &client);
+  ASSERT_EQ(request, "get_channels");
+  ASSERT_FALSE(queues.HasQueued(&client));
+}
+
+TEST(RequestQueues, immediate_waits_behind_queued_login) {
+  queues_t queues;
+  Client client;
+  Client other;
+  queues.Push(&client, LOGIN_REQUEST, "login");
+  ASSERT_TRUE(queues.MustQueue(&client, IMMEDIATE_REQUEST));
+  ASSERT_FALSE(queues.MustQueue(&other, IMMEDIATE_REQUEST));
+  queues.Push(&client, IMMEDIATE_REQUEST, "ping");
+  queues.Push(&client, BULK_REQUEST, "get_channels");
+  ASSERT_EQ(queues.GetQueueSize(&client, BULK_REQUEST), 3u);
+  ASSERT_EQ(queues.GetQueueSize(&other, BULK_REQUEST), 0u);
+
+  // login queue runs at any load, requests of client follow their order
+  Client* popped = nullptr;
+  std::string request;
+  ASSERT_TRUE(queues.Pop(lag_t::OVERLOADED, &popped, &request));
+  ASSERT_EQ(request, "login");
+  ASSERT_TRUE(queues.Pop(lag_t::OVERLOADED, &popped, &request));
+  ASSERT_EQ(request, "ping");
+  ASSERT_TRUE(queues.Pop(lag_t::OVERLOADED, &popped, &request));
+  ASSERT_EQ(request, "get_channels");
+  ASSERT_FALSE(queues.HasQueued(&client));
+  ASSERT_FALSE(queues.MustQueue(&client, IMMEDIATE_REQUEST));
+}
+
+TEST(RequestQueues, login_before_bulk) {
+  queues_t queues;
+  Client first;
+  Client second;
+  queues.Push(&first, BULK_REQUEST, "get_channels");
+  queues.Push(&second, LOGIN_REQUEST, "login");
+  ASSERT_TRUE(queues.HasRunnable(lag_t::DEGRADED_LOAD));
+  ASSERT_EQ(queues.GetOldestLogin()->compare("login"), 0);
+
+  Client* popped = nullptr;
+  std::string request;
+  ASSERT_TRUE(queues.Pop(lag_t::NORMAL_LOAD, &popped, &request));
+  ASSERT_EQ(popped, &second);
+  ASSERT_EQ(queues.GetOldestLogin(), nullptr);
+  ASSERT_TRUE(queues.Pop(lag_t::NORMAL_LOAD, &popped, &request));
+  ASSERT_EQ(popped, &first);
+  ASSERT_FALSE(queues.Pop(lag_t::NORMAL_LOAD, &popped, &request));
+}
+
+TEST(RequestQueues, remove_client) {
+  queues_t queues;
+  Client client;
+  Client other;
+  queues.Push(&client, BULK_REQUEST, "first");
+  queues.Push(&other, BULK_REQUEST, "other");
+  queues.Push(&client, LOGIN_REQUEST, "second");
+
+  std::vector<std::string> removed;
+  queues.Remove(&client, &removed);
+  ASSERT_EQ(removed.size(), 2u);
+  ASSERT_EQ(removed[0], "first");
+  ASSERT_EQ(removed[1], "second");
+  ASSERT_FALSE(queues.HasQueued(&client));
+  ASSERT_EQ(queues.GetQueueSize(&client, BULK_REQUEST), 1u);
+
+  Client* popped = nullptr;
+  std::string request;
+  ASSERT_TRUE(queues.Pop(lag_t::NORMAL_LOAD, &popped, &request));
+  ASSERT_EQ(popped, &other);
+  ASSERT_FALSE(queues.Pop(lag_t::NORMAL_LOAD, &popped, &request));
+}
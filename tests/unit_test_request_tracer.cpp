@@ -0,0 +1,124 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "base/metrics.h"
+#include "base/request_tracer.h"
+
+namespace {
+typedef fastocloud::server::base::RequestTrace RequestTrace;
+typedef fastocloud::server::base::RequestTracer RequestTracer;
+
+std::string MakeTracePath() {
+  return "/tmp/fastocloud_unit_test_trace_" + std::to_string(getpid()) + ".json";
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+}  // namespace
+
+TEST(RequestTracer, sample_interval) {
+  RequestTracer tracer(MakeTracePath(), 4);
+  size_t sampled = 0;
+  for (uint64_t i = 0; i < 12; ++i) {
+    const RequestTrace trace = tracer.StartTrace(i);
+    if (trace.IsSampled()) {
+      ASSERT_EQ(i % 4, 0);
+      ASSERT_EQ(trace.GetID(), i / 4 + 1);
+      ASSERT_EQ(trace.GetStartTime(), i);
+      sampled++;
+    }
+  }
+  ASSERT_EQ(sampled, 3);
+
+  // zero interval traces everything
+  RequestTracer every(MakeTracePath(), 0);
+  for (uint64_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(every.StartTrace(i).IsSampled());
+  }
+}
+
+TEST(RequestTracer, not_sampled_trace_is_free) {
+  RequestTrace trace;
+  ASSERT_FALSE(trace.IsSampled());
+  trace.SetMethod("client_ping");
+  trace.AddSpan("read", "socket", 1, 2);
+  ASSERT_TRUE(trace.GetMethod().empty());
+  ASSERT_TRUE(trace.GetSpans().empty());
+
+  {
+    const fastocloud::server::base::ScopedTraceActivation activation(&trace);
+    ASSERT_FALSE(RequestTrace::GetCurrent());
+  }
+
+  RequestTrace sampled(1, 0);
+  {
+    const fastocloud::server::base::ScopedTraceActivation activation(&sampled);
+    ASSERT_EQ(RequestTrace::GetCurrent(), &sampled);
+    const fastocloud::server::base::ScopedTraceSpan span("db", "db");
+  }
+  ASSERT_FALSE(RequestTrace::GetCurrent());
+  ASSERT_EQ(sampled.GetSpans().size(), 1);
+  ASSERT_EQ(sampled.GetSpans()[0].name, "db");
+}
+
+TEST(RequestTracer, escapes_names) {
+  const std::string path = MakeTracePath();
+  RequestTracer tracer(path, 1);
+  ASSERT_FALSE(tracer.Start());
+
+  const uint64_t now = fastocloud::server::base::GetMonotonicUsec();
+  RequestTrace trace = tracer.StartTrace(now);
+  trace.SetMethod("get \"x\"\\\n\x01");
+  trace.AddSpan("parse\t", "loop", now, now + 10);
+  tracer.FinishTrace(&trace);
+  ASSERT_FALSE(trace.IsSampled());
+  tracer.Stop();
+  ASSERT_EQ(tracer.GetWritten(), 1);
+  ASSERT_EQ(tracer.GetDropped(), 0);
+
+  const std::string content = ReadFile(path);
+  unlink(path.c_str());
+  ASSERT_NE(content.find("\"name\":\"get \\\"x\\\"\\\\\\u000a\\u0001 #1\""), std::string::npos) << content;
+  ASSERT_NE(content.find("\"name\":\"get \\\"x\\\"\\\\\\u000a\\u0001\",\"cat\":\"request\""), std::string::npos)
+      << content;
+  ASSERT_NE(content.find("\"name\":\"parse\\u0009\",\"cat\":\"loop\",\"ph\":\"X\""), std::string::npos) << content;
+  ASSERT_EQ(content.substr(content.size() - 2), "]\n");
+}
+
+TEST(RequestTracer, drops_after_stop) {
+  const std::string path = MakeTracePath();
+  RequestTracer tracer(path, 1);
+  ASSERT_FALSE(tracer.Start());
+  tracer.Stop();
+  unlink(path.c_str());
+
+  RequestTrace trace = tracer.StartTrace(0);
+  ASSERT_TRUE(trace.IsSampled());
+  tracer.FinishTrace(&trace);
+  ASSERT_EQ(tracer.GetWritten(), 0);
+  ASSERT_EQ(tracer.GetDropped(), 1);
+}
@@ -0,0 +1,104 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <set>
+
+#include "base/roaring_bitmap.h"
+
+TEST(RoaringBitmap, container_boundaries) {
+  fastocloud::server::base::RoaringBitmap bitmap;
+  const uint32_t values[] = {0, 65535, 65536, 131071, 131072, UINT32_MAX};
+  for (uint32_t value : values) {
+    ASSERT_TRUE(bitmap.Add(value));
+    ASSERT_FALSE(bitmap.Add(value));
+  }
+  ASSERT_EQ(bitmap.GetCardinality(), sizeof(values) / sizeof(values[0]));
+
+  for (uint32_t value : values) {
+    ASSERT_TRUE(bitmap.Contains(value));
+  }
+  ASSERT_FALSE(bitmap.Contains(1));
+  ASSERT_FALSE(bitmap.Contains(65534));
+  ASSERT_FALSE(bitmap.Contains(65537));
+  ASSERT_FALSE(bitmap.Contains(UINT32_MAX - 1));
+
+  ASSERT_TRUE(bitmap.Remove(65535));
+  ASSERT_FALSE(bitmap.Remove(65535));
+  ASSERT_FALSE(bitmap.Contains(65535));
+  ASSERT_TRUE(bitmap.Contains(0));
+  ASSERT_TRUE(bitmap.Contains(65536));
+  ASSERT_FALSE(bitmap.Remove(65537));
+
+  for (uint32_t value : values) {
+    bitmap.Remove(value);
+  }
+  ASSERT_TRUE(bitmap.IsEmpty());
+  ASSERT_EQ(bitmap.GetCardinality(), 0);
+}
+
+TEST(RoaringBitmap, array_to_bitset_and_back) {
+  fastocloud::server::base::RoaringBitmap bitmap;
+  const uint32_t base = 3 * 65536;
+  const uint32_t count = fastocloud::server::base::RoaringBitmap::array_max_size + 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(bitmap.Add(base + i * 2));
+  }
+  // neighbours in other containers are not affected by layout switch
+  ASSERT_TRUE(bitmap.Add(base - 1));
+  ASSERT_TRUE(bitmap.Add(base + 65536));
+  const size_t bitset_memory = bitmap.GetMemoryUsage();
+  ASSERT_GE(bitset_memory, 8192);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(bitmap.Contains(base + i * 2));
+    ASSERT_FALSE(bitmap.Contains(base + i * 2 + 1));
+  }
+
+  // back to array at half of the limit
+  for (uint32_t i = 0; i < count; i += 2) {
+    ASSERT_TRUE(bitmap.Remove(base + i * 2));
+  }
+  ASSERT_LT(bitmap.GetMemoryUsage(), bitset_memory);
+  for (uint32_t i = 0; i < count; ++i) {
+    ASSERT_EQ(bitmap.Contains(base + i * 2), i % 2 == 1);
+  }
+  ASSERT_TRUE(bitmap.Contains(base - 1));
+  ASSERT_TRUE(bitmap.Contains(base + 65536));
+  ASSERT_EQ(bitmap.GetCardinality(), count / 2 + 2);
+}
+
+TEST(RoaringBitmap, matches_set) {
+  fastocloud::server::base::RoaringBitmap bitmap;
+  std::set<uint32_t> expected;
+  unsigned int seed = 42;
+  for (int i = 0; i < 200000; ++i) {
+    // dense low containers switch layouts, high values stay sparse
+    const uint32_t value = i % 4 ? rand_r(&seed) % (4 * 65536) : static_cast<uint32_t>(rand_r(&seed)) * 2;
+    if (rand_r(&seed) % 3) {
+      ASSERT_EQ(bitmap.Add(value), expected.insert(value).second);
+    } else {
+      ASSERT_EQ(bitmap.Remove(value), expected.erase(value) == 1);
+    }
+  }
+
+  ASSERT_EQ(bitmap.GetCardinality(), expected.size());
+  for (uint32_t value = 0; value < 4 * 65536; ++value) {
+    ASSERT_EQ(bitmap.Contains(value), expected.count(value) == 1);
+  }
+}
@@ -0,0 +1,130 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "base/timing_wheel.h"
+
+namespace {
+typedef fastocloud::server::base::TimingWheel::tick_t tick_t;
+const tick_t kStart = 1000;
+
+// returns tick at which node expired, 0 if it didn't until limit
+tick_t AdvanceUntilExpired(fastocloud::server::base::TimingWheel* wheel,
+                           fastocloud::server::base::TimingWheelNode* node,
+                           tick_t limit) {
+  std::vector<fastocloud::server::base::TimingWheelNode*> expired;
+  for (tick_t tick = wheel->GetCurrentTick() + 1; tick <= limit; ++tick) {
+    wheel->Advance(tick, &expired);
+    for (size_t i = 0; i < expired.size(); ++i) {
+      if (expired[i] == node) {
+        return tick;
+      }
+    }
+    expired.clear();
+  }
+  return 0;
+}
+}  // namespace
+
+TEST(TimingWheel, schedule_and_advance) {
+  fastocloud::server::base::TimingWheel wheel(kStart);
+  fastocloud::server::base::TimingWheelNode node;
+  wheel.Schedule(&node, 5);
+  ASSERT_TRUE(node.IsScheduled());
+  ASSERT_EQ(node.GetExpires(), kStart + 5);
+
+  std::vector<fastocloud::server::base::TimingWheelNode*> expired;
+  wheel.Advance(kStart + 4, &expired);
+  ASSERT_TRUE(expired.empty());
+  wheel.Advance(kStart + 5, &expired);
+  ASSERT_EQ(expired.size(), 1);
+  ASSERT_EQ(expired[0], &node);
+  ASSERT_FALSE(node.IsScheduled());
+  ASSERT_EQ(wheel.GetCurrentTick(), kStart + 5);
+}
+
+TEST(TimingWheel, delay_is_clamped) {
+  fastocloud::server::base::TimingWheel wheel(kStart);
+  fastocloud::server::base::TimingWheelNode node;
+  wheel.Schedule(&node, 0);
+  ASSERT_EQ(node.GetExpires(), kStart + 1);
+
+  wheel.Schedule(&node, fastocloud::server::base::TimingWheel::max_delay + 100);
+  ASSERT_EQ(node.GetExpires(), kStart + fastocloud::server::base::TimingWheel::max_delay);
+}
+
+TEST(TimingWheel, cascade_keeps_exact_expiration) {
+  // delays on every level and across slot boundaries of lower levels
+  const tick_t delays[] = {1, 63, 64, 65, 100, 4095, 4096, 4097, 70000, 262143, 262144, 300000};
+  for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); ++i) {
+    fastocloud::server::base::TimingWheel wheel(kStart + i * 7);
+    fastocloud::server::base::TimingWheelNode node;
+    wheel.Schedule(&node, delays[i]);
+    const tick_t expires = node.GetExpires();
+    ASSERT_EQ(AdvanceUntilExpired(&wheel, &node, expires + 1), expires) << "delay " << delays[i];
+  }
+}
+
+TEST(TimingWheel, expired_in_expiration_order) {
+  fastocloud::server::base::TimingWheel wheel(kStart);
+  fastocloud::server::base::TimingWheelNode nodes[4];
+  wheel.Schedule(&nodes[0], 200);
+  wheel.Schedule(&nodes[1], 3);
+  wheel.Schedule(&nodes[2], 70);
+  wheel.Schedule(&nodes[3], 5000);
+
+  std::vector<fastocloud::server::base::TimingWheelNode*> expired;
+  wheel.Advance(kStart + 5000, &expired);
+  ASSERT_EQ(expired.size(), 4);
+  ASSERT_EQ(expired[0], &nodes[1]);
+  ASSERT_EQ(expired[1], &nodes[2]);
+  ASSERT_EQ(expired[2], &nodes[0]);
+  ASSERT_EQ(expired[3], &nodes[3]);
+}
+
+TEST(TimingWheel, cancel_and_reschedule) {
+  fastocloud::server::base::TimingWheel wheel(kStart);
+  fastocloud::server::base::TimingWheelNode canceled;
+  fastocloud::server::base::TimingWheelNode moved;
+  wheel.Schedule(&canceled, 10);
+  wheel.Schedule(&moved, 10);
+  wheel.Cancel(&canceled);
+  ASSERT_FALSE(canceled.IsScheduled());
+  wheel.Schedule(&moved, 100);
+
+  std::vector<fastocloud::server::base::TimingWheelNode*> expired;
+  wheel.Advance(kStart + 99, &expired);
+  ASSERT_TRUE(expired.empty());
+  wheel.Advance(kStart + 100, &expired);
+  ASSERT_EQ(expired.size(), 1);
+  ASSERT_EQ(expired[0], &moved);
+}
+
+TEST(TimingWheel, destroyed_node_is_unlinked) {
+  fastocloud::server::base::TimingWheel wheel(kStart);
+  fastocloud::server::base::TimingWheelNode kept;
+  wheel.Schedule(&kept, 10);
+  {
+    fastocloud::server::base::TimingWheelNode destroyed;
+    wheel.Schedule(&destroyed, 10);
+  }
+
+  std::vector<fastocloud::server::base::TimingWheelNode*> expired;
+  wheel.Advance(kStart + 10, &expired);
+  ASSERT_EQ(expired.size(), 1);
+  ASSERT_EQ(expired[0], &kept);
+}
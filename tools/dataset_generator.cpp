@@ -0,0 +1,741 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <common/logging.h>
+#include <common/macros.h>
+#include <common/sprintf.h>
+#include <common/time.h>
+
+#include "mongo/mongo2info.h"
+#include "mongo/mongo_engine.h"
+#include "mongo/schema.h"
+
+#define HELP_TEXT                                                                                  \
+  "Usage: fastocloud_dataset_generator [options]\n"                                                \
+  "  Writes synthetic subscribers, services and streams into iptv database.\n"                     \
+  "  Same options and seed produce the same documents and ids.\n\n"                                \
+  "    --mongodb-url <url>         target database, default mongodb://localhost:27017\n"           \
+  "    --drop <0|1>                drop collections before writing, default 0\n"                   \
+  "    --seed <n>                  random seed, default 1\n"                                       \
+  "    --services <n>              services owning streams, default 1\n"                           \
+  "    --subscribers <n>           subscribers, default 1000\n"                                    \
+  "    --devices <n>               max devices of subscriber, default 4\n"                         \
+  "    --login-format <fmt>        printf format of login, default user%zu@fastocloud.com\n"       \
+  "    --password <password>       password of every user, default password\n"                     \
+  "    --exp-days <n>              account expiration from now, default 365\n"                     \
+  "    --channels <n>              live streams, default 5000\n"                                   \
+  "    --vods <n>                  vod streams, default 2000\n"                                    \
+  "    --catchup-parents <n>       channels with catchups, default 20\n"                           \
+  "    --parts <n>                 catchups of every parent, default 200\n"                        \
+  "    --outputs <n>               max outputs of stream, default 3\n"                             \
+  "    --proxy-ratio <0..1>        part of proxy streams, default 0.1\n"                           \
+  "    --user-channels <n>         mean channels of subscriber, default 1000\n"                    \
+  "    --user-vods <n>             mean vods of subscriber, default 200\n"                         \
+  "    --user-catchups <n>         mean catchups of subscriber, default 50\n"                      \
+  "    --favorite-ratio <0..1>     part of favorite user streams, default 0.05\n"                  \
+  "    --private-ratio <0..1>      part of private user streams, default 0.01\n"                   \
+  "    --recent-ratio <0..1>       part of recently watched user streams, default 0.1\n"           \
+  "    --http-host <host:port>     host in output urls, default localhost:8000\n"                  \
+  "    --http-root <path>          outputs are served from <path>/<sid>/<cid>, default /tmp/fastocloud/hls\n"
+
+namespace {
+namespace mongo = fastocloud::server::mongo;
+
+typedef std::unique_ptr<bson_t, mongo::MongoQueryDeleter> unique_ptr_bson_t;
+
+// ids are <fixed time><kind><index>, stable between runs and readable in the shell
+const uint32_t kOidTime = 0x5e000000;
+enum OidKind : uint8_t { OID_SERVICE = 1, OID_SUBSCRIBER, OID_DEVICE, OID_STREAM };
+
+const size_t kBulkDocuments = 1000;
+const size_t kBulkBytes = 16 * 1024 * 1024;
+const fastotv::timestamp_t kDay = 24 * 3600 * 1000;
+const fastotv::timestamp_t kCatchupDuration = 3600 * 1000;
+
+const char* const kGroups[] = {"News",  "Sports",      "Movies",        "Kids",
+                               "Music", "Documentary", "Entertainment", "Education"};
+const char* const kCountries[] = {"USA", "UK", "Germany", "France", "Spain", "Italy", "Canada", "Brazil"};
+const int32_t kIarcs[] = {0, 6, 12, 16, 18};
+
+struct Options {
+  Options();
+
+  std::string mongodb_url;
+  bool drop;
+  uint32_t seed;
+  size_t services;
+  size_t subscribers;
+  size_t devices;
+  std::string login_format;
+  std::string password;
+  uint32_t exp_days;
+  size_t channels;
+  size_t vods;
+  size_t catchup_parents;
+  size_t parts;
+  size_t outputs;
+  double proxy_ratio;
+  size_t user_channels;
+  size_t user_vods;
+  size_t user_catchups;
+  double favorite_ratio;
+  double private_ratio;
+  double recent_ratio;
+  std::string http_host;
+  std::string http_root;
+};
+
+Options::Options()
+    : mongodb_url("mongodb://localhost:27017"),
+      drop(false),
+      seed(1),
+      services(1),
+      subscribers(1000),
+      devices(4),
+      login_format("user%zu@fastocloud.com"),
+      password("password"),
+      exp_days(365),
+      channels(5000),
+      vods(2000),
+      catchup_parents(20),
+      parts(200),
+      outputs(3),
+      proxy_ratio(0.1),
+      user_channels(1000),
+      user_vods(200),
+      user_catchups(50),
+      favorite_ratio(0.05),
+      private_ratio(0.01),
+      recent_ratio(0.1),
+      http_host("localhost:8000"),
+      http_root("/tmp/fastocloud/hls") {}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0 || i + 1 == argc) {
+      return false;
+    }
+
+    const char* value = argv[++i];
+    if (strcmp(arg, "--mongodb-url") == 0) {
+      options->mongodb_url = value;
+    } else if (strcmp(arg, "--drop") == 0) {
+      options->drop = strtoul(value, nullptr, 10) != 0;
+    } else if (strcmp(arg, "--seed") == 0) {
+      options->seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--services") == 0) {
+      options->services = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--subscribers") == 0) {
+      options->subscribers = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--devices") == 0) {
+      options->devices = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--login-format") == 0) {
+      options->login_format = value;
+    } else if (strcmp(arg, "--password") == 0) {
+      options->password = value;
+    } else if (strcmp(arg, "--exp-days") == 0) {
+      options->exp_days = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--channels") == 0) {
+      options->channels = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--vods") == 0) {
+      options->vods = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--catchup-parents") == 0) {
+      options->catchup_parents = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--parts") == 0) {
+      options->parts = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--outputs") == 0) {
+      options->outputs = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--proxy-ratio") == 0) {
+      options->proxy_ratio = strtod(value, nullptr);
+    } else if (strcmp(arg, "--user-channels") == 0) {
+      options->user_channels = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--user-vods") == 0) {
+      options->user_vods = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--user-catchups") == 0) {
+      options->user_catchups = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--favorite-ratio") == 0) {
+      options->favorite_ratio = strtod(value, nullptr);
+    } else if (strcmp(arg, "--private-ratio") == 0) {
+      options->private_ratio = strtod(value, nullptr);
+    } else if (strcmp(arg, "--recent-ratio") == 0) {
+      options->recent_ratio = strtod(value, nullptr);
+    } else if (strcmp(arg, "--http-host") == 0) {
+      options->http_host = value;
+    } else if (strcmp(arg, "--http-root") == 0) {
+      options->http_root = value;
+    } else {
+      return false;
+    }
+  }
+
+  options->catchup_parents = std::min(options->catchup_parents, options->channels);
+  return options->services && options->devices && options->outputs;
+}
+
+void MakeOid(OidKind kind, uint64_t index, bson_oid_t* oid) {
+  uint8_t data[12];
+  for (size_t i = 0; i < 4; ++i) {
+    data[i] = static_cast<uint8_t>(kOidTime >> (24 - 8 * i));
+  }
+  data[4] = kind;
+  for (size_t i = 0; i < 7; ++i) {
+    data[5 + i] = static_cast<uint8_t>(index >> (48 - 8 * i));
+  }
+  bson_oid_init_from_data(oid, data);
+}
+
+class ArrayBuilder {
+ public:
+  ArrayBuilder(bson_t* parent, const char* key) : parent_(parent), index_(0) {
+    BSON_APPEND_ARRAY_BEGIN(parent, key, &array_);
+  }
+  ~ArrayBuilder() { bson_append_array_end(parent_, &array_); }
+
+  void BeginDocument(bson_t* doc) {
+    char buf[16];
+    const char* key;
+    const size_t keylen = bson_uint32_to_string(index_++, &key, buf, sizeof(buf));
+    bson_append_document_begin(&array_, key, keylen, doc);
+  }
+  void EndDocument(bson_t* doc) { bson_append_document_end(&array_, doc); }
+
+  void AppendOid(const bson_oid_t* oid) {
+    char buf[16];
+    const char* key;
+    const size_t keylen = bson_uint32_to_string(index_++, &key, buf, sizeof(buf));
+    bson_append_oid(&array_, key, keylen, oid);
+  }
+
+ private:
+  bson_t* parent_;
+  bson_t array_;
+  uint32_t index_;
+};
+
+// batches inserts, one round trip per thousand documents or 16MB
+class BulkWriter {
+ public:
+  explicit BulkWriter(mongoc_collection_t* collection);
+  ~BulkWriter();
+
+  bool Insert(const bson_t* doc) WARN_UNUSED_RESULT;
+  bool Flush() WARN_UNUSED_RESULT;
+  size_t GetInserted() const;
+
+ private:
+  mongoc_collection_t* collection_;
+  mongoc_bulk_operation_t* bulk_;
+  size_t documents_;
+  size_t bytes_;
+  size_t inserted_;
+};
+
+BulkWriter::BulkWriter(mongoc_collection_t* collection)
+    : collection_(collection), bulk_(nullptr), documents_(0), bytes_(0), inserted_(0) {}
+
+BulkWriter::~BulkWriter() {
+  if (bulk_) {
+    mongoc_bulk_operation_destroy(bulk_);
+  }
+}
+
+bool BulkWriter::Insert(const bson_t* doc) {
+  if (!bulk_) {
+    bulk_ = mongoc_collection_create_bulk_operation(collection_, false, NULL);
+  }
+
+  mongoc_bulk_operation_insert(bulk_, doc);
+  documents_++;
+  bytes_ += doc->len;
+  if (documents_ >= kBulkDocuments || bytes_ >= kBulkBytes) {
+    return Flush();
+  }
+  return true;
+}
+
+bool BulkWriter::Flush() {
+  if (!bulk_) {
+    return true;
+  }
+
+  bson_t reply;
+  bson_error_t error;
+  const bool ok = mongoc_bulk_operation_execute(bulk_, &reply, &error) != 0;
+  bson_destroy(&reply);
+  mongoc_bulk_operation_destroy(bulk_);
+  bulk_ = nullptr;
+  if (!ok) {
+    std::cerr << "Insert into " << mongoc_collection_get_name(collection_) << " failed: " << error.message
+              << std::endl;
+    return false;
+  }
+
+  inserted_ += documents_;
+  documents_ = 0;
+  bytes_ = 0;
+  return true;
+}
+
+size_t BulkWriter::GetInserted() const {
+  return inserted_;
+}
+
+// stream ordinals: channels, then vods, then catchups grouped by parent channel
+class Generator {
+ public:
+  explicit Generator(const Options& options);
+
+  bool WriteStreams(mongoc_collection_t* streams) WARN_UNUSED_RESULT;
+  bool WriteServices(mongoc_collection_t* services) WARN_UNUSED_RESULT;
+  bool WriteSubscribers(mongoc_collection_t* subscribers) WARN_UNUSED_RESULT;
+
+ private:
+  size_t GetVodsBegin() const;
+  size_t GetCatchupsBegin() const;
+  size_t GetStreamsCount() const;
+
+  template <typename T>
+  const T& Pick(const T* values, size_t count);
+  bool Chance(double ratio);
+  size_t GetAround(size_t mean, size_t limit);
+
+  void AppendStreamBase(bson_t* doc, const bson_oid_t* sid, const char* cls, const std::string& name);
+  void AppendOutputs(bson_t* doc, const std::string& sid, bool proxy);
+  void AppendEncoderFields(bson_t* doc, size_t outputs);
+  void MakeChannel(size_t index, bson_t* doc);
+  void MakeVod(size_t index, bson_t* doc);
+  void MakeCatchup(size_t parent, size_t part, bson_t* doc);
+  void MakeSubscriber(size_t index, bson_t* doc);
+  void AppendUserStreams(bson_t* doc, const char* field, std::vector<size_t>* sample, size_t mean, bool catchups);
+
+  const Options options_;
+  const fastotv::timestamp_t now_;
+  std::mt19937 random_;
+  fastotv::channel_id_t next_cid_;
+  size_t last_outputs_;
+  // permutations of stream ordinals, k swaps from the front give a uniform sample of k streams
+  std::vector<size_t> channels_sample_;
+  std::vector<size_t> vods_sample_;
+  std::vector<size_t> catchups_sample_;
+};
+
+Generator::Generator(const Options& options)
+    : options_(options),
+      now_(common::time::current_utc_mstime()),
+      random_(options.seed),
+      next_cid_(1),
+      last_outputs_(0),
+      channels_sample_(),
+      vods_sample_(),
+      catchups_sample_() {
+  for (size_t i = 0; i < GetVodsBegin(); ++i) {
+    channels_sample_.push_back(i);
+  }
+  for (size_t i = GetVodsBegin(); i < GetCatchupsBegin(); ++i) {
+    vods_sample_.push_back(i);
+  }
+  for (size_t i = GetCatchupsBegin(); i < GetStreamsCount(); ++i) {
+    catchups_sample_.push_back(i);
+  }
+}
+
+size_t Generator::GetVodsBegin() const {
+  return options_.channels;
+}
+
+size_t Generator::GetCatchupsBegin() const {
+  return options_.channels + options_.vods;
+}
+
+size_t Generator::GetStreamsCount() const {
+  return GetCatchupsBegin() + options_.catchup_parents * options_.parts;
+}
+
+template <typename T>
+const T& Generator::Pick(const T* values, size_t count) {
+  return values[std::uniform_int_distribution<size_t>(0, count - 1)(random_)];
+}
+
+bool Generator::Chance(double ratio) {
+  return std::uniform_real_distribution<double>(0, 1)(random_) < ratio;
+}
+
+size_t Generator::GetAround(size_t mean, size_t limit) {
+  if (!mean || !limit) {
+    return 0;
+  }
+  const size_t value = std::uniform_int_distribution<size_t>(mean / 2, mean + mean / 2)(random_);
+  return std::min(std::max(value, static_cast<size_t>(1)), limit);
+}
+
+void Generator::AppendStreamBase(bson_t* doc, const bson_oid_t* sid, const char* cls, const std::string& name) {
+  BSON_APPEND_OID(doc, STREAM_ID_FIELD, sid);
+  BSON_APPEND_UTF8(doc, STREAM_CLS_FIELD, cls);
+  BSON_APPEND_DATE_TIME(doc, STREAM_CREATE_DATE_FIELD, now_ - kDay * 30);
+  BSON_APPEND_UTF8(doc, STREAM_NAME_FIELD, name.c_str());
+  BSON_APPEND_UTF8(doc, STREAM_GROUP_FIELD, Pick(kGroups, SIZEOFMASS(kGroups)));
+  BSON_APPEND_DOUBLE(doc, STREAM_PRICE_FIELD, 0);
+  BSON_APPEND_BOOL(doc, STREAM_VISIBLE_FIELD, true);
+  BSON_APPEND_INT32(doc, STREAM_IARC_FIELD, Pick(kIarcs, SIZEOFMASS(kIarcs)));
+}
+
+void Generator::AppendOutputs(bson_t* doc, const std::string& sid, bool proxy) {
+  last_outputs_ = std::uniform_int_distribution<size_t>(1, options_.outputs)(random_);
+  ArrayBuilder outputs(doc, STREAM_OUTPUT_FIELD);
+  for (size_t i = 0; i < last_outputs_; ++i) {
+    const fastotv::channel_id_t cid = next_cid_++;
+    const std::string cid_str = std::to_string(cid);
+    bson_t url;
+    outputs.BeginDocument(&url);
+    BSON_APPEND_UTF8(&url, "_cls", OUTPUT_URL_CLS);
+    BSON_APPEND_INT32(&url, STREAM_OUTPUT_URLS_ID_FIELD, cid);
+    if (proxy) {
+      // proxy streams are served by their origin, the service only redirects
+      const std::string uri = common::MemSPrintf("http://origin%d.example.com/live/%s/master.m3u8",
+                                                 static_cast<int>(cid % 16), sid);
+      BSON_APPEND_UTF8(&url, STREAM_OUTPUT_URLS_URI_FIELD, uri.c_str());
+      BSON_APPEND_UTF8(&url, STREAM_OUTPUT_URLS_HTTP_ROOT_FIELD, "");
+    } else {
+      const std::string uri = common::MemSPrintf("http://%s/%s/%s/master.m3u8", options_.http_host, sid, cid_str);
+      const std::string http_root = common::MemSPrintf("%s/%s/%s", options_.http_root, sid, cid_str);
+      BSON_APPEND_UTF8(&url, STREAM_OUTPUT_URLS_URI_FIELD, uri.c_str());
+      BSON_APPEND_UTF8(&url, STREAM_OUTPUT_URLS_HTTP_ROOT_FIELD, http_root.c_str());
+    }
+    BSON_APPEND_INT32(&url, STREAM_OUTPUT_URLS_HLS_TYPE_FIELD, 0);
+    outputs.EndDocument(&url);
+  }
+}
+
+void Generator::AppendEncoderFields(bson_t* doc, size_t outputs) {
+  BSON_APPEND_INT32(doc, STREAM_LOG_LEVEL_FIELD, common::logging::LOG_LEVEL_INFO);
+  {
+    ArrayBuilder inputs(doc, STREAM_INPUT_FIELD);
+    for (size_t i = 0; i < outputs; ++i) {
+      bson_t url;
+      inputs.BeginDocument(&url);
+      BSON_APPEND_UTF8(&url, "_cls", INPUT_URL_CLS);
+      BSON_APPEND_INT32(&url, "id", static_cast<int32_t>(i));
+      const int group = static_cast<int>(next_cid_ & 0xffff);
+      const std::string uri =
+          common::MemSPrintf("udp://239.0.%d.%d:%d", group >> 8, group & 0xff, 5000 + static_cast<int>(i));
+      BSON_APPEND_UTF8(&url, "uri", uri.c_str());
+      BSON_APPEND_INT32(&url, "user_agent", 0);
+      BSON_APPEND_BOOL(&url, "stream_link", false);
+      inputs.EndDocument(&url);
+    }
+  }
+  BSON_APPEND_BOOL(doc, STREAM_HAVE_VIDEO_FIELD, true);
+  BSON_APPEND_BOOL(doc, STREAM_HAVE_AUDIO_FIELD, true);
+  BSON_APPEND_INT32(doc, STREAM_AUDIO_SELECT_FIELD, -1);
+  BSON_APPEND_BOOL(doc, STREAM_LOOP_FIELD, false);
+  BSON_APPEND_BOOL(doc, STREAM_AVFORMAT_FIELD, false);
+  BSON_APPEND_INT32(doc, STREAM_RESTART_ATTEMPTS_FIELD, 10);
+  BSON_APPEND_INT32(doc, STREAM_AUTO_EXIT_FIELD, 0);
+  BSON_APPEND_UTF8(doc, STREAM_EXTRA_CONFIG_ARGS_FIELD, "");
+  BSON_APPEND_UTF8(doc, STREAM_VIDEO_PARSER_FIELD, "h264parse");
+  BSON_APPEND_UTF8(doc, STREAM_AUDIO_PARSER_FIELD, "aacparse");
+}
+
+void Generator::MakeChannel(size_t index, bson_t* doc) {
+  const bool proxy = Chance(options_.proxy_ratio);
+  const std::string name = common::MemSPrintf("Channel %zu", index);
+  bson_oid_t sid;
+  MakeOid(OID_STREAM, index, &sid);
+  AppendStreamBase(doc, &sid, proxy ? PROXY_STR : (index % 2 ? ENCODE_STR : RELAY_STR), name);
+  const std::string tvg_id = common::MemSPrintf("channel%zu.tvg", index);
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_ID_FIELD, tvg_id.c_str());
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_NAME_FIELD, name.c_str());
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_LOGO_FIELD, "https://fastocloud.com/images/unknown_channel.png");
+  {
+    ArrayBuilder parts(doc, STREAM_PARTS_FIELD);
+    if (index < options_.catchup_parents) {
+      for (size_t i = 0; i < options_.parts; ++i) {
+        bson_oid_t pid;
+        MakeOid(OID_STREAM, GetCatchupsBegin() + index * options_.parts + i, &pid);
+        parts.AppendOid(&pid);
+      }
+    }
+  }
+
+  AppendOutputs(doc, common::ConvertToString(&sid), proxy);
+  if (proxy) {
+    BSON_APPEND_BOOL(doc, STREAM_HAVE_VIDEO_FIELD, true);
+    BSON_APPEND_BOOL(doc, STREAM_HAVE_AUDIO_FIELD, true);
+    return;
+  }
+  AppendEncoderFields(doc, last_outputs_);
+  BSON_APPEND_INT32(doc, TIMESHIFT_CHUNK_DURATION_FIELD, 12);
+  BSON_APPEND_INT32(doc, TIMESHIFT_CHUNK_LIFE_TIME_FIELD, 43200);
+}
+
+void Generator::MakeVod(size_t index, bson_t* doc) {
+  const bool proxy = Chance(options_.proxy_ratio);
+  const std::string name = common::MemSPrintf("Movie %zu", index);
+  bson_oid_t sid;
+  MakeOid(OID_STREAM, GetVodsBegin() + index, &sid);
+  AppendStreamBase(doc, &sid, proxy ? VOD_PROXY_STR : (index % 2 ? VOD_ENCODE_STR : VOD_RELAY_STR), name);
+  // typical admin panel descriptions are a paragraph or two
+  const std::string description(std::uniform_int_distribution<size_t>(128, 2048)(random_), 'd');
+  BSON_APPEND_UTF8(doc, VOD_DESCRIPTION_FIELD, description.c_str());
+  BSON_APPEND_UTF8(doc, VOD_PRVIEW_ICON_FIELD, "https://fastocloud.com/images/unknown_preview.png");
+  const std::string trailer = common::MemSPrintf("https://fastocloud.com/trailers/%zu.mp4", index);
+  BSON_APPEND_UTF8(doc, VOD_TRAILER_URL_FIELD, trailer.c_str());
+  BSON_APPEND_DOUBLE(doc, VOD_USER_SCORE_FIELD, std::uniform_real_distribution<double>(1, 10)(random_));
+  BSON_APPEND_DATE_TIME(doc, VOD_PRIME_DATE_FIELD, now_ - kDay * static_cast<fastotv::timestamp_t>(index % 10000));
+  BSON_APPEND_UTF8(doc, VOD_COUNTRY_FIELD, Pick(kCountries, SIZEOFMASS(kCountries)));
+  BSON_APPEND_INT32(doc, VOD_DURATION_FIELD, std::uniform_int_distribution<int32_t>(20, 180)(random_) * 60 * 1000);
+  BSON_APPEND_INT32(doc, VOD_TYPE_FIELD, index % 2);
+  const unique_ptr_bson_t bparts(bson_new());
+  BSON_APPEND_ARRAY(doc, STREAM_PARTS_FIELD, bparts.get());
+
+  AppendOutputs(doc, common::ConvertToString(&sid), proxy);
+  if (proxy) {
+    BSON_APPEND_BOOL(doc, STREAM_HAVE_VIDEO_FIELD, true);
+    BSON_APPEND_BOOL(doc, STREAM_HAVE_AUDIO_FIELD, true);
+    return;
+  }
+  AppendEncoderFields(doc, last_outputs_);
+}
+
+// same layout as SubscribersManager::CreateCatchup writes
+void Generator::MakeCatchup(size_t parent, size_t part, bson_t* doc) {
+  const std::string name = common::MemSPrintf("Channel %zu program %zu", parent, part);
+  bson_oid_t sid;
+  MakeOid(OID_STREAM, GetCatchupsBegin() + parent * options_.parts + part, &sid);
+  AppendStreamBase(doc, &sid, CATCHUP_STR, name);
+  const std::string tvg_id = common::MemSPrintf("channel%zu.tvg", parent);
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_ID_FIELD, tvg_id.c_str());
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_NAME_FIELD, "");
+  BSON_APPEND_UTF8(doc, CHANNEL_TVG_LOGO_FIELD, "https://fastocloud.com/images/unknown_channel.png");
+  const unique_ptr_bson_t bparts(bson_new());
+  BSON_APPEND_ARRAY(doc, STREAM_PARTS_FIELD, bparts.get());
+
+  AppendOutputs(doc, common::ConvertToString(&sid), false);
+  AppendEncoderFields(doc, last_outputs_);
+  BSON_APPEND_INT32(doc, TIMESHIFT_CHUNK_DURATION_FIELD, 12);
+  BSON_APPEND_INT32(doc, TIMESHIFT_CHUNK_LIFE_TIME_FIELD, 43200);
+  const fastotv::timestamp_t start = now_ - static_cast<fastotv::timestamp_t>(part + 1) * kCatchupDuration;
+  BSON_APPEND_DATE_TIME(doc, CATCHUP_START_FIELD, start);
+  BSON_APPEND_DATE_TIME(doc, CATCHUP_STOP_FIELD, start + kCatchupDuration);
+}
+
+void Generator::AppendUserStreams(bson_t* doc,
+                                  const char* field,
+                                  std::vector<size_t>* sample,
+                                  size_t mean,
+                                  bool catchups) {
+  const size_t count = sample->size();
+  const size_t total = GetAround(mean, count);
+  ArrayBuilder streams(doc, field);
+  for (size_t i = 0; i < total; ++i) {
+    std::swap((*sample)[i], (*sample)[std::uniform_int_distribution<size_t>(i, count - 1)(random_)]);
+    bson_oid_t sid;
+    MakeOid(OID_STREAM, (*sample)[i], &sid);
+    const bool recent = Chance(options_.recent_ratio);
+    const fastotv::timestamp_t watched = std::uniform_int_distribution<fastotv::timestamp_t>(0, kDay * 30)(random_);
+    bson_t entry;
+    streams.BeginDocument(&entry);
+    BSON_APPEND_OID(&entry, USER_STREAM_ID_FIELD, &sid);
+    BSON_APPEND_BOOL(&entry, FAVORITE_FIELD, Chance(options_.favorite_ratio));
+    BSON_APPEND_BOOL(&entry, PRIVATE_FIELD, Chance(options_.private_ratio));
+    BSON_APPEND_DATE_TIME(&entry, RECENT_FIELD, recent ? now_ - watched : 0);
+    BSON_APPEND_INT32(&entry, INTERRUPTION_TIME_FIELD,
+                      recent ? std::uniform_int_distribution<int32_t>(0, 3600 * 1000)(random_) : 0);
+    if (catchups) {
+      BSON_APPEND_UTF8(&entry, "_cls", CATCHUP_USER_CLS_VALUE);
+    }
+    streams.EndDocument(&entry);
+  }
+}
+
+void Generator::MakeSubscriber(size_t index, bson_t* doc) {
+  bson_oid_t uid;
+  MakeOid(OID_SUBSCRIBER, index, &uid);
+  BSON_APPEND_OID(doc, "_id", &uid);
+  const std::string email = common::MemSPrintf(options_.login_format.c_str(), index);
+  BSON_APPEND_UTF8(doc, "email", email.c_str());
+  BSON_APPEND_UTF8(doc, "first_name", "User");
+  BSON_APPEND_UTF8(doc, "last_name", std::to_string(index).c_str());
+  // server compares stored hash with the one sent by the box, load tools send it as is
+  BSON_APPEND_UTF8(doc, "password", options_.password.c_str());
+  BSON_APPEND_DATE_TIME(doc, "created_date", now_ - kDay * 30);
+  BSON_APPEND_DATE_TIME(doc, "exp_date", now_ + kDay * options_.exp_days);
+  BSON_APPEND_INT32(doc, "status", mongo::USER_ACTIVE);
+  BSON_APPEND_INT32(doc, "max_devices_count", static_cast<int32_t>(options_.devices));
+  BSON_APPEND_UTF8(doc, "country", Pick(kCountries, SIZEOFMASS(kCountries)));
+  {
+    ArrayBuilder servers(doc, "servers");
+    bson_oid_t sid;
+    MakeOid(OID_SERVICE, index % options_.services, &sid);
+    servers.AppendOid(&sid);
+  }
+  {
+    // devices are not activated, CLIENT_ACTIVATE_DEVICE lists them until the first login
+    const size_t devices = std::uniform_int_distribution<size_t>(1, options_.devices)(random_);
+    ArrayBuilder array(doc, "devices");
+    for (size_t i = 0; i < devices; ++i) {
+      bson_oid_t did;
+      MakeOid(OID_DEVICE, index * options_.devices + i, &did);
+      bson_t device;
+      array.BeginDocument(&device);
+      BSON_APPEND_OID(&device, "_id", &did);
+      const std::string name = common::MemSPrintf("Device %zu", i);
+      BSON_APPEND_UTF8(&device, "name", name.c_str());
+      BSON_APPEND_INT32(&device, "status", mongo::DEVICE_NOT_ACTIVE);
+      BSON_APPEND_DATE_TIME(&device, "created_date", now_ - kDay * 30);
+      array.EndDocument(&device);
+    }
+  }
+
+  AppendUserStreams(doc, USER_STREAMS_FIELD, &channels_sample_, options_.user_channels, false);
+  AppendUserStreams(doc, USER_VODS_FIELD, &vods_sample_, options_.user_vods, false);
+  AppendUserStreams(doc, USER_CATCHUPS_FIELD, &catchups_sample_, options_.user_catchups, true);
+}
+
+bool Generator::WriteStreams(mongoc_collection_t* streams) {
+  BulkWriter writer(streams);
+  for (size_t i = 0; i < options_.channels; ++i) {
+    const unique_ptr_bson_t doc(bson_new());
+    MakeChannel(i, doc.get());
+    if (!writer.Insert(doc.get())) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < options_.vods; ++i) {
+    const unique_ptr_bson_t doc(bson_new());
+    MakeVod(i, doc.get());
+    if (!writer.Insert(doc.get())) {
+      return false;
+    }
+  }
+  for (size_t parent = 0; parent < options_.catchup_parents; ++parent) {
+    for (size_t part = 0; part < options_.parts; ++part) {
+      const unique_ptr_bson_t doc(bson_new());
+      MakeCatchup(parent, part, doc.get());
+      if (!writer.Insert(doc.get())) {
+        return false;
+      }
+    }
+  }
+
+  if (!writer.Flush()) {
+    return false;
+  }
+  std::cout << "Streams: " << writer.GetInserted() << ", outputs: " << next_cid_ - 1 << std::endl;
+  return true;
+}
+
+bool Generator::WriteServices(mongoc_collection_t* services) {
+  BulkWriter writer(services);
+  for (size_t i = 0; i < options_.services; ++i) {
+    const unique_ptr_bson_t doc(bson_new());
+    bson_oid_t sid;
+    MakeOid(OID_SERVICE, i, &sid);
+    BSON_APPEND_OID(doc.get(), "_id", &sid);
+    const std::string name = common::MemSPrintf("Service %zu", i);
+    BSON_APPEND_UTF8(doc.get(), "name", name.c_str());
+    {
+      ArrayBuilder streams(doc.get(), SERVER_STREAMS_FIELD);
+      for (size_t ordinal = i; ordinal < GetStreamsCount(); ordinal += options_.services) {
+        bson_oid_t stream;
+        MakeOid(OID_STREAM, ordinal, &stream);
+        streams.AppendOid(&stream);
+      }
+    }
+    if (!writer.Insert(doc.get())) {
+      return false;
+    }
+  }
+
+  if (!writer.Flush()) {
+    return false;
+  }
+  std::cout << "Services: " << writer.GetInserted() << std::endl;
+  return true;
+}
+
+bool Generator::WriteSubscribers(mongoc_collection_t* subscribers) {
+  BulkWriter writer(subscribers);
+  for (size_t i = 0; i < options_.subscribers; ++i) {
+    const unique_ptr_bson_t doc(bson_new());
+    MakeSubscriber(i, doc.get());
+    if (!writer.Insert(doc.get())) {
+      return false;
+    }
+  }
+
+  if (!writer.Flush()) {
+    return false;
+  }
+  std::cout << "Subscribers: " << writer.GetInserted() << std::endl;
+  return true;
+}
+
+void DropCollection(mongoc_collection_t* collection) {
+  bson_error_t error;
+  if (!mongoc_collection_drop(collection, &error)) {
+    // first run, nothing to drop
+    std::cerr << "Drop " << mongoc_collection_get_name(collection) << ": " << error.message << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << HELP_TEXT << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  mongoc_client_t* client = mongo::MongoEngine::GetInstance().Connect(options.mongodb_url);
+  if (!client) {
+    std::cerr << "Can't connect to: " << options.mongodb_url << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  mongoc_collection_t* subscribers = mongoc_client_get_collection(client, DB_NAME, SUBSCRIBERS_COLLECTION);
+  mongoc_collection_t* services = mongoc_client_get_collection(client, DB_NAME, SERVERS_COLLECTION);
+  mongoc_collection_t* streams = mongoc_client_get_collection(client, DB_NAME, STREAMS_COLLECTION);
+  if (options.drop) {
+    DropCollection(subscribers);
+    DropCollection(services);
+    DropCollection(streams);
+  }
+
+  // generation order is fixed, every collection draws from the same random sequence
+  Generator generator(options);
+  const bool ok =
+      generator.WriteStreams(streams) && generator.WriteServices(services) && generator.WriteSubscribers(subscribers);
+  if (!ok) {
+    std::cerr << "Generation failed, rerun with --drop 1 if collections already have generated ids" << std::endl;
+  }
+
+  mongoc_collection_destroy(streams);
+  mongoc_collection_destroy(services);
+  mongoc_collection_destroy(subscribers);
+  mongoc_client_destroy(client);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,810 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/file_system/file_system.h>
+#include <common/sprintf.h>
+
+#include "tools/load_accounts.h"
+#include "tools/load_socket.h"
+#include "tools/load_stats.h"
+
+#define HELP_TEXT                                                                          \
+  "Usage: fastocloud_hls_load [options]\n"                                                 \
+  "  Simulates hls players against http_host of a running service.\n"                      \
+  "  Viewers are made from subscribers, devices and streams found in the database.\n\n"    \
+  "    --host <ip:port>            http host, default 127.0.0.1:5001\n"                    \
+  "    --mongodb-url <url>         service database, default mongodb://localhost:27017\n"  \
+  "    --users <n>                 max subscribers to read from database, default 1000\n"  \
+  "    --prepare <0|1>             write playlists and segments into stream http roots\n"    \
+  "    --segments <n>              segments in generated playlist, default 6\n"            \
+  "    --bitrate <kbps>            generated segment bitrate, default 2000\n"              \
+  "    --viewers <n>               simultaneous players, default 100\n"                    \
+  "    --threads <n>               worker threads, default 4\n"                            \
+  "    --arrival-rate <n>          new players per second, default 20\n"                   \
+  "    --duration <sec>            run time, default 60\n"                                 \
+  "    --segment-duration <sec>    playback time of one segment, default 10\n"             \
+  "    --speed <x>                 pacing multiplier, default 1\n"                         \
+  "    --buffer <n>                segments fetched back to back on start, default 3\n"    \
+  "    --keep-alive <0|1>          reuse connections between requests, default 1\n"        \
+  "    --timeout <msec>            request timeout, default 10000\n"                       \
+  "    --seed <n>                  random seed, default 1\n"                               \
+  "    --report-interval <sec>     progress line period, default 5\n"
+
+#define PLAYLIST_NAME "master.m3u8"
+
+namespace {
+namespace tools = fastocloud::server::tools;
+
+using tools::Account;
+using tools::Channel;
+
+struct SigIgnInit {
+  SigIgnInit() { signal(SIGPIPE, SIG_IGN); }
+} sig_init;
+
+const char kConnectOperation[] = "connect";
+const char kPlaylistOperation[] = "playlist";
+const char kSegmentOperation[] = "segment";
+const char kRedirectOperation[] = "redirect";
+const char kTimeoutOperation[] = "timeout";
+const char kHeaderEnd[] = "\r\n\r\n";
+const size_t kReadBufferSize = 64 * 1024;
+const size_t kTsPacketSize = 188;
+const int kMaxEvents = 256;
+const uint64_t kPollIntervalUsec = 100000;
+
+struct Options {
+  Options();
+
+  struct sockaddr_in address;
+  std::string host;
+  std::string mongodb_url;
+  size_t users;
+  bool prepare;
+  size_t segments;
+  uint32_t bitrate;
+  size_t viewers;
+  size_t threads;
+  double arrival_rate;
+  uint32_t duration;
+  uint32_t segment_duration;
+  double speed;
+  size_t buffer;
+  bool keep_alive;
+  uint32_t timeout;
+  uint32_t seed;
+  uint32_t report_interval;
+};
+
+Options::Options()
+    : address(),
+      host("127.0.0.1:5001"),
+      mongodb_url("mongodb://localhost:27017"),
+      users(1000),
+      prepare(false),
+      segments(6),
+      bitrate(2000),
+      viewers(100),
+      threads(4),
+      arrival_rate(20),
+      duration(60),
+      segment_duration(10),
+      speed(1),
+      buffer(3),
+      keep_alive(true),
+      timeout(10000),
+      seed(1),
+      report_interval(5) {}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0 || i + 1 == argc) {
+      return false;
+    }
+
+    const char* value = argv[++i];
+    if (strcmp(arg, "--host") == 0) {
+      options->host = value;
+    } else if (strcmp(arg, "--mongodb-url") == 0) {
+      options->mongodb_url = value;
+    } else if (strcmp(arg, "--users") == 0) {
+      options->users = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--prepare") == 0) {
+      options->prepare = strtoul(value, nullptr, 10) != 0;
+    } else if (strcmp(arg, "--segments") == 0) {
+      options->segments = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--bitrate") == 0) {
+      options->bitrate = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--viewers") == 0) {
+      options->viewers = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--threads") == 0) {
+      options->threads = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--arrival-rate") == 0) {
+      options->arrival_rate = strtod(value, nullptr);
+    } else if (strcmp(arg, "--duration") == 0) {
+      options->duration = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--segment-duration") == 0) {
+      options->segment_duration = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--speed") == 0) {
+      options->speed = strtod(value, nullptr);
+    } else if (strcmp(arg, "--buffer") == 0) {
+      options->buffer = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--keep-alive") == 0) {
+      options->keep_alive = strtoul(value, nullptr, 10) != 0;
+    } else if (strcmp(arg, "--timeout") == 0) {
+      options->timeout = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--seed") == 0) {
+      options->seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--report-interval") == 0) {
+      options->report_interval = strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+
+  if (!options->viewers || !options->threads || options->arrival_rate <= 0 || options->speed <= 0 ||
+      !options->segment_duration || !options->segments) {
+    return false;
+  }
+  return tools::ResolveAddress(options->host, &options->address);
+}
+
+// live-like playlist with TS-looking segments, named the way the streamer names them
+bool PrepareChannel(const Options& options, const Channel& channel) {
+  if (channel.proxy || channel.http_root.empty()) {
+    return true;
+  }
+
+  if (!common::file_system::is_directory_exist(channel.http_root) &&
+      !common::file_system::create_directory(channel.http_root, true)) {
+    return false;
+  }
+
+  const std::string root = channel.http_root.back() == '/' ? channel.http_root : channel.http_root + "/";
+  std::ofstream playlist((root + PLAYLIST_NAME).c_str(), std::ios::trunc);
+  playlist << "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:" << options.segment_duration
+           << "\n#EXT-X-MEDIA-SEQUENCE:0\n";
+  const size_t segment_size =
+      static_cast<size_t>(options.bitrate) * 1000 / 8 * options.segment_duration / kTsPacketSize * kTsPacketSize;
+  std::string packet(kTsPacketSize, '\xff');
+  packet[0] = 0x47;
+  for (size_t i = 0; i < options.segments; ++i) {
+    const std::string name = common::MemSPrintf("%zu.ts", i);
+    playlist << "#EXTINF:" << options.segment_duration << ".0,\n" << name << "\n";
+    std::ofstream segment((root + name).c_str(), std::ios::binary | std::ios::trunc);
+    for (size_t written = 0; written < segment_size; written += kTsPacketSize) {
+      segment.write(packet.data(), packet.size());
+    }
+    if (!segment) {
+      return false;
+    }
+  }
+  return static_cast<bool>(playlist);
+}
+
+enum ViewerState { VIEWER_IDLE = 0, VIEWER_CONNECTING, VIEWER_WAITING, VIEWER_READY };
+
+struct Viewer {
+  Viewer();
+
+  void ResetResponse();
+
+  int fd;
+  ViewerState state;
+  size_t account;
+  size_t channel;
+
+  // playback position, segment k is due at play_start + k segment durations once buffered
+  std::vector<std::string> segments;
+  size_t next_segment;
+  bool buffered;
+  uint64_t play_start;
+
+  const char* operation;
+  std::string file;
+  std::string request;
+  size_t request_offset;
+  uint64_t connect_start;
+  uint64_t request_start;
+  uint64_t first_byte;
+
+  std::string header;
+  bool header_done;
+  int status;
+  bool server_close;
+  int64_t content_length;
+  size_t body_received;
+  std::string body;
+  uint32_t timer_generation;
+};
+
+Viewer::Viewer()
+    : fd(-1),
+      state(VIEWER_IDLE),
+      account(0),
+      channel(0),
+      segments(),
+      next_segment(0),
+      buffered(false),
+      play_start(0),
+      operation(nullptr),
+      file(),
+      request(),
+      request_offset(0),
+      connect_start(0),
+      request_start(0),
+      first_byte(0),
+      header(),
+      header_done(false),
+      status(0),
+      server_close(false),
+      content_length(-1),
+      body_received(0),
+      body(),
+      timer_generation(0) {}
+
+void Viewer::ResetResponse() {
+  first_byte = 0;
+  header.clear();
+  header_done = false;
+  status = 0;
+  server_close = false;
+  content_length = -1;
+  body_received = 0;
+  body.clear();
+}
+
+struct ViewerTimer {
+  uint64_t when;
+  size_t viewer;
+  uint32_t generation;
+
+  bool operator>(const ViewerTimer& other) const { return when > other.when; }
+};
+
+std::vector<std::string> ParsePlaylist(const std::string& body) {
+  std::vector<std::string> segments;
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t end = body.find('\n', pos);
+    if (end == std::string::npos) {
+      end = body.size();
+    }
+    std::string line = body.substr(pos, end - pos);
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty() && line[0] != '#') {
+      segments.push_back(line);
+    }
+    pos = end + 1;
+  }
+  return segments;
+}
+
+class Worker {
+ public:
+  Worker(const Options& options,
+         size_t id,
+         const std::vector<Account>& accounts,
+         const std::vector<Channel>& channels,
+         const std::atomic<bool>* stop);
+  ~Worker();
+
+  void Run();
+
+  const tools::LoadStats& GetStats() const;
+  uint64_t GetCompleted() const;
+  uint64_t GetErrors() const;
+  uint64_t GetBytes() const;
+
+ private:
+  void Schedule(size_t index, uint64_t when);
+  void FireTimers(uint64_t now);
+  void CheckTimeouts(uint64_t now);
+
+  void StartRequest(size_t index, uint64_t now);
+  void Fail(size_t index, const char* operation, uint64_t now);
+  void Close(size_t index);
+  void OnEvent(size_t index, uint32_t events, uint64_t now);
+  bool Flush(size_t index);
+  bool Read(size_t index, uint64_t now);
+  bool ParseHeader(Viewer* viewer);
+  void Complete(size_t index, uint64_t now);
+  void UpdateEvents(size_t index, bool want_write);
+
+  uint64_t GetSegmentDuration() const;
+  size_t PickChannel(const Account& account);
+
+  const Options& options_;
+  const std::vector<Account>& accounts_;
+  const std::vector<Channel>& channels_;
+  const std::atomic<bool>* stop_;
+  int epoll_fd_;
+  std::vector<Viewer> viewers_;
+  std::priority_queue<ViewerTimer, std::vector<ViewerTimer>, std::greater<ViewerTimer>> timers_;
+  std::mt19937 random_;
+  tools::LoadStats stats_;
+  std::atomic<uint64_t> completed_;
+  std::atomic<uint64_t> errors_;
+  std::atomic<uint64_t> bytes_;
+};
+
+Worker::Worker(const Options& options,
+               size_t id,
+               const std::vector<Account>& accounts,
+               const std::vector<Channel>& channels,
+               const std::atomic<bool>* stop)
+    : options_(options),
+      accounts_(accounts),
+      channels_(channels),
+      stop_(stop),
+      epoll_fd_(epoll_create1(0)),
+      viewers_(),
+      timers_(),
+      random_(options.seed + static_cast<uint32_t>(id)),
+      stats_(),
+      completed_(0),
+      errors_(0),
+      bytes_(0) {
+  // global viewer k belongs to worker k % threads and starts at k / arrival_rate
+  const uint64_t start = tools::GetMonotonicUsec();
+  for (size_t k = id; k < options.viewers; k += options.threads) {
+    Viewer viewer;
+    viewer.account = k % accounts.size();
+    viewer.channel = PickChannel(accounts[viewer.account]);
+    viewers_.push_back(viewer);
+    Schedule(viewers_.size() - 1, start + static_cast<uint64_t>(k * 1000000 / options.arrival_rate));
+  }
+}
+
+Worker::~Worker() {
+  for (size_t i = 0; i < viewers_.size(); ++i) {
+    Close(i);
+  }
+  if (epoll_fd_ != -1) {
+    close(epoll_fd_);
+  }
+}
+
+void Worker::Run() {
+  struct epoll_event events[kMaxEvents];
+  uint64_t last_timeout_check = tools::GetMonotonicUsec();
+  while (!*stop_) {
+    uint64_t now = tools::GetMonotonicUsec();
+    uint64_t wait = kPollIntervalUsec;
+    if (!timers_.empty()) {
+      wait = timers_.top().when > now ? std::min(wait, timers_.top().when - now) : 0;
+    }
+
+    const int count = epoll_wait(epoll_fd_, events, kMaxEvents, static_cast<int>(wait / 1000));
+    now = tools::GetMonotonicUsec();
+    for (int i = 0; i < count; ++i) {
+      OnEvent(events[i].data.u64, events[i].events, now);
+    }
+
+    FireTimers(now);
+    if (now - last_timeout_check >= 1000000) {
+      last_timeout_check = now;
+      CheckTimeouts(now);
+    }
+  }
+}
+
+const tools::LoadStats& Worker::GetStats() const {
+  return stats_;
+}
+
+uint64_t Worker::GetCompleted() const {
+  return completed_;
+}
+
+uint64_t Worker::GetErrors() const {
+  return errors_;
+}
+
+uint64_t Worker::GetBytes() const {
+  return bytes_;
+}
+
+void Worker::Schedule(size_t index, uint64_t when) {
+  Viewer& viewer = viewers_[index];
+  viewer.timer_generation++;
+  timers_.push({when, index, viewer.timer_generation});
+}
+
+void Worker::FireTimers(uint64_t now) {
+  while (!timers_.empty() && timers_.top().when <= now) {
+    const ViewerTimer timer = timers_.top();
+    timers_.pop();
+    const Viewer& viewer = viewers_[timer.viewer];
+    if (timer.generation == viewer.timer_generation &&
+        (viewer.state == VIEWER_IDLE || viewer.state == VIEWER_READY)) {
+      StartRequest(timer.viewer, now);
+    }
+  }
+}
+
+void Worker::CheckTimeouts(uint64_t now) {
+  const uint64_t timeout = static_cast<uint64_t>(options_.timeout) * 1000;
+  for (size_t i = 0; i < viewers_.size(); ++i) {
+    const Viewer& viewer = viewers_[i];
+    if ((viewer.state == VIEWER_CONNECTING && now - viewer.connect_start >= timeout) ||
+        (viewer.state == VIEWER_WAITING && now - viewer.request_start >= timeout)) {
+      Fail(i, kTimeoutOperation, now);
+    }
+  }
+}
+
+void Worker::StartRequest(size_t index, uint64_t now) {
+  Viewer& viewer = viewers_[index];
+  const Account& account = accounts_[viewer.account];
+  const Channel& channel = channels_[viewer.channel];
+  if (viewer.next_segment < viewer.segments.size()) {
+    viewer.operation = kSegmentOperation;
+    viewer.file = viewer.segments[viewer.next_segment];
+  } else {
+    viewer.operation = kPlaylistOperation;
+    viewer.file = PLAYLIST_NAME;
+  }
+
+  // user_id/password_hash/device_id/stream_id/channel_id/file, see HttpHandler::ProcessReceived
+  viewer.request = common::MemSPrintf(
+      "GET /%s/%s/%s/%s/%s/%s HTTP/1.1\r\nHost: %s\r\nUser-Agent: fastocloud_hls_load\r\nConnection: %s\r\n\r\n",
+      account.uid, account.password, account.device, channel.sid, std::to_string(channel.cid), viewer.file,
+      options_.host, options_.keep_alive ? "Keep-Alive" : "close");
+  viewer.request_offset = 0;
+  viewer.ResetResponse();
+
+  if (viewer.fd != -1) {
+    viewer.state = VIEWER_WAITING;
+    viewer.request_start = now;
+    if (!Flush(index)) {
+      Fail(index, viewer.operation, now);
+    }
+    return;
+  }
+
+  viewer.fd = tools::StartConnect(options_.address);
+  if (viewer.fd == -1) {
+    Fail(index, kConnectOperation, now);
+    return;
+  }
+
+  viewer.state = VIEWER_CONNECTING;
+  viewer.connect_start = now;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT;
+  ev.data.u64 = index;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, viewer.fd, &ev);
+}
+
+void Worker::Fail(size_t index, const char* operation, uint64_t now) {
+  stats_.RecordError(operation);
+  errors_++;
+  Close(index);
+
+  // players retry after a segment, a new session may land on another channel
+  Viewer& viewer = viewers_[index];
+  viewer.segments.clear();
+  viewer.next_segment = 0;
+  viewer.buffered = false;
+  viewer.channel = PickChannel(accounts_[viewer.account]);
+  Schedule(index, now + GetSegmentDuration());
+}
+
+void Worker::Close(size_t index) {
+  Viewer& viewer = viewers_[index];
+  if (viewer.fd != -1) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, viewer.fd, nullptr);
+    close(viewer.fd);
+    viewer.fd = -1;
+  }
+  viewer.state = VIEWER_IDLE;
+}
+
+void Worker::OnEvent(size_t index, uint32_t events, uint64_t now) {
+  Viewer& viewer = viewers_[index];
+  if (viewer.fd == -1) {
+    return;
+  }
+
+  if (viewer.state == VIEWER_CONNECTING) {
+    if ((events & (EPOLLERR | EPOLLHUP)) || !tools::IsConnected(viewer.fd)) {
+      Fail(index, kConnectOperation, now);
+      return;
+    }
+
+    stats_.RecordSuccess(kConnectOperation, now - viewer.connect_start);
+    viewer.state = VIEWER_WAITING;
+    viewer.request_start = now;
+  }
+
+  if ((events & EPOLLOUT) && !Flush(index)) {
+    Fail(index, viewer.operation, now);
+    return;
+  }
+  if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !Read(index, now)) {
+    Fail(index, viewer.operation, now);
+  }
+}
+
+bool Worker::Flush(size_t index) {
+  Viewer& viewer = viewers_[index];
+  while (viewer.request_offset < viewer.request.size()) {
+    const ssize_t nwrite = write(viewer.fd, viewer.request.data() + viewer.request_offset,
+                                 viewer.request.size() - viewer.request_offset);
+    if (nwrite == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return false;
+    }
+    viewer.request_offset += nwrite;
+  }
+
+  UpdateEvents(index, viewer.request_offset < viewer.request.size());
+  return true;
+}
+
+bool Worker::Read(size_t index, uint64_t now) {
+  char buffer[kReadBufferSize];
+  while (true) {
+    Viewer& viewer = viewers_[index];
+    const ssize_t nread = read(viewer.fd, buffer, sizeof(buffer));
+    if (nread == -1) {
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (nread == 0) {
+      // body delimited by close
+      if (viewer.state == VIEWER_WAITING && viewer.header_done && viewer.content_length < 0) {
+        Complete(index, now);
+        return true;
+      }
+      if (viewer.state == VIEWER_READY) {
+        Close(index);
+        return true;
+      }
+      return false;
+    }
+    if (viewer.state != VIEWER_WAITING) {
+      continue;
+    }
+
+    if (!viewer.first_byte) {
+      viewer.first_byte = now;
+    }
+    bytes_ += nread;
+    size_t offset = 0;
+    if (!viewer.header_done) {
+      viewer.header.append(buffer, nread);
+      const size_t header_end = viewer.header.find(kHeaderEnd);
+      if (header_end == std::string::npos) {
+        continue;
+      }
+      offset = nread - (viewer.header.size() - header_end - strlen(kHeaderEnd));
+      viewer.header.resize(header_end);
+      if (!ParseHeader(&viewer)) {
+        return false;
+      }
+      // redirects are sent without body and length
+      if (viewer.content_length < 0 && viewer.status >= 300 && viewer.status < 400) {
+        viewer.content_length = 0;
+      }
+    }
+
+    const size_t body_size = nread - offset;
+    viewer.body_received += body_size;
+    if (viewer.operation == kPlaylistOperation) {
+      viewer.body.append(buffer + offset, body_size);
+    }
+    if (viewer.content_length >= 0 && viewer.body_received >= static_cast<size_t>(viewer.content_length)) {
+      Complete(index, now);
+      if (viewers_[index].fd == -1) {
+        return true;
+      }
+    }
+  }
+}
+
+bool Worker::ParseHeader(Viewer* viewer) {
+  viewer->header_done = true;
+  if (sscanf(viewer->header.c_str(), "HTTP/%*d.%*d %d", &viewer->status) != 1) {
+    return false;
+  }
+
+  size_t pos = viewer->header.find("\r\n");
+  while (pos != std::string::npos) {
+    const size_t start = pos + 2;
+    pos = viewer->header.find("\r\n", start);
+    const std::string line = viewer->header.substr(start, pos == std::string::npos ? std::string::npos : pos - start);
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+
+    const std::string key = line.substr(0, colon);
+    const char* value = line.c_str() + colon + 1;
+    while (*value == ' ') {
+      value++;
+    }
+    if (strcasecmp(key.c_str(), "Content-Length") == 0) {
+      viewer->content_length = strtoll(value, nullptr, 10);
+    } else if (strcasecmp(key.c_str(), "Connection") == 0) {
+      viewer->server_close = strcasecmp(value, "close") == 0;
+    }
+  }
+  return true;
+}
+
+void Worker::Complete(size_t index, uint64_t now) {
+  Viewer& viewer = viewers_[index];
+  const uint64_t latency = now - viewer.request_start;
+  const std::string ttfb_operation = std::string(viewer.operation) + "_ttfb";
+  if (viewer.status >= 300 && viewer.status < 400) {
+    // proxy streams, players go to the edge and come back for the next segment
+    stats_.RecordSuccess(kRedirectOperation, latency);
+    completed_++;
+    viewer.state = VIEWER_READY;
+    if (!options_.keep_alive || viewer.server_close) {
+      Close(index);
+    }
+    Schedule(index, now + GetSegmentDuration());
+    return;
+  }
+
+  if (viewer.status < 200 || viewer.status >= 300) {
+    Fail(index, viewer.operation, now);
+    return;
+  }
+
+  stats_.RecordSuccess(ttfb_operation, viewer.first_byte - viewer.request_start);
+  stats_.RecordSuccess(viewer.operation, latency, viewer.body_received);
+  completed_++;
+  viewer.state = VIEWER_READY;
+  if (!options_.keep_alive || viewer.server_close) {
+    Close(index);
+  }
+
+  if (viewer.operation == kPlaylistOperation) {
+    // live refresh keeps buffered state, playback goes on without a new burst
+    viewer.segments = ParsePlaylist(viewer.body);
+    viewer.next_segment = 0;
+    viewer.play_start = now;
+    Schedule(index, viewer.segments.empty() ? now + GetSegmentDuration() : now);
+    return;
+  }
+
+  viewer.next_segment++;
+  if (!viewer.buffered) {
+    if (viewer.next_segment < options_.buffer && viewer.next_segment < viewer.segments.size()) {
+      Schedule(index, now);
+      return;
+    }
+    // buffer is full, next segment is needed once the first buffered one is played
+    viewer.buffered = true;
+    viewer.play_start = now - (viewer.next_segment - 1) * GetSegmentDuration();
+  }
+  Schedule(index, std::max(now, viewer.play_start + viewer.next_segment * GetSegmentDuration()));
+}
+
+void Worker::UpdateEvents(size_t index, bool want_write) {
+  const Viewer& viewer = viewers_[index];
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  ev.data.u64 = index;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, viewer.fd, &ev);
+}
+
+uint64_t Worker::GetSegmentDuration() const {
+  return static_cast<uint64_t>(options_.segment_duration * 1000000 / options_.speed);
+}
+
+size_t Worker::PickChannel(const Account& account) {
+  return account.channels[std::uniform_int_distribution<size_t>(0, account.channels.size() - 1)(random_)];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << HELP_TEXT << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Account> accounts;
+  std::vector<Channel> channels;
+  if (!tools::LoadAccounts(options.mongodb_url, options.users, &accounts, &channels) || accounts.empty()) {
+    std::cerr << "No subscribers with devices and streams found, url: " << options.mongodb_url << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (options.viewers > accounts.size()) {
+    std::cerr << "Only " << accounts.size() << " user devices found, viewers sharing a device will be rejected"
+              << std::endl;
+  }
+
+  if (options.prepare) {
+    for (size_t i = 0; i < channels.size(); ++i) {
+      if (!PrepareChannel(options, channels[i])) {
+        std::cerr << "Can't prepare http root: " << channels[i].http_root << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    std::cout << "Prepared " << channels.size() << " channels" << std::endl;
+  }
+
+  std::atomic<bool> stop(false);
+  std::vector<Worker*> workers;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < options.threads; ++i) {
+    workers.push_back(new Worker(options, i, accounts, channels, &stop));
+  }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    threads.push_back(std::thread(&Worker::Run, workers[i]));
+  }
+
+  const uint64_t start = tools::GetMonotonicUsec();
+  uint64_t last_bytes = 0;
+  for (uint32_t sec = 1; sec <= options.duration; ++sec) {
+    sleep(1);
+    if (options.report_interval && sec % options.report_interval == 0) {
+      uint64_t completed = 0;
+      uint64_t errors = 0;
+      uint64_t bytes = 0;
+      for (size_t i = 0; i < workers.size(); ++i) {
+        completed += workers[i]->GetCompleted();
+        errors += workers[i]->GetErrors();
+        bytes += workers[i]->GetBytes();
+      }
+      const double mbits = static_cast<double>(bytes - last_bytes) * 8 / options.report_interval / 1000000;
+      std::cout << sec << "s requests: " << completed << ", errors: " << errors << ", mbit/s: " << mbits << std::endl;
+      last_bytes = bytes;
+    }
+  }
+
+  stop = true;
+  tools::LoadStats total;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    threads[i].join();
+    total.Merge(workers[i]->GetStats());
+    delete workers[i];
+  }
+
+  const double elapsed = static_cast<double>(tools::GetMonotonicUsec() - start) / 1000000;
+  total.Print(std::cout, elapsed);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/load_accounts.h"
+
+#include <string.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "mongo/mongo2info.h"
+#include "mongo/mongo_engine.h"
+
+#define DB_NAME "iptv"
+#define SUBSCRIBERS_COLLECTION "subscribers"
+#define STREAMS_COLLECTION "streams"
+
+namespace {
+namespace mongo = fastocloud::server::mongo;
+using fastocloud::server::tools::Channel;
+
+typedef std::unique_ptr<bson_t, mongo::MongoQueryDeleter> unique_ptr_bson_t;
+typedef std::unique_ptr<mongoc_cursor_t, mongo::MongoCursorDeleter> unique_ptr_cursor_t;
+
+bool IsProxyStream(const char* cls) {
+  return strstr(cls, "ProxyStream") || strstr(cls, "ProxyVodStream");
+}
+
+bool LoadStreamChannels(mongoc_collection_t* streams, const bson_oid_t* sid, std::vector<Channel>* channels) {
+  const unique_ptr_bson_t query(BCON_NEW("_id", BCON_OID(sid)));
+  const unique_ptr_cursor_t cursor(
+      mongoc_collection_find(streams, MONGOC_QUERY_NONE, 0, 1, 0, query.get(), NULL, NULL));
+  const bson_t* doc;
+  if (!cursor || !mongoc_cursor_next(cursor.get(), &doc)) {
+    return false;
+  }
+
+  bson_iter_t bcls;
+  bson_iter_t boutput;
+  if (!bson_iter_init_find(&bcls, doc, STREAM_CLS_FIELD) || !BSON_ITER_HOLDS_UTF8(&bcls) ||
+      !bson_iter_init_find(&boutput, doc, STREAM_OUTPUT_FIELD)) {
+    return false;
+  }
+
+  std::vector<fastotv::OutputUri> urls;
+  if (!mongo::GetOutputUrlData(&boutput, &urls)) {
+    return false;
+  }
+
+  const bool proxy = IsProxyStream(bson_iter_utf8(&bcls, NULL));
+  for (size_t i = 0; i < urls.size(); ++i) {
+    Channel channel;
+    channel.sid = common::ConvertToString(sid);
+    channel.cid = urls[i].GetID();
+    channel.http_root = urls[i].GetHttpRoot().GetPath();
+    channel.proxy = proxy;
+    channels->push_back(channel);
+  }
+  return true;
+}
+
+std::vector<bson_oid_t> GetOids(const bson_t* doc, const char* array_field, const char* id_field) {
+  std::vector<bson_oid_t> result;
+  bson_iter_t iter;
+  bson_iter_t ar;
+  if (!bson_iter_init_find(&iter, doc, array_field) || !BSON_ITER_HOLDS_ARRAY(&iter) ||
+      !bson_iter_recurse(&iter, &ar)) {
+    return result;
+  }
+
+  while (bson_iter_next(&ar)) {
+    bson_iter_t bid;
+    if (BSON_ITER_HOLDS_DOCUMENT(&ar) && bson_iter_recurse(&ar, &bid) && bson_iter_find(&bid, id_field) &&
+        BSON_ITER_HOLDS_OID(&bid)) {
+      result.push_back(*bson_iter_oid(&bid));
+    }
+  }
+  return result;
+}
+}  // namespace
+
+namespace fastocloud {
+namespace server {
+namespace tools {
+
+bool LoadAccounts(const std::string& mongodb_url,
+                  size_t max_users,
+                  std::vector<Account>* accounts,
+                  std::vector<Channel>* channels) {
+  mongoc_client_t* client = mongo::MongoEngine::GetInstance().Connect(mongodb_url);
+  if (!client) {
+    return false;
+  }
+
+  mongoc_collection_t* subscribers = mongoc_client_get_collection(client, DB_NAME, SUBSCRIBERS_COLLECTION);
+  mongoc_collection_t* streams = mongoc_client_get_collection(client, DB_NAME, STREAMS_COLLECTION);
+  std::map<std::string, std::vector<size_t>> stream_channels;
+  {
+    const unique_ptr_bson_t query(bson_new());
+    const unique_ptr_cursor_t cursor(mongoc_collection_find(subscribers, MONGOC_QUERY_NONE, 0,
+                                                            static_cast<uint32_t>(max_users), 0, query.get(),
+                                                            NULL, NULL));
+    const bson_t* doc;
+    while (cursor && mongoc_cursor_next(cursor.get(), &doc)) {
+      bson_iter_t buid;
+      bson_iter_t bemail;
+      bson_iter_t bpassword;
+      if (!bson_iter_init_find(&buid, doc, "_id") || !BSON_ITER_HOLDS_OID(&buid) ||
+          !bson_iter_init_find(&bemail, doc, "email") || !BSON_ITER_HOLDS_UTF8(&bemail) ||
+          !bson_iter_init_find(&bpassword, doc, "password") || !BSON_ITER_HOLDS_UTF8(&bpassword)) {
+        continue;
+      }
+
+      std::vector<size_t> user_channels;
+      const std::vector<bson_oid_t> sids = GetOids(doc, "streams", "sid");
+      for (size_t i = 0; i < sids.size(); ++i) {
+        const std::string sid = common::ConvertToString(&sids[i]);
+        auto it = stream_channels.find(sid);
+        if (it == stream_channels.end()) {
+          const size_t first = channels->size();
+          LoadStreamChannels(streams, &sids[i], channels);
+          std::vector<size_t> indexes;
+          for (size_t j = first; j < channels->size(); ++j) {
+            indexes.push_back(j);
+          }
+          it = stream_channels.insert(std::make_pair(sid, indexes)).first;
+        }
+        user_channels.insert(user_channels.end(), it->second.begin(), it->second.end());
+      }
+      if (user_channels.empty()) {
+        continue;
+      }
+
+      const std::vector<bson_oid_t> devices = GetOids(doc, "devices", "_id");
+      for (size_t i = 0; i < devices.size(); ++i) {
+        Account account;
+        account.uid = common::ConvertToString(bson_iter_oid(&buid));
+        account.login = bson_iter_utf8(&bemail, NULL);
+        account.password = bson_iter_utf8(&bpassword, NULL);
+        account.device = common::ConvertToString(&devices[i]);
+        account.channels = user_channels;
+        accounts->push_back(account);
+      }
+    }
+  }
+
+  mongoc_collection_destroy(streams);
+  mongoc_collection_destroy(subscribers);
+  mongoc_client_destroy(client);
+  return true;
+}
+
+}  // namespace tools
+}  // namespace server
+}  // namespace fastocloud
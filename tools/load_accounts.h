@@ -0,0 +1,54 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include <fastotv/types.h>
+
+namespace fastocloud {
+namespace server {
+namespace tools {
+
+// one output of a stream, served from http_root or redirected for proxy streams
+struct Channel {
+  std::string sid;
+  fastotv::channel_id_t cid;
+  std::string http_root;
+  bool proxy;
+};
+
+// one device of a subscriber, clients of the same user must use different devices,
+// the service rejects a second connection of a device
+struct Account {
+  std::string uid;
+  std::string login;
+  std::string password;
+  std::string device;
+  std::vector<size_t> channels;  // indexes in channels list
+};
+
+// subscribers with at least one device and one stream output, at most max_users of them
+bool LoadAccounts(const std::string& mongodb_url,
+                  size_t max_users,
+                  std::vector<Account>* accounts,
+                  std::vector<Channel>* channels);
+
+}  // namespace tools
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,73 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/load_socket.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fastocloud {
+namespace server {
+namespace tools {
+
+bool ResolveAddress(const std::string& host, struct sockaddr_in* address) {
+  const size_t colon = host.rfind(':');
+  if (colon == std::string::npos || !address) {
+    return false;
+  }
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result = nullptr;
+  const std::string node = host.substr(0, colon);
+  const std::string service = host.substr(colon + 1);
+  if (getaddrinfo(node.c_str(), service.c_str(), &hints, &result) != 0 || !result) {
+    return false;
+  }
+
+  memcpy(address, result->ai_addr, sizeof(*address));
+  freeaddrinfo(result);
+  return true;
+}
+
+int StartConnect(const struct sockaddr_in& address) {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    return -1;
+  }
+
+  int nodelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+  if (connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) == -1 && errno != EINPROGRESS) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool IsConnected(int fd) {
+  int error = 0;
+  socklen_t len = sizeof(error);
+  return getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+}
+
+}  // namespace tools
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,36 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <netinet/in.h>
+
+#include <string>
+
+namespace fastocloud {
+namespace server {
+namespace tools {
+
+// host:port, names are resolved once at start
+bool ResolveAddress(const std::string& host, struct sockaddr_in* address);
+
+// non blocking tcp socket with connect in progress, -1 on failure
+int StartConnect(const struct sockaddr_in& address);
+
+// result of connect started by StartConnect, call when socket becomes writable
+bool IsConnected(int fd);
+
+}  // namespace tools
+}  // namespace server
+}  // namespace fastocloud
@@ -0,0 +1,182 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tools/load_stats.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+namespace fastocloud {
+namespace server {
+namespace tools {
+
+namespace {
+// 32 exact values + 32 sub buckets for every msb position from 5 to 63
+const size_t kBucketsCount = LatencyHistogram::sub_bucket_count * (64 - LatencyHistogram::sub_bucket_bits + 1);
+
+int GetMostSignificantBit(uint64_t value) {
+  return 63 - __builtin_clzll(value);
+}
+
+double ToMsec(uint64_t usec) {
+  return static_cast<double>(usec) / 1000.0;
+}
+}  // namespace
+
+uint64_t GetMonotonicUsec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(kBucketsCount, 0), count_(0), sum_(0), min_(std::numeric_limits<uint64_t>::max()), max_(0) {}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+  if (value < sub_bucket_count) {
+    return static_cast<size_t>(value);
+  }
+
+  const int msb = GetMostSignificantBit(value);
+  const int shift = msb - sub_bucket_bits;
+  const size_t sub = static_cast<size_t>(value >> shift) & (sub_bucket_count - 1);
+  return sub_bucket_count + static_cast<size_t>(shift) * sub_bucket_count + sub;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t index) {
+  if (index < sub_bucket_count) {
+    return index;
+  }
+
+  const size_t shift = (index - sub_bucket_count) / sub_bucket_count;
+  const uint64_t sub = (index - sub_bucket_count) % sub_bucket_count;
+  const uint64_t low = (sub_bucket_count + sub) << shift;
+  // middle of the bucket
+  return low + ((static_cast<uint64_t>(1) << shift) >> 1);
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  counts_[GetBucketIndex(value)]++;
+  count_++;
+  sum_ += value;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+  return count_;
+}
+
+uint64_t LatencyHistogram::GetMin() const {
+  return count_ ? min_ : 0;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+  return max_;
+}
+
+double LatencyHistogram::GetMean() const {
+  return count_ ? static_cast<double>(sum_) / count_ : 0;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+  if (!count_) {
+    return 0;
+  }
+
+  const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+  uint64_t rank = static_cast<uint64_t>(clamped / 100.0 * count_ + 0.5);
+  rank = std::max<uint64_t>(rank, 1);
+  if (rank >= count_) {
+    return max_;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(std::max(GetBucketValue(i), min_), max_);
+    }
+  }
+  return max_;
+}
+
+OperationStats::OperationStats() : requests(0), errors(0), bytes(0), latency() {}
+
+void OperationStats::Merge(const OperationStats& other) {
+  requests += other.requests;
+  errors += other.errors;
+  bytes += other.bytes;
+  latency.Merge(other.latency);
+}
+
+LoadStats::LoadStats() : operations_() {}
+
+void LoadStats::RecordSuccess(const std::string& operation, uint64_t latency_usec, size_t bytes) {
+  OperationStats& stats = operations_[operation];
+  stats.requests++;
+  stats.bytes += bytes;
+  stats.latency.Record(latency_usec);
+}
+
+void LoadStats::RecordError(const std::string& operation) {
+  OperationStats& stats = operations_[operation];
+  stats.requests++;
+  stats.errors++;
+}
+
+void LoadStats::Merge(const LoadStats& other) {
+  for (auto it = other.operations_.begin(); it != other.operations_.end(); ++it) {
+    operations_[it->first].Merge(it->second);
+  }
+}
+
+const LoadStats::operations_t& LoadStats::GetOperations() const {
+  return operations_;
+}
+
+void LoadStats::Print(std::ostream& out, double elapsed_sec) const {
+  const double elapsed = elapsed_sec > 0 ? elapsed_sec : 1;
+  out << std::left << std::setw(32) << "operation" << std::right << std::setw(10) << "requests" << std::setw(10)
+      << "rps" << std::setw(9) << "errors%" << std::setw(10) << "p50ms" << std::setw(10) << "p90ms" << std::setw(10)
+      << "p99ms" << std::setw(10) << "p99.9ms" << std::setw(10) << "maxms" << std::setw(10) << "MB/s" << std::endl;
+  out << std::fixed << std::setprecision(2);
+  for (auto it = operations_.begin(); it != operations_.end(); ++it) {
+    const OperationStats& stats = it->second;
+    const double errors = stats.requests ? static_cast<double>(stats.errors) * 100 / stats.requests : 0;
+    out << std::left << std::setw(32) << it->first << std::right << std::setw(10) << stats.requests << std::setw(10)
+        << stats.requests / elapsed << std::setw(9) << errors << std::setw(10)
+        << ToMsec(stats.latency.GetPercentile(50)) << std::setw(10) << ToMsec(stats.latency.GetPercentile(90))
+        << std::setw(10) << ToMsec(stats.latency.GetPercentile(99)) << std::setw(10)
+        << ToMsec(stats.latency.GetPercentile(99.9)) << std::setw(10) << ToMsec(stats.latency.GetMax())
+        << std::setw(10) << stats.bytes / elapsed / (1024 * 1024) << std::endl;
+  }
+}
+
+}  // namespace tools
+}  // namespace server
+}  // namespace fastocloud
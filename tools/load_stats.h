@@ -0,0 +1,93 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace fastocloud {
+namespace server {
+namespace tools {
+
+// steady clock, not affected by ntp steps during long runs
+uint64_t GetMonotonicUsec();
+
+// Log-linear buckets: values under 32 are exact, above that every power of two range
+// is split into 32 buckets, so any reported percentile is within ~3% of the real one.
+class LatencyHistogram {
+ public:
+  enum { sub_bucket_bits = 5, sub_bucket_count = 1 << sub_bucket_bits };
+
+  LatencyHistogram();
+
+  void Record(uint64_t value);
+  void Merge(const LatencyHistogram& other);
+
+  uint64_t GetCount() const;
+  uint64_t GetMin() const;
+  uint64_t GetMax() const;
+  double GetMean() const;
+  // percentile in [0, 100]
+  uint64_t GetPercentile(double percentile) const;
+
+ private:
+  static size_t GetBucketIndex(uint64_t value);
+  static uint64_t GetBucketValue(size_t index);
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+struct OperationStats {
+  OperationStats();
+
+  void Merge(const OperationStats& other);
+
+  uint64_t requests;
+  uint64_t errors;
+  uint64_t bytes;
+  LatencyHistogram latency;  // usec
+};
+
+// Per operation counters of one worker thread, workers are merged when the run is over.
+class LoadStats {
+ public:
+  typedef std::map<std::string, OperationStats> operations_t;
+
+  LoadStats();
+
+  void RecordSuccess(const std::string& operation, uint64_t latency_usec, size_t bytes = 0);
+  void RecordError(const std::string& operation);
+  void Merge(const LoadStats& other);
+
+  const operations_t& GetOperations() const;
+  // table with rate, error ratio and latency percentiles in msec
+  void Print(std::ostream& out, double elapsed_sec) const;
+
+ private:
+  operations_t operations_;
+};
+
+}  // namespace tools
+}  // namespace server
+}  // namespace fastocloud
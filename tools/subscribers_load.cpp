@@ -0,0 +1,817 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <common/daemon/commands/ping_info.h>
+#include <common/sprintf.h>
+#include <common/time.h>
+
+#include <fastotv/commands/commands.h>
+#include <fastotv/commands_info/auth_info.h>
+#include <fastotv/commands_info/recent_stream_time_info.h>
+#include <fastotv/commands_info/runtime_channel_info.h>
+
+#include "tools/load_socket.h"
+#include "tools/load_stats.h"
+
+#define HELP_TEXT                                                                            \
+  "Usage: fastocloud_subscribers_load [options]\n"                                           \
+  "  Simulates set-top boxes against subscribers_host of a running service.\n\n"             \
+  "    --host <ip:port>            subscribers host, default 127.0.0.1:6000\n"               \
+  "    --connections <n>           simultaneous boxes, default 1000\n"                       \
+  "    --threads <n>               worker threads, default 4\n"                              \
+  "    --arrival-rate <n>          new connections per second, default 100\n"                \
+  "    --duration <sec>            run time, default 60\n"                                   \
+  "    --think-min <msec>          min pause between box requests, default 1000\n"           \
+  "    --think-max <msec>          max pause between box requests, default 10000\n"          \
+  "    --session <sec>             mean box session before reconnect, 0 never, default 0\n"  \
+  "    --storm-interval <sec>      drop and reconnect boxes at once every interval, 0 off\n" \
+  "    --storm-fraction <0..1>     part of boxes dropped by a storm, default 0.5\n"          \
+  "    --timeout <msec>            request timeout, default 10000\n"                         \
+  "    --users <n>                 users in dataset, box i logs in as user i % n\n"          \
+  "    --login-format <fmt>        printf format of login, default user%zu@fastocloud.com\n" \
+  "    --password <password>       password of every user, default password\n"               \
+  "    --seed <n>                  random seed, default 1\n"                                 \
+  "    --report-interval <sec>     progress line period, default 5\n"
+
+namespace {
+namespace tools = fastocloud::server::tools;
+
+struct SigIgnInit {
+  SigIgnInit() { signal(SIGPIPE, SIG_IGN); }
+} sig_init;
+
+const char kConnectOperation[] = "connect";
+const char kDisconnectOperation[] = "disconnect";
+const char kTimeoutOperation[] = "timeout";
+const char kServerRequestOperation[] = "server_request";
+const size_t kFrameHeaderSize = 4;
+const size_t kReadBufferSize = 16 * 1024;
+const int kMaxEvents = 256;
+const uint64_t kPollIntervalUsec = 100000;
+// watching box actions: zap (runtime info + recent) or just mark recent, otherwise ping
+const int kZapPercent = 60;
+const int kRecentPercent = 30;
+
+struct Options {
+  Options();
+
+  struct sockaddr_in address;
+  size_t connections;
+  size_t threads;
+  double arrival_rate;
+  uint32_t duration;
+  uint32_t think_min;
+  uint32_t think_max;
+  uint32_t session;
+  uint32_t storm_interval;
+  double storm_fraction;
+  uint32_t timeout;
+  size_t users;
+  std::string login_format;
+  std::string password;
+  uint32_t seed;
+  uint32_t report_interval;
+};
+
+Options::Options()
+    : address(),
+      connections(1000),
+      threads(4),
+      arrival_rate(100),
+      duration(60),
+      think_min(1000),
+      think_max(10000),
+      session(0),
+      storm_interval(0),
+      storm_fraction(0.5),
+      timeout(10000),
+      users(0),
+      login_format("user%zu@fastocloud.com"),
+      password("password"),
+      seed(1),
+      report_interval(5) {}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  std::string host = "127.0.0.1:6000";
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0 || i + 1 == argc) {
+      return false;
+    }
+
+    const char* value = argv[++i];
+    if (strcmp(arg, "--host") == 0) {
+      host = value;
+    } else if (strcmp(arg, "--connections") == 0) {
+      options->connections = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--threads") == 0) {
+      options->threads = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--arrival-rate") == 0) {
+      options->arrival_rate = strtod(value, nullptr);
+    } else if (strcmp(arg, "--duration") == 0) {
+      options->duration = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--think-min") == 0) {
+      options->think_min = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--think-max") == 0) {
+      options->think_max = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--session") == 0) {
+      options->session = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--storm-interval") == 0) {
+      options->storm_interval = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--storm-fraction") == 0) {
+      options->storm_fraction = strtod(value, nullptr);
+    } else if (strcmp(arg, "--timeout") == 0) {
+      options->timeout = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--users") == 0) {
+      options->users = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--login-format") == 0) {
+      options->login_format = value;
+    } else if (strcmp(arg, "--password") == 0) {
+      options->password = value;
+    } else if (strcmp(arg, "--seed") == 0) {
+      options->seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--report-interval") == 0) {
+      options->report_interval = strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+
+  if (!options->connections || !options->threads || options->arrival_rate <= 0 ||
+      options->think_min > options->think_max) {
+    return false;
+  }
+  if (!options->users) {
+    options->users = options->connections;
+  }
+  return tools::ResolveAddress(host, &options->address);
+}
+
+template <typename T>
+std::string SerializeParams(const T& params) {
+  std::string result;
+  common::Error err = params.SerializeToString(&result);
+  if (err) {
+    return std::string();
+  }
+  return result;
+}
+
+void AppendFrame(const std::string& body, std::string* out) {
+  const uint32_t size = htonl(static_cast<uint32_t>(body.size()));
+  out->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out->append(body);
+}
+
+// ids of the first array found in result, either the result itself or one of its fields
+void CollectIDs(json_object* result, const char* field, std::vector<std::string>* ids) {
+  json_object* jarray = result;
+  if (result && json_object_is_type(result, json_type_object)) {
+    json_object_object_get_ex(result, field, &jarray);
+  }
+  if (!jarray || !json_object_is_type(jarray, json_type_array)) {
+    return;
+  }
+
+  const size_t count = json_object_array_length(jarray);
+  for (size_t i = 0; i < count; ++i) {
+    json_object* jitem = json_object_array_get_idx(jarray, i);
+    json_object* jid = nullptr;
+    if (json_object_object_get_ex(jitem, "id", &jid)) {
+      ids->push_back(json_object_get_string(jid));
+    }
+  }
+}
+
+enum BoxState {
+  BOX_IDLE = 0,
+  BOX_CONNECTING,
+  BOX_ACTIVATING,
+  BOX_LOGGING_IN,
+  BOX_GETTING_SERVER_INFO,
+  BOX_GETTING_CHANNELS,
+  BOX_WATCHING
+};
+
+struct Box {
+  Box();
+
+  int fd;
+  BoxState state;
+  size_t user;
+  size_t slot;  // boxes of the same user pick different devices
+  std::string device;
+  std::vector<std::string> channels;
+  std::string current_channel;
+
+  std::string input;
+  std::string output;
+  size_t output_offset;
+
+  uint64_t request_seq;
+  std::string pending_id;
+  const char* pending_method;
+  uint64_t pending_start;
+  uint64_t connect_start;
+  uint64_t session_end;
+  uint32_t timer_generation;
+};
+
+Box::Box()
+    : fd(-1),
+      state(BOX_IDLE),
+      user(0),
+      slot(0),
+      device(),
+      channels(),
+      current_channel(),
+      input(),
+      output(),
+      output_offset(0),
+      request_seq(0),
+      pending_id(),
+      pending_method(nullptr),
+      pending_start(0),
+      connect_start(0),
+      session_end(0),
+      timer_generation(0) {}
+
+struct BoxTimer {
+  uint64_t when;
+  size_t box;
+  uint32_t generation;
+
+  bool operator>(const BoxTimer& other) const { return when > other.when; }
+};
+
+// Drives its share of boxes on one epoll instance, boxes are plain state machines
+// advanced by responses and by think time timers.
+class Worker {
+ public:
+  Worker(const Options& options, size_t id, const std::atomic<bool>* stop, const std::atomic<uint32_t>* storm);
+  ~Worker();
+
+  void Run();
+
+  const tools::LoadStats& GetStats() const;
+  uint64_t GetCompleted() const;
+  uint64_t GetErrors() const;
+  size_t GetOnline() const;
+
+ private:
+  void Schedule(size_t index, uint64_t when);
+  void FireTimers(uint64_t now);
+  void CheckTimeouts(uint64_t now);
+  void RunStorm(uint64_t now);
+
+  void Connect(size_t index, uint64_t now);
+  void Disconnect(size_t index, const char* error_operation, uint64_t reconnect_at);
+  void OnEvent(size_t index, uint32_t events, uint64_t now);
+  bool ReadFrames(size_t index, uint64_t now);
+  void HandleFrame(size_t index, const std::string& frame, uint64_t now);
+  void HandleServerRequest(size_t index, json_object* jid, const char* method);
+  void HandleResponse(size_t index, json_object* jresult, bool failed, uint64_t now);
+  void DoBoxAction(size_t index, uint64_t now);
+
+  void SendRequest(size_t index, const char* method, const std::string& params, uint64_t now);
+  void Send(size_t index, const std::string& body);
+  bool Flush(size_t index);
+  void UpdateEvents(size_t index);
+
+  uint64_t GetThinkTime();
+  uint64_t GetSessionTime();
+  std::string GetLogin(const Box& box) const;
+
+  const Options& options_;
+  const size_t id_;
+  const std::atomic<bool>* stop_;
+  const std::atomic<uint32_t>* storm_;
+  uint32_t storm_seen_;
+  int epoll_fd_;
+  std::vector<Box> boxes_;
+  std::priority_queue<BoxTimer, std::vector<BoxTimer>, std::greater<BoxTimer>> timers_;
+  std::mt19937 random_;
+  tools::LoadStats stats_;
+  std::atomic<uint64_t> completed_;
+  std::atomic<uint64_t> errors_;
+  std::atomic<size_t> online_;
+};
+
+Worker::Worker(const Options& options,
+               size_t id,
+               const std::atomic<bool>* stop,
+               const std::atomic<uint32_t>* storm)
+    : options_(options),
+      id_(id),
+      stop_(stop),
+      storm_(storm),
+      storm_seen_(0),
+      epoll_fd_(epoll_create1(0)),
+      boxes_(),
+      timers_(),
+      random_(options.seed + static_cast<uint32_t>(id)),
+      stats_(),
+      completed_(0),
+      errors_(0),
+      online_(0) {
+  // global box k belongs to worker k % threads and arrives at k / arrival_rate
+  const uint64_t start = tools::GetMonotonicUsec();
+  for (size_t k = id; k < options.connections; k += options.threads) {
+    Box box;
+    box.user = k % options.users;
+    box.slot = k / options.users;
+    boxes_.push_back(box);
+    Schedule(boxes_.size() - 1, start + static_cast<uint64_t>(k * 1000000 / options.arrival_rate));
+  }
+}
+
+Worker::~Worker() {
+  for (size_t i = 0; i < boxes_.size(); ++i) {
+    if (boxes_[i].fd != -1) {
+      close(boxes_[i].fd);
+    }
+  }
+  if (epoll_fd_ != -1) {
+    close(epoll_fd_);
+  }
+}
+
+void Worker::Run() {
+  struct epoll_event events[kMaxEvents];
+  uint64_t last_timeout_check = tools::GetMonotonicUsec();
+  while (!*stop_) {
+    uint64_t now = tools::GetMonotonicUsec();
+    uint64_t wait = kPollIntervalUsec;
+    if (!timers_.empty()) {
+      wait = timers_.top().when > now ? std::min(wait, timers_.top().when - now) : 0;
+    }
+
+    const int count = epoll_wait(epoll_fd_, events, kMaxEvents, static_cast<int>(wait / 1000));
+    now = tools::GetMonotonicUsec();
+    for (int i = 0; i < count; ++i) {
+      OnEvent(events[i].data.u64, events[i].events, now);
+    }
+
+    FireTimers(now);
+    const uint32_t storm = *storm_;
+    if (storm != storm_seen_) {
+      storm_seen_ = storm;
+      RunStorm(now);
+    }
+    if (now - last_timeout_check >= 1000000) {
+      last_timeout_check = now;
+      CheckTimeouts(now);
+    }
+  }
+}
+
+const tools::LoadStats& Worker::GetStats() const {
+  return stats_;
+}
+
+uint64_t Worker::GetCompleted() const {
+  return completed_;
+}
+
+uint64_t Worker::GetErrors() const {
+  return errors_;
+}
+
+size_t Worker::GetOnline() const {
+  return online_;
+}
+
+void Worker::Schedule(size_t index, uint64_t when) {
+  Box& box = boxes_[index];
+  box.timer_generation++;
+  timers_.push({when, index, box.timer_generation});
+}
+
+void Worker::FireTimers(uint64_t now) {
+  while (!timers_.empty() && timers_.top().when <= now) {
+    const BoxTimer timer = timers_.top();
+    timers_.pop();
+    Box& box = boxes_[timer.box];
+    if (timer.generation != box.timer_generation) {
+      continue;
+    }
+
+    if (box.state == BOX_IDLE) {
+      Connect(timer.box, now);
+    } else if (box.state == BOX_WATCHING && !box.pending_method) {
+      DoBoxAction(timer.box, now);
+    }
+  }
+}
+
+void Worker::CheckTimeouts(uint64_t now) {
+  const uint64_t timeout = static_cast<uint64_t>(options_.timeout) * 1000;
+  for (size_t i = 0; i < boxes_.size(); ++i) {
+    const Box& box = boxes_[i];
+    const uint64_t start = box.state == BOX_CONNECTING ? box.connect_start : box.pending_start;
+    const bool waiting = box.state == BOX_CONNECTING || box.pending_method;
+    if (waiting && now - start >= timeout) {
+      Disconnect(i, kTimeoutOperation, now + GetThinkTime());
+    }
+  }
+}
+
+void Worker::RunStorm(uint64_t now) {
+  std::uniform_real_distribution<double> dist(0, 1);
+  for (size_t i = 0; i < boxes_.size(); ++i) {
+    if (boxes_[i].state != BOX_IDLE && dist(random_) < options_.storm_fraction) {
+      // every dropped box comes back at the same moment, like after an edge restart
+      Disconnect(i, nullptr, now);
+    }
+  }
+}
+
+void Worker::Connect(size_t index, uint64_t now) {
+  Box& box = boxes_[index];
+  box.fd = tools::StartConnect(options_.address);
+  if (box.fd == -1) {
+    Disconnect(index, kConnectOperation, now + GetThinkTime());
+    return;
+  }
+
+  box.connect_start = now;
+  box.state = BOX_CONNECTING;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT;
+  ev.data.u64 = index;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, box.fd, &ev);
+}
+
+void Worker::Disconnect(size_t index, const char* error_operation, uint64_t reconnect_at) {
+  Box& box = boxes_[index];
+  if (error_operation) {
+    stats_.RecordError(error_operation);
+    errors_++;
+  }
+  if (error_operation && box.pending_method) {
+    stats_.RecordError(box.pending_method);
+    errors_++;
+  }
+  if (box.state >= BOX_GETTING_SERVER_INFO) {
+    online_--;
+  }
+  if (box.fd != -1) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, box.fd, nullptr);
+    close(box.fd);
+  }
+
+  const size_t user = box.user;
+  const size_t slot = box.slot;
+  box = Box();
+  box.user = user;
+  box.slot = slot;
+  Schedule(index, reconnect_at);
+}
+
+void Worker::OnEvent(size_t index, uint32_t events, uint64_t now) {
+  Box& box = boxes_[index];
+  if (box.fd == -1) {
+    // dropped earlier in this batch
+    return;
+  }
+  if (box.state == BOX_CONNECTING) {
+    if ((events & (EPOLLERR | EPOLLHUP)) || !tools::IsConnected(box.fd)) {
+      Disconnect(index, kConnectOperation, now + GetThinkTime());
+      return;
+    }
+
+    stats_.RecordSuccess(kConnectOperation, now - box.connect_start);
+    box.state = BOX_ACTIVATING;
+    SendRequest(index, CLIENT_ACTIVATE_DEVICE,
+                SerializeParams(fastotv::commands_info::LoginInfo(GetLogin(box), options_.password)), now);
+    return;
+  }
+
+  if (events & EPOLLOUT) {
+    if (!Flush(index)) {
+      Disconnect(index, kDisconnectOperation, now + GetThinkTime());
+      return;
+    }
+  }
+  if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+    if (!ReadFrames(index, now)) {
+      Disconnect(index, kDisconnectOperation, now + GetThinkTime());
+    }
+  }
+}
+
+bool Worker::ReadFrames(size_t index, uint64_t now) {
+  char buffer[kReadBufferSize];
+  while (true) {
+    const ssize_t nread = read(boxes_[index].fd, buffer, sizeof(buffer));
+    if (nread == 0) {
+      return false;
+    }
+    if (nread == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return false;
+    }
+    boxes_[index].input.append(buffer, nread);
+  }
+
+  while (true) {
+    // handling may disconnect the box and reset its buffers
+    Box& box = boxes_[index];
+    if (box.fd == -1 || box.input.size() < kFrameHeaderSize) {
+      break;
+    }
+
+    uint32_t size;
+    memcpy(&size, box.input.data(), sizeof(size));
+    size = ntohl(size);
+    if (box.input.size() < kFrameHeaderSize + size) {
+      break;
+    }
+
+    const std::string frame = box.input.substr(kFrameHeaderSize, size);
+    box.input.erase(0, kFrameHeaderSize + size);
+    HandleFrame(index, frame, now);
+  }
+  return true;
+}
+
+void Worker::HandleFrame(size_t index, const std::string& frame, uint64_t now) {
+  json_object* jframe = json_tokener_parse(frame.c_str());
+  if (!jframe) {
+    Disconnect(index, kDisconnectOperation, now + GetThinkTime());
+    return;
+  }
+
+  json_object* jid = nullptr;
+  json_object_object_get_ex(jframe, "id", &jid);
+  json_object* jmethod = nullptr;
+  if (json_object_object_get_ex(jframe, "method", &jmethod)) {
+    HandleServerRequest(index, jid, json_object_get_string(jmethod));
+    json_object_put(jframe);
+    return;
+  }
+
+  Box& box = boxes_[index];
+  if (!box.pending_method || !jid || box.pending_id != json_object_get_string(jid)) {
+    json_object_put(jframe);
+    return;
+  }
+
+  json_object* jresult = nullptr;
+  json_object_object_get_ex(jframe, "result", &jresult);
+  json_object* jerror = nullptr;
+  const bool failed = json_object_object_get_ex(jframe, "error", &jerror) && jerror;
+  HandleResponse(index, jresult, failed, now);
+  json_object_put(jframe);
+}
+
+void Worker::HandleServerRequest(size_t index, json_object* jid, const char* method) {
+  if (!jid) {
+    return;
+  }
+
+  const std::string id = json_object_to_json_string_ext(jid, JSON_C_TO_STRING_PLAIN);
+  stats_.RecordSuccess(kServerRequestOperation, 0);
+  if (strcmp(method, SERVER_PING) == 0) {
+    const std::string result = SerializeParams(common::daemon::commands::ClientPingInfo());
+    Send(index, "{\"jsonrpc\":\"2.0\",\"id\":" + id + ",\"result\":" + result + "}");
+    return;
+  }
+
+  // boxes answer SERVER_GET_CLIENT_INFO with hardware details, the server keeps going without them
+  Send(index, "{\"jsonrpc\":\"2.0\",\"id\":" + id +
+                  ",\"error\":{\"code\":-32601,\"message\":\"Not supported by load generator\"}}");
+}
+
+void Worker::HandleResponse(size_t index, json_object* jresult, bool failed, uint64_t now) {
+  Box& box = boxes_[index];
+  const char* method = box.pending_method;
+  box.pending_method = nullptr;
+  if (failed) {
+    stats_.RecordError(method);
+    errors_++;
+    if (box.state != BOX_WATCHING) {
+      Disconnect(index, nullptr, now + GetThinkTime());
+      return;
+    }
+    Schedule(index, now + GetThinkTime());
+    return;
+  }
+
+  stats_.RecordSuccess(method, now - box.pending_start);
+  completed_++;
+  if (box.state == BOX_ACTIVATING) {
+    std::vector<std::string> devices;
+    CollectIDs(jresult, "devices", &devices);
+    if (devices.empty()) {
+      Disconnect(index, CLIENT_ACTIVATE_DEVICE, now + GetThinkTime());
+      return;
+    }
+    box.device = devices[box.slot % devices.size()];
+    box.state = BOX_LOGGING_IN;
+    const fastotv::commands_info::AuthInfo auth(fastotv::commands_info::LoginInfo(GetLogin(box), options_.password),
+                                                box.device);
+    SendRequest(index, CLIENT_LOGIN, SerializeParams(auth), now);
+  } else if (box.state == BOX_LOGGING_IN) {
+    box.state = BOX_GETTING_SERVER_INFO;
+    online_++;
+    SendRequest(index, CLIENT_GET_SERVER_INFO, std::string(), now);
+  } else if (box.state == BOX_GETTING_SERVER_INFO) {
+    box.state = BOX_GETTING_CHANNELS;
+    SendRequest(index, CLIENT_GET_CHANNELS, std::string(), now);
+  } else if (box.state == BOX_GETTING_CHANNELS) {
+    CollectIDs(jresult, "channels", &box.channels);
+    box.state = BOX_WATCHING;
+    const uint64_t session = GetSessionTime();
+    box.session_end = session ? now + session : 0;
+    Schedule(index, now + GetThinkTime());
+  } else {
+    Schedule(index, now + GetThinkTime());
+  }
+}
+
+void Worker::DoBoxAction(size_t index, uint64_t now) {
+  Box& box = boxes_[index];
+  if (box.session_end && now >= box.session_end) {
+    Disconnect(index, nullptr, now + GetThinkTime());
+    return;
+  }
+
+  const int action = std::uniform_int_distribution<int>(0, 99)(random_);
+  if (box.channels.empty() || action >= kZapPercent + kRecentPercent) {
+    SendRequest(index, CLIENT_PING, SerializeParams(common::daemon::commands::ClientPingInfo()), now);
+    return;
+  }
+
+  if (action < kZapPercent || box.current_channel.empty()) {
+    box.current_channel = box.channels[std::uniform_int_distribution<size_t>(0, box.channels.size() - 1)(random_)];
+    SendRequest(index, CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                SerializeParams(fastotv::commands_info::RuntimeChannelLiteInfo(box.current_channel)), now);
+    return;
+  }
+
+  SendRequest(index, CLIENT_SET_RECENT,
+              SerializeParams(fastotv::commands_info::RecentStreamTimeInfo(box.current_channel,
+                                                                           common::time::current_utc_mstime())),
+              now);
+}
+
+void Worker::SendRequest(size_t index, const char* method, const std::string& params, uint64_t now) {
+  Box& box = boxes_[index];
+  box.pending_id = common::MemSPrintf("%zu-%llu", id_, static_cast<unsigned long long>(++box.request_seq));
+  box.pending_method = method;
+  box.pending_start = now;
+  std::string body = "{\"jsonrpc\":\"2.0\",\"id\":\"" + box.pending_id + "\",\"method\":\"" + method + "\"";
+  if (!params.empty()) {
+    body += ",\"params\":" + params;
+  }
+  body += "}";
+  Send(index, body);
+}
+
+void Worker::Send(size_t index, const std::string& body) {
+  Box& box = boxes_[index];
+  AppendFrame(body, &box.output);
+  if (!Flush(index)) {
+    Disconnect(index, kDisconnectOperation, tools::GetMonotonicUsec() + GetThinkTime());
+  }
+}
+
+bool Worker::Flush(size_t index) {
+  Box& box = boxes_[index];
+  while (box.output_offset < box.output.size()) {
+    const ssize_t nwrite =
+        write(box.fd, box.output.data() + box.output_offset, box.output.size() - box.output_offset);
+    if (nwrite == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return false;
+    }
+    box.output_offset += nwrite;
+  }
+
+  if (box.output_offset == box.output.size()) {
+    box.output.clear();
+    box.output_offset = 0;
+  }
+  UpdateEvents(index);
+  return true;
+}
+
+void Worker::UpdateEvents(size_t index) {
+  const Box& box = boxes_[index];
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = box.output.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+  ev.data.u64 = index;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, box.fd, &ev);
+}
+
+uint64_t Worker::GetThinkTime() {
+  const uint32_t msec = std::uniform_int_distribution<uint32_t>(options_.think_min, options_.think_max)(random_);
+  return static_cast<uint64_t>(msec) * 1000;
+}
+
+uint64_t Worker::GetSessionTime() {
+  if (!options_.session) {
+    return 0;
+  }
+  std::exponential_distribution<double> dist(1.0 / options_.session);
+  return static_cast<uint64_t>(dist(random_) * 1000000);
+}
+
+std::string Worker::GetLogin(const Box& box) const {
+  return common::MemSPrintf(options_.login_format.c_str(), box.user);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << HELP_TEXT << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::atomic<bool> stop(false);
+  std::atomic<uint32_t> storm(0);
+  std::vector<Worker*> workers;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < options.threads; ++i) {
+    workers.push_back(new Worker(options, i, &stop, &storm));
+  }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    threads.push_back(std::thread(&Worker::Run, workers[i]));
+  }
+
+  const uint64_t start = tools::GetMonotonicUsec();
+  uint64_t last_completed = 0;
+  for (uint32_t sec = 1; sec <= options.duration; ++sec) {
+    sleep(1);
+    if (options.storm_interval && sec % options.storm_interval == 0) {
+      storm++;
+    }
+    if (options.report_interval && sec % options.report_interval == 0) {
+      uint64_t completed = 0;
+      uint64_t errors = 0;
+      size_t online = 0;
+      for (size_t i = 0; i < workers.size(); ++i) {
+        completed += workers[i]->GetCompleted();
+        errors += workers[i]->GetErrors();
+        online += workers[i]->GetOnline();
+      }
+      std::cout << sec << "s online: " << online << ", rps: " << (completed - last_completed) / options.report_interval
+                << ", errors: " << errors << std::endl;
+      last_completed = completed;
+    }
+  }
+
+  stop = true;
+  tools::LoadStats total;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    threads[i].join();
+    total.Merge(workers[i]->GetStats());
+    delete workers[i];
+  }
+
+  const double elapsed = static_cast<double>(tools::GetMonotonicUsec() - start) / 1000000;
+  total.Print(std::cout, elapsed);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,907 @@
+/*  Copyright (C) 2014-2020 FastoGT. All right reserved.
+    This file is part of fastocloud.
+    fastocloud is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    fastocloud is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with fastocloud.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <common/daemon/commands/ping_info.h>
+
+#include <fastotv/commands/commands.h>
+
+#include "base/traffic_capture.h"
+
+#include "tools/load_accounts.h"
+#include "tools/load_socket.h"
+#include "tools/load_stats.h"
+
+#define HELP_TEXT                                                                              \
+  "Usage: fastocloud_traffic_replay [options]\n"                                               \
+  "  Replays inbound traffic recorded by capture_path option of a service against a test\n"    \
+  "  instance. Captured pseudonyms of users and devices are mapped to accounts found in\n"     \
+  "  its database, captured responses are skipped, server pings are answered.\n\n"            \
+  "    --capture <path>            capture file, required\n"                                   \
+  "    --subscribers-host <ip:port> subscribers host, default 127.0.0.1:6000\n"                \
+  "    --http-host <ip:port>       http host, default 127.0.0.1:5001\n"                        \
+  "    --mongodb-url <url>         test database, default mongodb://localhost:27017\n"         \
+  "    --users <n>                 max subscribers to read from database, default 1000\n"      \
+  "    --speed <x>                 replay speed multiplier, default 1\n"                       \
+  "    --map-streams <0|1>         replace stream ids with streams of mapped users, default 1\n" \
+  "    --timeout <msec>            response timeout, default 10000\n"                          \
+  "    --report-interval <sec>     progress line period, default 5\n"
+
+#define JSONRPC_ID_FIELD "id"
+#define JSONRPC_METHOD_FIELD "method"
+#define JSONRPC_PARAMS_FIELD "params"
+#define JSONRPC_ERROR_FIELD "error"
+#define LOGIN_FIELD "login"
+#define PASSWORD_FIELD "password"
+#define DEVICE_ID_FIELD "device_id"
+#define STREAM_ID_FIELD "id"
+// replayer reads plain frames, see subscribers/compression.h
+#define COMPRESSION_FIELD "compression"
+
+namespace {
+namespace tools = fastocloud::server::tools;
+namespace base = fastocloud::server::base;
+
+struct SigIgnInit {
+  SigIgnInit() { signal(SIGPIPE, SIG_IGN); }
+} sig_init;
+
+const char kConnectOperation[] = "connect";
+const char kDisconnectOperation[] = "disconnect";
+const char kTimeoutOperation[] = "timeout";
+const char kBinaryOperation[] = "binary";
+const char kHttpPlaylistOperation[] = "http_playlist";
+const char kHttpSegmentOperation[] = "http_segment";
+const char kHttpOtherOperation[] = "http_other";
+const size_t kFrameHeaderSize = 4;
+const size_t kReadBufferSize = 16 * 1024;
+const int kMaxEvents = 256;
+const uint64_t kPollIntervalUsec = 100000;
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+struct Options {
+  Options();
+
+  std::string capture;
+  struct sockaddr_in subscribers_address;
+  struct sockaddr_in http_address;
+  std::string mongodb_url;
+  size_t users;
+  double speed;
+  bool map_streams;
+  uint32_t timeout;
+  uint32_t report_interval;
+};
+
+Options::Options()
+    : capture(),
+      subscribers_address(),
+      http_address(),
+      mongodb_url("mongodb://localhost:27017"),
+      users(1000),
+      speed(1),
+      map_streams(true),
+      timeout(10000),
+      report_interval(5) {}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  std::string subscribers_host = "127.0.0.1:6000";
+  std::string http_host = "127.0.0.1:5001";
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0 || i + 1 == argc) {
+      return false;
+    }
+
+    const char* value = argv[++i];
+    if (strcmp(arg, "--capture") == 0) {
+      options->capture = value;
+    } else if (strcmp(arg, "--subscribers-host") == 0) {
+      subscribers_host = value;
+    } else if (strcmp(arg, "--http-host") == 0) {
+      http_host = value;
+    } else if (strcmp(arg, "--mongodb-url") == 0) {
+      options->mongodb_url = value;
+    } else if (strcmp(arg, "--users") == 0) {
+      options->users = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--speed") == 0) {
+      options->speed = strtod(value, nullptr);
+    } else if (strcmp(arg, "--map-streams") == 0) {
+      options->map_streams = strtoul(value, nullptr, 10) != 0;
+    } else if (strcmp(arg, "--timeout") == 0) {
+      options->timeout = strtoul(value, nullptr, 10);
+    } else if (strcmp(arg, "--report-interval") == 0) {
+      options->report_interval = strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+
+  if (options->capture.empty() || options->speed <= 0 || !options->users) {
+    return false;
+  }
+  return tools::ResolveAddress(subscribers_host, &options->subscribers_address) &&
+         tools::ResolveAddress(http_host, &options->http_address);
+}
+
+// stable between runs, the same capture is replayed onto the same accounts
+uint64_t HashString(const std::string& value) {
+  uint64_t hash = kFnvOffsetBasis;
+  for (size_t i = 0; i < value.size(); ++i) {
+    hash ^= static_cast<uint8_t>(value[i]);
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+void AppendFrame(const std::string& body, std::string* out) {
+  const uint32_t size = htonl(static_cast<uint32_t>(body.size()));
+  out->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out->append(body);
+}
+
+const char* GetHttpOperation(const std::string& file) {
+  const size_t dot = file.rfind('.');
+  const std::string extension = dot == std::string::npos ? std::string() : file.substr(dot);
+  if (extension == ".m3u8") {
+    return kHttpPlaylistOperation;
+  }
+  if (extension == ".ts") {
+    return kHttpSegmentOperation;
+  }
+  return kHttpOtherOperation;
+}
+
+// subscriber with all its devices, accounts of the database are grouped by user
+struct User {
+  std::string uid;
+  std::string login;
+  std::string password;
+  std::vector<std::string> devices;
+  std::vector<size_t> channels;
+};
+
+struct PendingRequest {
+  std::string operation;
+  uint64_t start;
+  bool head;
+};
+
+struct Connection {
+  Connection();
+
+  int fd;
+  base::TrafficRecord::Source source;
+  bool connected;
+  bool closing;  // captured client closed, connection is closed once answers arrive
+  uint64_t connect_start;
+  const User* user;
+
+  std::string input;
+  std::string output;
+  size_t output_offset;
+
+  std::map<std::string, PendingRequest> pending;  // subscribers requests by json-rpc id
+  std::deque<PendingRequest> http_pending;        // http answers come in order
+  bool http_header_done;
+  int http_status;
+  int64_t http_body_left;  // -1 till close of connection
+  size_t http_body_size;
+};
+
+Connection::Connection()
+    : fd(-1),
+      source(base::TrafficRecord::SUBSCRIBERS_SOURCE),
+      connected(false),
+      closing(false),
+      connect_start(0),
+      user(nullptr),
+      input(),
+      output(),
+      output_offset(0),
+      pending(),
+      http_pending(),
+      http_header_done(false),
+      http_status(0),
+      http_body_left(0),
+      http_body_size(0) {}
+
+// Single epoll loop, captured connections are opened on their first frame and closed after their close record.
+class Replayer {
+ public:
+  Replayer(const Options& options,
+           const std::vector<tools::Account>& accounts,
+           const std::vector<tools::Channel>& channels);
+  ~Replayer();
+
+  common::ErrnoError Run(base::TrafficCaptureReader* reader) WARN_UNUSED_RESULT;
+
+  const tools::LoadStats& GetStats() const;
+
+ private:
+  typedef uint64_t connection_key_t;  // source and captured connection
+  typedef uint64_t connection_serial_t;
+
+  void Dispatch(const base::TrafficRecord& record, uint64_t now);
+  void DispatchSubscribers(Connection* conn, const std::string& payload, uint64_t now);
+  void DispatchHttp(Connection* conn, const std::string& payload, uint64_t now);
+  bool RewriteParams(Connection* conn, json_object* params);
+  std::string RewriteHttpRequest(Connection* conn, const std::string& request, std::string* file);
+
+  bool Open(connection_key_t key, base::TrafficRecord::Source source, uint64_t now, connection_serial_t* serial);
+  void Close(connection_serial_t serial, const char* error_operation);
+  void CloseIfDone(connection_serial_t serial);
+  void OnEvent(connection_serial_t serial, uint32_t events, uint64_t now);
+  bool Read(connection_serial_t serial, uint64_t now);
+  void HandleSubscribersFrame(Connection* conn, const std::string& frame, uint64_t now);
+  void HandleHttpInput(Connection* conn, bool eof, uint64_t now);
+  bool Flush(Connection* conn);
+  void UpdateEvents(connection_serial_t serial);
+  void CheckTimeouts(uint64_t now);
+  void Report(uint64_t now);
+
+  const User& MapUser(const std::string& pseudonym) const;
+  const std::string& MapDevice(const User& user, const std::string& pseudonym) const;
+  const tools::Channel& MapChannel(const User& user, const std::string& stream) const;
+
+  const Options& options_;
+  const std::vector<tools::Channel>& channels_;
+  std::vector<User> users_;
+  int epoll_fd_;
+  std::map<connection_serial_t, std::unique_ptr<Connection>> connections_;
+  std::map<connection_key_t, connection_serial_t> captured_;
+  connection_serial_t next_serial_;
+  tools::LoadStats stats_;
+  uint64_t start_;
+  uint64_t frames_;
+  uint64_t skipped_;
+  uint64_t responses_;
+  uint64_t errors_;
+};
+
+Replayer::Replayer(const Options& options,
+                   const std::vector<tools::Account>& accounts,
+                   const std::vector<tools::Channel>& channels)
+    : options_(options),
+      channels_(channels),
+      users_(),
+      epoll_fd_(epoll_create1(0)),
+      connections_(),
+      captured_(),
+      next_serial_(0),
+      stats_(),
+      start_(0),
+      frames_(0),
+      skipped_(0),
+      responses_(0),
+      errors_(0) {
+  std::map<std::string, size_t> indexes;
+  for (size_t i = 0; i < accounts.size(); ++i) {
+    const tools::Account& account = accounts[i];
+    auto it = indexes.find(account.uid);
+    if (it == indexes.end()) {
+      User user;
+      user.uid = account.uid;
+      user.login = account.login;
+      user.password = account.password;
+      user.channels = account.channels;
+      it = indexes.insert(std::make_pair(account.uid, users_.size())).first;
+      users_.push_back(user);
+    }
+    users_[it->second].devices.push_back(account.device);
+  }
+}
+
+Replayer::~Replayer() {
+  for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+    close(it->second->fd);
+  }
+  if (epoll_fd_ != -1) {
+    close(epoll_fd_);
+  }
+}
+
+common::ErrnoError Replayer::Run(base::TrafficCaptureReader* reader) {
+  struct epoll_event events[kMaxEvents];
+  base::TrafficRecord record;
+  bool has_record = reader->Next(&record);
+  if (!has_record) {
+    return common::make_errno_error("Capture file has no records", EINVAL);
+  }
+
+  start_ = tools::GetMonotonicUsec();
+  uint64_t last_timeout_check = start_;
+  uint64_t last_report = start_;
+  while (has_record || !connections_.empty()) {
+    uint64_t now = tools::GetMonotonicUsec();
+    uint64_t wait = kPollIntervalUsec;
+    if (has_record) {
+      const uint64_t due = start_ + static_cast<uint64_t>(record.offset_usec / options_.speed);
+      wait = due > now ? std::min(wait, due - now) : 0;
+    }
+
+    const int count = epoll_wait(epoll_fd_, events, kMaxEvents, static_cast<int>(wait / 1000));
+    now = tools::GetMonotonicUsec();
+    for (int i = 0; i < count; ++i) {
+      OnEvent(events[i].data.u64, events[i].events, now);
+    }
+
+    while (has_record && start_ + static_cast<uint64_t>(record.offset_usec / options_.speed) <= now) {
+      Dispatch(record, now);
+      has_record = reader->Next(&record);
+    }
+    if (!has_record && !captured_.empty()) {
+      // capture is over, wait for answers of what was sent
+      std::vector<connection_serial_t> serials;
+      for (auto it = captured_.begin(); it != captured_.end(); ++it) {
+        serials.push_back(it->second);
+      }
+      captured_.clear();
+      for (size_t i = 0; i < serials.size(); ++i) {
+        connections_[serials[i]]->closing = true;
+        CloseIfDone(serials[i]);
+      }
+    }
+
+    if (now - last_timeout_check >= 1000000) {
+      last_timeout_check = now;
+      CheckTimeouts(now);
+    }
+    if (options_.report_interval && now - last_report >= options_.report_interval * 1000000ULL) {
+      last_report = now;
+      Report(now);
+    }
+  }
+  return common::ErrnoError();
+}
+
+const tools::LoadStats& Replayer::GetStats() const {
+  return stats_;
+}
+
+void Replayer::Dispatch(const base::TrafficRecord& record, uint64_t now) {
+  const connection_key_t key = (static_cast<uint64_t>(record.source) << 32) | record.connection;
+  auto it = captured_.find(key);
+  if (record.kind == base::TrafficRecord::CLOSE_RECORD) {
+    if (it != captured_.end()) {
+      const connection_serial_t serial = it->second;
+      captured_.erase(it);
+      connections_[serial]->closing = true;
+      CloseIfDone(serial);
+    }
+    return;
+  }
+
+  connection_serial_t serial;
+  if (it != captured_.end()) {
+    serial = it->second;
+  } else if (!Open(key, record.source, now, &serial)) {
+    return;
+  }
+
+  frames_++;
+  Connection* conn = connections_[serial].get();
+  if (record.source == base::TrafficRecord::HTTP_SOURCE) {
+    DispatchHttp(conn, record.payload, now);
+  } else {
+    DispatchSubscribers(conn, record.payload, now);
+  }
+  if (!Flush(conn)) {
+    Close(serial, kDisconnectOperation);
+    return;
+  }
+  UpdateEvents(serial);
+}
+
+void Replayer::DispatchSubscribers(Connection* conn, const std::string& payload, uint64_t now) {
+  json_object* jframe = json_tokener_parse(payload.c_str());
+  if (!jframe || !json_object_is_type(jframe, json_type_object)) {
+    // msgpack requests of negotiated binary encoding go as is
+    if (jframe) {
+      json_object_put(jframe);
+    }
+    AppendFrame(payload, &conn->output);
+    stats_.RecordSuccess(kBinaryOperation, 0, payload.size());
+    return;
+  }
+
+  json_object* jmethod = nullptr;
+  json_object* jid = nullptr;
+  if (!json_object_object_get_ex(jframe, JSONRPC_METHOD_FIELD, &jmethod)) {
+    // answers of the captured client to server requests, test server asks its own
+    skipped_++;
+    json_object_put(jframe);
+    return;
+  }
+
+  json_object* jparams = nullptr;
+  if (json_object_object_get_ex(jframe, JSONRPC_PARAMS_FIELD, &jparams) && RewriteParams(conn, jparams)) {
+    AppendFrame(json_object_to_json_string_ext(jframe, JSON_C_TO_STRING_PLAIN), &conn->output);
+  } else {
+    AppendFrame(payload, &conn->output);
+  }
+
+  if (json_object_object_get_ex(jframe, JSONRPC_ID_FIELD, &jid) && !json_object_is_type(jid, json_type_null)) {
+    conn->pending[json_object_get_string(jid)] = {json_object_get_string(jmethod), now, false};
+  }
+  json_object_put(jframe);
+}
+
+void Replayer::DispatchHttp(Connection* conn, const std::string& payload, uint64_t now) {
+  std::string file;
+  const std::string request = RewriteHttpRequest(conn, payload, &file);
+  conn->output += request;
+  conn->http_pending.push_back({GetHttpOperation(file), now, request.compare(0, 5, "HEAD ") == 0});
+}
+
+bool Replayer::RewriteParams(Connection* conn, json_object* params) {
+  if (!json_object_is_type(params, json_type_object)) {
+    return false;
+  }
+
+  bool changed = false;
+  json_object* jlogin = nullptr;
+  if (json_object_object_get_ex(params, LOGIN_FIELD, &jlogin) && json_object_is_type(jlogin, json_type_string)) {
+    conn->user = &MapUser(json_object_get_string(jlogin));
+    json_object_object_add(params, LOGIN_FIELD, json_object_new_string(conn->user->login.c_str()));
+    changed = true;
+  }
+  if (!conn->user) {
+    return changed;
+  }
+
+  json_object* jvalue = nullptr;
+  if (json_object_object_get_ex(params, PASSWORD_FIELD, &jvalue)) {
+    json_object_object_add(params, PASSWORD_FIELD, json_object_new_string(conn->user->password.c_str()));
+    changed = true;
+  }
+  if (json_object_object_get_ex(params, DEVICE_ID_FIELD, &jvalue) && json_object_is_type(jvalue, json_type_string)) {
+    const std::string& device = MapDevice(*conn->user, json_object_get_string(jvalue));
+    json_object_object_add(params, DEVICE_ID_FIELD, json_object_new_string(device.c_str()));
+    changed = true;
+  }
+  if (json_object_object_get_ex(params, COMPRESSION_FIELD, &jvalue)) {
+    json_object_object_del(params, COMPRESSION_FIELD);
+    changed = true;
+  }
+  if (options_.map_streams && json_object_object_get_ex(params, STREAM_ID_FIELD, &jvalue) &&
+      json_object_is_type(jvalue, json_type_string)) {
+    const tools::Channel& channel = MapChannel(*conn->user, json_object_get_string(jvalue));
+    json_object_object_add(params, STREAM_ID_FIELD, json_object_new_string(channel.sid.c_str()));
+    changed = true;
+  }
+  return changed;
+}
+
+std::string Replayer::RewriteHttpRequest(Connection* conn, const std::string& request, std::string* file) {
+  // GET /user_id/password_hash/device_id/stream_id/channel_id/file HTTP/1.1
+  const size_t line_end = request.find("\r\n");
+  const std::string line = request.substr(0, line_end);
+  const size_t path_start = line.find(" /");
+  const size_t path_end = line.rfind(' ');
+  if (path_start == std::string::npos || path_end <= path_start + 1) {
+    return request;
+  }
+
+  std::vector<std::string> tokens;
+  const std::string path = line.substr(path_start + 2, path_end - path_start - 2);
+  size_t token_start = 0;
+  while (token_start <= path.size()) {
+    size_t token_end = path.find('/', token_start);
+    if (token_end == std::string::npos) {
+      token_end = path.size();
+    }
+    tokens.push_back(path.substr(token_start, token_end - token_start));
+    token_start = token_end + 1;
+  }
+  *file = tokens.back();
+  if (tokens.size() < 3) {
+    return request;
+  }
+
+  conn->user = &MapUser(tokens[0]);
+  tokens[0] = conn->user->uid;
+  tokens[1] = conn->user->password;
+  tokens[2] = MapDevice(*conn->user, tokens[2]);
+  if (options_.map_streams && tokens.size() > 4) {
+    const tools::Channel& channel = MapChannel(*conn->user, tokens[3] + "/" + tokens[4]);
+    tokens[3] = channel.sid;
+    tokens[4] = std::to_string(channel.cid);
+  }
+
+  std::string result = line.substr(0, path_start + 1);
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    result += "/" + tokens[i];
+  }
+  result += line.substr(path_end);
+  if (line_end != std::string::npos) {
+    result += request.substr(line_end);
+  }
+  return result;
+}
+
+bool Replayer::Open(connection_key_t key,
+                    base::TrafficRecord::Source source,
+                    uint64_t now,
+                    connection_serial_t* serial) {
+  const int fd = tools::StartConnect(source == base::TrafficRecord::HTTP_SOURCE ? options_.http_address
+                                                                                : options_.subscribers_address);
+  if (fd == -1) {
+    stats_.RecordError(kConnectOperation);
+    errors_++;
+    return false;
+  }
+
+  *serial = next_serial_++;
+  Connection* conn = new Connection;
+  conn->fd = fd;
+  conn->source = source;
+  conn->connect_start = now;
+  connections_[*serial].reset(conn);
+  captured_[key] = *serial;
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT;
+  ev.data.u64 = *serial;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+  return true;
+}
+
+void Replayer::Close(connection_serial_t serial, const char* error_operation) {
+  auto it = connections_.find(serial);
+  if (it == connections_.end()) {
+    return;
+  }
+
+  Connection* conn = it->second.get();
+  if (error_operation) {
+    stats_.RecordError(error_operation);
+    errors_++;
+  }
+  // requests left without answer
+  for (auto pit = conn->pending.begin(); pit != conn->pending.end(); ++pit) {
+    stats_.RecordError(pit->second.operation);
+    errors_++;
+  }
+  for (size_t i = 0; i < conn->http_pending.size(); ++i) {
+    stats_.RecordError(conn->http_pending[i].operation);
+    errors_++;
+  }
+
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->fd, nullptr);
+  close(conn->fd);
+  for (auto cit = captured_.begin(); cit != captured_.end(); ++cit) {
+    if (cit->second == serial) {
+      captured_.erase(cit);
+      break;
+    }
+  }
+  connections_.erase(it);
+}
+
+void Replayer::CloseIfDone(connection_serial_t serial) {
+  const Connection* conn = connections_[serial].get();
+  if (conn->closing && conn->pending.empty() && conn->http_pending.empty() &&
+      conn->output_offset == conn->output.size()) {
+    Close(serial, nullptr);
+  }
+}
+
+void Replayer::OnEvent(connection_serial_t serial, uint32_t events, uint64_t now) {
+  auto it = connections_.find(serial);
+  if (it == connections_.end()) {
+    // closed earlier in this batch
+    return;
+  }
+
+  Connection* conn = it->second.get();
+  if (!conn->connected) {
+    if ((events & (EPOLLERR | EPOLLHUP)) || !tools::IsConnected(conn->fd)) {
+      Close(serial, kConnectOperation);
+      return;
+    }
+    stats_.RecordSuccess(kConnectOperation, now - conn->connect_start);
+    conn->connected = true;
+  }
+
+  if ((events & EPOLLIN) && !Read(serial, now)) {
+    return;
+  }
+  if (connections_.find(serial) == connections_.end()) {
+    return;
+  }
+  if (!Flush(conn)) {
+    Close(serial, kDisconnectOperation);
+    return;
+  }
+  UpdateEvents(serial);
+  CloseIfDone(serial);
+}
+
+bool Replayer::Read(connection_serial_t serial, uint64_t now) {
+  Connection* conn = connections_[serial].get();
+  char buffer[kReadBufferSize];
+  bool eof = false;
+  while (true) {
+    const ssize_t nread = read(conn->fd, buffer, sizeof(buffer));
+    if (nread == 0) {
+      eof = true;
+      break;
+    }
+    if (nread == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      eof = true;
+      break;
+    }
+    conn->input.append(buffer, nread);
+  }
+
+  if (conn->source == base::TrafficRecord::HTTP_SOURCE) {
+    HandleHttpInput(conn, eof, now);
+  } else {
+    while (conn->input.size() >= kFrameHeaderSize) {
+      uint32_t size;
+      memcpy(&size, conn->input.data(), sizeof(size));
+      size = ntohl(size);
+      if (conn->input.size() < kFrameHeaderSize + size) {
+        break;
+      }
+
+      const std::string frame = conn->input.substr(kFrameHeaderSize, size);
+      conn->input.erase(0, kFrameHeaderSize + size);
+      HandleSubscribersFrame(conn, frame, now);
+    }
+  }
+
+  if (eof) {
+    // http server closes connections without keep-alive, unanswered requests are counted by Close
+    const bool expected = conn->closing || conn->source == base::TrafficRecord::HTTP_SOURCE;
+    Close(serial, expected ? nullptr : kDisconnectOperation);
+    return false;
+  }
+  return true;
+}
+
+void Replayer::HandleSubscribersFrame(Connection* conn, const std::string& frame, uint64_t now) {
+  json_object* jframe = json_tokener_parse(frame.c_str());
+  if (!jframe) {
+    // binary answers are not matched
+    return;
+  }
+
+  json_object* jid = nullptr;
+  json_object_object_get_ex(jframe, JSONRPC_ID_FIELD, &jid);
+  json_object* jmethod = nullptr;
+  if (json_object_object_get_ex(jframe, JSONRPC_METHOD_FIELD, &jmethod)) {
+    if (jid && strcmp(json_object_get_string(jmethod), SERVER_PING) == 0) {
+      std::string result;
+      common::Error err = common::daemon::commands::ClientPingInfo().SerializeToString(&result);
+      if (!err) {
+        const std::string id = json_object_to_json_string_ext(jid, JSON_C_TO_STRING_PLAIN);
+        AppendFrame("{\"jsonrpc\":\"2.0\",\"id\":" + id + ",\"result\":" + result + "}", &conn->output);
+      }
+    }
+    json_object_put(jframe);
+    return;
+  }
+
+  auto it = jid ? conn->pending.find(json_object_get_string(jid)) : conn->pending.end();
+  if (it != conn->pending.end()) {
+    json_object* jerror = nullptr;
+    if (json_object_object_get_ex(jframe, JSONRPC_ERROR_FIELD, &jerror) && jerror) {
+      stats_.RecordError(it->second.operation);
+      errors_++;
+    } else {
+      stats_.RecordSuccess(it->second.operation, now - it->second.start, frame.size());
+      responses_++;
+    }
+    conn->pending.erase(it);
+  }
+  json_object_put(jframe);
+}
+
+void Replayer::HandleHttpInput(Connection* conn, bool eof, uint64_t now) {
+  while (!conn->http_pending.empty()) {
+    if (!conn->http_header_done) {
+      const size_t header_end = conn->input.find("\r\n\r\n");
+      if (header_end == std::string::npos) {
+        return;
+      }
+
+      const std::string header = conn->input.substr(0, header_end);
+      conn->input.erase(0, header_end + 4);
+      conn->http_header_done = true;
+      const size_t space = header.find(' ');
+      conn->http_status = space == std::string::npos ? 0 : atoi(header.c_str() + space + 1);
+      conn->http_body_left = -1;
+      conn->http_body_size = 0;
+      for (size_t pos = header.find("\r\n"); pos != std::string::npos; pos = header.find("\r\n", pos + 2)) {
+        static const char kContentLength[] = "Content-Length:";
+        if (strncasecmp(header.c_str() + pos + 2, kContentLength, sizeof(kContentLength) - 1) == 0) {
+          conn->http_body_left = strtoll(header.c_str() + pos + 2 + sizeof(kContentLength) - 1, nullptr, 10);
+        }
+      }
+      // redirects of proxy streams come without body
+      const bool no_body = conn->http_pending.front().head || conn->http_status == 204 || conn->http_status == 304 ||
+                           (conn->http_status >= 300 && conn->http_status < 400);
+      if (no_body && conn->http_body_left == -1) {
+        conn->http_body_left = 0;
+      }
+    }
+
+    if (conn->http_body_left == -1) {
+      conn->http_body_size += conn->input.size();
+      conn->input.clear();
+      if (!eof) {
+        return;
+      }
+    } else {
+      const size_t consumed = std::min(conn->input.size(), static_cast<size_t>(conn->http_body_left));
+      conn->input.erase(0, consumed);
+      conn->http_body_left -= consumed;
+      conn->http_body_size += consumed;
+      if (conn->http_body_left) {
+        return;
+      }
+    }
+
+    const PendingRequest request = conn->http_pending.front();
+    conn->http_pending.pop_front();
+    conn->http_header_done = false;
+    if (conn->http_status >= 400 || conn->http_status == 0) {
+      stats_.RecordError(request.operation);
+      errors_++;
+    } else {
+      stats_.RecordSuccess(request.operation, now - request.start, conn->http_body_size);
+      responses_++;
+    }
+  }
+}
+
+bool Replayer::Flush(Connection* conn) {
+  if (!conn->connected) {
+    return true;
+  }
+
+  while (conn->output_offset < conn->output.size()) {
+    const ssize_t nwrite =
+        write(conn->fd, conn->output.data() + conn->output_offset, conn->output.size() - conn->output_offset);
+    if (nwrite == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return false;
+    }
+    conn->output_offset += nwrite;
+  }
+
+  if (conn->output_offset == conn->output.size()) {
+    conn->output.clear();
+    conn->output_offset = 0;
+  }
+  return true;
+}
+
+void Replayer::UpdateEvents(connection_serial_t serial) {
+  const Connection* conn = connections_[serial].get();
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  if (!conn->connected || conn->output_offset < conn->output.size()) {
+    ev.events |= EPOLLOUT;
+  }
+  ev.data.u64 = serial;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+void Replayer::CheckTimeouts(uint64_t now) {
+  const uint64_t timeout = static_cast<uint64_t>(options_.timeout) * 1000;
+  std::vector<connection_serial_t> expired;
+  for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+    const Connection* conn = it->second.get();
+    uint64_t oldest = conn->connected ? now : conn->connect_start;
+    for (auto pit = conn->pending.begin(); pit != conn->pending.end(); ++pit) {
+      oldest = std::min(oldest, pit->second.start);
+    }
+    if (!conn->http_pending.empty()) {
+      oldest = std::min(oldest, conn->http_pending.front().start);
+    }
+    if (now - oldest >= timeout) {
+      expired.push_back(it->first);
+    }
+  }
+
+  for (size_t i = 0; i < expired.size(); ++i) {
+    Close(expired[i], kTimeoutOperation);
+  }
+}
+
+void Replayer::Report(uint64_t now) {
+  std::cout << (now - start_) / 1000000 << "s frames: " << frames_ << ", responses: " << responses_
+            << ", errors: " << errors_ << ", connections: " << connections_.size() << ", skipped: " << skipped_
+            << std::endl;
+}
+
+// pseudonyms keep identity inside capture, equal pseudonyms land on the same account
+const User& Replayer::MapUser(const std::string& pseudonym) const {
+  return users_[HashString(pseudonym) % users_.size()];
+}
+
+const std::string& Replayer::MapDevice(const User& user, const std::string& pseudonym) const {
+  return user.devices[HashString(pseudonym) % user.devices.size()];
+}
+
+const tools::Channel& Replayer::MapChannel(const User& user, const std::string& stream) const {
+  return channels_[user.channels[HashString(stream) % user.channels.size()]];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << HELP_TEXT << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  base::TrafficCaptureReader reader;
+  common::ErrnoError err = reader.Open(options.capture);
+  if (err) {
+    std::cerr << err->GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<tools::Account> accounts;
+  std::vector<tools::Channel> channels;
+  if (!tools::LoadAccounts(options.mongodb_url, options.users, &accounts, &channels) || accounts.empty()) {
+    std::cerr << "No subscribers with devices and streams found, url: " << options.mongodb_url << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Replayer replayer(options, accounts, channels);
+  const uint64_t start = tools::GetMonotonicUsec();
+  err = replayer.Run(&reader);
+  if (err) {
+    std::cerr << err->GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const double elapsed = static_cast<double>(tools::GetMonotonicUsec() - start) / 1000000;
+  replayer.GetStats().Print(std::cout, elapsed);
+  return EXIT_SUCCESS;
+}